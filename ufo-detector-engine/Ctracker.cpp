@@ -16,10 +16,12 @@ CTracker::CTracker(
       dist_thres(dist_thres_),
       maximum_allowed_skipped_frames(maximum_allowed_skipped_frames_),
       max_trace_length(max_trace_length_),
-	  NextTrackID(0)
+	  NextTrackID(0),
+	  grid(dist_thres_)
 {
     removedTrackWithPositive=false;
     wasBird=false;
+    collectTrackEvents=false;
 }
 // ---------------------------------------------------------------------------
 //
@@ -36,53 +38,16 @@ void CTracker::Update(const std::vector<cv::Point2d>& detections, const std::vec
 		// If no tracks yet
 		for (size_t i = 0; i < detections.size(); ++i)
 		{
-            //tracks.push_back(std::make_unique<CTrack>(detections[i], rects[i], dt, Accel_noise_mag, NextTrackID++));
-            std::unique_ptr<CTrack> track(new CTrack(detections[i], rects[i], dt, Accel_noise_mag, NextTrackID++));
-            tracks.push_back(std::move(track));
+            AddTrack(detections[i], rects[i]);
 		}
 	}
 
-	size_t N = tracks.size();		// треки
-	size_t M = detections.size();	// детекты
-
 	assignments_t assignment; // назначения
+	distMatrix_t assignedCost;
 
 	if (!tracks.empty())
 	{
-		// Матрица расстояний от N-ного трека до M-ного детекта.
-		distMatrix_t Cost(N * M);
-
-		// -----------------------------------
-		// Треки уже есть, составим матрицу расстояний
-		// -----------------------------------
-		switch (distType)
-		{
-		case CentersDist:
-			for (size_t i = 0; i < tracks.size(); i++)
-			{
-				for (size_t j = 0; j < detections.size(); j++)
-				{
-					Cost[i + j * N] = tracks[i]->CalcDist(detections[j]);
-				}
-			}
-			break;
-
-		case RectsDist:
-			for (size_t i = 0; i < tracks.size(); i++)
-			{
-				for (size_t j = 0; j < detections.size(); j++)
-				{
-					Cost[i + j * N] = tracks[i]->CalcDist(rects[j]);
-				}
-			}
-			break;
-		}
-
-		// -----------------------------------
-		// Solving assignment problem (tracks and predictions of Kalman filter)
-		// -----------------------------------
-		AssignmentProblemSolver APS;
-		APS.Solve(Cost, N, M, assignment, AssignmentProblemSolver::optimal);
+		Assign(detections, rects, distType, assignment, assignedCost);
 
 		// -----------------------------------
 		// clean assignment from pairs with large distance
@@ -91,7 +56,7 @@ void CTracker::Update(const std::vector<cv::Point2d>& detections, const std::vec
 		{
 			if (assignment[i] != -1)
 			{
-				if (Cost[i + assignment[i] * N] > dist_thres)
+				if (assignedCost[i] > dist_thres)
 				{
 					assignment[i] = -1;
 					tracks[i]->skipped_frames = 1;
@@ -122,6 +87,7 @@ void CTracker::Update(const std::vector<cv::Point2d>& detections, const std::vec
                         wasBird = false;
                     }
                 }
+				NoteRemovedTrack(*tracks[i]);
 				tracks.erase(tracks.begin() + i);
 				assignment.erase(assignment.begin() + i);
 				i--;
@@ -136,9 +102,7 @@ void CTracker::Update(const std::vector<cv::Point2d>& detections, const std::vec
 	{
         if (find(assignment.begin(), assignment.end(), i) == assignment.end())
 		{
-            //tracks.push_back(std::make_unique<CTrack>(detections[i], rects[i], dt, Accel_noise_mag, NextTrackID++));
-            std::unique_ptr<CTrack> track(new CTrack(detections[i], rects[i], dt, Accel_noise_mag, NextTrackID++));
-            tracks.push_back(std::move(track));
+            AddTrack(detections[i], rects[i]);
 		}
 	}
 
@@ -181,6 +145,7 @@ void CTracker::updateEmpty(){
                 }
             }
             //cout << "Pos: " << tracks[i]->posCounter << " Neg: " << tracks[i]->negCounter << endl;
+            NoteRemovedTrack(*tracks[i]);
             tracks.erase(tracks.begin()+i);
             //assignment.erase(assignment.begin()+i);
             i--;
@@ -188,6 +153,166 @@ void CTracker::updateEmpty(){
         }
     }
 }
+// ---------------------------------------------------------------------------
+// Only track x detection pairs in neighbouring grid cells are candidates, and
+// of these only pairs not farther apart than dist_thres are kept. The kept
+// pairs split tracks and detections into groups that share no pair, and each
+// group is solved on its own, so the solver never sees the full N x M matrix
+// of a crowded frame. Pairs outside the gate can't be assigned.
+// ---------------------------------------------------------------------------
+void CTracker::Assign(const std::vector<cv::Point2d>& detections, const std::vector<cv::Rect>& rects, DistType distType,
+                      assignments_t& assignment, distMatrix_t& assignedCost)
+{
+	const size_t N = tracks.size();
+	const size_t M = detections.size();
+	const bool useRects = (distType == RectsDist);
+
+	assignment.assign(N, -1);
+	assignedCost.assign(N, 0);
+
+	grid.Clear();
+	for (size_t j = 0; j < M; j++)
+	{
+		if (useRects)
+		{
+			grid.Insert(Point_t(static_cast<track_t>(rects[j].x), static_cast<track_t>(rects[j].y)), j);
+		}
+		else
+		{
+			grid.Insert(Point_t(static_cast<track_t>(detections[j].x), static_cast<track_t>(detections[j].y)), j);
+		}
+	}
+
+	// union-find over tracks 0...N-1 and detections N...N+M-1
+	gatedPairs.clear();
+	groupOf.resize(N + M);
+	for (size_t k = 0; k < N + M; k++)
+	{
+		groupOf[k] = k;
+	}
+	for (size_t i = 0; i < N; i++)
+	{
+		candidates.clear();
+		grid.Query(tracks[i]->GatePoint(useRects), candidates);
+
+		for (size_t c = 0; c < candidates.size(); c++)
+		{
+			size_t j = candidates[c];
+			GatedPair pair = { i, j, useRects ? tracks[i]->CalcDist(rects[j]) : tracks[i]->CalcDist(detections[j]) };
+			// neighbouring cells also hold detections outside the gate, they must not join groups
+			if (pair.cost > dist_thres)
+			{
+				continue;
+			}
+			gatedPairs.push_back(pair);
+			size_t a = FindGroup(i);
+			size_t b = FindGroup(N + j);
+			if (a != b)
+			{
+				groupOf[a] = b;
+			}
+		}
+	}
+
+	// local indices of tracks and detections inside their group
+	std::vector<std::vector<size_t> > groupTracks(N + M);
+	std::vector<std::vector<size_t> > groupDetections(N + M);
+	std::vector<size_t> localIndex(N + M);
+	for (size_t i = 0; i < N; i++)
+	{
+		std::vector<size_t>& members = groupTracks[FindGroup(i)];
+		localIndex[i] = members.size();
+		members.push_back(i);
+	}
+	for (size_t j = 0; j < M; j++)
+	{
+		std::vector<size_t>& members = groupDetections[FindGroup(N + j)];
+		localIndex[N + j] = members.size();
+		members.push_back(j);
+	}
+
+	// a pair without a candidate in the group gets a cost the solver avoids and the caller drops
+	const track_t forbidden_dist = dist_thres * 100 + 1;
+	std::vector<distMatrix_t> groupCost(N + M);
+	for (size_t g = 0; g < N + M; g++)
+	{
+		if (!groupTracks[g].empty() && !groupDetections[g].empty())
+		{
+			groupCost[g].assign(groupTracks[g].size() * groupDetections[g].size(), forbidden_dist);
+		}
+	}
+	for (size_t p = 0; p < gatedPairs.size(); p++)
+	{
+		const GatedPair& pair = gatedPairs[p];
+		size_t g = FindGroup(pair.track);
+		groupCost[g][localIndex[pair.track] + localIndex[N + pair.detection] * groupTracks[g].size()] = pair.cost;
+	}
+
+	// -----------------------------------
+	// Solving assignment problem (tracks and predictions of Kalman filter)
+	// -----------------------------------
+	AssignmentProblemSolver APS;
+	assignments_t groupAssignment;
+	for (size_t g = 0; g < N + M; g++)
+	{
+		if (groupCost[g].empty())
+		{
+			continue;
+		}
+		const size_t rows = groupTracks[g].size();
+		groupAssignment.clear();
+		APS.Solve(groupCost[g], rows, groupDetections[g].size(), groupAssignment, AssignmentProblemSolver::optimal);
+		for (size_t r = 0; r < rows; r++)
+		{
+			if (groupAssignment[r] != -1)
+			{
+				size_t i = groupTracks[g][r];
+				assignment[i] = static_cast<int>(groupDetections[g][groupAssignment[r]]);
+				assignedCost[i] = groupCost[g][r + groupAssignment[r] * rows];
+			}
+		}
+	}
+}
+
+// ---------------------------------------------------------------------------
+//
+// ---------------------------------------------------------------------------
+size_t CTracker::FindGroup(size_t node)
+{
+	while (groupOf[node] != node)
+	{
+		groupOf[node] = groupOf[groupOf[node]];
+		node = groupOf[node];
+	}
+	return node;
+}
+
+// ---------------------------------------------------------------------------
+//
+// ---------------------------------------------------------------------------
+void CTracker::AddTrack(const Point_t& detection, const cv::Rect& rect)
+{
+	//tracks.push_back(std::make_unique<CTrack>(detection, rect, dt, Accel_noise_mag, NextTrackID++));
+	std::unique_ptr<CTrack> track(new CTrack(detection, rect, dt, Accel_noise_mag, NextTrackID++));
+	if (collectTrackEvents)
+	{
+		createdTracks.push_back(track->track_id);
+	}
+	tracks.push_back(std::move(track));
+}
+
+// ---------------------------------------------------------------------------
+//
+// ---------------------------------------------------------------------------
+void CTracker::NoteRemovedTrack(const CTrack& track)
+{
+	if (collectTrackEvents)
+	{
+		RemovedTrack removed = { track.track_id, track.posCounter, track.negCounter, track.birdCounter };
+		removedTracks.push_back(removed);
+	}
+}
+
 // ---------------------------------------------------------------------------
 //
 // ---------------------------------------------------------------------------
@@ -1,6 +1,7 @@
 #pragma once
 #include "Kalman.h"
 #include "HungarianAlg.h"
+#include "SpatialGrid.h"
 #include "defines.h"
 #include <iostream>
 #include <vector>
@@ -22,6 +23,9 @@ public:
         negCounter=0;
         posCounter=0;
         birdCounter=0;
+        birdChecks=0;
+        lastCheckWasBird=false;
+        framesWithoutVerdict=0;
 	}
 
 	track_t CalcDist(const Point_t& p)
@@ -48,6 +52,17 @@ public:
 		return sqrtf(dist);
 	}
 
+	// Point which CalcDist compares against the detection point (center or top-left corner).
+	// Its distance to the detection point is a lower bound of CalcDist.
+	Point_t GatePoint(bool useRects) const
+	{
+		if (useRects)
+		{
+			return Point_t(prediction.x - lastRect.width / 2, prediction.y - lastRect.height / 2);
+		}
+		return prediction;
+	}
+
 	void Update(const Point_t& p, const cv::Rect& rect, bool dataCorrect, size_t max_trace_length)
 	{
 		KF.GetPrediction();
@@ -73,6 +88,28 @@ public:
     int posCounter;
     int negCounter;
     int birdCounter;
+    int birdChecks;     // number of finished bird classifications
+    bool lastCheckWasBird;      // verdict of the latest finished bird classification
+    size_t framesWithoutVerdict; // bright frames since the latest finished bird classification
+
+	// Bird classification verdict is settled, no need to classify the object again
+	bool IsKnownBird() const
+	{
+		return birdCounter >= 2;
+	}
+
+	bool IsKnownNonBird() const
+	{
+		return birdCounter == 0 && birdChecks >= 5;
+	}
+
+	// Object may still turn out to be a bird: no verdict yet, or the latest one was a bird.
+	// Gives up after timeoutFrames bright frames without a verdict, e.g. when the classifier is busy.
+	bool AwaitsBirdVerdict(size_t timeoutFrames) const
+	{
+		return !IsKnownBird() && !IsKnownNonBird() && (birdChecks == 0 || lastCheckWasBird)
+			&& framesWithoutVerdict < timeoutFrames;
+	}
 
 	cv::Rect GetLastRect()
 	{
@@ -108,6 +145,25 @@ public:
     bool wasBird;
     void updateEmpty();
 
+	// Assign detections to tracks. Only pairs inside the distance gate are considered.
+	// assignment[i] is the detection of track i or -1, assignedCost[i] its distance.
+	void Assign(const std::vector<cv::Point2d>& detections, const std::vector<cv::Rect>& rects, DistType distType,
+	            assignments_t& assignment, distMatrix_t& assignedCost);
+
+	// Final counters of a removed track
+	struct RemovedTrack
+	{
+		size_t track_id;
+		int posCounter;
+		int negCounter;
+		int birdCounter;
+	};
+
+	// When enabled, created and removed tracks are collected here until the caller clears the lists
+	bool collectTrackEvents;
+	std::vector<size_t> createdTracks;
+	std::vector<RemovedTrack> removedTracks;
+
 private:
 	// Шаг времени опроса фильтра
 	track_t dt;
@@ -123,4 +179,23 @@ private:
     size_t max_trace_length;
 
 	size_t NextTrackID;
+
+	void AddTrack(const Point_t& detection, const cv::Rect& rect);
+	void NoteRemovedTrack(const CTrack& track);
+
+	// Detections bucketed by position, used to only compute distances inside the gate
+	CSpatialGrid grid;
+	std::vector<size_t> candidates;
+
+	// Track x detection pair inside the gate
+	struct GatedPair
+	{
+		size_t track;
+		size_t detection;
+		track_t cost;
+	};
+	std::vector<GatedPair> gatedPairs;
+	std::vector<size_t> groupOf;	// union-find parent of tracks, then detections
+
+	size_t FindGroup(size_t node);
 };
@@ -0,0 +1,67 @@
+#include "SpatialGrid.h"
+#include <cmath>
+
+// ---------------------------------------------------------------------------
+//
+// ---------------------------------------------------------------------------
+CSpatialGrid::CSpatialGrid(track_t cellSize)
+	:
+	m_cellSize(cellSize > 0 ? cellSize : 1)
+{
+}
+
+// ---------------------------------------------------------------------------
+// Empty the cells but keep their storage for the next frame
+// ---------------------------------------------------------------------------
+void CSpatialGrid::Clear()
+{
+	for (auto it = m_cells.begin(); it != m_cells.end(); ++it)
+	{
+		it->second.clear();
+	}
+}
+
+// ---------------------------------------------------------------------------
+//
+// ---------------------------------------------------------------------------
+void CSpatialGrid::Insert(const Point_t& p, size_t index)
+{
+	m_cells[CellKey(CellCoord(p.x), CellCoord(p.y))].push_back(index);
+}
+
+// ---------------------------------------------------------------------------
+//
+// ---------------------------------------------------------------------------
+void CSpatialGrid::Query(const Point_t& p, std::vector<size_t>& candidates) const
+{
+	int cx = CellCoord(p.x);
+	int cy = CellCoord(p.y);
+
+	for (int dy = -1; dy <= 1; ++dy)
+	{
+		for (int dx = -1; dx <= 1; ++dx)
+		{
+			auto it = m_cells.find(CellKey(cx + dx, cy + dy));
+			if (it != m_cells.end())
+			{
+				candidates.insert(candidates.end(), it->second.begin(), it->second.end());
+			}
+		}
+	}
+}
+
+// ---------------------------------------------------------------------------
+//
+// ---------------------------------------------------------------------------
+CSpatialGrid::cellKey_t CSpatialGrid::CellKey(int cx, int cy) const
+{
+	return (static_cast<cellKey_t>(cx) << 32) ^ static_cast<cellKey_t>(static_cast<uint32_t>(cy));
+}
+
+// ---------------------------------------------------------------------------
+//
+// ---------------------------------------------------------------------------
+int CSpatialGrid::CellCoord(track_t v) const
+{
+	return static_cast<int>(std::floor(v / m_cellSize));
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include "defines.h"
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+// --------------------------------------------------------------------------
+// Uniform grid spatial hash. Points are bucketed into square cells whose side
+// is the gating distance, so every point within the gate of a query point is
+// found from the 3x3 block of cells around it.
+// --------------------------------------------------------------------------
+class CSpatialGrid
+{
+public:
+	CSpatialGrid(track_t cellSize);
+
+	void Clear();
+	void Insert(const Point_t& p, size_t index);
+
+	// Append indices of all points stored in cells neighbouring p.
+	// Candidates may be farther than the cell size; exact distance is left to the caller.
+	void Query(const Point_t& p, std::vector<size_t>& candidates) const;
+
+private:
+	typedef int64_t cellKey_t;
+
+	cellKey_t CellKey(int cx, int cy) const;
+	int CellCoord(track_t v) const;
+
+	track_t m_cellSize;
+	std::unordered_map<cellKey_t, std::vector<size_t> > m_cells;
+};
@@ -17,6 +17,7 @@
  */
 
 #include "actualdetector.h"
+#include <cmath>
 
 ActualDetector::ActualDetector(Camera* camera, Config* config, Logger* logger,
     DataManager* dataManager, QObject *parent) :
@@ -25,26 +26,40 @@ ActualDetector::ActualDetector(Camera* camera, Config* config, Logger* logger,
     m_config = config;
     m_logger = logger;
     m_dataManager = dataManager;
-    const QString DETECTION_AREA_FILE = m_config->detectionAreaFile();
-    const QString IMAGEPATH = m_config->resultImageDir() + "/";
-    m_willSaveImages = m_config->saveResultImages();
-    m_cameraWidth = m_config->cameraWidth();
-    m_cameraHeight = m_config->cameraHeight();
-    m_willRecordWithRect = m_config->resultVideoWithObjectRectangles();
+    m_configSnapshot = m_config->snapshot();
+    const ConfigSnapshot& settings = *m_configSnapshot;
+    const QString DETECTION_AREA_FILE = settings.m_detectionAreaFile;
+    const QString IMAGEPATH = settings.m_resultImageDir + "/";
+    m_willSaveImages = settings.m_saveResultImages;
+    m_cameraWidth = settings.m_cameraWidth;
+    m_cameraHeight = settings.m_cameraHeight;
+    m_willRecordWithRect = settings.m_resultVideoWithObjectRectangles;
     m_isMainThreadRunning = false;
+    m_runState = Stopped;
+    m_detectionQueue = NULL;
+    m_frameIndex = 0;
     m_showCameraVideo = false;
     m_startedRecording = false;
+    m_isInNightMode = false;
+    m_useCoarseMotion = false;
+    m_motionModelType = settings.m_motionModel;
+    m_nightCheckFrameRequested = false;
+    m_darknessChanged = false;
+    m_isDark = false;
+    m_ambientLevel = 0;
 
     m_detectionAreaFile = DETECTION_AREA_FILE.toStdString();
     m_resultImageDirNameBase = IMAGEPATH.toStdString();
 
-    setNoiseLevel(m_config->noiseFilterPixelSize());
-    setThresholdLevel(m_config->motionThreshold());
+    setNoiseLevel(settings.m_noiseFilterPixelSize);
+    setThresholdLevel(settings.m_motionThreshold);
 
     m_recorder = new Recorder(m_camPtr, m_config, m_logger, m_dataManager);
+    m_birdClassifier = new BirdClassifier(this);
+    m_imageWriter.reset(new ResultImageWriter());
 
     state = new DetectorState(this, m_recorder);
-    state->MIN_POS_REQUIRED = m_config->minPositiveDetections();
+    state->MIN_POS_REQUIRED = settings.m_minPositiveDetections;
     connect(state, SIGNAL(sendOutputText(QString)), this, SIGNAL(broadcastOutputText(QString)));
     //qDebug() << "ActualDetector constructed";
 }
@@ -57,38 +72,35 @@ ActualDetector::~ActualDetector()
 
 bool ActualDetector::initialize()
 {
+    updateSettings();
     if (!initDetectionArea()){
         return false;
     }
-    state->resetState();
-
-    m_prevFrame = m_camPtr->getWebcamFrame();
-    m_resultFrame = m_prevFrame;
-    m_currentFrame = m_camPtr->getWebcamFrame();
-    m_nextFrame = m_camPtr->getWebcamFrame();
-    cvtColor(m_currentFrame, m_currentFrame, CV_RGB2GRAY);
-    cvtColor(m_prevFrame, m_prevFrame, CV_RGB2GRAY);
-    cvtColor(m_nextFrame, m_nextFrame, CV_RGB2GRAY);
-
-    m_minAmountOfMotion = 2;
-    m_maxDeviation = 20;
-    m_imageCount = 0;
-    m_savedImageExtension =".jpg";
 
+    std::vector<CameraFrame> initialFrames;
+    quint64 frameSequence = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        initialFrames.push_back(m_camPtr->waitNextFrame(frameSequence));
+    }
+    initializeDetection(initialFrames);
 
-    m_willParseRectangle = false;
     if(m_willSaveImages)
     {
-        string dateTime=QDateTime::currentDateTime().toString("yyyy-MM-dd--hh-mm-ss").toStdString();
-        QDir dir = QDir::root();
-        dir.mkpath(QString::fromStdString(m_resultImageDirNameBase + dateTime));
-        m_resultImageDirName = m_resultImageDirNameBase + dateTime +"/image";
-        m_pathNameThresh = m_resultImageDirName + "Thresh";
+        // one archive file per session instead of a folder with a file per image
+        QString dateTime=QDateTime::currentDateTime().toString("yyyy-MM-dd--hh-mm-ss");
+        QString archiveFileName = QString::fromStdString(m_resultImageDirNameBase) + dateTime + "." + CropArchive::FILE_SUFFIX;
+        QDir::root().mkpath(QFileInfo(archiveFileName).absolutePath());
+        if (!m_imageWriter->openArchive(archiveFileName))
+        {
+            emit broadcastOutputText(tr("WARNING: could not create result image file %1").arg(archiveFileName));
+        }
+        m_imageWriter->start();
     }
 
     m_isInNightMode = false;
     m_isCascadeFound = true;
-    if (!m_birdsCascade.load(m_config->birdClassifierTrainingFile().toStdString()))
+    if (!m_birdClassifier->init(m_configSnapshot->m_birdClassifierTrainingFile.toStdString(), CLASSIFIER_DIMENSION_SIZE))
     {
         auto output_text = tr("WARNING: could not load bird detection data (cascade classifier file)");
         //qWarning() << output_text;
@@ -97,16 +109,67 @@ bool ActualDetector::initialize()
         m_isCascadeFound = false;
     }
 
+    if (!m_brightnessThresholds.load(m_configSnapshot->m_brightnessThresholds))
+    {
+        m_brightnessThresholds.reset();
+        emit broadcastOutputText(tr("WARNING: invalid brightness thresholds in settings, using defaults"));
+    }
+
+    if (m_sessionRecorder)
+    {
+        startSessionRecording(initialFrames);
+    }
+
+    if (m_eventLog && !m_eventLog->start(m_eventLogFileName))
+    {
+        emit broadcastOutputText(tr("WARNING: could not write detection events to %1").arg(m_eventLogFileName));
+    }
+    state->tracker.collectTrackEvents = m_eventLog && m_eventLog->isRunning();
+
     //qDebug() << "Initialized ActualDetector";
-    this_thread::sleep_for(std::chrono::seconds(1));
-    m_startedRecording = false;
+    return true;
+}
+
+void ActualDetector::initializeDetection(const std::vector<CameraFrame> &initialFrames)
+{
+    m_regionMask = Mat(m_cameraHeight, m_cameraWidth, CV_8UC1, Scalar(0));
+    for (unsigned int i = 0; i < m_region.size(); i++)
+    {
+        m_regionMask.at<uchar>(m_region[i]) = 255;
+    }
+    std::atomic_store(&m_activeRegionMask, std::shared_ptr<const Mat>(new Mat(m_regionMask)));
+    m_ambientBrightness.setRegion(m_region, Size(m_cameraWidth, m_cameraHeight));
+    m_isDark = false;
+    m_ambientLevel = 0;
+    m_darknessChanged = false;
+    state->resetState();
+
+    CameraFrame firstFrame = initialFrames[0];
+    m_resultFrame = firstFrame.bgr();
+    m_prevFrame = firstFrame.gray();
+    m_currentFrame = CameraFrame(initialFrames[1]).gray();
+    m_nextFrame = CameraFrame(initialFrames[2]).gray();
+
+    m_motionModel.reset(MotionModel::create(m_motionModelType));
+    m_motionModel->apply(m_prevFrame, m_thresholdLevel, m_motion);
+    m_motionModel->apply(m_currentFrame, m_thresholdLevel, m_motion);
+    m_motionModel->apply(m_nextFrame, m_thresholdLevel, m_motion);
+    initCoarseMotion({m_prevFrame, m_currentFrame, m_nextFrame});
+    m_objectDetector.reset(new CDetector(m_currentFrame));
 
+    m_minAmountOfMotion = 2;
+    m_maxDeviation = 20;
+    m_counterNoMotion = 0;
+    m_counterBlackDetector = 0;
+    m_counterLight = 0;
+    m_centers.clear();
+    m_willParseRectangle = false;
+    m_startedRecording = false;
+    m_frameIndex = 0;
 
     m_rect = Rect(Point(0,0),Point(m_cameraWidth,m_cameraHeight));
     m_treshImg = m_resultFrame.clone();
     m_treshImg.setTo(Scalar(0,0,0));
-
-    return true;
 }
 
 /*
@@ -114,227 +177,333 @@ bool ActualDetector::initialize()
  */
 void ActualDetector::detectingThread()
 {    
-    Mat tempImage;
-    int counterNoMotion = 0;
-    int counterBlackDetecor = 0;
-    int counterLight = 0;
-    bool isPositiveRectangle;
-    int threadYieldPauseUsec = 1000;
-    int numberOfChanges = 0;
+    CameraFrame cameraFrame;
+    quint64 frameSequence = 0;
+    quint64 previousSequence = 0;
     int frameCount = 0;
-    int framesInFpsMeasurement = OUTPUT_FPS * 10;
+    int framesInFpsMeasurement = Recorder::DEFAULT_FRAME_RATE * 10;
     bool fpsMeasurementDone = false;
-    QTime fpsMeasurementTimer;
-
-    CDetector* detector=new CDetector(m_currentFrame);
-    vector<Point2d> centers;
-    Scalar Colors[]={Scalar(255,0,0),Scalar(0,255,0),Scalar(0,0,255),Scalar(255,255,0),Scalar(0,255,255),Scalar(255,0,255),Scalar(255,127,255),Scalar(127,0,255),Scalar(127,0,127)};
-    pair < vector<Point2d>,vector<Rect> > centerAndRectPair;
 
     m_logger->print("ActualDetector::detectingThread() started");
-
-    fpsMeasurementTimer.start();
+    setRunState(Running);
 
     while (m_isMainThreadRunning)
     {
-        m_prevFrame = m_currentFrame;
-        m_currentFrame = m_nextFrame;
-        tempImage = m_camPtr->getWebcamFrame();
+        // sleeps until the camera delivers the next frame
+        cameraFrame = m_camPtr->waitNextFrame(frameSequence);
+        if (cameraFrame.empty())
+        {
+            continue;
+        }
+        if ((previousSequence > 0) && (frameSequence > previousSequence + 1))
+        {
+            Metrics::instance().count(Metrics::FramesMissed, frameSequence - previousSequence - 1);
+        }
+        previousSequence = frameSequence;
         frameCount++;
         if (!fpsMeasurementDone && (frameCount >= framesInFpsMeasurement)) {
-            float fps = ((float)frameCount / (float)fpsMeasurementTimer.elapsed()) * (float)1000;
-            m_logger->print("ActualDetector reading " + QString::number(fps) + " FPS on average");
+            m_logger->print("ActualDetector camera delivers " + QString::number(m_camPtr->frameRate()) + " FPS");
             fpsMeasurementDone = true;
         }
+        if (m_sessionRecorder && m_sessionRecorder->isRecording())
+        {
+            m_sessionRecorder->addFrame(cameraFrame.bgr());
+        }
 
-        m_nextFrame = tempImage.clone();
-        m_resultFrame = m_nextFrame;
-        cvtColor(m_nextFrame, m_nextFrame, CV_RGB2GRAY);
+        if (m_detectionQueue)
+        {
+            m_detectionQueue->run([this, &cameraFrame]() { processFrame(cameraFrame); });
+        }
+        else
+        {
+            processFrame(cameraFrame);
+        }
+    }
+    m_logger->print("ActualDetector::detectingThread() finished");
+}
 
-        absdiff(m_prevFrame, m_nextFrame, m_d1);
-        absdiff(m_currentFrame, m_nextFrame, m_d2);
-        bitwise_and(m_d1, m_d2, m_motion);
-        threshold(m_motion, m_motion, m_thresholdLevel, 255, CV_THRESH_BINARY);
+/*
+ * Everything done for one camera frame. Doesn't depend on wall clock time,
+ * so replaying recorded frames gives the same results.
+ */
+int ActualDetector::processFrame(CameraFrame &cameraFrame)
+{
+    static const Scalar Colors[]={Scalar(255,0,0),Scalar(0,255,0),Scalar(0,0,255),Scalar(255,255,0),Scalar(0,255,255),Scalar(255,0,255),Scalar(255,127,255),Scalar(127,0,255),Scalar(127,0,127)};
+    pair < vector<Point2d>,vector<Rect> > centerAndRectPair;
+    bool isPositiveRectangle;
+    int numberOfChanges = 0;
+    int positives = 0;
+    int negatives = 0;
+    const quint64 frameIndex = m_frameIndex++;
+    updateSettings();
+    MetricsScopedTimer frameTimer(Metrics::FrameStage);
+
+    MetricsScopedTimer grayFrameTimer(Metrics::GrayFrameStage);
+    m_resultFrame = cameraFrame.bgr();
+    m_prevFrame = m_currentFrame;
+    m_currentFrame = m_nextFrame;
+    m_nextFrame = cameraFrame.gray();
+    grayFrameTimer.stop();
+    provideNightCheckFrame(m_nextFrame);
+    if (m_ambientBrightness.update(m_nextFrame))
+    {
+        m_isDark = m_ambientBrightness.isNight();
+        m_isInNightMode = m_isDark || !m_isCascadeFound;
+        std::lock_guard<std::mutex> lock(m_nightCheckMutex);
+        m_darknessChanged = true;
+        m_nightCheckCondition.notify_all();
+    }
+    m_ambientLevel = m_ambientBrightness.averageBrightness();
 
-        erode(m_motion, m_motion, m_noiseLevel);
+    Rect motionArea(0, 0, m_nextFrame.cols, m_nextFrame.rows);
+    if (m_useCoarseMotion)
+    {
+        MetricsScopedTimer coarseMotionTimer(Metrics::CoarseMotionStage);
+        motionArea = findCoarseMotionArea(cameraFrame);
+    }
+    MetricsScopedTimer motionMaskTimer(Metrics::MotionMaskStage);
+    m_motionModel->apply(m_nextFrame, m_thresholdLevel, m_motion, motionArea);
 
-        numberOfChanges = detectMotion(m_motion, m_resultFrame, m_resultFrameCropped, m_region, m_maxDeviation);
+    if (motionArea.area() > 0)
+    {
+        Mat motionInArea = m_motion(motionArea);
+        erode(motionInArea, motionInArea, m_noiseLevel);
+        motionMaskTimer.stop();
+
+        // night checker may have published a new region since the last frame
+        std::shared_ptr<const Mat> regionMask = std::atomic_load(&m_activeRegionMask);
+        MetricsScopedTimer detectMotionTimer(Metrics::DetectMotionStage);
+        numberOfChanges = detectMotion(m_motion, motionArea, m_resultFrame, m_resultFrameCropped, *regionMask, m_maxDeviation);
+    }
+    else
+    {
+        motionMaskTimer.stop();
+        numberOfChanges = 0;
+    }
 
-        if(numberOfChanges>=m_minAmountOfMotion)
+    if(numberOfChanges>=m_minAmountOfMotion)
+    {
+        MetricsScopedTimer detectTimer(Metrics::DetectStage);
+        centerAndRectPair = m_objectDetector->Detect(m_treshImg,m_rect);
+        detectTimer.stop();
+        m_centers = centerAndRectPair.first;
+        m_detectorRectVec = centerAndRectPair.second;
+        m_counterNoMotion=0;
+        if(m_centers.size()>0)
         {
-            centerAndRectPair = detector->Detect(m_treshImg,m_rect);
-            centers = centerAndRectPair.first;
-            m_detectorRectVec = centerAndRectPair.second;
-            counterNoMotion=0;
-            if(centers.size()>0)
-            {
-                state->tracker.Update(centers,m_detectorRectVec,CTracker::RectsDist);
-            }
-            //loop through detected objects
-            if (m_detectorRectVec.size()<  MAX_OBJECTS_IN_FRAME)
+            MetricsScopedTimer trackerTimer(Metrics::TrackerUpdateStage);
+            state->tracker.Update(m_centers,m_detectorRectVec,CTracker::RectsDist);
+        }
+        logTrackEvents();
+        applyBirdClassificationResults();
+        //loop through detected objects
+        if (m_detectorRectVec.size()<  MAX_OBJECTS_IN_FRAME)
+        {
+            isPositiveRectangle=false;
+            for ( unsigned int i=0;i<m_detectorRectVec.size();i++)
             {
-                isPositiveRectangle=false;
-                for ( unsigned int i=0;i<m_detectorRectVec.size();i++)
+                Rect croppedRectangle = m_detectorRectVec[i];
+                Mat croppedImage = m_resultFrame(croppedRectangle);
+                Mat croppedImageGray;
+                CTrack* track = state->tracker.tracks[i].get();
+                //+++check if there was light in object
+                MetricsScopedTimer lightDetectionTimer(Metrics::LightDetectionStage);
+                bool isBright = lightDetection(croppedRectangle,croppedImage,croppedImageGray);
+                lightDetectionTimer.stop();
+                if(isBright)
                 {
-                    Rect croppedRectangle = m_detectorRectVec[i];
-                    Mat temp = m_resultFrame(croppedRectangle);
-                    Mat croppedImage = temp.clone();
-                    //+++check if there was light in object
-                    if(lightDetection(croppedRectangle,croppedImage))
+                    //object was bright
+                    if (!m_isInNightMode && track->IsKnownBird())
                     {
-                        //object was bright
-                        if (!m_isInNightMode && checkIfBird())
+                        track->birdCounter++;
+                    }
+                    else if (!m_isInNightMode && track->AwaitsBirdVerdict(BIRD_VERDICT_TIMEOUT_FRAMES))
+                    {
+                        // not counted as positive before the verdict, which arrives on a later frame
+                        track->framesWithoutVerdict++;
+                        m_birdClassifier->requestClassification(track->track_id, croppedImageGray);
+                    }
+                    else
+                    {//+++ not in night mode or was not a bird*/
+                        if (!m_isInNightMode && !track->IsKnownNonBird())
                         {
-                            state->tracker.tracks[i]->birdCounter++;
+                            // verdict arrives on a later frame
+                            m_birdClassifier->requestClassification(track->track_id, croppedImageGray);
                         }
-                        else
-                        {//+++ not in night mode or was not a bird*/
-                            counterLight++;
-                            if(counterLight>2)counterBlackDetecor=0;
-                            if(counterBlackDetecor<5)
+                        m_counterLight++;
+                        if(m_counterLight>2)m_counterBlackDetector=0;
+                        if(m_counterBlackDetector<5)
+                        {
+                            emit checkPlane();
+                            if(!m_startedRecording)
                             {
-                                emit checkPlane();
-                                if(!m_startedRecording)
+                                Mat tempImg = m_resultFrame.clone();
+                                rectangle(tempImg,croppedRectangle,Scalar(255,0,0),1);
+                                m_recorder->startRecording(tempImg);
+                                if(m_willRecordWithRect) m_willParseRectangle=true;
+                                m_startedRecording=true;
+                                auto output_text = tr("Positive detection - starting video recording");
+                                emit broadcastOutputText(output_text);
+                                if (m_eventLog)
                                 {
-                                    Mat tempImg = m_resultFrame.clone();
-                                    rectangle(tempImg,croppedRectangle,Scalar(255,0,0),1);
-                                    m_recorder->startRecording(tempImg);
-                                    if(m_willRecordWithRect) m_willParseRectangle=true;
-                                    m_startedRecording=true;
-                                    auto output_text = tr("Positive detection - starting video recording");
-                                    emit broadcastOutputText(output_text);
+                                    m_eventLog->add(DetectionEvent::create(DetectionEvent::RecordingStarted, frameIndex));
                                 }
+                            }
 
-                                if(m_willParseRectangle)
-                                {
-                                    isPositiveRectangle=true;
-                                }
-                                state->negAndNoMotionCounter=0;
-                                state->posCounter++;
-                                state->tracker.tracks[i]->posCounter++;
-                                emit positiveMessage();
+                            if(m_willParseRectangle)
+                            {
+                                isPositiveRectangle=true;
+                            }
+                            state->negAndNoMotionCounter=0;
+                            state->posCounter++;
+                            track->posCounter++;
+                            positives++;
+                            emit positiveMessage();
 
-                                if(m_willSaveImages)
-                                {
-                                    saveImg(m_resultImageDirName, croppedImage);
-                                    m_imageCount++;
-                                    //saveImg(pathnameThresh, treshImg);
-                                }
+                            if(m_willSaveImages)
+                            {
+                                saveImg(croppedRectangle, track->track_id, isBright);
                             }
                         }
                     }
+                }
 
-                    else { //+++motion has black pixel
-                        counterBlackDetecor++;
-                        counterLight=0;
-                        state->tracker.tracks[i]->negCounter++;
+                else { //+++motion has black pixel
+                    m_counterBlackDetector++;
+                    m_counterLight=0;
+                    track->negCounter++;
+                    negatives++;
 
-                        if (m_startedRecording)
-                        {
-                            state->negAndNoMotionCounter++;
-                        }
-                        emit negativeMessage();
+                    if (m_startedRecording)
+                    {
+                        state->negAndNoMotionCounter++;
                     }
+                    emit negativeMessage();
                 }
-                if(m_willParseRectangle)
-                {
-                    m_recorder->setRectangle(m_rect,isPositiveRectangle);
-                }
-
             }
-        }
-        else
-        { //+++no motion detected
-            counterLight=0;
-            counterBlackDetecor=0;
-            counterNoMotion++;
-            if (m_startedRecording)
+            if(m_willParseRectangle)
             {
-                state->negAndNoMotionCounter++;
+                m_recorder->setRectangle(m_rect,isPositiveRectangle);
             }
-            state->tracker.updateEmpty();
-            centers.clear();
-            m_detectorRectVec.clear();
-            if ((m_startedRecording && counterNoMotion > 150) || (state->negAndNoMotionCounter > 700))
+
+        }
+    }
+    else
+    { //+++no motion detected
+        m_counterLight=0;
+        m_counterBlackDetector=0;
+        m_counterNoMotion++;
+        if (m_startedRecording)
+        {
+            state->negAndNoMotionCounter++;
+        }
+        MetricsScopedTimer trackerTimer(Metrics::TrackerUpdateStage);
+        state->tracker.updateEmpty();
+        trackerTimer.stop();
+        logTrackEvents();
+        m_centers.clear();
+        m_detectorRectVec.clear();
+        if ((m_startedRecording && m_counterNoMotion > 150) || (state->negAndNoMotionCounter > 700))
+        {
+            DetectorState::DetectionResult result = state->finishRecording();
+            if (m_startedRecording)
             {
-                state->finishRecording();
-                state->resetState();
-                m_willParseRectangle=false;
-                m_startedRecording=false;
+                logRecordingFinished(DetectorState::resultName(result), state->willSaveVideo(result));
             }
+            state->resetState();
+            m_willParseRectangle=false;
+            m_startedRecording=false;
         }
+    }
 
-        // check if there was a plane
-        if (state->numberOfPlanes && state->numberOfPlanes >= centers.size()){
-            state->wasPlane = true;
-        }
+    // check if there was a plane
+    if (state->numberOfPlanes && state->numberOfPlanes >= m_centers.size()){
+        state->wasPlane = true;
+    }
+
+    // frames without motion are not logged, they would be most of the log
+    if (m_eventLog && (numberOfChanges > 0))
+    {
+        DetectionEvent event = DetectionEvent::create(DetectionEvent::Frame, frameIndex);
+        event.m_motionPixels = numberOfChanges;
+        event.m_objects = (int)m_centers.size();
+        event.m_positives = positives;
+        event.m_negatives = negatives;
+        event.m_ambientLevel = m_ambientLevel;
+        event.m_isNight = m_isDark;
+        m_eventLog->add(event);
+    }
 
-        if (m_showCameraVideo && centers.size() < MAX_OBJECTS_IN_FRAME )
+    if (m_showCameraVideo && m_centers.size() < MAX_OBJECTS_IN_FRAME )
+    {
+        Mat cameraView = cameraFrame.rgb();
+        if(m_centers.size()>0)
         {
-            for(unsigned int i=0; i<centers.size(); i++)
-            {
-                //rectangle(result,detectorRectVec[i],color,1);
-                circle(m_resultFrame,centers[i],3,Scalar(0,255,0),1,CV_AA);
-                // stringstream ss;
-                // char str[256] = "";
-                // snprintf(str, sizeof(str), "%zu", tracker.tracks[i]->track_id);
-                // ss << str << " P: " << tracker.tracks[i]->posCounter << " N: " << tracker.tracks[i]->negCounter;
-                // putText(result,ss.str(),centers[i],CV_FONT_HERSHEY_PLAIN,2, CV_RGB(250,0,0));
-            }
-            if(centers.size()>0)
+            // the frame is shared with the recorder and the main window
+            cameraView = cameraView.clone();
+        }
+        for(unsigned int i=0; i<m_centers.size(); i++)
+        {
+            //rectangle(result,detectorRectVec[i],color,1);
+            circle(cameraView,m_centers[i],3,Scalar(0,255,0),1,CV_AA);
+            // stringstream ss;
+            // char str[256] = "";
+            // snprintf(str, sizeof(str), "%zu", tracker.tracks[i]->track_id);
+            // ss << str << " P: " << tracker.tracks[i]->posCounter << " N: " << tracker.tracks[i]->negCounter;
+            // putText(result,ss.str(),m_centers[i],CV_FONT_HERSHEY_PLAIN,2, CV_RGB(250,0,0));
+        }
+        if(m_centers.size()>0)
+        {
+            for(unsigned int i=0;i<state->tracker.tracks.size();i++)
             {
-                for(unsigned int i=0;i<state->tracker.tracks.size();i++)
+                if(!state->tracker.tracks[i]->trace.empty())
                 {
-                    if(!state->tracker.tracks[i]->trace.empty())
+                    for(unsigned int j=0;j<state->tracker.tracks[i]->trace.size()-1;j++)
                     {
-                        for(unsigned int j=0;j<state->tracker.tracks[i]->trace.size()-1;j++)
-                        {
-                            line(m_resultFrame,state->tracker.tracks[i]->trace[j],state->tracker.tracks[i]->trace[j+1],Colors[state->tracker.tracks[i]->track_id%9],2,CV_AA);
-                        }
+                        // Colors are in BGR order
+                        const Scalar& color = Colors[state->tracker.tracks[i]->track_id%9];
+                        line(cameraView,state->tracker.tracks[i]->trace[j],state->tracker.tracks[i]->trace[j+1],Scalar(color[2],color[1],color[0]),2,CV_AA);
                     }
                 }
             }
-
-            cv::cvtColor(m_resultFrame, m_resultFrame, CV_BGR2RGB);
-            m_cameraViewImage = QImage((uchar*)m_resultFrame.data, m_resultFrame.cols, m_resultFrame.rows, m_resultFrame.step, QImage::Format_RGB888);
-            emit updatePixmap(m_cameraViewImage.copy());
         }
-        // give chance to other threads to run
-        std::this_thread::yield();
-        std::this_thread::sleep_for(std::chrono::microseconds(threadYieldPauseUsec));
+
+        m_cameraViewImage = QImage((uchar*)cameraView.data, cameraView.cols, cameraView.rows, cameraView.step, QImage::Format_RGB888);
+        emit updatePixmap(m_cameraViewImage.copy());
     }
-    m_logger->print("ActualDetector::detectingThread() finished");
-    delete detector;    
+    return numberOfChanges;
 }
 
 /*
  * Check if there was motion between frames. Return the AmountOfMotion detected
  */
-inline int ActualDetector::detectMotion(const Mat & motion, Mat & result, Mat & result_cropped,vector<Point> & region,int max_deviation)
+int ActualDetector::detectMotion(const Mat & motion, const Rect & area, Mat & result, Mat & result_cropped, const Mat & regionMask, int max_deviation)
 {
-    // calculate the standard deviation
-    Scalar mean, stddev;
-    meanStdDev(motion, mean, stddev);
+    // the mask is 0 or 255 and 0 outside the area, so the standard deviation
+    // of the whole mask follows from the changed pixels inside the area
+    double changedFraction = (double)countNonZero(motion(area)) / (double)motion.total();
+    double stddev = 255.0 * std::sqrt(changedFraction * (1.0 - changedFraction));
     // if not to much changes then the motion is real
-    if(stddev[0] < max_deviation)
+    if(stddev < max_deviation)
     {
         int number_of_changes = 0;
         int min_x = motion.cols, max_x = 0;
         int min_y = motion.rows, max_y = 0;
-        // loop over image and detect changes
-        int x, y, size = region.size();
-
-        for(int i = 0; i < size; i++)
-        { // loop over region
-            x = region[i].x;
-            y = region[i].y;
-            if(static_cast<int>(motion.at<uchar>(y,x)) == 255)
+        // loop over the area and detect changes in the region
+        for(int y = area.y; y < area.y + area.height; y++)
+        {
+            const uchar* motionRow = motion.ptr<uchar>(y);
+            const uchar* regionRow = regionMask.ptr<uchar>(y);
+            for(int x = area.x; x < area.x + area.width; x++)
             {
-                number_of_changes++;
-                if(min_x>x) min_x = x;
-                if(max_x<x) max_x = x;
-                if(min_y>y) min_y = y;
-                if(max_y<y) max_y = y;
+                if((motionRow[x] == 255) && (regionRow[x] != 0))
+                {
+                    number_of_changes++;
+                    if(min_x>x) min_x = x;
+                    if(max_x<x) max_x = x;
+                    if(min_y>y) min_y = y;
+                    if(max_y<y) max_y = y;
+                }
             }
         }
         if(number_of_changes)
@@ -364,6 +533,57 @@ inline int ActualDetector::detectMotion(const Mat & motion, Mat & result, Mat &
     return 0;
 }
 
+void ActualDetector::initCoarseMotion(const std::vector<Mat> &grayFrames)
+{
+    m_useCoarseMotion = !grayFrames.empty() && (grayFrames.back().cols >= COARSE_MOTION_MIN_WIDTH);
+    if (!m_useCoarseMotion)
+    {
+        m_coarseBrightMotionModel.reset();
+        m_coarseDarkMotionModel.reset();
+        return;
+    }
+
+    // a coarse pixel is in the detection area if any of its pixels is
+    CameraFrame::downscaleGrayExtremes(m_regionMask, COARSE_MOTION_SCALE, m_coarseRegionMask, m_coarseDarkest);
+
+    m_coarseBrightMotionModel.reset(MotionModel::create(m_motionModelType));
+    m_coarseDarkMotionModel.reset(MotionModel::create(m_motionModelType));
+    for (unsigned int i = 0; i < grayFrames.size(); i++)
+    {
+        CameraFrame::downscaleGrayExtremes(grayFrames[i], COARSE_MOTION_SCALE, m_coarseBrightest, m_coarseDarkest);
+        m_coarseBrightMotionModel->apply(m_coarseBrightest, m_thresholdLevel, m_coarseMotion);
+        m_coarseDarkMotionModel->apply(m_coarseDarkest, m_thresholdLevel, m_coarseDarkMotion);
+    }
+}
+
+/*
+ * Averaging 4x4 pixels would leave an object of 2x2 pixels 1/16 of its contrast, so the coarse frames
+ * keep the brightest and the darkest pixel of each block instead: bright and dark objects of any size
+ * keep their contrast. The threshold is lowered as the extreme pixel of a block is already above or
+ * below the average by the noise. Motion is then searched at full resolution only around the coarse motion.
+ */
+Rect ActualDetector::findCoarseMotionArea(CameraFrame &frame)
+{
+    const int coarseThreshold = std::max(2, m_thresholdLevel / 2);
+    m_coarseBrightMotionModel->apply(frame.downscaledGrayMax(COARSE_MOTION_SCALE), coarseThreshold, m_coarseMotion);
+    m_coarseDarkMotionModel->apply(frame.downscaledGrayMin(COARSE_MOTION_SCALE), coarseThreshold, m_coarseDarkMotion);
+    bitwise_or(m_coarseMotion, m_coarseDarkMotion, m_coarseMotion);
+    bitwise_and(m_coarseMotion, m_coarseRegionMask, m_coarseMotion);
+
+    if (countNonZero(m_coarseMotion) == 0)
+    {
+        return Rect();
+    }
+    vector<Point> coarsePoints;
+    findNonZero(m_coarseMotion, coarsePoints);
+    Rect coarseArea = boundingRect(coarsePoints);
+    Rect area(coarseArea.x * COARSE_MOTION_SCALE - COARSE_MOTION_PADDING,
+              coarseArea.y * COARSE_MOTION_SCALE - COARSE_MOTION_PADDING,
+              coarseArea.width * COARSE_MOTION_SCALE + 2 * COARSE_MOTION_PADDING,
+              coarseArea.height * COARSE_MOTION_SCALE + 2 * COARSE_MOTION_PADDING);
+    return area & Rect(Point(0, 0), frame.size());
+}
+
 bool ActualDetector::initDetectionArea() {
 
     bool readOk = m_dataManager->readDetectionAreaFile(true);
@@ -371,7 +591,7 @@ bool ActualDetector::initDetectionArea() {
         return false;
     }
     int size = 0;
-    QRect cameraRect(0, 0, m_config->cameraWidth(), m_config->cameraHeight());
+    QRect cameraRect(0, 0, m_configSnapshot->m_cameraWidth, m_configSnapshot->m_cameraHeight);
 
     QList<QPolygon*> polygonList = m_dataManager->detectionArea();
     QListIterator<QPolygon*> polygonListIt(polygonList);
@@ -401,53 +621,43 @@ bool ActualDetector::initDetectionArea() {
 /*
  * Check if an object is bright. I.e. object has more bright pixels than dark pixels
  */
-bool ActualDetector::lightDetection(Rect &rectangle, Mat &croppedImage)
+bool ActualDetector::lightDetection(Rect &rectangle, Mat &croppedImage, Mat &croppedImageGray)
 {
     bool objectHasLight=false;
 
-    vector<cv::Point> detectionRegion;
-
-    int lightCounter=0;
-    int blackCounter=0;
-    Mat croppedImageThreshTemp, croppedImageThresh;
-    croppedImageThreshTemp = m_motion(rectangle);
-    croppedImageThreshTemp.copyTo(croppedImageThresh);
-    cvtColor(croppedImage, m_croppedImageGray , CV_RGB2GRAY);
+    Mat croppedImageThresh = m_motion(rectangle);
+    // gray frame is not modified after this frame, so the classifier may keep the reference
+    croppedImageGray = m_nextFrame(rectangle);
 
     int light=0;
     int totalLight=0;
     bool wasDark=false;
 
-    for(int y = 0; y < croppedImage.rows; y++)
+    //single pass: brightness of the whole object image and histogram of the motion pixels
+    int histogram[256] = {0};
+    for(int y = 0; y < croppedImageGray.rows; y++)
     {
-        for(int x = 0; x < croppedImage.cols; x++)
+        const uchar* grayRow = croppedImageGray.ptr<uchar>(y);
+        const uchar* threshRow = croppedImageThresh.ptr<uchar>(y);
+        for(int x = 0; x < croppedImageGray.cols; x++)
         {
-            light+=static_cast<int>(m_croppedImageGray.at<uchar>(y,x));
-            if(static_cast<int>(croppedImageThresh.at<uchar>(y,x)) == 255)
-            {
-                Point2f p(x,y);
-                detectionRegion.push_back(p);
-            }
+            light+=grayRow[x];
+            histogram[grayRow[x]]+=(threshRow[x] == 255);
         }
     }
 
-    totalLight=light/(croppedImage.cols*croppedImage.rows);
-    pair<int,int> minAndMaxLight = checkBrightness(totalLight);
-
-    int x, y, size = detectionRegion.size();
-    for(int j = 0; j < size; j++)
+    //histogram[i] becomes the number of motion pixels with brightness <= i
+    for(int i = 1; i < 256; i++)
     {
-        x = detectionRegion[j].x;
-        y = detectionRegion[j].y;
-        if(static_cast<int>(m_croppedImageGray.at<uchar>(y,x)) > minAndMaxLight.first)
-        {
-            lightCounter++;
-        }
-        if(static_cast<int>(m_croppedImageGray.at<uchar>(y,x)) < minAndMaxLight.second)
-        {
-            blackCounter++;
-        }
+        histogram[i]+=histogram[i-1];
     }
+    int size = histogram[255];
+
+    totalLight=light/(croppedImage.cols*croppedImage.rows);
+    BrightnessThresholds thresholds = m_brightnessThresholds.lookup(totalLight);
+
+    int lightCounter = size - histogram[thresholds.minLight];
+    int blackCounter = thresholds.minBlack > 0 ? histogram[thresholds.minBlack - 1] : 0;
 
     if(totalLight<26)
     {  //Activate night mode for object
@@ -473,207 +683,155 @@ bool ActualDetector::lightDetection(Rect &rectangle, Mat &croppedImage)
 }
 
 /*
- * For parameter totalLight return pair that contains the min values for light (first)
- * and min values for black (second)
- */
-pair<int,int> ActualDetector::checkBrightness(int totalLight)
-{
-    //first int = minLight
-    //second int = minBlack
-    if (totalLight<10){
-        return make_pair(50,30);
-    }
-    else if (totalLight<70){
-        return make_pair(90,75);
-    }
-    else if (totalLight<100){
-        return make_pair(110,85);
-    }
-    else if (totalLight<130){
-        return make_pair(150,130);
-    }
-    else if (totalLight<150){
-        return make_pair(160,145);
-    }
-    else if (totalLight<180){
-        return make_pair(190,170);
-    }
-    else if (totalLight<210){
-        return make_pair(215,205);
-    }
-    else if (totalLight<230){
-        return make_pair(235,225);
-    }
-    else if (totalLight<241){
-        return make_pair(243,235);
-    }
-    else {
-        return make_pair(250,240);
-    }
-
-}
-
-/*
- * Thread that check if it is night every 300 seconds (5mins)
- * If total brightness is less than 100 it is night. In that case we temporary stop the detection process
- * to exclude any area from the detection area which is bright (i.e. the moon and stars) in order to
- * ignore any image noise around that area
+ * Thread that excludes bright areas (i.e. the moon and stars) from the detection area at night
+ * in order to ignore any image noise around those areas. The detection thread tells when night
+ * starts or ends; during the night the areas are updated every 300 seconds (5mins) as they move.
+ * The reduced detection area is published to the detection thread without stopping it.
  */
 void ActualDetector::checkIfNight()
 {
-    bool isRunning = true;
-    vector<Point> regionBackup=m_region;
-    vector<Point> regionNew;
-    bool changedRegion=false;
-    int timerSeconds=300;
+    bool isRegionReduced=false;
+    const chrono::seconds refreshInterval(300);
 
-    while(isRunning)
+    while(m_isMainThreadRunning)
     {
-        //get average brightness of region
-        int total=0;
-        long light=0;
-        Mat temp;
-        temp = m_camPtr->getWebcamFrame();
-        Mat frame = temp.clone();
-        cvtColor(frame, frame , CV_RGB2GRAY);
-
-        for(unsigned int i = 0; i<m_region.size(); i++)
+        bool willCheck;
         {
-            int x = m_region[i].x;
-            int y = m_region[i].y;
-            light+=static_cast<int>(frame.at<uchar>(y,x));
+            std::unique_lock<std::mutex> lock(m_nightCheckMutex);
+            bool isWoken = m_nightCheckCondition.wait_for(lock, refreshInterval, [this] {
+                return m_darknessChanged || !m_isMainThreadRunning;
+            });
+            // at night, check again after the interval as the moon and stars move
+            willCheck = m_darknessChanged || (!isWoken && m_isDark);
+            m_darknessChanged = false;
         }
-
-        total = light/m_region.size();
-
-        if (total<100)
+        if (!m_isMainThreadRunning)
         {
-            stopOnlyDetecting();
-            m_region=regionBackup;
-            m_isInNightMode=true;
+            break;
+        }
+        if (!willCheck)
+        {
+            continue;
+        }
 
+        if (m_isDark)
+        {
+            m_logger->print("Checking for bright areas at night...");
+            Mat frame;
+            if (!waitNightCheckFrame(frame))
+            {
+                break;
+            }
 
-            vector<Rect> constants = getConstantRecs(total);
+            vector<Rect> constants = getConstantRecs(frame, m_ambientLevel);
             if(constants.size()<=4 && constants.size()>0)
             {
-                Mat imageBinary(frame.rows,frame.cols,CV_THRESH_BINARY, Scalar(0,0,0));
-                //draw white pixel for everything inside rectangles
+                //clear everything inside rectangles from the region
+                /// @todo mark ignored areas in live camera stream
+                Mat* regionMaskNew = new Mat(m_regionMask.clone());
                 for(std::vector<Rect>::iterator it = constants.begin(); it != constants.end(); ++it)
                 {
                     Rect rectangleArea = *it;
                     if(rectangleArea.width<140 && rectangleArea.height<140)
                     {
-                        rectangle(imageBinary,rectangleArea,Scalar(255,255,255),-1);
-                    }
-                }
-
-                //find rectangle coordinates in region and remove them
-                /// @todo mark ignored areas in live camera stream
-                regionNew=m_region;
-                vector<Point>::iterator it = regionNew.begin();
-                for ( ; it != regionNew.end(); )
-                {
-                    if (static_cast<int>(imageBinary.at<uchar>(*it)) != 0)
-                    {
-                        it = regionNew.erase(it);
+                        rectangle(*regionMaskNew,rectangleArea,Scalar(0),-1);
                     }
-                    else ++it;
                 }
+                std::atomic_store(&m_activeRegionMask, std::shared_ptr<const Mat>(regionMaskNew));
+                isRegionReduced=true;
 
                 auto output_text = tr("%1 area(s) being ignored in order to filter the moon and stars").arg(QString::number(constants.size()));
                 emit broadcastOutputText(output_text);
-                changedRegion=true;
-
-            }
-            if (!m_mainThread)
-            {
-                if(changedRegion)
-                {
-                    m_region=regionNew;
-                    changedRegion=false;
-                }
-                regionNew.clear();
-                m_isMainThreadRunning=true;
-                m_mainThread.reset(new std::thread(&ActualDetector::detectingThread, this));
             }
-
         }
-        else if (m_isCascadeFound)
+        else if (isRegionReduced)
         {
-            m_isInNightMode=false;
+            std::atomic_store(&m_activeRegionMask, std::shared_ptr<const Mat>(new Mat(m_regionMask)));
+            isRegionReduced=false;
         }
+    }
+}
 
+bool ActualDetector::waitNightCheckFrame(Mat &frame)
+{
+    std::unique_lock<std::mutex> lock(m_nightCheckMutex);
+    m_nightCheckFrame.release();
+    m_nightCheckFrameRequested = true;
+    // woken up by the detection thread with a frame, or by stopThread()
+    m_nightCheckCondition.wait(lock, [this] {
+        return !m_nightCheckFrame.empty() || !m_isMainThreadRunning;
+    });
+    if (m_nightCheckFrame.empty())
+    {
+        m_nightCheckFrameRequested = false;
+        return false;
+    }
+    frame = m_nightCheckFrame;
+    m_nightCheckFrame.release();
+    return true;
+}
 
-        //timer
-        int counter=0;
-        bool isSleeping=true;
-        while(isSleeping)
-        {
-            if(m_isMainThreadRunning && counter<timerSeconds)
-            {
-                this_thread::sleep_for(chrono::seconds(1));
-                counter++;
-            }
-            else if(m_isMainThreadRunning && counter==timerSeconds)
-            {
-                isSleeping=false;
-                m_logger->print("Checking for low light condition...");
-            }
-            else if(!m_isMainThreadRunning)
-            {
-                isSleeping=false;
-                isRunning=false;
-            }
-        }
+void ActualDetector::provideNightCheckFrame(const Mat &grayFrame)
+{
+    if (!m_nightCheckFrameRequested)
+    {
+        return;
     }
+    std::lock_guard<std::mutex> lock(m_nightCheckMutex);
+    m_nightCheckFrame = grayFrame.clone();
+    m_nightCheckFrameRequested = false;
+    m_nightCheckCondition.notify_one();
 }
 
 /*
- * Called from checkIfNight to temporary stop detecting
+ * Apply results from the bird classifier. Results of tracks which have been removed meanwhile are dropped.
  */
-void ActualDetector::stopOnlyDetecting()
+void ActualDetector::applyBirdClassificationResults()
 {
-    if(m_startedRecording)
-    {
-        m_logger->print("Waiting for recording to stop...");
-        this_thread::sleep_for(chrono::seconds(1));
-        stopOnlyDetecting();
-    }
-    else
+    m_birdClassificationResults.clear();
+    m_birdClassifier->takeResults(m_birdClassificationResults);
+    for (unsigned int i = 0; i < m_birdClassificationResults.size(); i++)
     {
-        if (m_mainThread)
+        const BirdClassificationResult& result = m_birdClassificationResults[i];
+        CTrack* track = findTrack(result.m_trackId);
+        if (track)
         {
-            m_isMainThreadRunning=false;
-            m_mainThread->join();
-            m_mainThread.reset();
+            track->birdChecks++;
+            track->lastCheckWasBird = result.m_isBird;
+            track->framesWithoutVerdict = 0;
+            if (result.m_isBird)
+            {
+                track->birdCounter++;
+            }
         }
     }
 }
 
-bool ActualDetector::checkIfBird()
+CTrack* ActualDetector::findTrack(size_t trackId)
 {
-    std::vector<Rect> birds;
-    m_birdsCascade.detectMultiScale(m_croppedImageGray, birds, 1.1, 2, 0|CV_HAAR_SCALE_IMAGE, Size(CLASSIFIER_DIMENSION_SIZE, CLASSIFIER_DIMENSION_SIZE) );
-
-    return (!birds.empty());
+    for (unsigned int i = 0; i < state->tracker.tracks.size(); i++)
+    {
+        if (state->tracker.tracks[i]->track_id == trackId)
+        {
+            return state->tracker.tracks[i].get();
+        }
+    }
+    return NULL;
 }
 
 /*
  * Get vector with the Rect of all constant bright objects
  */
-std::vector<Rect> ActualDetector::getConstantRecs(int totalLight)
+std::vector<Rect> ActualDetector::getConstantRecs(const Mat &imageGray, int totalLight)
 {
     vector<Rect> rectVec;
-    Mat image = m_camPtr->getWebcamFrame();
-    Mat imageGray;
-    cvtColor(image, imageGray , CV_RGB2GRAY);
 
     int y, x, size;
     size=m_region.size();
-    int minLight = checkBrightness(totalLight).first;
+    int minLight = m_brightnessThresholds.lookup(totalLight).minLight;
 
     //find bright pixels in webcam frame and paint pixels in binary image
-    Mat imageBinary(image.rows,image.cols,CV_THRESH_BINARY, Scalar(0,0,0));
+    Mat imageBinary(imageGray.rows,imageGray.cols,CV_THRESH_BINARY, Scalar(0,0,0));
     for(int i = 0; i < size; i++)
     {
         x = m_region[i].x;
@@ -718,11 +876,17 @@ std::vector<Rect> ActualDetector::getConstantRecs(int totalLight)
 /*
  * Save image
  */
-void ActualDetector::saveImg(string path, Mat & image)
+void ActualDetector::saveImg(const Rect& rectangle, size_t trackId, bool isBright)
 {
-    stringstream ss;
-    ss << path << m_imageCount << m_savedImageExtension;
-    imwrite(ss.str(), image );
+    CropArchiveEntry entry;
+    entry.m_timestamp = QDateTime::currentMSecsSinceEpoch();
+    entry.m_trackId = trackId;
+    entry.m_rect = rectangle;
+    entry.m_isBright = isBright;
+    // the result frame is drawn on later and the motion image is reused for the next frame
+    Mat image = m_resultFrame(rectangle).clone();
+    Mat mask = m_motion(rectangle).clone();
+    m_imageWriter->writeCrop(entry, image, mask);
 }
 
 /*
@@ -730,42 +894,116 @@ void ActualDetector::saveImg(string path, Mat & image)
  */
 void ActualDetector::stopThread()
 {
-    m_region.clear();
+    {
+        std::unique_lock<std::mutex> lock(m_runStateMutex);
+        // a start in progress finishes first, a stop in progress is waited for
+        m_runStateChanged.wait(lock, [this] { return (m_runState != Starting) && (m_runState != Stopping); });
+        if (m_runState == Stopped)
+        {
+            return;
+        }
+        m_runState = Stopping;
+        m_runStateChanged.notify_all();
+    }
+    MetricsScopedTimer stopTimer(Metrics::DetectorStopStage);
     m_isMainThreadRunning = false;
+    {
+        std::lock_guard<std::mutex> lock(m_nightCheckMutex);
+        m_nightCheckCondition.notify_all();
+    }
     m_recorder->stopRecording(true);
     if (m_mainThread)
     {
         m_mainThread->join();
         m_mainThread.reset();
-        this_thread::sleep_for(chrono::seconds(1));
-        m_nightCheckerThread->join(); m_nightCheckerThread.reset();
     }
+    if (m_nightCheckerThread)
+    {
+        // the night checker wakes up on the notification above
+        m_nightCheckerThread->join();
+        m_nightCheckerThread.reset();
+    }
+    if (m_eventLog)
+    {
+        if (m_startedRecording)
+        {
+            // recorder keeps the video when stopped
+            logRecordingFinished(NULL, true);
+        }
+        m_eventLog->stop();
+        if (m_eventLog->droppedCount() > 0)
+        {
+            emit broadcastOutputText(tr("WARNING: %1 detection events were not written because writing was too slow")
+                                     .arg(m_eventLog->droppedCount()));
+        }
+    }
+    m_imageWriter->stop();
+    if (m_imageWriter->droppedCount() > 0)
+    {
+        emit broadcastOutputText(tr("WARNING: %1 result images were not saved because writing was too slow")
+                                 .arg(m_imageWriter->droppedCount()));
+    }
+    if (m_sessionRecorder)
+    {
+        m_sessionRecorder->stop();
+    }
+    m_region.clear();
+    stopTimer.stop();
+    setRunState(Stopped);
 }
 
 bool ActualDetector::start()
 {
-    if (!m_mainThread)
     {
-        emit progressValueChanged(1);
-        if(initialize())
+        std::unique_lock<std::mutex> lock(m_runStateMutex);
+        m_runStateChanged.wait(lock, [this] { return (m_runState != Starting) && (m_runState != Stopping); });
+        if (m_runState == Running)
         {
-            m_isMainThreadRunning=true;
-            m_nightCheckerThread.reset(new std::thread(&ActualDetector::checkIfNight, this));
-            emit progressValueChanged(90);
-            this_thread::sleep_for(chrono::seconds(1));
-            emit progressValueChanged(100);
-
-            if (!m_mainThread)
-            {
-                m_mainThread.reset(new std::thread(&ActualDetector::detectingThread, this));
-            }
             return true;
         }
-        else return false;
+        m_runState = Starting;
+        m_runStateChanged.notify_all();
     }
+    MetricsScopedTimer startTimer(Metrics::DetectorStartStage);
+    emit progressValueChanged(1);
+    if(!initialize())
+    {
+        setRunState(Stopped);
+        return false;
+    }
+    m_isMainThreadRunning=true;
+    m_nightCheckerThread.reset(new std::thread(&ActualDetector::checkIfNight, this));
+    emit progressValueChanged(90);
+    m_mainThread.reset(new std::thread(&ActualDetector::detectingThread, this));
+    // the detection thread reports running when it enters its loop
+    std::unique_lock<std::mutex> lock(m_runStateMutex);
+    m_runStateChanged.wait(lock, [this] { return m_runState == Running; });
+    lock.unlock();
+    startTimer.stop();
+    emit progressValueChanged(100);
     return true;
 }
 
+ActualDetector::RunState ActualDetector::runState() const
+{
+    std::lock_guard<std::mutex> lock(m_runStateMutex);
+    return m_runState;
+}
+
+bool ActualDetector::waitForRunState(RunState runState, int timeoutMs)
+{
+    std::unique_lock<std::mutex> lock(m_runStateMutex);
+    return m_runStateChanged.wait_for(lock, chrono::milliseconds(timeoutMs),
+                                      [this, runState] { return m_runState == runState; });
+}
+
+void ActualDetector::setRunState(RunState runState)
+{
+    std::lock_guard<std::mutex> lock(m_runStateMutex);
+    m_runState = runState;
+    m_runStateChanged.notify_all();
+}
+
 Rect ActualDetector::enlargeROI(Mat &frm, Rect &boundingBox, int padding)
 {
     Rect returnRect = Rect(boundingBox.x - padding, boundingBox.y - padding, boundingBox.width + (padding * 2), boundingBox.height + (padding * 2));
@@ -779,8 +1017,168 @@ Rect ActualDetector::enlargeROI(Mat &frm, Rect &boundingBox, int padding)
 void ActualDetector::setAmountOfPlanes(int amount)
 {
     state->numberOfPlanes = amount;
+    if (m_sessionRecorder)
+    {
+        m_sessionRecorder->addPlaneCount(amount);
+    }
+}
+
+void ActualDetector::setWorkerPool(WorkerPool* pool)
+{
+    int client = pool->addClient();
+    int classifierCount = std::max(1, std::min(4, pool->threadCount() / 2));
+    m_detectionQueue = pool->createQueue(client, 1);
+    m_birdClassifier->setWorkerQueue(pool->createQueue(client, classifierCount));
+    m_recorder->setWorkerQueue(pool->createQueue(client, 1));
+}
+
+void ActualDetector::setSessionRecordingDirectory(QString directory)
+{
+    m_sessionRecordingDirectory = directory;
+    if (directory.isEmpty())
+    {
+        m_sessionRecorder.reset();
+    }
+    else if (!m_sessionRecorder)
+    {
+        m_sessionRecorder.reset(new SessionRecorder());
+    }
+}
+
+void ActualDetector::setEventLogFileName(QString fileName)
+{
+    m_eventLogFileName = fileName;
+    if (fileName.isEmpty())
+    {
+        m_eventLog.reset();
+    }
+    else if (!m_eventLog)
+    {
+        m_eventLog.reset(new DetectionEventLog());
+    }
 }
 
+void ActualDetector::logTrackEvents()
+{
+    CTracker& tracker = state->tracker;
+    if (!tracker.collectTrackEvents)
+    {
+        return;
+    }
+    for (unsigned int i = 0; i < tracker.createdTracks.size(); i++)
+    {
+        DetectionEvent event = DetectionEvent::create(DetectionEvent::TrackCreated, m_frameIndex - 1);
+        event.m_trackId = tracker.createdTracks[i];
+        m_eventLog->add(event);
+    }
+    for (unsigned int i = 0; i < tracker.removedTracks.size(); i++)
+    {
+        const CTracker::RemovedTrack& removed = tracker.removedTracks[i];
+        DetectionEvent event = DetectionEvent::create(DetectionEvent::TrackRemoved, m_frameIndex - 1);
+        event.m_trackId = removed.track_id;
+        event.m_posCounter = removed.posCounter;
+        event.m_negCounter = removed.negCounter;
+        event.m_birdCounter = removed.birdCounter;
+        m_eventLog->add(event);
+    }
+    tracker.createdTracks.clear();
+    tracker.removedTracks.clear();
+}
+
+void ActualDetector::logRecordingFinished(const char* result, bool videoSaved)
+{
+    if (!m_eventLog)
+    {
+        return;
+    }
+    DetectionEvent event = DetectionEvent::create(DetectionEvent::RecordingFinished, m_frameIndex - 1);
+    event.m_result = result;
+    event.m_videoSaved = videoSaved;
+    m_eventLog->add(event);
+}
+
+void ActualDetector::startSessionRecording(const std::vector<CameraFrame> &initialFrames)
+{
+    QJsonObject settings;
+    settings.insert("cameraWidth", m_cameraWidth);
+    settings.insert("cameraHeight", m_cameraHeight);
+    settings.insert("noiseFilterPixelSize", m_noiseLevel.cols);
+    settings.insert("motionThreshold", m_thresholdLevel);
+    settings.insert("motionModel", m_motionModelType);
+    settings.insert("minPositiveDetections", state->MIN_POS_REQUIRED);
+    settings.insert("brightnessThresholds", m_configSnapshot->m_brightnessThresholds);
+    settings.insert("birdClassifier", (bool)m_isCascadeFound);
+
+    if (!m_sessionRecorder->start(m_sessionRecordingDirectory, settings, m_regionMask))
+    {
+        emit broadcastOutputText(tr("WARNING: could not record detection session to %1").arg(m_sessionRecordingDirectory));
+        return;
+    }
+    for (unsigned int i = 0; i < initialFrames.size(); i++)
+    {
+        CameraFrame frame = initialFrames[i];
+        m_sessionRecorder->addFrame(frame.bgr());
+    }
+    m_logger->print("Recording detection session to " + m_sessionRecordingDirectory);
+}
+
+
+void ActualDetector::updateSettings()
+{
+    std::shared_ptr<const ConfigSnapshot> settings = m_config->snapshot();
+    if (settings == m_configSnapshot)
+    {
+        return;
+    }
+    const ConfigSnapshot& previous = *m_configSnapshot;
+
+    if (settings->m_noiseFilterPixelSize != previous.m_noiseFilterPixelSize)
+    {
+        setNoiseLevel(settings->m_noiseFilterPixelSize);
+    }
+    if (settings->m_motionThreshold != previous.m_motionThreshold)
+    {
+        setThresholdLevel(settings->m_motionThreshold);
+    }
+    if (settings->m_minPositiveDetections != previous.m_minPositiveDetections)
+    {
+        state->MIN_POS_REQUIRED = settings->m_minPositiveDetections;
+    }
+    if (settings->m_resultVideoWithObjectRectangles != previous.m_resultVideoWithObjectRectangles)
+    {
+        m_willRecordWithRect = settings->m_resultVideoWithObjectRectangles;
+    }
+    if ((settings->m_brightnessThresholds != previous.m_brightnessThresholds)
+            && !m_brightnessThresholds.load(settings->m_brightnessThresholds))
+    {
+        m_brightnessThresholds.reset();
+        emit broadcastOutputText(tr("WARNING: invalid brightness thresholds in settings, using defaults"));
+    }
+    if (settings->m_motionModel != previous.m_motionModel)
+    {
+        m_motionModelType = settings->m_motionModel;
+        if (m_motionModel && !m_prevFrame.empty())
+        {
+            // restart both models from the last three frames, processFrame keeps them current
+            m_motionModel.reset(MotionModel::create(m_motionModelType));
+            m_motionModel->apply(m_prevFrame, m_thresholdLevel, m_motion);
+            m_motionModel->apply(m_currentFrame, m_thresholdLevel, m_motion);
+            m_motionModel->apply(m_nextFrame, m_thresholdLevel, m_motion);
+            initCoarseMotion({m_prevFrame, m_currentFrame, m_nextFrame});
+        }
+    }
+    if ((settings->m_cameraIndex != previous.m_cameraIndex)
+            || (settings->m_cameraWidth != previous.m_cameraWidth)
+            || (settings->m_cameraHeight != previous.m_cameraHeight)
+            || (settings->m_detectionAreaFile != previous.m_detectionAreaFile)
+            || (settings->m_resultImageDir != previous.m_resultImageDir)
+            || (settings->m_saveResultImages != previous.m_saveResultImages)
+            || (settings->m_birdClassifierTrainingFile != previous.m_birdClassifierTrainingFile))
+    {
+        emit broadcastOutputText(tr("Changed camera and result image settings take effect after restarting the application"));
+    }
+    m_configSnapshot = settings;
+}
 
 void ActualDetector::setNoiseLevel(int level)
 {
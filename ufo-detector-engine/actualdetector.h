@@ -30,6 +30,9 @@
 #include <iostream>
 #include <opencv2/imgproc/imgproc.hpp>
 #include <chrono>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
 #include <stdio.h>
 #include "camera.h"
 #include <QDir>
@@ -38,8 +41,17 @@
 #include <QtXml>
 #include "Ctracker.h"
 #include "Detector.h"
+#include "birdclassifier.h"
+#include "brightnessthresholds.h"
+#include "ambientbrightness.h"
+#include "motionmodel.h"
 #include "detectorstate.h"
 #include "logger.h"
+#include "metrics.h"
+#include "detectionsession.h"
+#include "workerpool.h"
+#include "resultimagewriter.h"
+#include "detectioneventlog.h"
 
 using namespace cv;
 
@@ -58,6 +70,16 @@ public:
     ActualDetector(Camera* camera, Config* config, Logger* logger, DataManager* dataManager, QObject *parent = 0);
     ~ActualDetector();
 
+    /**
+     * @brief State of the detection process.
+     */
+    enum RunState {
+        Stopped,
+        Starting,   ///< start() is initializing and starting threads
+        Running,
+        Stopping    ///< stopThread() is waiting for threads and writers
+    };
+
     /**
      * @brief Initialize ActualDetector. Need to be called before calling start().
      * @return
@@ -65,16 +87,37 @@ public:
     bool initialize();
 
     /**
-     * @brief Start the detection process.
+     * @brief Start the detection process. Returns as soon as the detection thread runs.
+     * Waits for a stop in progress to finish first.
+     * @return false if initialization failed
      */
     bool start();
 
     /**
-     * @brief Stop the detection process.
+     * @brief Stop the detection process. Returns as soon as threads and writers have finished.
      */
     void stopThread();
 
+    RunState runState() const;
+
+    /**
+     * @brief Wait until the detection process reaches a state.
+     * @param runState state to wait for
+     * @param timeoutMs max. time to wait in milliseconds
+     * @return false on timeout
+     */
+    bool waitForRunState(RunState runState, int timeoutMs);
+
+    /**
+     * @brief Set noise filter size. Use only while not detecting,
+     * running detection follows Config::setNoiseFilterPixelSize().
+     */
     void setNoiseLevel(int level);
+
+    /**
+     * @brief Set motion threshold. Use only while not detecting,
+     * running detection follows Config::setMotionThreshold().
+     */
     void setThresholdLevel(int level);
     void setFilename(std::string msg);
     void startRecording();
@@ -91,6 +134,28 @@ public:
      */
     void setShowCameraVideo(bool show);
 
+    /**
+     * @brief Record camera frames and detector settings for replaying, see SessionRecorder.
+     * Takes effect when detection is started next time.
+     * @param directory session folder, empty = don't record
+     */
+    void setSessionRecordingDirectory(QString directory);
+
+    /**
+     * @brief Write detection events as newline-delimited JSON, see DetectionEventLog.
+     * Takes effect when detection is started next time.
+     * @param fileName event log file, appended to; empty = don't write events
+     */
+    void setEventLogFileName(QString fileName);
+
+    /**
+     * @brief Run detection, bird classification and video writing in a worker pool
+     * shared with other cameras. Camera frames are still read in the detection thread.
+     * Call once before start().
+     * @param pool shared pool, must outlive this object
+     */
+    void setWorkerPool(WorkerPool* pool);
+
 #ifndef _UNIT_TEST_
 private:
 #endif
@@ -99,54 +164,96 @@ private:
     Config* m_config;
     Logger* m_logger;
     DataManager* m_dataManager;
-    cv::Mat m_resultFrame;
+    cv::Mat m_resultFrame;      ///< color image of the frame being processed, shared with other consumers, never drawn on
     cv::Mat m_resultFrameCropped;
-    cv::Mat m_prevFrame;
-    cv::Mat m_currentFrame;
-    cv::Mat m_nextFrame;
+    cv::Mat m_prevFrame;        ///< gray frame before m_currentFrame
+    cv::Mat m_currentFrame;     ///< gray frame before m_nextFrame
+    cv::Mat m_nextFrame;        ///< gray frame being processed
     std::atomic<bool> m_showCameraVideo; ///< whether the camera video is shown (updatePixmap signal emitted)
     QImage m_cameraViewImage;   ///< image to be given out with signal updatePixmap()
-    cv::Mat m_d1;
-    cv::Mat m_d2;
+    int m_motionModelType;      ///< MotionModel::Type
+    std::unique_ptr<MotionModel> m_motionModel;
     cv::Mat m_motion;
+    bool m_useCoarseMotion;     ///< find motion first in a downscaled frame (large frames only)
+    std::unique_ptr<MotionModel> m_coarseBrightMotionModel; ///< motion of the brightest pixel of each block
+    std::unique_ptr<MotionModel> m_coarseDarkMotionModel;   ///< motion of the darkest pixel of each block
+    cv::Mat m_coarseBrightest;
+    cv::Mat m_coarseDarkest;
+    cv::Mat m_coarseMotion;
+    cv::Mat m_coarseDarkMotion;
+    cv::Mat m_coarseRegionMask; ///< detection area in downscaled frame
     cv::Mat m_treshImg;
-    cv::Mat m_croppedImageGray;
     cv::Mat m_noiseLevel;
     cv::Rect m_rect;
     int m_minAmountOfMotion;
     int m_maxDeviation;
-    std::string m_resultImageDirNameBase; ///< base for result image folder name
-    std::string m_pathNameThresh;
-    std::string m_resultImageDirName;   ///< complete result image folder name
-    std::string m_savedImageExtension;
-    int m_imageCount;
+    std::string m_resultImageDirNameBase; ///< base for result image crop archive name
     int m_thresholdLevel;
     int m_cameraWidth;
     int m_cameraHeight;
     DetectorState *state;
     const unsigned int MAX_OBJECTS_IN_FRAME = 10;
     const int CLASSIFIER_DIMENSION_SIZE = 30;
+    const size_t BIRD_VERDICT_TIMEOUT_FRAMES = 5; ///< bright frames a track waits for a bird verdict before it counts as positive
+    const int COARSE_MOTION_MIN_WIDTH = 1280;   ///< use coarse motion pass for frames at least this wide
+    const int COARSE_MOTION_SCALE = 4;          ///< frame size divided by coarse frame size
+    const int COARSE_MOTION_PADDING = 16;       ///< pixels added around coarse motion area
     bool m_willRecordWithRect;
-    cv::CascadeClassifier m_birdsCascade;
+    BirdClassifier* m_birdClassifier;
+    std::vector<BirdClassificationResult> m_birdClassificationResults;
+    BrightnessThresholdTable m_brightnessThresholds; ///< light and dark pixel limits by average brightness
 
 
-    std::vector<cv::Point> m_region;
+    std::vector<cv::Point> m_region;    ///< complete detection area, not changed while detecting
+    cv::Mat m_regionMask;               ///< m_region as camera sized mask, 255 inside
+    /// mask of the detection area without night time exclusions (moon, stars); replaced as a whole with std::atomic_store
+    std::shared_ptr<const cv::Mat> m_activeRegionMask;
     std::string m_detectionAreaFile;
+    std::mutex m_nightCheckMutex;               ///< guards m_nightCheckFrame and m_darknessChanged
+    std::condition_variable m_nightCheckCondition; ///< wakes up the night checker
+    std::atomic<bool> m_nightCheckFrameRequested; ///< night checker waits for a frame from the detection thread
+    cv::Mat m_nightCheckFrame;                  ///< gray frame given to the night checker
+    bool m_darknessChanged;                     ///< night started or ended, night checker has not reacted yet
+    AmbientBrightness m_ambientBrightness;      ///< used only by the detection thread
+    std::atomic<bool> m_isDark;                 ///< night according to m_ambientBrightness
+    std::atomic<int> m_ambientLevel;            ///< average brightness according to m_ambientBrightness
 
     std::atomic<bool> m_isMainThreadRunning;
+    mutable std::mutex m_runStateMutex;         ///< guards m_runState
+    std::condition_variable m_runStateChanged;
+    RunState m_runState;
     std::atomic<bool> m_willParseRectangle;
-    bool m_isInNightMode;
+    std::atomic<bool> m_isInNightMode;
     std::atomic<bool> m_startedRecording;
     bool m_willSaveImages;
+    std::unique_ptr<ResultImageWriter> m_imageWriter; ///< writes result images in the background
     bool m_isCascadeFound;
     std::unique_ptr<std::thread> m_mainThread;
     std::unique_ptr<std::thread> m_nightCheckerThread;
     std::vector <cv::Rect> m_detectorRectVec;
+    std::unique_ptr<CDetector> m_objectDetector;
+    std::vector<cv::Point2d> m_centers;     ///< object centers in the latest frame
+    int m_counterNoMotion;      ///< consecutive frames without motion
+    int m_counterBlackDetector; ///< consecutive dark objects
+    int m_counterLight;         ///< consecutive bright objects
+    QString m_sessionRecordingDirectory;
+    std::unique_ptr<SessionRecorder> m_sessionRecorder;
+    QString m_eventLogFileName;
+    std::unique_ptr<DetectionEventLog> m_eventLog;  ///< NULL if events are not written
+    quint64 m_frameIndex;       ///< frames processed since initialization
+    WorkerPool::Queue* m_detectionQueue;    ///< shared pool queue for processFrame(), NULL = own thread
+    std::shared_ptr<const ConfigSnapshot> m_configSnapshot; ///< settings in use, owned by detection thread
 
 
-    inline int detectMotion(const cv::Mat & m_motion, cv::Mat & m_resultFrame, cv::Mat & m_resultFrameCropped,
-                     std::vector<cv::Point> &m_region,
-                     int m_maxDeviation);
+    /**
+     * @brief Count changed pixels inside the detection area.
+     * @param motion motion mask, zero outside area
+     * @param area part of the frame where motion was searched
+     * @param regionMask detection area mask, 255 inside
+     * @return number of changed pixels, 0 if too much of the frame changed
+     */
+    int detectMotion(const cv::Mat & motion, const cv::Rect & area, cv::Mat & result, cv::Mat & result_cropped,
+                     const cv::Mat & regionMask, int max_deviation);
 
     /**
      * @brief Initialize detection area.
@@ -155,20 +262,104 @@ private:
      */
     bool initDetectionArea();
 
-    bool lightDetection(cv::Rect &rectangle, cv::Mat &croppedImage);
+    /**
+     * @brief Reset detection state and motion models for new detection.
+     * Detection area, thresholds and noise level need to be set before calling this.
+     * @param initialFrames first DetectionSession::INITIAL_FRAME_COUNT camera frames
+     */
+    void initializeDetection(const std::vector<CameraFrame>& initialFrames);
+
+    /**
+     * @brief Apply settings that changed since the snapshot in use.
+     * Detection parameters change right away, camera and result image settings
+     * need an application restart. Called once per frame by the detection thread.
+     */
+    void updateSettings();
+
+    /**
+     * @brief Detect objects in one camera frame. Called by the detection thread for each frame.
+     * @param cameraFrame camera frame
+     * @return amount of motion in frame
+     */
+    int processFrame(CameraFrame& cameraFrame);
+
+    /**
+     * @brief Start session recorder with current settings and the initial frames.
+     */
+    void startSessionRecording(const std::vector<CameraFrame>& initialFrames);
+
+    /**
+     * @brief Add created and removed tracks of the tracker to the event log.
+     */
+    void logTrackEvents();
+
+    /**
+     * @brief Add recording finished event with result, NULL if detection was stopped.
+     */
+    void logRecordingFinished(const char* result, bool videoSaved);
+
+    /**
+     * @brief Initialize the coarse motion pass for large frames.
+     * @param grayFrames initial gray frames, oldest first
+     */
+    void initCoarseMotion(const std::vector<cv::Mat>& grayFrames);
+
+    /**
+     * @brief Find the area with motion in frames downscaled to the brightest and darkest pixel of each block.
+     * @param frame camera frame
+     * @return area in full size frame where motion needs to be searched, empty if there is no motion
+     */
+    cv::Rect findCoarseMotionArea(CameraFrame& frame);
+
+    /**
+     * @brief Check if an object is bright.
+     * @param rectangle object rectangle in camera frame
+     * @param croppedImage object image
+     * @param croppedImageGray gray version of object image is stored here
+     * @return true if the object is bright
+     */
+    bool lightDetection(cv::Rect &rectangle, cv::Mat &croppedImage, cv::Mat &croppedImageGray);
     void detectingThread();
     void detectingThreadHigh();
-    void saveImg(std::string path, cv::Mat &image);
-    std::pair<int, int> checkBrightness(int totalLight);
+
+    /**
+     * @brief Queue a copy of an object image and its threshold mask for the session crop archive.
+     * @param rectangle object rectangle in the result frame
+     * @param trackId ID of the track the object belongs to
+     * @param isBright brightness verdict of the object
+     */
+    void saveImg(const cv::Rect& rectangle, size_t trackId, bool isBright);
     void checkIfNight();
-    void stopOnlyDetecting();
 
     /**
-     * @brief Check if single (!) object is a bird.
-     * @todo Improve to only look for single objects
+     * @brief Set run state and wake up threads waiting for it.
+     */
+    void setRunState(RunState runState);
+
+    /**
+     * @brief Get the next gray frame from the detection thread. Called by the night checker.
+     * @param frame the frame is stored here
+     * @return false if detection stopped before a frame was available
+     */
+    bool waitNightCheckFrame(cv::Mat& frame);
+
+    /**
+     * @brief Give a copy of the frame to the night checker if it is waiting for one.
+     * Called by the detection thread for each frame.
+     */
+    void provideNightCheckFrame(const cv::Mat& grayFrame);
+
+    /**
+     * @brief Apply finished bird classification results to their tracks.
+     */
+    void applyBirdClassificationResults();
+
+    /**
+     * @brief Find track by its ID.
+     * @return pointer to track or NULL if the track doesn't exist anymore
      */
-    bool checkIfBird();
-    std::vector<cv::Rect> getConstantRecs(int totalLight);
+    CTrack* findTrack(size_t trackId);
+    std::vector<cv::Rect> getConstantRecs(const cv::Mat& imageGray, int totalLight);
 
     cv::Rect enlargeROI(cv::Mat &frm, cv::Rect &boundingBox, int padding);
 
@@ -0,0 +1,106 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ambientbrightness.h"
+#include <algorithm>
+
+AmbientBrightness::AmbientBrightness(int updateInterval, double smoothing,
+                                     int nightEnterLevel, int nightLeaveLevel)
+{
+    m_updateInterval = updateInterval > 0 ? updateInterval : 1;
+    m_smoothing = smoothing;
+    m_nightEnterLevel = nightEnterLevel;
+    m_nightLeaveLevel = nightLeaveLevel;
+    m_frameCounter = 0;
+    m_hasMeasurement = false;
+    m_isNight = false;
+    m_averageBrightness = 0;
+}
+
+void AmbientBrightness::setRegion(const std::vector<cv::Point>& region, cv::Size frameSize)
+{
+    cv::Mat fullMask(frameSize, CV_8UC1, cv::Scalar(0));
+    for (unsigned int i = 0; i < region.size(); i++) {
+        fullMask.at<uchar>(region[i]) = 255;
+    }
+    cv::Size mapSize(std::max(1, frameSize.width / MAP_SCALE), std::max(1, frameSize.height / MAP_SCALE));
+    cv::resize(fullMask, m_regionMask, mapSize, 0, 0, cv::INTER_AREA);
+    // a map cell belongs to the region if any of its pixels does
+    cv::threshold(m_regionMask, m_regionMask, 0, 255, CV_THRESH_BINARY);
+
+    m_frameCounter = 0;
+    m_hasMeasurement = false;
+    m_isNight = false;
+    m_averageBrightness = 0;
+    m_map.release();
+}
+
+bool AmbientBrightness::update(const cv::Mat& grayFrame)
+{
+    if (m_regionMask.empty()) {
+        return false;
+    }
+    bool isMeasurementFrame = (m_frameCounter == 0);
+    if (++m_frameCounter >= m_updateInterval) {
+        m_frameCounter = 0;
+    }
+    if (!isMeasurementFrame) {
+        return false;
+    }
+
+    cv::resize(grayFrame, m_scaledFrame, m_regionMask.size(), 0, 0, cv::INTER_AREA);
+    if (!m_hasMeasurement) {
+        m_scaledFrame.convertTo(m_map, CV_32F);
+    } else {
+        cv::accumulateWeighted(m_scaledFrame, m_map, m_smoothing);
+    }
+    m_averageBrightness = cv::mean(m_map, m_regionMask)[0];
+
+    bool wasNight = m_isNight;
+    if (!m_hasMeasurement) {
+        m_isNight = m_averageBrightness < (m_nightEnterLevel + m_nightLeaveLevel) / 2;
+        m_hasMeasurement = true;
+        return true;
+    }
+    if (m_isNight && (m_averageBrightness > m_nightLeaveLevel)) {
+        m_isNight = false;
+    } else if (!m_isNight && (m_averageBrightness < m_nightEnterLevel)) {
+        m_isNight = true;
+    }
+    return m_isNight != wasNight;
+}
+
+int AmbientBrightness::averageBrightness() const
+{
+    return (int)m_averageBrightness;
+}
+
+bool AmbientBrightness::isNight() const
+{
+    return m_isNight;
+}
+
+bool AmbientBrightness::hasMeasurement() const
+{
+    return m_hasMeasurement;
+}
+
+const cv::Mat& AmbientBrightness::brightnessMap() const
+{
+    return m_map;
+}
@@ -0,0 +1,99 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef AMBIENTBRIGHTNESS_H
+#define AMBIENTBRIGHTNESS_H
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <vector>
+
+/**
+ * @brief Running brightness statistics of the detection area.
+ *
+ * Updated from the gray frames the detection thread already has. Every
+ * updateInterval-th frame is downscaled into a low resolution brightness map,
+ * which is smoothed with an exponential moving average. The average brightness
+ * of the detection area is taken from the map. Night is entered below
+ * nightEnterLevel and left above nightLeaveLevel, so noise around a single
+ * level doesn't toggle night mode.
+ */
+class AmbientBrightness
+{
+public:
+    /**
+     * @param updateInterval measure every updateInterval-th frame
+     * @param smoothing weight of a new measurement in the moving average (0-1)
+     * @param nightEnterLevel night starts when average brightness drops below this
+     * @param nightLeaveLevel night ends when average brightness rises above this
+     */
+    AmbientBrightness(int updateInterval = 10, double smoothing = 0.1,
+                      int nightEnterLevel = 90, int nightLeaveLevel = 110);
+
+    /**
+     * @brief Set detection area and forget previous measurements.
+     * @param region detection area points
+     * @param frameSize camera frame size
+     */
+    void setRegion(const std::vector<cv::Point>& region, cv::Size frameSize);
+
+    /**
+     * @brief Give a gray frame. Only every updateInterval-th frame is measured.
+     * @return true if night started or ended with this frame
+     */
+    bool update(const cv::Mat& grayFrame);
+
+    /**
+     * @brief Smoothed average brightness of the detection area (0-255).
+     */
+    int averageBrightness() const;
+
+    /**
+     * @brief Whether it is night according to the hysteresis levels.
+     */
+    bool isNight() const;
+
+    /**
+     * @brief Whether at least one frame has been measured.
+     */
+    bool hasMeasurement() const;
+
+    /**
+     * @brief Smoothed low resolution brightness map (CV_32F).
+     */
+    const cv::Mat& brightnessMap() const;
+
+#ifndef _UNIT_TEST_
+private:
+#endif
+    static const int MAP_SCALE = 8;     ///< frame size divided by map size
+
+    int m_updateInterval;
+    double m_smoothing;
+    int m_nightEnterLevel;
+    int m_nightLeaveLevel;
+    int m_frameCounter;         ///< frames since the last measurement, wraps at m_updateInterval
+    bool m_hasMeasurement;
+    bool m_isNight;
+    double m_averageBrightness;
+    cv::Mat m_regionMask;       ///< detection area at map resolution
+    cv::Mat m_map;
+    cv::Mat m_scaledFrame;
+};
+
+#endif // AMBIENTBRIGHTNESS_H
@@ -0,0 +1,286 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "birdclassifier.h"
+
+BirdClassifier::BirdClassifier(QObject *parent) : QObject(parent)
+{
+    m_running = false;
+    m_initialized = false;
+    m_synchronous = false;
+    m_workerQueue = NULL;
+    m_minObjectSize = 0;
+    m_canonicalSize = 0;
+}
+
+BirdClassifier::~BirdClassifier()
+{
+    stop();
+}
+
+bool BirdClassifier::init(std::string trainingFile, int minObjectSize, int workerCount)
+{
+    if (m_initialized) {
+        return true;
+    }
+    if (m_synchronous) {
+        workerCount = 1;
+    } else if (m_workerQueue) {
+        workerCount = m_workerQueue->maxConcurrency();
+    } else if (workerCount <= 0) {
+        // leave most of the cores for detection, recording and encoding
+        workerCount = std::max(1, std::min(4, (int)std::thread::hardware_concurrency() / 2));
+    }
+    m_minObjectSize = minObjectSize;
+    // leave room for a few pyramid levels (scale factor 1.1) above the minimum size
+    m_canonicalSize = (minObjectSize * 4) / 3;
+
+    for (int i = 0; i < workerCount; i++) {
+        std::unique_ptr<cv::CascadeClassifier> classifier(new cv::CascadeClassifier());
+        if (!classifier->load(trainingFile)) {
+            m_classifiers.clear();
+            return false;
+        }
+        m_classifiers.push_back(std::move(classifier));
+    }
+
+    m_running = true;
+    if (m_workerQueue) {
+        for (unsigned int i = 0; i < m_classifiers.size(); i++) {
+            m_freeClassifiers.push_back(m_classifiers[i].get());
+        }
+    }
+    for (unsigned int i = 0; i < m_classifiers.size() && !m_synchronous && !m_workerQueue; i++) {
+        m_workers.push_back(std::unique_ptr<std::thread>(
+                new std::thread(&BirdClassifier::workerThread, this, m_classifiers[i].get())));
+    }
+    m_initialized = true;
+    return true;
+}
+
+bool BirdClassifier::isInitialized()
+{
+    return m_initialized;
+}
+
+void BirdClassifier::setSynchronous(bool synchronous)
+{
+    m_synchronous = synchronous;
+}
+
+void BirdClassifier::setWorkerQueue(WorkerPool::Queue* queue)
+{
+    m_workerQueue = queue;
+}
+
+bool BirdClassifier::requestClassification(size_t trackId, cv::Mat& grayImage)
+{
+    if (m_synchronous && m_running) {
+        BirdClassificationResult result;
+        result.m_trackId = trackId;
+        MetricsScopedTimer classificationTimer(Metrics::BirdClassificationStage);
+        result.m_isBird = classifyFullScale(m_classifiers[0].get(), grayImage);
+        classificationTimer.stop();
+        grayImage = cv::Mat();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_results.push_back(result);
+        return true;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_running || (m_requests.size() >= MAX_PENDING_REQUESTS)
+            || (m_pendingTracks.count(trackId) > 0)) {
+        return false;
+    }
+    Request request;
+    request.m_trackId = trackId;
+    request.m_image = grayImage;
+    grayImage = cv::Mat();
+    m_requests.push_back(request);
+    m_pendingTracks.insert(trackId);
+    if (m_workerQueue) {
+        m_workerQueue->post(std::bind(&BirdClassifier::classifyQueued, this));
+    } else {
+        m_requestAvailable.notify_one();
+    }
+    return true;
+}
+
+void BirdClassifier::takeResults(std::vector<BirdClassificationResult>& results)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    results.insert(results.end(), m_results.begin(), m_results.end());
+    m_results.clear();
+}
+
+void BirdClassifier::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running = false;
+        m_requests.clear();
+        m_requestAvailable.notify_all();
+    }
+    for (unsigned int i = 0; i < m_workers.size(); i++) {
+        m_workers[i]->join();
+    }
+    if (m_workerQueue) {
+        // queued tasks find no requests and return
+        m_workerQueue->waitIdle();
+    }
+    m_workers.clear();
+    m_freeClassifiers.clear();
+    m_classifiers.clear();
+    m_pendingTracks.clear();
+    m_results.clear();
+    m_initialized = false;
+}
+
+void BirdClassifier::workerThread(cv::CascadeClassifier* classifier)
+{
+    std::vector<Request> batch;
+
+    while (true) {
+        batch.clear();
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            while (m_running && m_requests.empty()) {
+                m_requestAvailable.wait(lock);
+            }
+            if (!m_running) {
+                return;
+            }
+            while (!m_requests.empty() && (batch.size() < BATCH_SIZE)) {
+                batch.push_back(m_requests.front());
+                m_requests.pop_front();
+            }
+        }
+        classifyRequests(classifier, batch);
+    }
+}
+
+void BirdClassifier::classifyQueued()
+{
+    std::vector<Request> batch;
+    cv::CascadeClassifier* classifier = NULL;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_running || m_requests.empty() || m_freeClassifiers.empty()) {
+            // an earlier task took the requests already
+            return;
+        }
+        classifier = m_freeClassifiers.back();
+        m_freeClassifiers.pop_back();
+        while (!m_requests.empty() && (batch.size() < BATCH_SIZE)) {
+            batch.push_back(m_requests.front());
+            m_requests.pop_front();
+        }
+    }
+    classifyRequests(classifier, batch);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_freeClassifiers.push_back(classifier);
+}
+
+void BirdClassifier::classifyRequests(cv::CascadeClassifier* classifier, const std::vector<Request>& batch)
+{
+    std::vector<BirdClassificationResult> results;
+
+    // classifyBatch() finds fewer birds than the full scale search, see birdclassifier.h
+    MetricsScopedTimer classificationTimer(Metrics::BirdClassificationStage);
+    for (unsigned int i = 0; i < batch.size(); i++) {
+        BirdClassificationResult result;
+        result.m_trackId = batch[i].m_trackId;
+        result.m_isBird = classifyFullScale(classifier, batch[i].m_image);
+        results.push_back(result);
+    }
+    classificationTimer.stop();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (unsigned int i = 0; i < results.size(); i++) {
+        m_pendingTracks.erase(results[i].m_trackId);
+        m_results.push_back(results[i]);
+    }
+}
+
+cv::Mat BirdClassifier::normalizeImage(const cv::Mat& grayImage)
+{
+    int shorterSide = std::min(grayImage.cols, grayImage.rows);
+    if (shorterSide < m_minObjectSize) {
+        // the classifier can't find anything smaller than its window
+        return cv::Mat();
+    }
+    if (shorterSide <= m_canonicalSize) {
+        return grayImage;
+    }
+    double scale = (double)m_canonicalSize / (double)shorterSide;
+    cv::Mat scaled;
+    cv::resize(grayImage, scaled, cv::Size(), scale, scale, cv::INTER_AREA);
+    return scaled;
+}
+
+std::vector<bool> BirdClassifier::classifyBatch(cv::CascadeClassifier* classifier, const std::vector<cv::Mat>& grayImages)
+{
+    std::vector<bool> verdicts(grayImages.size(), false);
+    std::vector<cv::Mat> normalized(grayImages.size());
+    std::vector<cv::Rect> tiles(grayImages.size());
+    int mosaicWidth = 0;
+    int mosaicHeight = 0;
+
+    for (unsigned int i = 0; i < grayImages.size(); i++) {
+        normalized[i] = normalizeImage(grayImages[i]);
+        if (normalized[i].empty()) {
+            continue;
+        }
+        tiles[i] = cv::Rect(mosaicWidth, 0, normalized[i].cols, normalized[i].rows);
+        mosaicWidth += normalized[i].cols + MOSAIC_GAP;
+        mosaicHeight = std::max(mosaicHeight, normalized[i].rows);
+    }
+    if (mosaicWidth == 0) {
+        return verdicts;
+    }
+
+    cv::Mat mosaic(mosaicHeight, mosaicWidth, CV_8UC1, cv::Scalar(0));
+    for (unsigned int i = 0; i < normalized.size(); i++) {
+        if (!normalized[i].empty()) {
+            normalized[i].copyTo(mosaic(tiles[i]));
+        }
+    }
+
+    std::vector<cv::Rect> birds;
+    classifier->detectMultiScale(mosaic, birds, 1.1, 2, 0|CV_HAAR_SCALE_IMAGE,
+                                 cv::Size(m_minObjectSize, m_minObjectSize),
+                                 cv::Size(mosaicHeight, mosaicHeight));
+
+    // a detection counts only if it is completely inside one image
+    for (unsigned int b = 0; b < birds.size(); b++) {
+        for (unsigned int i = 0; i < tiles.size(); i++) {
+            if (!normalized[i].empty() && ((birds[b] & tiles[i]) == birds[b])) {
+                verdicts[i] = true;
+                break;
+            }
+        }
+    }
+    return verdicts;
+}
+
+bool BirdClassifier::classifyFullScale(cv::CascadeClassifier* classifier, const cv::Mat& grayImage)
+{
+    std::vector<cv::Rect> birds;
+    classifier->detectMultiScale(grayImage, birds, 1.1, 2, 0|CV_HAAR_SCALE_IMAGE,
+                                 cv::Size(m_minObjectSize, m_minObjectSize));
+    return !birds.empty();
+}
@@ -0,0 +1,183 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BIRDCLASSIFIER_H
+#define BIRDCLASSIFIER_H
+
+#include "metrics.h"
+#include "workerpool.h"
+#include <QObject>
+#include <opencv2/objdetect/objdetect.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <set>
+#include <vector>
+#include <memory>
+#include <string>
+#include <algorithm>
+
+/**
+ * @brief Result of classifying a single object.
+ */
+struct BirdClassificationResult {
+    size_t m_trackId;   ///< ID of the track the object belongs to
+    bool m_isBird;      ///< whether the object was classified as a bird
+};
+
+/**
+ * @brief Classifies bright objects as birds on worker threads.
+ *
+ * The detection thread queues gray object images with requestClassification()
+ * and collects finished results with takeResults() on a later frame, so the
+ * cascade classifier never runs inside the detection loop. Each worker thread
+ * has its own cv::CascadeClassifier instance.
+ *
+ * Workers take up to BATCH_SIZE queued images at a time and classify each one
+ * at its original size with classifyFullScale().
+ *
+ * classifyBatch() is a faster alternative: images are scaled to a canonical
+ * size slightly larger than the minimum object size and placed side by side in
+ * one mosaic image, which is classified with a single detectMultiScale() call.
+ * It is not used for detection until it finds as many birds as the full scale
+ * search on real bird crops, testBirdClassifier compares both.
+ *
+ * With setWorkerQueue() classification runs as tasks of a shared WorkerPool
+ * instead of own worker threads.
+ */
+class BirdClassifier : public QObject
+{
+    Q_OBJECT
+public:
+    explicit BirdClassifier(QObject *parent = 0);
+    ~BirdClassifier();
+
+    /**
+     * @brief Load classifier training data and start worker threads.
+     * Calling this again for an initialized object does nothing.
+     * @param trainingFile cascade classifier file
+     * @param minObjectSize smallest object side length in pixels the classifier looks for
+     * @param workerCount number of worker threads, 0 = choose by hardware concurrency
+     * @return true if training data was loaded, false otherwise
+     */
+    bool init(std::string trainingFile, int minObjectSize, int workerCount = 0);
+
+    /**
+     * @brief Whether init() has succeeded.
+     */
+    bool isInitialized();
+
+    /**
+     * @brief Classify in requestClassification() instead of worker threads.
+     * The result is then available right away, which makes results independent
+     * of thread timing, e.g. when replaying a detection session. Call before init().
+     */
+    void setSynchronous(bool synchronous);
+
+    /**
+     * @brief Classify in tasks of a shared worker pool instead of own worker threads.
+     * One classifier is loaded for each task that may run at the same time. Call before init().
+     * @param queue pool queue for classification tasks, NULL = use own threads
+     */
+    void setWorkerQueue(WorkerPool::Queue* queue);
+
+    /**
+     * @brief Queue an object image for classification. Never blocks.
+     * @param trackId ID of the track the object belongs to
+     * @param grayImage gray object image, ownership is taken over
+     * @return false if a request for the track is already pending or the queue is full
+     */
+    bool requestClassification(size_t trackId, cv::Mat& grayImage);
+
+    /**
+     * @brief Move finished results into the given list. Never blocks on classification.
+     * @param results list where the results are appended
+     */
+    void takeResults(std::vector<BirdClassificationResult>& results);
+
+    /**
+     * @brief Stop worker threads. Pending requests are discarded.
+     */
+    void stop();
+
+    /**
+     * @brief Classify images with the batched, size-normalized method. Not used for detection yet.
+     * @param classifier classifier to use
+     * @param grayImages gray object images
+     * @return bird verdict for each image
+     */
+    std::vector<bool> classifyBatch(cv::CascadeClassifier* classifier, const std::vector<cv::Mat>& grayImages);
+
+    /**
+     * @brief Classify a single image at its original size, searching all scales.
+     * Used by the workers and in synchronous mode.
+     */
+    bool classifyFullScale(cv::CascadeClassifier* classifier, const cv::Mat& grayImage);
+
+#ifndef _UNIT_TEST_
+private:
+#endif
+    /**
+     * @brief A queued classification request.
+     */
+    struct Request {
+        size_t m_trackId;
+        cv::Mat m_image;
+    };
+
+    const size_t MAX_PENDING_REQUESTS = 16;
+    const size_t BATCH_SIZE = 8;            ///< max. number of requests taken at once, and of images in a classifyBatch() mosaic
+    const int MOSAIC_GAP = 2;               ///< empty pixels between images in mosaic
+
+    std::vector<std::unique_ptr<cv::CascadeClassifier> > m_classifiers; ///< one classifier per worker
+    std::vector<cv::CascadeClassifier*> m_freeClassifiers; ///< classifiers not used by pool tasks
+    WorkerPool::Queue* m_workerQueue;       ///< shared pool queue, NULL = own worker threads
+    std::vector<std::unique_ptr<std::thread> > m_workers;
+    std::mutex m_mutex;                     ///< guards requests, results and pending tracks
+    std::condition_variable m_requestAvailable;
+    std::deque<Request> m_requests;
+    std::vector<BirdClassificationResult> m_results;
+    std::set<size_t> m_pendingTracks;       ///< tracks with a request queued or being classified
+    bool m_running;
+    bool m_initialized;
+    bool m_synchronous;         ///< classify in the calling thread, no workers
+    int m_minObjectSize;
+    int m_canonicalSize;        ///< side length of the shorter side of normalized images
+
+    void workerThread(cv::CascadeClassifier* classifier);
+
+    /**
+     * @brief Pool task: classify up to BATCH_SIZE queued requests with a free classifier.
+     */
+    void classifyQueued();
+
+    /**
+     * @brief Classify a batch of requests and publish the results.
+     */
+    void classifyRequests(cv::CascadeClassifier* classifier, const std::vector<Request>& batch);
+
+    /**
+     * @brief Scale image so that its shorter side is at most the canonical size.
+     * @return scaled image, or empty image if the image is smaller than the minimum object size
+     */
+    cv::Mat normalizeImage(const cv::Mat& grayImage);
+};
+
+#endif // BIRDCLASSIFIER_H
@@ -0,0 +1,94 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "brightnessthresholds.h"
+#include <QStringList>
+
+namespace {
+
+template<int... Indices> struct IndexList {};
+
+template<int N, int... Indices>
+struct MakeIndexList : MakeIndexList<N - 1, N - 1, Indices...> {};
+
+template<int... Indices>
+struct MakeIndexList<0, Indices...> {
+    typedef IndexList<Indices...> type;
+};
+
+template<int... Indices>
+constexpr BrightnessThresholdTable::Table makeDefaultTable(IndexList<Indices...>)
+{
+    return BrightnessThresholdTable::Table{{ defaultBrightnessThresholds(Indices)... }};
+}
+
+constexpr BrightnessThresholdTable::Table DEFAULT_TABLE = makeDefaultTable(MakeIndexList<256>::type());
+
+} // namespace
+
+BrightnessThresholdTable::BrightnessThresholdTable()
+{
+    reset();
+}
+
+const BrightnessThresholdTable::Table& BrightnessThresholdTable::defaultTable()
+{
+    return DEFAULT_TABLE;
+}
+
+void BrightnessThresholdTable::reset()
+{
+    m_table = DEFAULT_TABLE;
+}
+
+bool BrightnessThresholdTable::load(const QString& definition)
+{
+    if (definition.trimmed().isEmpty()) {
+        reset();
+        return true;
+    }
+
+    Table table;
+    int first = 0;
+    QStringList entries = definition.split(';', QString::SkipEmptyParts);
+    foreach (QString entry, entries) {
+        QStringList values = entry.split(':');
+        if (values.size() != 3) {
+            return false;
+        }
+        bool limitOk, lightOk, blackOk;
+        int limit = values[0].trimmed().toInt(&limitOk);
+        BrightnessThresholds thresholds;
+        thresholds.minLight = values[1].trimmed().toInt(&lightOk);
+        thresholds.minBlack = values[2].trimmed().toInt(&blackOk);
+        if (!limitOk || !lightOk || !blackOk || (limit <= first) || (limit > 256)
+                || (thresholds.minLight < 0) || (thresholds.minLight > 255)
+                || (thresholds.minBlack < 0) || (thresholds.minBlack > 256)) {
+            return false;
+        }
+        for (int i = first; i < limit; i++) {
+            table[i] = thresholds;
+        }
+        first = limit;
+    }
+    if (first != 256) {
+        return false;
+    }
+    m_table = table;
+    return true;
+}
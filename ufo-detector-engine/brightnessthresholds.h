@@ -0,0 +1,99 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BRIGHTNESSTHRESHOLDS_H
+#define BRIGHTNESSTHRESHOLDS_H
+
+#include <QString>
+#include <array>
+
+/**
+ * @brief Pixel brightness limits for classifying object pixels as light or dark.
+ */
+struct BrightnessThresholds {
+    int minLight;   ///< pixels brighter than this are light
+    int minBlack;   ///< pixels darker than this are dark
+};
+
+/**
+ * @brief Default thresholds for an average image brightness (0-255).
+ */
+constexpr BrightnessThresholds defaultBrightnessThresholds(int averageBrightness)
+{
+    return averageBrightness < 10 ? BrightnessThresholds{50, 30}
+         : averageBrightness < 70 ? BrightnessThresholds{90, 75}
+         : averageBrightness < 100 ? BrightnessThresholds{110, 85}
+         : averageBrightness < 130 ? BrightnessThresholds{150, 130}
+         : averageBrightness < 150 ? BrightnessThresholds{160, 145}
+         : averageBrightness < 180 ? BrightnessThresholds{190, 170}
+         : averageBrightness < 210 ? BrightnessThresholds{215, 205}
+         : averageBrightness < 230 ? BrightnessThresholds{235, 225}
+         : averageBrightness < 241 ? BrightnessThresholds{243, 235}
+         : BrightnessThresholds{250, 240};
+}
+
+/**
+ * @brief Lookup table from average image brightness to brightness thresholds.
+ *
+ * The default table is generated at compile time from defaultBrightnessThresholds().
+ * It can be replaced at runtime with a definition string of the form
+ * "limit:minLight:minBlack;limit:minLight:minBlack;..." where each entry applies
+ * to average brightness values below its limit and above the previous limit.
+ * The limits must be ascending and the last one must be 256.
+ */
+class BrightnessThresholdTable
+{
+public:
+    typedef std::array<BrightnessThresholds, 256> Table;
+
+    /**
+     * @brief Create table with default thresholds.
+     */
+    BrightnessThresholdTable();
+
+    /**
+     * @brief Thresholds for an average brightness. Values outside 0-255 are clamped.
+     */
+    BrightnessThresholds lookup(int averageBrightness) const
+    {
+        return m_table[averageBrightness < 0 ? 0 : (averageBrightness > 255 ? 255 : averageBrightness)];
+    }
+
+    /**
+     * @brief Load table from definition string. Empty definition restores the defaults.
+     * @return false if the definition is invalid, in which case the table is not changed
+     */
+    bool load(const QString& definition);
+
+    /**
+     * @brief Restore default thresholds.
+     */
+    void reset();
+
+    /**
+     * @brief The table generated at compile time.
+     */
+    static const Table& defaultTable();
+
+#ifndef _UNIT_TEST_
+private:
+#endif
+    Table m_table;
+};
+
+#endif // BRIGHTNESSTHRESHOLDS_H
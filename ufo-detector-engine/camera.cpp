@@ -24,6 +24,14 @@ Camera::Camera(int index, int width, int height)
     m_width = width;
     m_height = height;
     m_initialized = false;
+    m_webcam = NULL;
+    m_frameFormat = CameraFrame::BGR;
+    m_capturing = false;
+    m_frameSequence = 0;
+    m_frameRate = 0;
+    m_useDriverTimestamps = true;
+    m_lastDriverTimestampUs = -1;
+    m_lastTimestampUs = 0;
 
     m_cameraInfo = new CameraInfo(m_index);
     connect(m_cameraInfo, SIGNAL(queryProgressChanged(int)), this, SIGNAL(queryProgressChanged(int)));
@@ -31,8 +39,16 @@ Camera::Camera(int index, int width, int height)
     std::cout << "Constructed camera with index " << m_index <<  std::endl;
 }
 
+Camera::~Camera()
+{
+    release();
+    delete m_webcam;
+}
+
 bool Camera::init()
 {
+    release();
+    delete m_webcam;
     m_webcam = new cv::VideoCapture(m_index);
     m_webcam->open(m_index);
     m_webcam->set(CV_CAP_PROP_FRAME_WIDTH, m_width);
@@ -46,12 +62,22 @@ bool Camera::init()
                     "but got" << actualWidth << "x" << actualHeight;
     }
 
+    m_frameSize = cv::Size(actualWidth, actualHeight);
+    m_frameFormat = CameraFrame::BGR;
+
     if(m_webcam->isOpened())
     {
-        m_webcam->read(videoFrame);
+        initRawCapture();
     } else {
         return false;
     }
+    m_useDriverTimestamps = true;
+    m_lastDriverTimestampUs = -1;
+    m_frameTimestamps.clear();
+    // first frame is available right after init()
+    readFrame();
+    m_capturing = true;
+    m_captureThread.reset(new std::thread(&Camera::captureThread, this));
     m_initialized = true;
     return true;
 }
@@ -67,21 +93,146 @@ void Camera::release()
     {
         return;
     }
+    if (m_captureThread)
+    {
+        // a read in progress ends with the next frame
+        m_capturing = false;
+        m_captureThread->join();
+        m_captureThread.reset();
+    }
     m_webcam->release();
     m_initialized = false;
 }
 
+void Camera::initRawCapture()
+{
+    int fourcc = (int)m_webcam->get(CV_CAP_PROP_FOURCC);
+    CameraFrame::Format format;
+    if ((fourcc == CV_FOURCC('Y', 'U', 'Y', 'V')) || (fourcc == CV_FOURCC('Y', 'U', 'Y', '2'))) {
+        format = CameraFrame::YUYV;
+    } else if (fourcc == CV_FOURCC('N', 'V', '1', '2')) {
+        format = CameraFrame::NV12;
+    } else {
+        return;
+    }
+    if (!m_webcam->set(CV_CAP_PROP_CONVERT_RGB, 0)) {
+        return;
+    }
+    // not all backends honor the setting, so check what we really get
+    cv::Mat rawFrame;
+    m_webcam->read(rawFrame);
+    if (CameraFrame::fromRawData(rawFrame, format, m_frameSize.width, m_frameSize.height).empty()) {
+        m_webcam->set(CV_CAP_PROP_CONVERT_RGB, 1);
+        return;
+    }
+    m_frameFormat = format;
+    qDebug() << "Reading camera frames without color conversion";
+}
+
+void Camera::captureThread()
+{
+    while (m_capturing)
+    {
+        if (!readFrame())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(READ_RETRY_PAUSE_MS));
+        }
+    }
+}
+
+bool Camera::readFrame()
+{
+    // new buffer for each frame, consumers may still hold the previous one
+    cv::Mat data;
+    if (!m_webcam->read(data) || data.empty())
+    {
+        return false;
+    }
+    qint64 timestampUs = frameTimestampUs(steadyClockUs());
+    CameraFrame frame = (m_frameFormat != CameraFrame::BGR)
+            ? CameraFrame::fromRawData(data, m_frameFormat, m_frameSize.width, m_frameSize.height)
+            : CameraFrame(data);
+    frame.setTimestampUs(timestampUs);
+    Metrics::instance().count(Metrics::FramesRead);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    m_latestFrame = frame;
+    m_frameSequence++;
+    m_frameTimestamps.push_back(timestampUs);
+    if (m_frameTimestamps.size() > FRAME_RATE_WINDOW)
+    {
+        m_frameTimestamps.pop_front();
+    }
+    qint64 windowUs = m_frameTimestamps.back() - m_frameTimestamps.front();
+    if (windowUs > 0)
+    {
+        m_frameRate = (double)(m_frameTimestamps.size() - 1) * 1000000.0 / (double)windowUs;
+    }
+    m_frameAvailable.notify_all();
+    return true;
+}
+
+qint64 Camera::frameTimestampUs(qint64 arrivalUs)
+{
+    if (m_useDriverTimestamps)
+    {
+        qint64 driverUs = (qint64)(m_webcam->get(CV_CAP_PROP_POS_MSEC) * 1000.0);
+        if ((driverUs > 0) && (driverUs > m_lastDriverTimestampUs))
+        {
+            // keep the steady clock as time base, take only the intervals from the driver
+            qint64 timestampUs = (m_lastDriverTimestampUs < 0)
+                    ? arrivalUs : m_lastTimestampUs + (driverUs - m_lastDriverTimestampUs);
+            m_lastDriverTimestampUs = driverUs;
+            m_lastTimestampUs = timestampUs;
+            return timestampUs;
+        }
+        // no usable driver timestamps, use the arrival time from now on
+        m_useDriverTimestamps = false;
+    }
+    m_lastTimestampUs = std::max(arrivalUs, m_lastTimestampUs + 1);
+    return m_lastTimestampUs;
+}
+
+qint64 Camera::steadyClockUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 /*
  * Get current frame 
  */
 cv::Mat Camera::getWebcamFrame()
 {
-    if (m_webcam) {
-        mutex.lock();
-        m_webcam->read(videoFrame);
-        mutex.unlock();
+    return getCameraFrame().bgr();
+}
+
+CameraFrame Camera::getCameraFrame()
+{
+    // consumers share the frame and its converted images
+    std::lock_guard<std::mutex> lock(mutex);
+    return m_latestFrame;
+}
+
+CameraFrame Camera::waitNextFrame(quint64& sequence, int timeoutMs)
+{
+    CameraFrame latestFrame;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!m_frameAvailable.wait_for(lock, std::chrono::milliseconds(timeoutMs),
+                [this, sequence]() { return m_frameSequence > sequence; })) {
+            return CameraFrame();
+        }
+        sequence = m_frameSequence;
+        latestFrame = m_latestFrame;
     }
-    return videoFrame;
+    return latestFrame;
+}
+
+double Camera::frameRate()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return m_frameRate;
 }
 
 /*
@@ -101,9 +252,13 @@ int Camera::index()
     return m_index;
 }
 
-bool Camera::queryAvailableResolutions(bool verboseQuery)
+bool Camera::queryAvailableResolutions(bool verboseQuery, bool refresh)
 {
-    if (!m_cameraInfo->isInitialized())
+    if (refresh)
+    {
+        m_cameraInfo->invalidateCache();
+    }
+    if (!m_cameraInfo->isInitialized() && !m_cameraInfo->initWithoutProbing())
     {
         // first release current cv::VideoCapture
         this->release();
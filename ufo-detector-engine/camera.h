@@ -20,11 +20,16 @@
 #define CAMERA_H
 
 #include "camerainfo.h"
+#include "cameraframe.h"
+#include "metrics.h"
 #include <opencv2/highgui/highgui.hpp>
 #include <mutex>
 #include <thread>
 #include <atomic>
 #include <memory>
+#include <condition_variable>
+#include <chrono>
+#include <deque>
 #include <QObject>
 #include <iostream>
 #include <opencv2/imgproc/imgproc.hpp>
@@ -33,6 +38,10 @@
 /**
  * @brief Main camera class to handle reading of frames from multiple threads
  *
+ * A capture thread reads frames as fast as the camera delivers them and wakes up
+ * threads waiting in waitNextFrame(). Each frame gets a sequence number and a
+ * capture timestamp, so consumers are paced by the camera instead of own timers.
+ *
  * @todo add setResolution(width, height) method to apply resolution change on-the-fly
  */
 class Camera : public QObject
@@ -49,6 +58,7 @@ public:
      * you will get nearest supported resolution anyway.
      */
     Camera(int index, int width, int height);
+    ~Camera();
 
     /**
      * @brief Initialize and open camera.
@@ -63,15 +73,39 @@ public:
     bool isInitialized();
 
     /**
-     * @brief Stop and close camera.
+     * @brief Stop capture thread and close camera.
      */
     void release();
 
     /**
-     * @brief Get the current/newest frame from camera.
-     * @return
+     * @brief Get the newest frame from camera. Doesn't wait for a new frame.
+     * @return BGR image shared with other consumers, clone it before drawing on it
      */
     cv::Mat getWebcamFrame();
+
+    /**
+     * @brief Get a copy of the newest frame from camera in the format delivered by the camera.
+     * Gray and color images are computed from it only when needed, and only once for all
+     * consumers of the frame. Doesn't wait for a new frame.
+     */
+    CameraFrame getCameraFrame();
+
+    /**
+     * @brief Wait until the camera has delivered a frame newer than the caller's previous one.
+     * A caller slower than the camera gets the newest frame, the ones in between are skipped.
+     * @param sequence sequence number of the previous frame, 0 if none;
+     *        set to the sequence number of the returned frame
+     * @param timeoutMs max. time to wait
+     * @return copy of the frame with its capture timestamp, or an empty frame on timeout
+     */
+    CameraFrame waitNextFrame(quint64& sequence, int timeoutMs = FRAME_TIMEOUT_MS);
+
+    /**
+     * @brief Frame rate measured from capture timestamps of recent frames.
+     * @return frames per second, or 0 if not enough frames have been captured yet
+     */
+    double frameRate();
+
     bool isWebcamOpen();
 
     /**
@@ -82,10 +116,14 @@ public:
 
     /**
      * @brief Run web camera resolution query.
+     * Results from the camera driver or the resolution cache are used without
+     * releasing the camera. Only when neither is available the camera is
+     * released and resolutions are probed one by one.
      * @param verboseQuery Whether to print query results for each query
+     * @param refresh Forget cached resolutions of this camera and query again
      * @return
      */
-    bool queryAvailableResolutions(bool verboseQuery = false);
+    bool queryAvailableResolutions(bool verboseQuery = false, bool refresh = false);
 
     /**
      * @brief List of available web camera resolutions.
@@ -99,17 +137,60 @@ public:
      */
     QList<int> knownAspectRatios();
 
+    static const int FRAME_TIMEOUT_MS = 250;     ///< default max. wait in waitNextFrame()
+
 #ifndef _UNIT_TEST_
 private:
 #endif
+    const size_t FRAME_RATE_WINDOW = 30;        ///< number of frame timestamps frame rate is measured over
+    const int READ_RETRY_PAUSE_MS = 100;        ///< pause after a failed read, e.g. camera unplugged
+
     int m_index;    ///< camera index as used by OpenCV
     int m_width;
     int m_height;
     cv::VideoCapture* m_webcam;
-    cv::Mat videoFrame;
     std::mutex mutex;
     CameraInfo* m_cameraInfo;
     bool m_initialized;     ///< whether camera is initialized or not
+    CameraFrame::Format m_frameFormat;  ///< format of frames read from m_webcam
+    cv::Size m_frameSize;   ///< actual frame size
+
+    std::unique_ptr<std::thread> m_captureThread;
+    std::atomic<bool> m_capturing;          ///< capture thread run flag
+    std::condition_variable m_frameAvailable;   ///< notified for each new frame, guarded by mutex
+    CameraFrame m_latestFrame;              ///< newest frame, its data is never written again
+    quint64 m_frameSequence;                ///< sequence number of m_latestFrame
+    std::deque<qint64> m_frameTimestamps;   ///< capture timestamps of recent frames
+    double m_frameRate;                     ///< measured frame rate, guarded by mutex
+    bool m_useDriverTimestamps;             ///< whether the capture backend gives usable frame timestamps
+    qint64 m_lastDriverTimestampUs;         ///< driver timestamp of the previous frame, -1 = none
+    qint64 m_lastTimestampUs;               ///< capture timestamp of the previous frame
+
+    /**
+     * @brief Read YUYV and NV12 frames without conversion to BGR if the capture backend allows it.
+     */
+    void initRawCapture();
+
+    void captureThread();
+
+    /**
+     * @brief Read a frame from m_webcam, make it the newest frame and wake up waiting threads.
+     * @return false if reading failed
+     */
+    bool readFrame();
+
+    /**
+     * @brief Capture timestamp of the frame just read, on the steady clock.
+     * Driver timestamps are used for the intervals between frames when the backend
+     * gives increasing ones, arrival time otherwise.
+     * @param arrivalUs steady clock time the read finished
+     */
+    qint64 frameTimestampUs(qint64 arrivalUs);
+
+    /**
+     * @brief Current steady clock time in microseconds.
+     */
+    static qint64 steadyClockUs();
 
 signals:
     /**
@@ -0,0 +1,215 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "cameraframe.h"
+
+namespace {
+
+/*
+ * Take the first pixel of each factor x factor block. resize() with INTER_NEAREST
+ * may be off by one pixel for factors that are not a power of two.
+ */
+void takeBlockOrigins(const cv::Mat& image, int factor, cv::Mat& downscaled)
+{
+    downscaled.create(image.rows / factor, image.cols / factor, CV_8UC1);
+    for (int y = 0; y < downscaled.rows; y++) {
+        const uchar* imageRow = image.ptr<uchar>(y * factor);
+        uchar* downscaledRow = downscaled.ptr<uchar>(y);
+        for (int x = 0; x < downscaled.cols; x++) {
+            downscaledRow[x] = imageRow[x * factor];
+        }
+    }
+}
+
+}
+
+CameraFrame::CameraFrame()
+{
+    m_planes = std::make_shared<Planes>();
+    m_planes->m_format = CameraFrame::BGR;
+    m_timestampUs = 0;
+}
+
+CameraFrame::CameraFrame(const cv::Mat& data, Format format)
+{
+    m_planes = std::make_shared<Planes>();
+    m_planes->m_format = format;
+    m_planes->m_data = data;
+    m_timestampUs = 0;
+}
+
+CameraFrame CameraFrame::fromRawData(const cv::Mat& data, Format format, int width, int height)
+{
+    if (data.empty() || (width <= 0) || (height <= 0) || !data.isContinuous() || (data.depth() != CV_8U)) {
+        return CameraFrame();
+    }
+    size_t bytes = data.total() * data.elemSize();
+    switch (format) {
+    case CameraFrame::YUYV:
+        if (bytes != (size_t)width * height * 2) {
+            return CameraFrame();
+        }
+        return CameraFrame(cv::Mat(height, width, CV_8UC2, data.data).clone(), format);
+    case CameraFrame::NV12:
+        if ((height % 2 != 0) || (bytes != (size_t)width * height * 3 / 2)) {
+            return CameraFrame();
+        }
+        return CameraFrame(cv::Mat(height * 3 / 2, width, CV_8UC1, data.data).clone(), format);
+    default:
+        if (bytes != (size_t)width * height * 3) {
+            return CameraFrame();
+        }
+        return CameraFrame(cv::Mat(height, width, CV_8UC3, data.data).clone(), format);
+    }
+}
+
+bool CameraFrame::empty() const
+{
+    return m_planes->m_data.empty();
+}
+
+CameraFrame::Format CameraFrame::format() const
+{
+    return m_planes->m_format;
+}
+
+cv::Size CameraFrame::size() const
+{
+    if (m_planes->m_format == CameraFrame::NV12) {
+        return cv::Size(m_planes->m_data.cols, m_planes->m_data.rows * 2 / 3);
+    }
+    return m_planes->m_data.size();
+}
+
+qint64 CameraFrame::timestampUs() const
+{
+    return m_timestampUs;
+}
+
+void CameraFrame::setTimestampUs(qint64 timestampUs)
+{
+    m_timestampUs = timestampUs;
+}
+
+const cv::Mat& CameraFrame::data() const
+{
+    return m_planes->m_data;
+}
+
+const cv::Mat& CameraFrame::bgr()
+{
+    std::lock_guard<std::mutex> lock(m_planes->m_mutex);
+    cv::Mat& bgr = m_planes->m_bgr;
+    const cv::Mat& data = m_planes->m_data;
+    if (bgr.empty() && !data.empty()) {
+        switch (m_planes->m_format) {
+        case CameraFrame::YUYV:
+            cv::cvtColor(data, bgr, CV_YUV2BGR_YUYV);
+            break;
+        case CameraFrame::NV12:
+            cv::cvtColor(data, bgr, CV_YUV2BGR_NV12);
+            break;
+        default:
+            bgr = data;
+            break;
+        }
+    }
+    return bgr;
+}
+
+const cv::Mat& CameraFrame::gray()
+{
+    std::lock_guard<std::mutex> lock(m_planes->m_mutex);
+    return lockedGray();
+}
+
+const cv::Mat& CameraFrame::lockedGray()
+{
+    cv::Mat& gray = m_planes->m_gray;
+    const cv::Mat& data = m_planes->m_data;
+    if (gray.empty() && !data.empty()) {
+        switch (m_planes->m_format) {
+        case CameraFrame::YUYV:
+            cv::cvtColor(data, gray, CV_YUV2GRAY_YUYV);
+            break;
+        case CameraFrame::NV12:
+            // Y plane, no copy
+            gray = data.rowRange(0, size().height);
+            break;
+        default:
+            // same conversion the detector has always used for camera frames
+            cv::cvtColor(data, gray, CV_RGB2GRAY);
+            break;
+        }
+    }
+    return gray;
+}
+
+const cv::Mat& CameraFrame::downscaledGrayMax(int factor)
+{
+    std::lock_guard<std::mutex> lock(m_planes->m_mutex);
+    return lockedDownscaledGray(factor).first;
+}
+
+const cv::Mat& CameraFrame::downscaledGrayMin(int factor)
+{
+    std::lock_guard<std::mutex> lock(m_planes->m_mutex);
+    return lockedDownscaledGray(factor).second;
+}
+
+const std::pair<cv::Mat, cv::Mat>& CameraFrame::lockedDownscaledGray(int factor)
+{
+    // an image once computed is never replaced, copies may still use it
+    std::pair<cv::Mat, cv::Mat>& extremes = m_planes->m_downscaledGray[factor];
+    if (extremes.first.empty() && !m_planes->m_data.empty() && (factor > 0)) {
+        downscaleGrayExtremes(lockedGray(), factor, extremes.first, extremes.second);
+    }
+    return extremes;
+}
+
+void CameraFrame::downscaleGrayExtremes(const cv::Mat& gray, int factor, cv::Mat& brightest, cv::Mat& darkest)
+{
+    cv::Mat kernel = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(factor, factor));
+    cv::Mat extremes;
+    // with the anchor at the kernel origin, each pixel gets the extreme of the block starting at it
+    cv::dilate(gray, extremes, kernel, cv::Point(0, 0));
+    takeBlockOrigins(extremes, factor, brightest);
+    cv::erode(gray, extremes, kernel, cv::Point(0, 0));
+    takeBlockOrigins(extremes, factor, darkest);
+}
+
+const cv::Mat& CameraFrame::rgb()
+{
+    std::lock_guard<std::mutex> lock(m_planes->m_mutex);
+    cv::Mat& rgb = m_planes->m_rgb;
+    const cv::Mat& data = m_planes->m_data;
+    if (rgb.empty() && !data.empty()) {
+        switch (m_planes->m_format) {
+        case CameraFrame::YUYV:
+            cv::cvtColor(data, rgb, CV_YUV2RGB_YUYV);
+            break;
+        case CameraFrame::NV12:
+            cv::cvtColor(data, rgb, CV_YUV2RGB_NV12);
+            break;
+        default:
+            cv::cvtColor(data, rgb, CV_BGR2RGB);
+            break;
+        }
+    }
+    return rgb;
+}
@@ -0,0 +1,152 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CAMERAFRAME_H
+#define CAMERAFRAME_H
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <QtGlobal>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+/**
+ * @brief A camera frame with lazily computed and cached derived images.
+ *
+ * Each derived image (color, gray, downscaled gray, RGB preview) is computed at
+ * most once per frame. For NV12 frames the gray image is the Y plane of the
+ * frame data without copying.
+ *
+ * Copies share the frame data and the derived images, so the detector, the
+ * recorder and the preview of the same frame convert it only once. Each thread
+ * may use its own copy at the same time.
+ *
+ * @note The frame data and the derived images are never written after they have
+ * been computed. Consumers that draw on an image must draw on a clone.
+ */
+class CameraFrame
+{
+public:
+    /**
+     * @brief Pixel format of the frame data.
+     */
+    enum Format {
+        BGR,    ///< CV_8UC3, as delivered by OpenCV by default
+        YUYV,   ///< CV_8UC2, height x width, Y U Y V byte order
+        NV12    ///< CV_8UC1, height * 3 / 2 x width, Y plane followed by interleaved UV plane
+    };
+
+    CameraFrame();
+
+    /**
+     * @brief Create frame from frame data in given format. The data is not copied.
+     */
+    explicit CameraFrame(const cv::Mat& data, Format format = BGR);
+
+    /**
+     * @brief Create frame from raw capture data, which may be a single row of bytes.
+     * @param data raw frame data
+     * @param format format of the data
+     * @param width frame width
+     * @param height frame height
+     * @return frame, or empty frame if the data size doesn't match the format and frame size
+     */
+    static CameraFrame fromRawData(const cv::Mat& data, Format format, int width, int height);
+
+    bool empty() const;
+    Format format() const;
+    cv::Size size() const;
+
+    /**
+     * @brief Capture time of the frame on the steady clock, 0 if unknown.
+     */
+    qint64 timestampUs() const;
+    void setTimestampUs(qint64 timestampUs);
+
+    /**
+     * @brief Frame data as given.
+     */
+    const cv::Mat& data() const;
+
+    /**
+     * @brief Color image in BGR order.
+     */
+    const cv::Mat& bgr();
+
+    /**
+     * @brief Gray image.
+     */
+    const cv::Mat& gray();
+
+    /**
+     * @brief Gray image downscaled to the brightest pixel of each factor x factor block.
+     * Unlike averaging, this keeps objects smaller than a block at their full contrast.
+     * @param factor frame size divided by downscaled size
+     */
+    const cv::Mat& downscaledGrayMax(int factor);
+
+    /**
+     * @brief Gray image downscaled to the darkest pixel of each factor x factor block.
+     * Computed and cached together with downscaledGrayMax().
+     */
+    const cv::Mat& downscaledGrayMin(int factor);
+
+    /**
+     * @brief Downscale a gray image to the brightest and darkest pixel of each factor x factor block.
+     * An incomplete last block column or row is left out.
+     */
+    static void downscaleGrayExtremes(const cv::Mat& gray, int factor, cv::Mat& brightest, cv::Mat& darkest);
+
+    /**
+     * @brief Color image in RGB order, e.g. for QImage::Format_RGB888.
+     */
+    const cv::Mat& rgb();
+
+#ifndef _UNIT_TEST_
+private:
+#endif
+    /**
+     * @brief Frame data and derived images, shared by all copies of a frame.
+     */
+    struct Planes {
+        Format m_format;
+        cv::Mat m_data;
+        std::mutex m_mutex;     ///< guards computing the derived images
+        cv::Mat m_bgr;
+        cv::Mat m_gray;
+        std::map<int, std::pair<cv::Mat, cv::Mat> > m_downscaledGray; ///< brightest and darkest by factor
+        cv::Mat m_rgb;
+    };
+
+    std::shared_ptr<Planes> m_planes;
+    qint64 m_timestampUs;   ///< capture time in microseconds
+
+    /**
+     * @brief Gray image, m_planes->m_mutex must be locked.
+     */
+    const cv::Mat& lockedGray();
+
+    /**
+     * @brief Brightest and darkest downscaled gray images, m_planes->m_mutex must be locked.
+     */
+    const std::pair<cv::Mat, cv::Mat>& lockedDownscaledGray(int factor);
+};
+
+#endif // CAMERAFRAME_H
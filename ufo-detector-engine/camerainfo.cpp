@@ -17,6 +17,45 @@
  */
 
 #include "camerainfo.h"
+#include <QCryptographicHash>
+#include <QFileInfo>
+#include <QFile>
+
+#ifdef Q_OS_LINUX
+#include <linux/videodev2.h>
+#include <sys/ioctl.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#endif
+
+namespace {
+
+/**
+ * @brief Read a sysfs attribute file, empty if it doesn't exist.
+ */
+QString readSysfsValue(const QString& fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QString();
+    }
+    return QString::fromLatin1(file.readAll()).trimmed();
+}
+
+#ifdef Q_OS_LINUX
+int retryIoctl(int fd, unsigned long request, void* argument)
+{
+    int result;
+    do {
+        result = ioctl(fd, request, argument);
+    } while ((result == -1) && (errno == EINTR));
+    return result;
+}
+#endif
+
+}
 
 CameraInfo::CameraInfo(int cameraIndex, QObject *parent, int openCvBackend) : QObject(parent)
 {
@@ -218,15 +257,23 @@ CameraInfo::CameraInfo(int cameraIndex, QObject *parent, int openCvBackend) : QO
 #endif
 
     m_initialized = false;
+    m_resolutionSource = NotQueried;
     updateAspectRatios();
 }
 
 bool CameraInfo::init(bool verboseResolutionQuery) {
+    if (initWithoutProbing()) {
+        return true;
+    }
     bool ok = false;
     m_webCamera = new cv::VideoCapture(m_cameraIndex + m_cameraBackend);
     if (m_webCamera && m_webCamera->open(m_cameraIndex)) {
+        m_availableResolutions.clear();
         ok = queryResolutions(verboseResolutionQuery);
-        if (!ok) {
+        if (ok) {
+            m_resolutionSource = Probed;
+            saveToCache();
+        } else {
             qDebug() << "Querying web camera resolutions failed";
         }
         m_webCamera->release();
@@ -239,6 +286,57 @@ bool CameraInfo::init(bool verboseResolutionQuery) {
     return ok;
 }
 
+bool CameraInfo::initWithoutProbing() {
+    // asking the driver is as fast as reading the cache and never out of date
+    bool ok = false;
+    if (enumerateResolutions()) {
+        m_resolutionSource = Enumerated;
+        ok = true;
+    } else if (loadFromCache()) {
+        m_resolutionSource = Cached;
+        ok = true;
+    }
+    if (ok) {
+        updateAspectRatios();
+        m_initialized = true;
+        emit queryProgressChanged(100);
+    }
+    return ok;
+}
+
+void CameraInfo::invalidateCache() {
+    QSettings* cache = openCache();
+    cache->remove(cacheGroup());
+    delete cache;
+    m_availableResolutions.clear();
+    m_resolutionSource = NotQueried;
+    m_initialized = false;
+}
+
+QString CameraInfo::deviceIdentity() {
+    QString identity;
+#ifdef Q_OS_LINUX
+    // OpenCV camera index N is /dev/videoN with the V4L backends
+    QString deviceDir = QString("/sys/class/video4linux/video%1/device").arg(m_cameraIndex);
+    QString busPath = QFileInfo(deviceDir).canonicalFilePath();
+    if (!busPath.isEmpty()) {
+        QString driver = QFileInfo(QFileInfo(deviceDir + "/driver").canonicalFilePath()).fileName();
+        // the device directory of a USB camera is an interface, IDs are in the parent
+        QString vendorId = readSysfsValue(busPath + "/../idVendor");
+        QString productId = readSysfsValue(busPath + "/../idProduct");
+        identity = QString("%1 %2:%3 %4").arg(busPath, vendorId, productId, driver);
+    }
+#endif
+    if (identity.isEmpty()) {
+        identity = QString("camera%1").arg(m_cameraIndex);
+    }
+    return identity + QString(" backend%1").arg(m_cameraBackend);
+}
+
+void CameraInfo::setCacheFileName(QString fileName) {
+    m_cacheFileName = fileName;
+}
+
 bool CameraInfo::isInitialized() {
     return m_initialized;
 }
@@ -363,3 +461,118 @@ bool CameraInfo::compareResolutionsWidthFirst(QSize res1, QSize res2) {
     }
     return false;
 }
+
+bool CameraInfo::enumerateResolutions() {
+#ifdef Q_OS_LINUX
+    if (m_cameraBackend != CV_CAP_ANY && m_cameraBackend != CV_CAP_V4L && m_cameraBackend != CV_CAP_V4L2) {
+        return false;
+    }
+    QByteArray deviceFile = QString("/dev/video%1").arg(m_cameraIndex).toLocal8Bit();
+    // listing formats works while another handle is capturing
+    int fd = open(deviceFile.constData(), O_RDWR | O_NONBLOCK);
+    if (fd < 0) {
+        return false;
+    }
+    QList<QSize> resolutions;
+    v4l2_fmtdesc format;
+    memset(&format, 0, sizeof(format));
+    format.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    for (format.index = 0; retryIoctl(fd, VIDIOC_ENUM_FMT, &format) == 0; format.index++) {
+        v4l2_frmsizeenum frameSize;
+        memset(&frameSize, 0, sizeof(frameSize));
+        frameSize.pixel_format = format.pixelformat;
+        for (frameSize.index = 0; retryIoctl(fd, VIDIOC_ENUM_FRAMESIZES, &frameSize) == 0; frameSize.index++) {
+            if (frameSize.type == V4L2_FRMSIZE_TYPE_DISCRETE) {
+                QSize resolution(frameSize.discrete.width, frameSize.discrete.height);
+                if (!resolutions.contains(resolution)) {
+                    resolutions << resolution;
+                }
+                continue;
+            }
+            // stepwise or continuous range is the only entry, offer common resolutions within it
+            const v4l2_frmsize_stepwise& range = frameSize.stepwise;
+            int widthStep = std::max(1, (int)range.step_width);
+            int heightStep = std::max(1, (int)range.step_height);
+            QListIterator<QSize> commonIt(m_commonResolutions);
+            while (commonIt.hasNext()) {
+                QSize resolution = commonIt.next();
+                int width = resolution.width();
+                int height = resolution.height();
+                if ((width >= (int)range.min_width) && (width <= (int)range.max_width)
+                        && (height >= (int)range.min_height) && (height <= (int)range.max_height)
+                        && (((width - (int)range.min_width) % widthStep) == 0)
+                        && (((height - (int)range.min_height) % heightStep) == 0)
+                        && !resolutions.contains(resolution)) {
+                    resolutions << resolution;
+                }
+            }
+            break;
+        }
+    }
+    close(fd);
+    if (resolutions.isEmpty()) {
+        return false;
+    }
+    std::sort(resolutions.begin(), resolutions.end(), CameraInfo::compareResolutionsWidthFirst);
+    m_availableResolutions = resolutions;
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool CameraInfo::loadFromCache() {
+    QSettings* cache = openCache();
+    cache->beginGroup(cacheGroup());
+    // the group name is a hash, make sure it's really the same device
+    bool found = (cache->value("identity").toString() == deviceIdentity());
+    QList<QSize> resolutions;
+    QStringListIterator resolutionIt(cache->value("resolutions").toStringList());
+    while (found && resolutionIt.hasNext()) {
+        QStringList size = resolutionIt.next().split('x');
+        if (size.size() == 2) {
+            resolutions << QSize(size.at(0).toInt(), size.at(1).toInt());
+        }
+    }
+    cache->endGroup();
+    delete cache;
+    if (!found || resolutions.isEmpty()) {
+        return false;
+    }
+    m_availableResolutions = resolutions;
+    return true;
+}
+
+void CameraInfo::saveToCache() {
+    QStringList resolutions;
+    QListIterator<QSize> resolutionIt(m_availableResolutions);
+    while (resolutionIt.hasNext()) {
+        QSize resolution = resolutionIt.next();
+        resolutions << QString("%1x%2").arg(resolution.width()).arg(resolution.height());
+    }
+    QSettings* cache = openCache();
+    cache->beginGroup(cacheGroup());
+    cache->setValue("identity", deviceIdentity());
+    cache->setValue("resolutions", resolutions);
+    cache->endGroup();
+    delete cache;
+}
+
+QSettings* CameraInfo::openCache() {
+    QSettings* cache;
+    if (m_cacheFileName.isEmpty()) {
+        cache = new QSettings(QSettings::IniFormat, QSettings::UserScope, "UFOID", "CameraResolutions");
+    } else {
+        cache = new QSettings(m_cacheFileName, QSettings::IniFormat);
+    }
+    if (cache->value("version").toInt() != CACHE_VERSION) {
+        cache->clear();
+        cache->setValue("version", CACHE_VERSION);
+    }
+    return cache;
+}
+
+QString CameraInfo::cacheGroup() {
+    QByteArray hash = QCryptographicHash::hash(deviceIdentity().toUtf8(), QCryptographicHash::Sha1);
+    return QString::fromLatin1(hash.toHex());
+}
@@ -25,10 +25,15 @@
 #include <list>     // for std::list::sort
 #include <algorithm>
 #include <QSize>
+#include <QSettings>
 #include <QDebug>
 
 /**
  * @brief Get information of web camera
+ *
+ * Resolution query results are cached on disk per camera device, so that the
+ * slow trial-and-error probing is done only once for each camera. On Linux the
+ * frame sizes are asked from the V4L2 driver directly when possible.
  */
 class CameraInfo : public QObject
 {
@@ -53,6 +58,32 @@ public:
      */
     bool init(bool verboseResolutionQuery = false);
 
+    /**
+     * @brief Initialize by enumerating the frame sizes of the camera driver or from the resolution cache.
+     * Neither needs the web camera, so it may stay reserved.
+     * @return true if resolutions were found, false if they need to be probed with init()
+     */
+    bool initWithoutProbing();
+
+    /**
+     * @brief Remove cached resolutions of this camera. The next init() queries the camera again.
+     */
+    void invalidateCache();
+
+    /**
+     * @brief Identity of the camera device, used as resolution cache key.
+     * On Linux bus path, USB vendor and product ID and driver name, elsewhere camera index.
+     * The OpenCV backend is always included.
+     * @return device identity
+     */
+    QString deviceIdentity();
+
+    /**
+     * @brief Set resolution cache file. By default CameraResolutions.ini in the UFOID user settings folder.
+     * @param fileName INI file name
+     */
+    void setCacheFileName(QString fileName);
+
     /**
      * @brief Check whether this instance of CameraInfo is initialized.
      * @return true if initialized, false otherwise
@@ -83,6 +114,18 @@ public:
 #ifndef _UNIT_TEST_
 private:
 #endif
+    /**
+     * @brief Where the available resolutions came from.
+     */
+    enum ResolutionSource {
+        NotQueried,
+        Enumerated,     ///< frame sizes listed by camera driver
+        Cached,         ///< read from resolution cache
+        Probed          ///< trial resolutions set to camera
+    };
+
+    static const int CACHE_VERSION = 1; ///< increase when cache contents change
+
     int m_cameraIndex;  ///< index of camera as used by OpenCV
     int m_cameraBackend;    ///< camera backend as used by OpenCV
     cv::VideoCapture* m_webCamera;
@@ -90,6 +133,8 @@ private:
     QList<int> m_knownAspectRatios;          ///< aspect ratios (*10,000) for common and available resolutions
     QList<QSize> m_availableResolutions;    ///< results of resolution querying
     bool m_initialized;
+    ResolutionSource m_resolutionSource;
+    QString m_cacheFileName;    ///< resolution cache file, empty = default
 
     /**
      * @brief Query available resolutions from web camera.
@@ -103,6 +148,34 @@ private:
      */
     void updateAspectRatios();
 
+    /**
+     * @brief Ask the V4L2 driver for the supported frame sizes of all pixel formats.
+     * Stepwise and continuous frame sizes are matched against common resolutions.
+     * @return true if any frame sizes were found, false if not or not supported
+     */
+    bool enumerateResolutions();
+
+    /**
+     * @brief Read available resolutions of this camera from the resolution cache.
+     * @return true if the camera was found in the cache
+     */
+    bool loadFromCache();
+
+    /**
+     * @brief Write probed resolutions of this camera to the resolution cache.
+     */
+    void saveToCache();
+
+    /**
+     * @brief Open resolution cache. Entries of other cache versions are removed.
+     */
+    QSettings* openCache();
+
+    /**
+     * @brief Cache group name of this camera.
+     */
+    QString cacheGroup();
+
 signals:
     /**
      * @brief This signal is emitted when querying available resolutions progresses.
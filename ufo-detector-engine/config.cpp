@@ -18,8 +18,9 @@
 
 #include "config.h"
 
-Config::Config(QObject *parent) : QObject(parent)
+Config::Config(QObject *parent, int cameraSlot) : QObject(parent)
 {
+    m_cameraSlot = cameraSlot;
     m_settingKeys[Config::ApplicationVersion] = "applicationVersion";
     m_settingKeys[Config::CheckApplicationUpdates] = "checkApplicationUpdates";
     m_settingKeys[Config::CameraIndex] = "cameraIndex";
@@ -44,6 +45,10 @@ Config::Config(QObject *parent) : QObject(parent)
     m_settingKeys[Config::CheckAirplanes] = "checkAirplanes";
     m_settingKeys[Config::AirplaneCoordinates] = "airplaneCoordinates";
     m_settingKeys[Config::LogFileName] = "logFileName";
+    m_settingKeys[Config::BrightnessThresholds] = "brightnessThresholds";
+    m_settingKeys[Config::MotionModelType] = "motionModel";
+    m_settingKeys[Config::CameraCount] = "cameraCount";
+    m_settingKeys[Config::ResultVideoFrameDecimation] = "resultVideoFrameDecimation";
 
     m_settings = new QSettings("UFOID", "Detector");
 
@@ -52,12 +57,14 @@ Config::Config(QObject *parent) : QObject(parent)
     m_defaultCheckApplicationUpdates = true;
 
     m_defaultCameraIndex = 0;
+    m_defaultCameraCount = 1;
     m_defaultCameraWidth = 640;
     m_defaultCameraHeight = 480;
     m_defaultCheckCameraAspectRatio = true;
 
     m_defaultNoiseFilterPixelSize = 2;
     m_defaultMotionThreshold = 10;
+    m_defaultMotionModel = 0;   // three-frame difference
     m_defaultMinPositiveDetections = 2;
     m_defaultBirdClassifierFileName = QCoreApplication::applicationDirPath() + "/cascade.xml";
 
@@ -88,6 +95,7 @@ Config::Config(QObject *parent) : QObject(parent)
     m_defaultResultVideoDir = m_defaultResultDocumentDir + "/Videos";
 
     m_defaultResultVideoWithRectangles = false;
+    m_defaultResultVideoFrameDecimation = 1;
     m_defaultResultImageDir = m_defaultResultDocumentDir + "/Images";
     m_defaultSaveResultImages = false;
 
@@ -96,6 +104,12 @@ Config::Config(QObject *parent) : QObject(parent)
     m_defaultAirplaneCoordinates = "";
 
     m_defaultLogFileName = m_defaultDetectionDataDir + "/messageLog.txt";
+    m_defaultBrightnessThresholds = "";
+
+    m_fileWatcher = NULL;
+    m_snapshotGeneration = 0;
+    publishSnapshot();
+    connect(this, SIGNAL(settingsChanged()), this, SLOT(publishSnapshot()));
 }
 
 Config::~Config() {
@@ -104,47 +118,59 @@ Config::~Config() {
 }
 
 QString Config::applicationVersion() {
-    return m_settings->value(m_settingKeys[Config::ApplicationVersion], m_defaultApplicationVersion).toString();
+    return value(Config::ApplicationVersion, m_defaultApplicationVersion).toString();
 }
 
 int Config::classifierVersion() {
-    return m_settings->value(m_settingKeys[Config::ClassifierVersion], m_defaultClassifierVersion).toInt();
+    return value(Config::ClassifierVersion, m_defaultClassifierVersion).toInt();
 }
 
 bool Config::checkApplicationUpdates() {
-    return m_settings->value(m_settingKeys[Config::CheckApplicationUpdates], m_defaultCheckApplicationUpdates).toBool();
+    return value(Config::CheckApplicationUpdates, m_defaultCheckApplicationUpdates).toBool();
 }
 
 int Config::cameraIndex() {
-    return m_settings->value(m_settingKeys[Config::CameraIndex], m_defaultCameraIndex).toInt();
+    return value(Config::CameraIndex, m_defaultCameraIndex).toInt();
+}
+
+int Config::cameraCount() {
+    return value(Config::CameraCount, m_defaultCameraCount).toInt();
+}
+
+int Config::cameraSlot() {
+    return m_cameraSlot;
 }
 
 int Config::cameraWidth() {
-    return m_settings->value(m_settingKeys[Config::CameraWidth], m_defaultCameraWidth).toInt();
+    return value(Config::CameraWidth, m_defaultCameraWidth).toInt();
 }
 
 int Config::cameraHeight() {
-    return m_settings->value(m_settingKeys[Config::CameraHeight], m_defaultCameraHeight).toInt();
+    return value(Config::CameraHeight, m_defaultCameraHeight).toInt();
 }
 
 bool Config::checkCameraAspectRatio() {
-    return m_settings->value(m_settingKeys[Config::CheckCameraAspectRatio], m_defaultCheckCameraAspectRatio).toBool();
+    return value(Config::CheckCameraAspectRatio, m_defaultCheckCameraAspectRatio).toBool();
 }
 
 QString Config::detectionAreaFile() {
-    return m_settings->value(m_settingKeys[Config::DetectionAreaFile], m_defaultDetectionAreaFileName).toString();
+    return value(Config::DetectionAreaFile, m_defaultDetectionAreaFileName).toString();
 }
 
 int Config::noiseFilterPixelSize() {
-    return m_settings->value(m_settingKeys[Config::NoiseFilterPixelSize], m_defaultNoiseFilterPixelSize).toInt();
+    return value(Config::NoiseFilterPixelSize, m_defaultNoiseFilterPixelSize).toInt();
 }
 
 int Config::motionThreshold() {
-    return m_settings->value(m_settingKeys[Config::MotionThreshold], m_defaultMotionThreshold).toInt();
+    return value(Config::MotionThreshold, m_defaultMotionThreshold).toInt();
+}
+
+int Config::motionModel() {
+    return value(Config::MotionModelType, m_defaultMotionModel).toInt();
 }
 
 int Config::minPositiveDetections() {
-    return m_settings->value(m_settingKeys[Config::MinPositiveDetections], m_defaultMinPositiveDetections).toInt();
+    return value(Config::MinPositiveDetections, m_defaultMinPositiveDetections).toInt();
 }
 
 QString Config::birdClassifierTrainingFile() {
@@ -152,15 +178,15 @@ QString Config::birdClassifierTrainingFile() {
 }
 
 QString Config::resultDataFile() {
-    return m_settings->value(m_settingKeys[Config::ResultDataFile], m_defaultResultDataFileName).toString();
+    return value(Config::ResultDataFile, m_defaultResultDataFileName).toString();
 }
 
 QString Config::resultVideoDir() {
-    return m_settings->value(m_settingKeys[Config::ResultVideoDir], m_defaultResultVideoDir).toString();
+    return value(Config::ResultVideoDir, m_defaultResultVideoDir).toString();
 }
 
 QString Config::resultVideoCodecStr() {
-    return m_settings->value(m_settingKeys[Config::ResultVideoCodec], m_defaultVideoCodecStr).toString();
+    return value(Config::ResultVideoCodec, m_defaultVideoCodecStr).toString();
 }
 
 int Config::resultVideoCodec() {
@@ -168,7 +194,11 @@ int Config::resultVideoCodec() {
 }
 
 bool Config::resultVideoWithObjectRectangles() {
-    return m_settings->value(m_settingKeys[Config::ResultVideoWithObjectRectangles], m_defaultResultVideoWithRectangles).toBool();
+    return value(Config::ResultVideoWithObjectRectangles, m_defaultResultVideoWithRectangles).toBool();
+}
+
+int Config::resultVideoFrameDecimation() {
+    return qMax(1, value(Config::ResultVideoFrameDecimation, m_defaultResultVideoFrameDecimation).toInt());
 }
 
 QString Config::videoEncoderLocation() {
@@ -176,33 +206,37 @@ QString Config::videoEncoderLocation() {
 }
 
 QString Config::resultImageDir() {
-    return m_settings->value(m_settingKeys[Config::ResultImageDir], m_defaultResultImageDir).toString();
+    return value(Config::ResultImageDir, m_defaultResultImageDir).toString();
 }
 
 bool Config::saveResultImages() {
-    return m_settings->value(m_settingKeys[Config::SaveResultImages], m_defaultSaveResultImages).toBool();
+    return value(Config::SaveResultImages, m_defaultSaveResultImages).toBool();
 }
 
 int Config::detectionAreaSize() {
-    return m_settings->value(m_settingKeys[Config::DetectionAreaSize], m_defaultDetectionAreaSize).toInt();
+    return value(Config::DetectionAreaSize, m_defaultDetectionAreaSize).toInt();
 }
 
 QString Config::userTokenAtUfoId() {
-    return m_settings->value(m_settingKeys[Config::UserTokenAtUfoId], m_defaultUserTokenAtUfoId).toString();
+    return value(Config::UserTokenAtUfoId, m_defaultUserTokenAtUfoId).toString();
 }
 
 bool Config::checkAirplanes()
 {
-    return m_settings->value(m_settingKeys[Config::CheckAirplanes], m_defaultCheckAirplanes).toBool();
+    return value(Config::CheckAirplanes, m_defaultCheckAirplanes).toBool();
 }
 
 QString Config::coordinates()
 {
-    return m_settings->value(m_settingKeys[Config::AirplaneCoordinates], m_defaultAirplaneCoordinates).toString();
+    return value(Config::AirplaneCoordinates, m_defaultAirplaneCoordinates).toString();
 }
 
 QString Config::logFileName() {
-    return m_settings->value(m_settingKeys[Config::LogFileName], m_defaultLogFileName).toString();
+    return value(Config::LogFileName, m_defaultLogFileName).toString();
+}
+
+QString Config::brightnessThresholds() {
+    return value(Config::BrightnessThresholds, m_defaultBrightnessThresholds).toString();
 }
 
 VideoCodecSupportInfo* Config::videoCodecSupportInfo() {
@@ -210,124 +244,152 @@ VideoCodecSupportInfo* Config::videoCodecSupportInfo() {
 }
 
 void Config::setApplicationVersion(QString version) {
-    m_settings->setValue(m_settingKeys[Config::ApplicationVersion], QVariant(version));
-    m_settings->sync();
+    setValue(Config::ApplicationVersion, QVariant(version));
+    syncSettings();
     emit settingsChanged();
 }
 
 void Config::setCameraIndex(int index) {
-    m_settings->setValue(m_settingKeys[Config::CameraIndex], QVariant(index));
-    m_settings->sync();
+    setValue(Config::CameraIndex, QVariant(index));
+    syncSettings();
+    emit settingsChanged();
+}
+
+void Config::setCameraCount(int count) {
+    setValue(Config::CameraCount, QVariant(count));
+    syncSettings();
     emit settingsChanged();
 }
 
 void Config::setCameraWidth(int width) {
-    m_settings->setValue(m_settingKeys[Config::CameraWidth], QVariant(width));
-    m_settings->sync();
+    setValue(Config::CameraWidth, QVariant(width));
+    syncSettings();
     emit settingsChanged();
 }
 
 void Config::setCameraHeight(int height) {
-    m_settings->setValue(m_settingKeys[Config::CameraHeight], QVariant(height));
-    m_settings->sync();
+    setValue(Config::CameraHeight, QVariant(height));
+    syncSettings();
     emit settingsChanged();
 }
 
 void Config::setDetectionAreaFile(QString fileName) {
-    m_settings->setValue(m_settingKeys[Config::DetectionAreaFile], QVariant(fileName));
-    m_settings->sync();
+    setValue(Config::DetectionAreaFile, QVariant(fileName));
+    syncSettings();
     emit settingsChanged();
 }
 
 void Config::resetDetectionAreaFile() {
-    setDetectionAreaFile(m_defaultDetectionAreaFileName);
-    m_settings->sync();
+    if (m_cameraSlot >= 0) {
+        m_settings->remove(cameraGroup() + "/" + m_settingKeys[Config::DetectionAreaFile]);
+    } else {
+        setDetectionAreaFile(m_defaultDetectionAreaFileName);
+    }
+    syncSettings();
     emit settingsChanged();
 }
 
 void Config::setDetectionAreaSize(int areaSize) {
-    m_settings->setValue(m_settingKeys[Config::DetectionAreaSize], QVariant(areaSize));
-    m_settings->sync();
+    setValue(Config::DetectionAreaSize, QVariant(areaSize));
+    syncSettings();
     emit settingsChanged();
 }
 
 void Config::setNoiseFilterPixelSize(int size) {
-    m_settings->setValue(m_settingKeys[Config::NoiseFilterPixelSize], QVariant(size));
-    m_settings->sync();
+    setValue(Config::NoiseFilterPixelSize, QVariant(size));
+    syncSettings();
     emit settingsChanged();
 }
 
 void Config::setMotionThreshold(int threshold) {
-    m_settings->setValue(m_settingKeys[Config::MotionThreshold], QVariant(threshold));
-    m_settings->sync();
+    setValue(Config::MotionThreshold, QVariant(threshold));
+    syncSettings();
+    emit settingsChanged();
+}
+
+void Config::setMotionModel(int type) {
+    setValue(Config::MotionModelType, QVariant(type));
+    syncSettings();
     emit settingsChanged();
 }
 
 void Config::setMinPositiveDetections(int detectionCount) {
-    m_settings->setValue(m_settingKeys[Config::MinPositiveDetections], QVariant(detectionCount));
-    m_settings->sync();
+    setValue(Config::MinPositiveDetections, QVariant(detectionCount));
+    syncSettings();
     emit settingsChanged();
 }
 
 void Config::setResultVideoDir(QString dirName) {
-    m_settings->setValue(m_settingKeys[Config::ResultVideoDir], QVariant(dirName));
-    m_settings->sync();
+    setValue(Config::ResultVideoDir, QVariant(dirName));
+    syncSettings();
     emit settingsChanged();
 }
 
 void Config::setResultVideoCodec(QString codec) {
-    m_settings->setValue(m_settingKeys[Config::ResultVideoCodec], QVariant(codec));
-    m_settings->sync();
+    setValue(Config::ResultVideoCodec, QVariant(codec));
+    syncSettings();
     emit settingsChanged();
 }
 
 void Config::setResultVideoWithObjectRectangles(bool drawRectangles) {
-    m_settings->setValue(m_settingKeys[Config::ResultVideoWithObjectRectangles], QVariant(drawRectangles));
-    m_settings->sync();
+    setValue(Config::ResultVideoWithObjectRectangles, QVariant(drawRectangles));
+    syncSettings();
+    emit settingsChanged();
+}
+
+void Config::setResultVideoFrameDecimation(int decimation) {
+    setValue(Config::ResultVideoFrameDecimation, QVariant(decimation));
+    syncSettings();
     emit settingsChanged();
 }
 
 void Config::setResultImageDir(QString dirName) {
-    m_settings->setValue(m_settingKeys[Config::ResultImageDir], QVariant(dirName));
-    m_settings->sync();
+    setValue(Config::ResultImageDir, QVariant(dirName));
+    syncSettings();
     emit settingsChanged();
 }
 
 void Config::setSaveResultImages(bool save) {
-    m_settings->setValue(m_settingKeys[Config::SaveResultImages], QVariant(save));
-    m_settings->sync();
+    setValue(Config::SaveResultImages, QVariant(save));
+    syncSettings();
     emit settingsChanged();
 }
 
 void Config::setUserTokenAtUfoId(QString token) {
-    m_settings->setValue(m_settingKeys[Config::UserTokenAtUfoId], QVariant(token));
-    m_settings->sync();
+    setValue(Config::UserTokenAtUfoId, QVariant(token));
+    syncSettings();
     emit settingsChanged();
 }
 
 void Config::setCheckAirplanes(bool check)
 {
-    m_settings->setValue(m_settingKeys[Config::CheckAirplanes], QVariant(check));
-    m_settings->sync();
+    setValue(Config::CheckAirplanes, QVariant(check));
+    syncSettings();
     emit settingsChanged();
 }
 
 void Config::setAirplaneCoordinates(QString coordinates)
 {
-    m_settings->setValue(m_settingKeys[Config::AirplaneCoordinates], QVariant(coordinates));
-    m_settings->sync();
+    setValue(Config::AirplaneCoordinates, QVariant(coordinates));
+    syncSettings();
     emit settingsChanged();
 }
 
 void Config::setLogFileName(QString fileName) {
-    m_settings->setValue(m_settingKeys[Config::LogFileName], QVariant(fileName));
-    m_settings->sync();
+    setValue(Config::LogFileName, QVariant(fileName));
+    syncSettings();
+    emit settingsChanged();
+}
+
+void Config::setBrightnessThresholds(QString definition) {
+    setValue(Config::BrightnessThresholds, QVariant(definition));
+    syncSettings();
     emit settingsChanged();
 }
 
 void Config::setClassifierVersion(int version) {
-    m_settings->setValue(m_settingKeys[Config::ClassifierVersion], QVariant(version));
-    m_settings->sync();
+    setValue(Config::ClassifierVersion, QVariant(version));
+    syncSettings();
     emit settingsChanged();
 }
 
@@ -342,6 +404,7 @@ void Config::createDefaultConfig(bool overwrite) {
     m_settings->setValue(m_settingKeys[Config::ApplicationVersion], QVariant(m_defaultApplicationVersion));
     m_settings->setValue(m_settingKeys[Config::CheckApplicationUpdates], QVariant(m_defaultCheckApplicationUpdates));
     m_settings->setValue(m_settingKeys[Config::CameraIndex], QVariant(m_defaultCameraIndex));
+    m_settings->setValue(m_settingKeys[Config::CameraCount], QVariant(m_defaultCameraCount));
     m_settings->setValue(m_settingKeys[Config::CameraWidth], QVariant(m_defaultCameraWidth));
     m_settings->setValue(m_settingKeys[Config::CameraHeight], QVariant(m_defaultCameraHeight));
     m_settings->setValue(m_settingKeys[Config::CheckCameraAspectRatio], QVariant(m_defaultCheckCameraAspectRatio));
@@ -349,12 +412,14 @@ void Config::createDefaultConfig(bool overwrite) {
     m_settings->setValue(m_settingKeys[Config::DetectionAreaSize], QVariant(m_defaultDetectionAreaSize));
     m_settings->setValue(m_settingKeys[Config::NoiseFilterPixelSize], QVariant(m_defaultNoiseFilterPixelSize));
     m_settings->setValue(m_settingKeys[Config::MotionThreshold], QVariant(m_defaultMotionThreshold));
+    m_settings->setValue(m_settingKeys[Config::MotionModelType], QVariant(m_defaultMotionModel));
     m_settings->setValue(m_settingKeys[Config::MinPositiveDetections], QVariant(m_defaultMinPositiveDetections));
     m_settings->setValue(m_settingKeys[Config::BirdClassifierTrainingFile], QVariant(m_defaultBirdClassifierFileName));
     m_settings->setValue(m_settingKeys[Config::ResultDataFile], QVariant(m_defaultResultDataFileName));
     m_settings->setValue(m_settingKeys[Config::ResultVideoDir], QVariant(m_defaultResultVideoDir));
     m_settings->setValue(m_settingKeys[Config::ResultVideoCodec], QVariant(m_defaultVideoCodecStr));
     m_settings->setValue(m_settingKeys[Config::ResultVideoWithObjectRectangles], QVariant(m_defaultResultVideoWithRectangles));
+    m_settings->setValue(m_settingKeys[Config::ResultVideoFrameDecimation], QVariant(m_defaultResultVideoFrameDecimation));
     m_settings->setValue(m_settingKeys[Config::VideoEncoderLocation], QVariant(m_defaultVideoEncoderLocation));
     m_settings->setValue(m_settingKeys[Config::ResultImageDir], QVariant(m_defaultResultImageDir));
     m_settings->setValue(m_settingKeys[Config::SaveResultImages], QVariant(m_defaultSaveResultImages));
@@ -363,10 +428,116 @@ void Config::createDefaultConfig(bool overwrite) {
     m_settings->setValue(m_settingKeys[Config::CheckAirplanes], QVariant(m_defaultCheckAirplanes));
     m_settings->setValue(m_settingKeys[Config::AirplaneCoordinates], QVariant(m_defaultAirplaneCoordinates));
     m_settings->setValue(m_settingKeys[Config::LogFileName], QVariant(m_defaultLogFileName));
-    m_settings->sync();
+    m_settings->setValue(m_settingKeys[Config::BrightnessThresholds], QVariant(m_defaultBrightnessThresholds));
+    syncSettings();
     emit settingsChanged();
 }
 
 QString Config::configFileName() {
     return m_settings->fileName();
 }
+
+std::shared_ptr<const ConfigSnapshot> Config::snapshot() {
+    return std::atomic_load(&m_snapshot);
+}
+
+bool Config::setConfigFileWatched(bool watch) {
+    if (!watch) {
+        delete m_fileWatcher;
+        m_fileWatcher = NULL;
+        return true;
+    }
+    if (!m_fileWatcher) {
+        m_fileWatcher = new QFileSystemWatcher(this);
+        connect(m_fileWatcher, SIGNAL(fileChanged(QString)), this, SLOT(onConfigFileChanged(QString)));
+    }
+    return m_fileWatcher->files().contains(configFileName()) || m_fileWatcher->addPath(configFileName());
+}
+
+void Config::publishSnapshot() {
+    m_snapshotGeneration++;
+    std::atomic_store(&m_snapshot, ConfigSnapshot::create(this, m_snapshotGeneration));
+}
+
+void Config::syncSettings() {
+    m_settings->sync();
+    m_ownFileHash = configFileHash();
+}
+
+QByteArray Config::configFileHash() {
+    QFile file(configFileName());
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QByteArray();
+    }
+    return QCryptographicHash::hash(file.readAll(), QCryptographicHash::Md5);
+}
+
+void Config::onConfigFileChanged(QString fileName) {
+    // editors often replace the file, which removes it from the watcher
+    if (m_fileWatcher && !m_fileWatcher->files().contains(fileName) && QFile::exists(fileName)) {
+        m_fileWatcher->addPath(fileName);
+    }
+    // our own writes are already in the settings and the snapshot
+    if (!m_ownFileHash.isEmpty() && (configFileHash() == m_ownFileHash)) {
+        return;
+    }
+    m_settings->sync();
+    emit settingsChanged();
+    emit settingsReloaded();
+}
+
+QString Config::cameraGroup() {
+    return QString("camera%1").arg(m_cameraSlot);
+}
+
+bool Config::isCameraSpecific(SettingKeys key) {
+    switch (key) {
+    case Config::CameraIndex:
+    case Config::DetectionAreaFile:
+    case Config::DetectionAreaSize:
+    case Config::ResultDataFile:
+    case Config::ResultVideoDir:
+    case Config::ResultImageDir:
+        return true;
+    default:
+        return false;
+    }
+}
+
+QVariant Config::value(SettingKeys key, const QVariant& defaultValue) {
+    if (m_cameraSlot < 0) {
+        return m_settings->value(m_settingKeys[key], defaultValue);
+    }
+    QString cameraKey = cameraGroup() + "/" + m_settingKeys[key];
+    if (m_settings->contains(cameraKey)) {
+        return m_settings->value(cameraKey);
+    }
+    if (!isCameraSpecific(key)) {
+        return m_settings->value(m_settingKeys[key], defaultValue);
+    }
+
+    // derive from the shared value so that cameras never write into the same files
+    QVariant sharedValue = m_settings->value(m_settingKeys[key], defaultValue);
+    QString suffix = "-" + cameraGroup();
+    switch (key) {
+    case Config::CameraIndex:
+        return QVariant(m_cameraSlot);
+    case Config::DetectionAreaSize:
+        return QVariant(m_defaultDetectionAreaSize);
+    case Config::ResultVideoDir:
+    case Config::ResultImageDir:
+        return QVariant(sharedValue.toString() + "/" + cameraGroup());
+    default: {
+        QFileInfo fileInfo(sharedValue.toString());
+        return QVariant(fileInfo.path() + "/" + fileInfo.completeBaseName() + suffix + "." + fileInfo.suffix());
+    }
+    }
+}
+
+void Config::setValue(SettingKeys key, const QVariant& value) {
+    if (m_cameraSlot < 0) {
+        m_settings->setValue(m_settingKeys[key], value);
+    } else {
+        m_settings->setValue(cameraGroup() + "/" + m_settingKeys[key], value);
+    }
+}
@@ -20,12 +20,17 @@
 #define CONFIG_H
 
 #include "videocodecsupportinfo.h"
+#include "configsnapshot.h"
 #include <QObject>
 #include <QSettings>
 #include <QApplication>
 #include <QDir>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QCryptographicHash>
 #include <QStandardPaths>
 #include <QDebug>
+#include <memory>
 
 #define APPLICATION_VERSION "0.7.7"
 
@@ -64,10 +69,26 @@ public:
         CheckAirplanes,
         AirplaneCoordinates,
         LogFileName,
+        BrightnessThresholds,
+        MotionModelType,
+        CameraCount,
+        ResultVideoFrameDecimation,
         SETTINGS_COUNT
     };
 
-    explicit Config(QObject *parent = 0);
+    /**
+     * @brief Create configuration object.
+     *
+     * A camera configuration reads settings from group camera<slot> of the
+     * settings file and falls back to the shared settings. Camera index,
+     * detection area, result data file and result folders are never shared:
+     * if they are missing from the group, they are derived from the shared
+     * values, e.g. detectionArea-camera1.xml and Videos/camera1. Setters of
+     * a camera configuration write into the group.
+     * @param parent
+     * @param cameraSlot camera number 0...cameraCount()-1, -1 = shared configuration
+     */
+    explicit Config(QObject *parent = 0, int cameraSlot = -1);
 
     ~Config();
 
@@ -91,6 +112,18 @@ public:
      */
     int cameraIndex();
 
+    /**
+     * @brief Number of cameras handled by one detector process.
+     * Settings of each camera are read with Config(parent, slot).
+     */
+    int cameraCount();
+
+    /**
+     * @brief Camera number of a camera configuration.
+     * @return camera slot, -1 for the shared configuration
+     */
+    int cameraSlot();
+
     /**
      * @brief Web camera width in pixels.
      */
@@ -133,6 +166,12 @@ public:
      */
     int motionThreshold();
 
+    /**
+     * @brief Motion model used for motion detection.
+     * @return MotionModel::Type value: 0 = three-frame difference, 1 = adaptive background
+     */
+    int motionModel();
+
     /**
      * @brief Minimum number of motion detections to start video recording.
      */
@@ -173,6 +212,13 @@ public:
      */
     bool resultVideoWithObjectRectangles();
 
+    /**
+     * @brief Every how many camera frames one is written into result videos.
+     * Videos are recorded at the measured camera frame rate divided by this.
+     * @return 1 = all frames, 2 = every second frame etc.
+     */
+    int resultVideoFrameDecimation();
+
     /**
      * @brief Location of video encoder (ffmpeg, avconv).
      * @return
@@ -215,6 +261,13 @@ public:
      */
     QString logFileName();
 
+    /**
+     * @brief Brightness thresholds for light detection as a BrightnessThresholdTable definition.
+     * This is a developer setting and needs to be added manually into the settings file.
+     * @return definition string, empty for compiled-in defaults
+     */
+    QString brightnessThresholds();
+
     /**
      * @brief Get video codec support info object. The object has been initialized.
      * @return pointer to initialized VideoCodecSupportInfo
@@ -241,6 +294,12 @@ public:
      */
     void setCameraIndex(int index);
 
+    /**
+     * @brief Set number of cameras handled by one detector process.
+     * @param count
+     */
+    void setCameraCount(int count);
+
     /**
      * @brief Set web camera width.
      * The final result depends on the camera. Check the camera documentation and
@@ -287,6 +346,12 @@ public:
      */
     void setMotionThreshold(int threshold);
 
+    /**
+     * @brief Set motion model.
+     * @param type MotionModel::Type value
+     */
+    void setMotionModel(int type);
+
     /**
      * @brief Set minimum number of positive detections to start video recording.
      * @param detectionCount
@@ -311,6 +376,12 @@ public:
      */
     void setResultVideoWithObjectRectangles(bool drawRectangles);
 
+    /**
+     * @brief Set every how many camera frames one is written into result videos.
+     * @param decimation 1 = all frames
+     */
+    void setResultVideoFrameDecimation(int decimation);
+
     /**
      * @brief Set directory for result image saving.
      * @param dirName
@@ -347,6 +418,12 @@ public:
      */
     void setLogFileName(QString fileName);
 
+    /**
+     * @brief Set brightness thresholds for light detection.
+     * @param definition BrightnessThresholdTable definition string, empty for defaults
+     */
+    void setBrightnessThresholds(QString definition);
+
     /**
      * @brief Check whether configuration file exists.
      * @return true if configuration file exists, false if not
@@ -366,18 +443,35 @@ public:
      */
     QString configFileName();
 
+    /**
+     * @brief Current settings as an immutable snapshot.
+     * A new snapshot is published after each change, the old one stays valid
+     * for whoever still holds it. Safe to call from any thread.
+     */
+    std::shared_ptr<const ConfigSnapshot> snapshot();
+
+    /**
+     * @brief Reload settings when the configuration file is changed by others.
+     * Running detection picks up the new settings on the next frame.
+     * @param watch true = watch the file, false = stop watching
+     * @return false if the file can't be watched
+     */
+    bool setConfigFileWatched(bool watch);
+
 
 #ifndef _UNIT_TEST_
 private:
 #endif
     QSettings* m_settings;
     QString m_settingKeys[Config::SETTINGS_COUNT]; ///< setting key strings
+    int m_cameraSlot;   ///< -1 = shared configuration
 
     QString m_defaultApplicationVersion;    ///< default app version number: empty by default
     QString m_defaultClassifierVersion;
     bool m_defaultCheckApplicationUpdates;  ///< default setting for automatic app updates check
 
     int m_defaultCameraIndex;
+    int m_defaultCameraCount;
     int m_defaultCameraWidth;
     int m_defaultCameraHeight;
     bool m_defaultCheckCameraAspectRatio;
@@ -388,6 +482,7 @@ private:
 
     int m_defaultNoiseFilterPixelSize;
     int m_defaultMotionThreshold;
+    int m_defaultMotionModel;
     int m_defaultMinPositiveDetections;
     QString m_defaultBirdClassifierFileName;  ///< default file name for bird classifier training data file
 
@@ -396,6 +491,7 @@ private:
     QString m_defaultResultVideoDir;    ///< default directory for result videos
     QString m_defaultVideoCodecStr;        ///< default video codec as FOURCC string
     bool m_defaultResultVideoWithRectangles; ///< whether to draw rectanges into result video
+    int m_defaultResultVideoFrameDecimation;
     QString m_defaultVideoEncoderLocation;
     QString m_defaultResultImageDir;    ///< default directory for result images
     bool m_defaultSaveResultImages;     ///< whether to save result images by default
@@ -406,14 +502,67 @@ private:
     QString m_defaultAirplaneCoordinates;
 
     QString m_defaultLogFileName;       ///< default message log file name
+    QString m_defaultBrightnessThresholds;  ///< empty: use compiled-in brightness thresholds
 
     VideoCodecSupportInfo* m_videoCodecSupportInfo; ///< info about video codec support
+    std::shared_ptr<const ConfigSnapshot> m_snapshot; ///< accessed with atomic_load/atomic_store only
+    unsigned int m_snapshotGeneration;
+    QFileSystemWatcher* m_fileWatcher;  ///< NULL when not watching
+    QByteArray m_ownFileHash;   ///< hash of the configuration file after our latest write
+
+    /**
+     * @brief Settings group of a camera configuration.
+     */
+    QString cameraGroup();
+
+    /**
+     * @brief Whether the setting must differ between cameras.
+     */
+    bool isCameraSpecific(SettingKeys key);
+
+    /**
+     * @brief Read setting from the camera group or shared settings.
+     */
+    QVariant value(SettingKeys key, const QVariant& defaultValue);
+
+    /**
+     * @brief Write setting into the camera group or shared settings.
+     */
+    void setValue(SettingKeys key, const QVariant& value);
+
+    /**
+     * @brief Write changed settings to the configuration file.
+     * The file watcher ignores the change notification of this write.
+     */
+    void syncSettings();
+
+    /**
+     * @brief Hash of the configuration file content, empty if it can't be read.
+     */
+    QByteArray configFileHash();
+
+#ifndef _UNIT_TEST_
+private slots:
+#else
+public slots:
+#endif
+    /**
+     * @brief Create a snapshot of current settings and make it the current one.
+     */
+    void publishSnapshot();
+
+    void onConfigFileChanged(QString fileName);
 
 signals:
     /**
      * @brief Emitted when any of the settings changed.
      */
     void settingsChanged();
+
+    /**
+     * @brief Emitted when settings were reloaded from a changed configuration file.
+     */
+    void settingsReloaded();
 };
 
 #endif // CONFIG_H
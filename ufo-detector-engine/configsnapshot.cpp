@@ -0,0 +1,44 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "configsnapshot.h"
+#include "config.h"
+
+std::shared_ptr<const ConfigSnapshot> ConfigSnapshot::create(Config* config, unsigned int generation)
+{
+    std::shared_ptr<ConfigSnapshot> snapshot(new ConfigSnapshot());
+    snapshot->m_generation = generation;
+    snapshot->m_cameraIndex = config->cameraIndex();
+    snapshot->m_cameraWidth = config->cameraWidth();
+    snapshot->m_cameraHeight = config->cameraHeight();
+    snapshot->m_detectionAreaFile = config->detectionAreaFile();
+    snapshot->m_noiseFilterPixelSize = config->noiseFilterPixelSize();
+    snapshot->m_motionThreshold = config->motionThreshold();
+    snapshot->m_motionModel = config->motionModel();
+    snapshot->m_minPositiveDetections = config->minPositiveDetections();
+    snapshot->m_birdClassifierTrainingFile = config->birdClassifierTrainingFile();
+    snapshot->m_brightnessThresholds = config->brightnessThresholds();
+    snapshot->m_resultVideoDir = config->resultVideoDir();
+    snapshot->m_resultVideoCodec = config->resultVideoCodec();
+    snapshot->m_resultVideoWithObjectRectangles = config->resultVideoWithObjectRectangles();
+    snapshot->m_resultVideoFrameDecimation = config->resultVideoFrameDecimation();
+    snapshot->m_resultImageDir = config->resultImageDir();
+    snapshot->m_saveResultImages = config->saveResultImages();
+    snapshot->m_checkAirplanes = config->checkAirplanes();
+    return snapshot;
+}
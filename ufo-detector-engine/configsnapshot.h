@@ -0,0 +1,65 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CONFIGSNAPSHOT_H
+#define CONFIGSNAPSHOT_H
+
+#include <QString>
+#include <memory>
+
+class Config;
+
+/**
+ * @brief Immutable copy of the settings used while detecting.
+ *
+ * Config publishes a new snapshot whenever settings change. Detection reads
+ * the current snapshot once per frame with Config::snapshot() and uses plain
+ * member values from it, so all stages of a frame see the same settings and
+ * no settings lookup is done in the detection loop.
+ */
+struct ConfigSnapshot
+{
+    unsigned int m_generation;      ///< increases with each published snapshot
+
+    int m_cameraIndex;
+    int m_cameraWidth;
+    int m_cameraHeight;
+    QString m_detectionAreaFile;
+    int m_noiseFilterPixelSize;
+    int m_motionThreshold;
+    int m_motionModel;              ///< MotionModel::Type
+    int m_minPositiveDetections;
+    QString m_birdClassifierTrainingFile;
+    QString m_brightnessThresholds; ///< BrightnessThresholdTable definition
+    QString m_resultVideoDir;
+    int m_resultVideoCodec;         ///< FOURCC code
+    bool m_resultVideoWithObjectRectangles;
+    int m_resultVideoFrameDecimation;
+    QString m_resultImageDir;
+    bool m_saveResultImages;
+    bool m_checkAirplanes;
+
+    /**
+     * @brief Read all values from configuration.
+     * @param config
+     * @param generation generation number of the snapshot
+     */
+    static std::shared_ptr<const ConfigSnapshot> create(Config* config, unsigned int generation);
+};
+
+#endif // CONFIGSNAPSHOT_H
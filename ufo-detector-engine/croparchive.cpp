@@ -0,0 +1,360 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "croparchive.h"
+#include "filesync.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QtEndian>
+#include <cstring>
+
+const char* const CropArchiveReader::METADATA_FILE = "crops.csv";
+
+namespace {
+
+const quint32 FLAG_BRIGHT = 1;
+
+void appendUInt32(QByteArray& data, quint32 value)
+{
+    uchar bytes[4];
+    qToLittleEndian(value, bytes);
+    data.append((const char*)bytes, 4);
+}
+
+void appendUInt64(QByteArray& data, quint64 value)
+{
+    uchar bytes[8];
+    qToLittleEndian(value, bytes);
+    data.append((const char*)bytes, 8);
+}
+
+void appendMetadata(QByteArray& data, const CropArchiveEntry& entry)
+{
+    appendUInt64(data, (quint64)entry.m_timestamp);
+    appendUInt64(data, entry.m_trackId);
+    appendUInt32(data, (quint32)entry.m_rect.x);
+    appendUInt32(data, (quint32)entry.m_rect.y);
+    appendUInt32(data, (quint32)entry.m_rect.width);
+    appendUInt32(data, (quint32)entry.m_rect.height);
+    appendUInt32(data, entry.m_isBright ? FLAG_BRIGHT : 0);
+    appendUInt32(data, entry.m_imageSize);
+    appendUInt32(data, entry.m_maskSize);
+}
+
+/**
+ * @brief Read metadata, offsets are set for a record starting at recordOffset.
+ */
+CropArchiveEntry readMetadata(const uchar* data, qint64 recordOffset)
+{
+    CropArchiveEntry entry;
+    entry.m_timestamp = (qint64)qFromLittleEndian<quint64>(data);
+    entry.m_trackId = qFromLittleEndian<quint64>(data + 8);
+    entry.m_rect.x = (qint32)qFromLittleEndian<quint32>(data + 16);
+    entry.m_rect.y = (qint32)qFromLittleEndian<quint32>(data + 20);
+    entry.m_rect.width = (qint32)qFromLittleEndian<quint32>(data + 24);
+    entry.m_rect.height = (qint32)qFromLittleEndian<quint32>(data + 28);
+    entry.m_isBright = (qFromLittleEndian<quint32>(data + 32) & FLAG_BRIGHT) != 0;
+    entry.m_imageSize = qFromLittleEndian<quint32>(data + 36);
+    entry.m_maskSize = qFromLittleEndian<quint32>(data + 40);
+    entry.m_imageOffset = recordOffset + CropArchive::RECORD_HEADER_SIZE;
+    entry.m_maskOffset = entry.m_imageOffset + entry.m_imageSize;
+    return entry;
+}
+
+bool writeFile(const QString& fileName, const QByteArray& data)
+{
+    QFile file(fileName);
+    return file.open(QIODevice::WriteOnly) && (file.write(data) == data.size());
+}
+
+}
+
+bool CropArchive::isArchiveFileName(const QString& fileName)
+{
+    return QFileInfo(fileName).suffix() == FILE_SUFFIX;
+}
+
+CropArchiveWriter::CropArchiveWriter()
+{
+}
+
+CropArchiveWriter::~CropArchiveWriter()
+{
+    close();
+}
+
+bool CropArchiveWriter::open(const QString& fileName)
+{
+    close();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.clear();
+    // each record is written with a single call, which also makes write errors show up right away
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Unbuffered)) {
+        return false;
+    }
+    QByteArray header(CropArchive::FILE_MAGIC, 8);
+    appendUInt32(header, CropArchive::VERSION);
+    appendUInt32(header, 0);
+    if (m_file.write(header) != header.size()) {
+        m_file.close();
+        return false;
+    }
+    FileSync::syncFile(m_file);
+    FileSync::syncDirectory(QFileInfo(m_file).absolutePath());
+    return true;
+}
+
+bool CropArchiveWriter::isOpen() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_file.isOpen();
+}
+
+bool CropArchiveWriter::append(CropArchiveEntry entry, const std::vector<uchar>& image, const std::vector<uchar>& mask)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_file.isOpen()) {
+        return false;
+    }
+    qint64 recordOffset = m_file.pos();
+    entry.m_imageSize = (quint32)image.size();
+    entry.m_maskSize = (quint32)mask.size();
+    entry.m_imageOffset = recordOffset + CropArchive::RECORD_HEADER_SIZE;
+    entry.m_maskOffset = entry.m_imageOffset + entry.m_imageSize;
+
+    QByteArray record;
+    record.reserve(CropArchive::RECORD_HEADER_SIZE + (int)image.size() + (int)mask.size());
+    appendUInt32(record, CropArchive::RECORD_MAGIC);
+    appendMetadata(record, entry);
+    record.append((const char*)image.data(), (int)image.size());
+    record.append((const char*)mask.data(), (int)mask.size());
+    if (m_file.write(record) != record.size()) {
+        // keep the archive readable for the next records
+        m_file.resize(recordOffset);
+        m_file.seek(recordOffset);
+        return false;
+    }
+    m_entries.push_back(entry);
+    return true;
+}
+
+void CropArchiveWriter::sync()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_file.isOpen()) {
+        FileSync::syncFile(m_file);
+    }
+}
+
+bool CropArchiveWriter::close()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_file.isOpen()) {
+        return true;
+    }
+    QByteArray index;
+    index.reserve((int)m_entries.size() * CropArchive::INDEX_ENTRY_SIZE + CropArchive::FOOTER_SIZE);
+    for (unsigned int i = 0; i < m_entries.size(); i++) {
+        appendMetadata(index, m_entries[i]);
+        appendUInt64(index, (quint64)(m_entries[i].m_imageOffset - CropArchive::RECORD_HEADER_SIZE));
+    }
+    appendUInt64(index, (quint64)m_file.pos());
+    appendUInt32(index, (quint32)m_entries.size());
+    appendUInt32(index, 0);
+    index.append(CropArchive::INDEX_MAGIC, 8);
+    bool indexWritten = (m_file.write(index) == index.size());
+    FileSync::syncFile(m_file);
+    m_file.close();
+    return indexWritten;
+}
+
+int CropArchiveWriter::entryCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return (int)m_entries.size();
+}
+
+CropArchiveReader::CropArchiveReader()
+{
+    m_data = NULL;
+    m_size = 0;
+    m_indexRecovered = false;
+}
+
+CropArchiveReader::~CropArchiveReader()
+{
+    close();
+}
+
+bool CropArchiveReader::open(const QString& fileName)
+{
+    close();
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    m_size = m_file.size();
+    if (m_size >= CropArchive::HEADER_SIZE) {
+        m_data = m_file.map(0, m_size);
+    }
+    if (!m_data || (memcmp(m_data, CropArchive::FILE_MAGIC, 8) != 0)
+            || (qFromLittleEndian<quint32>(m_data + 8) > CropArchive::VERSION)) {
+        close();
+        return false;
+    }
+    if (!readIndex()) {
+        scanRecords();
+        m_indexRecovered = true;
+    }
+    return true;
+}
+
+void CropArchiveReader::close()
+{
+    if (m_data) {
+        m_file.unmap(const_cast<uchar*>(m_data));
+    }
+    m_file.close();
+    m_data = NULL;
+    m_size = 0;
+    m_entries.clear();
+    m_indexRecovered = false;
+}
+
+QString CropArchiveReader::fileName() const
+{
+    return m_file.fileName();
+}
+
+bool CropArchiveReader::isIndexRecovered() const
+{
+    return m_indexRecovered;
+}
+
+int CropArchiveReader::count() const
+{
+    return (int)m_entries.size();
+}
+
+const CropArchiveEntry& CropArchiveReader::entry(int index) const
+{
+    return m_entries[index];
+}
+
+QByteArray CropArchiveReader::imageData(int index) const
+{
+    const CropArchiveEntry& e = m_entries[index];
+    return QByteArray::fromRawData((const char*)m_data + e.m_imageOffset, (int)e.m_imageSize);
+}
+
+QByteArray CropArchiveReader::maskData(int index) const
+{
+    const CropArchiveEntry& e = m_entries[index];
+    return QByteArray::fromRawData((const char*)m_data + e.m_maskOffset, (int)e.m_maskSize);
+}
+
+QString CropArchiveReader::imageFileName(int index)
+{
+    return QString("image%1.jpg").arg(index);
+}
+
+QString CropArchiveReader::maskFileName(int index)
+{
+    return QString("imageThresh%1.png").arg(index);
+}
+
+bool CropArchiveReader::extract(const QString& directory) const
+{
+    QDir dir;
+    if (!dir.mkpath(directory)) {
+        return false;
+    }
+    dir.setPath(directory);
+    QFile metadataFile(dir.filePath(METADATA_FILE));
+    if (!metadataFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        return false;
+    }
+    QTextStream metadata(&metadataFile);
+    metadata << "image,mask,timestamp,trackId,x,y,width,height,bright\n";
+    for (int i = 0; i < count(); i++) {
+        const CropArchiveEntry& e = m_entries[i];
+        QString maskName = (e.m_maskSize > 0) ? maskFileName(i) : QString();
+        if (!writeFile(dir.filePath(imageFileName(i)), imageData(i))
+                || (!maskName.isEmpty() && !writeFile(dir.filePath(maskName), maskData(i)))) {
+            return false;
+        }
+        metadata << imageFileName(i) << ',' << maskName << ',' << e.m_timestamp << ',' << e.m_trackId << ','
+                 << e.m_rect.x << ',' << e.m_rect.y << ',' << e.m_rect.width << ',' << e.m_rect.height << ','
+                 << (e.m_isBright ? 1 : 0) << '\n';
+    }
+    metadata.flush();
+    return metadataFile.error() == QFile::NoError;
+}
+
+bool CropArchiveReader::readIndex()
+{
+    const qint64 footerOffset = m_size - CropArchive::FOOTER_SIZE;
+    if (footerOffset < CropArchive::HEADER_SIZE
+            || memcmp(m_data + m_size - 8, CropArchive::INDEX_MAGIC, 8) != 0) {
+        return false;
+    }
+    const uchar* footer = m_data + footerOffset;
+    qint64 indexOffset = (qint64)qFromLittleEndian<quint64>(footer);
+    qint64 entryCount = qFromLittleEndian<quint32>(footer + 8);
+    if (indexOffset < CropArchive::HEADER_SIZE
+            || (indexOffset + entryCount * CropArchive::INDEX_ENTRY_SIZE) != footerOffset) {
+        return false;
+    }
+    std::vector<CropArchiveEntry> entries;
+    entries.reserve(entryCount);
+    for (qint64 i = 0; i < entryCount; i++) {
+        const uchar* indexEntry = m_data + indexOffset + i * CropArchive::INDEX_ENTRY_SIZE;
+        qint64 recordOffset = (qint64)qFromLittleEndian<quint64>(indexEntry + CropArchive::METADATA_SIZE);
+        CropArchiveEntry entry = readMetadata(indexEntry, recordOffset);
+        if (recordOffset < CropArchive::HEADER_SIZE || (entry.m_maskOffset + entry.m_maskSize) > indexOffset
+                || qFromLittleEndian<quint32>(m_data + recordOffset) != CropArchive::RECORD_MAGIC) {
+            return false;
+        }
+        entries.push_back(entry);
+    }
+    m_entries.swap(entries);
+    return true;
+}
+
+void CropArchiveReader::scanRecords()
+{
+    m_entries.clear();
+    qint64 offset = CropArchive::HEADER_SIZE;
+    while ((offset + CropArchive::RECORD_HEADER_SIZE) <= m_size
+           && qFromLittleEndian<quint32>(m_data + offset) == CropArchive::RECORD_MAGIC) {
+        CropArchiveEntry entry = readMetadata(m_data + offset + 4, offset);
+        if (!isEntryInFile(entry)) {
+            // the last record was not completely written
+            break;
+        }
+        m_entries.push_back(entry);
+        offset = entry.m_maskOffset + entry.m_maskSize;
+    }
+}
+
+bool CropArchiveReader::isEntryInFile(const CropArchiveEntry& entry) const
+{
+    return (entry.m_maskOffset + (qint64)entry.m_maskSize) <= m_size;
+}
@@ -0,0 +1,218 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CROPARCHIVE_H
+#define CROPARCHIVE_H
+
+#include <QString>
+#include <QByteArray>
+#include <QFile>
+#include <opencv2/core/core.hpp>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief Metadata of a crop stored in a crop archive.
+ */
+struct CropArchiveEntry {
+    qint64 m_timestamp;     ///< detection time, milliseconds since epoch
+    quint64 m_trackId;      ///< ID of the track the object belongs to
+    cv::Rect m_rect;        ///< object rectangle in the camera frame
+    bool m_isBright;        ///< brightness verdict of the object
+    qint64 m_imageOffset;   ///< file offset of the encoded crop, set by the archive
+    quint32 m_imageSize;
+    qint64 m_maskOffset;    ///< file offset of the encoded threshold mask, set by the archive
+    quint32 m_maskSize;
+};
+
+/**
+ * @brief File format of the per-session crop archive.
+ *
+ * All numbers are little-endian. The file starts with a HEADER_SIZE byte header:
+ * magic "UFOCROPS", format version and a reserved word. Each crop is appended
+ * as a record: RECORD_MAGIC, the metadata, the crop as JPEG and the threshold
+ * mask as PNG. Closing the archive appends an index with the metadata and
+ * record offset of each crop, followed by a FOOTER_SIZE byte footer: index
+ * offset, entry count, a reserved word and magic "UFOCIDX1". An archive that
+ * was not closed, e.g. after a power cut, has no index; readers then rebuild
+ * it by walking through the records.
+ */
+namespace CropArchive {
+    const char* const FILE_SUFFIX = "ufocrops";
+    const char* const FILE_MAGIC = "UFOCROPS";
+    const char* const INDEX_MAGIC = "UFOCIDX1";
+    const quint32 RECORD_MAGIC = 0x31505243;    ///< "CRP1"
+    const quint32 VERSION = 1;
+    const int HEADER_SIZE = 16;
+    const int METADATA_SIZE = 44;
+    const int RECORD_HEADER_SIZE = 4 + METADATA_SIZE;
+    const int INDEX_ENTRY_SIZE = METADATA_SIZE + 8;
+    const int FOOTER_SIZE = 24;
+
+    /**
+     * @brief Whether a file name has the crop archive suffix.
+     */
+    bool isArchiveFileName(const QString& fileName);
+}
+
+/**
+ * @brief Appends crops of a detection session into a single crop archive file.
+ *
+ * append() may be called from several threads. The archive is only valid
+ * for fast reading after close() has written the index.
+ */
+class CropArchiveWriter
+{
+public:
+    CropArchiveWriter();
+
+    /**
+     * @brief Write the index and close.
+     */
+    ~CropArchiveWriter();
+
+    /**
+     * @brief Create the archive file, replacing an existing one.
+     * @return false if the file can't be written
+     */
+    bool open(const QString& fileName);
+
+    bool isOpen() const;
+
+    /**
+     * @brief Append an encoded crop and mask.
+     * @param entry metadata, offsets and sizes are set here
+     * @param image encoded crop image
+     * @param mask encoded threshold mask, may be empty
+     * @return false if writing failed, the partial record is then cut off
+     */
+    bool append(CropArchiveEntry entry, const std::vector<uchar>& image, const std::vector<uchar>& mask);
+
+    /**
+     * @brief Flush appended records and sync them to disk.
+     */
+    void sync();
+
+    /**
+     * @brief Append the index, sync and close the file. Does nothing if not open.
+     * @return false if the index couldn't be written
+     */
+    bool close();
+
+    /**
+     * @brief Number of crops appended since open().
+     */
+    int entryCount() const;
+
+#ifndef _UNIT_TEST_
+private:
+#endif
+    mutable std::mutex m_mutex;     ///< guards the file and entries
+    QFile m_file;
+    std::vector<CropArchiveEntry> m_entries;
+};
+
+/**
+ * @brief Reads a crop archive through a memory mapping.
+ *
+ * Crop data is not copied: imageData() and maskData() return byte arrays that
+ * point into the mapping and are valid until the reader is closed or destroyed.
+ * Reading is thread-safe once open() has returned.
+ */
+class CropArchiveReader
+{
+public:
+    CropArchiveReader();
+    ~CropArchiveReader();
+
+    /**
+     * @brief Map the archive and read its index.
+     * If the archive has no index, it is rebuilt from the records and
+     * isIndexRecovered() returns true. A partially written last record is ignored.
+     * @return false if the file can't be mapped or is not a crop archive
+     */
+    bool open(const QString& fileName);
+
+    void close();
+
+    QString fileName() const;
+
+    /**
+     * @brief Whether the index was rebuilt because the archive was not closed properly.
+     */
+    bool isIndexRecovered() const;
+
+    int count() const;
+
+    /**
+     * @brief Metadata of crop at index 0...count()-1.
+     */
+    const CropArchiveEntry& entry(int index) const;
+
+    /**
+     * @brief Encoded crop image (JPEG) at index 0...count()-1, not copied.
+     */
+    QByteArray imageData(int index) const;
+
+    /**
+     * @brief Encoded threshold mask (PNG) at index 0...count()-1, not copied. Empty if there is no mask.
+     */
+    QByteArray maskData(int index) const;
+
+    /**
+     * @brief File name for a crop when it is a separate file, the same as result images had before archives.
+     */
+    static QString imageFileName(int index);
+    static QString maskFileName(int index);
+
+    /**
+     * @brief Write crops and masks into separate files and the metadata into CSV file METADATA_FILE.
+     * @param directory destination folder, created if it doesn't exist
+     * @return false if a file couldn't be written
+     */
+    bool extract(const QString& directory) const;
+
+    static const char* const METADATA_FILE;
+
+#ifndef _UNIT_TEST_
+private:
+#endif
+    QFile m_file;
+    const uchar* m_data;
+    qint64 m_size;
+    std::vector<CropArchiveEntry> m_entries;
+    bool m_indexRecovered;
+
+    /**
+     * @brief Read entries from the trailing index.
+     * @return false if there is no valid index
+     */
+    bool readIndex();
+
+    /**
+     * @brief Rebuild entries by walking through the records.
+     */
+    void scanRecords();
+
+    /**
+     * @brief Whether image and mask of an entry are inside the file.
+     */
+    bool isEntryInFile(const CropArchiveEntry& entry) const;
+};
+
+#endif // CROPARCHIVE_H
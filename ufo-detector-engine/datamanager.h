@@ -96,7 +96,7 @@ private:
     QFile m_resultDataFile;  ///< result data file (XML)
     QDomDocument m_resultDataDomDocument;   ///< DOM representation of result data file
     QNetworkAccessManager* m_networkAccessManager;
-    QList<QPolygon*> m_detectionAreaPolygons; ///< detection area polygons (cameras not separated)
+    QList<QPolygon*> m_detectionAreaPolygons; ///< detection area polygons of the camera in the configuration
 
     /**
      * @brief Check that the folders for images, videos, and other files exist
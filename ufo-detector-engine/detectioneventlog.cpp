@@ -0,0 +1,188 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "detectioneventlog.h"
+#include <QDateTime>
+#include <QJsonObject>
+#include <QJsonDocument>
+#include <chrono>
+#include <cstring>
+
+DetectionEvent DetectionEvent::create(Type type, quint64 frame)
+{
+    DetectionEvent event;
+    memset(&event, 0, sizeof(event));
+    event.m_type = type;
+    event.m_timestamp = QDateTime::currentMSecsSinceEpoch();
+    event.m_frame = frame;
+    return event;
+}
+
+DetectionEventLog::DetectionEventLog()
+{
+    m_ring.resize(RING_SIZE);
+    m_head = 0;
+    m_count = 0;
+    m_running = false;
+    m_droppedCount = 0;
+}
+
+DetectionEventLog::~DetectionEventLog()
+{
+    stop();
+}
+
+bool DetectionEventLog::start(const QString& fileName)
+{
+    stop();
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_head = 0;
+    m_count = 0;
+    m_droppedCount = 0;
+    m_running = true;
+    m_writerThread.reset(new std::thread(&DetectionEventLog::writerThread, this));
+    return true;
+}
+
+void DetectionEventLog::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running = false;
+        m_eventsAvailable.notify_all();
+    }
+    if (m_writerThread) {
+        // the writer writes the remaining events before leaving
+        m_writerThread->join();
+        m_writerThread.reset();
+    }
+    m_file.close();
+}
+
+bool DetectionEventLog::isRunning() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_running;
+}
+
+bool DetectionEventLog::add(const DetectionEvent& event)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_running || (m_count == RING_SIZE)) {
+        m_droppedCount++;
+        return false;
+    }
+    m_ring[(m_head + m_count) % RING_SIZE] = event;
+    m_count++;
+    if (m_count == RING_SIZE / 2) {
+        m_eventsAvailable.notify_one();
+    }
+    return true;
+}
+
+uint64_t DetectionEventLog::droppedCount() const
+{
+    return m_droppedCount;
+}
+
+QByteArray DetectionEventLog::toJson(const DetectionEvent& event)
+{
+    QJsonObject json;
+    json.insert("time", (double)event.m_timestamp);
+    json.insert("frame", (double)event.m_frame);
+    switch (event.m_type) {
+    case DetectionEvent::Frame:
+        json.insert("type", QString("frame"));
+        json.insert("motion", event.m_motionPixels);
+        json.insert("objects", event.m_objects);
+        json.insert("positives", event.m_positives);
+        json.insert("negatives", event.m_negatives);
+        json.insert("ambient", event.m_ambientLevel);
+        json.insert("night", event.m_isNight);
+        break;
+    case DetectionEvent::TrackCreated:
+        json.insert("type", QString("trackCreated"));
+        json.insert("track", (double)event.m_trackId);
+        break;
+    case DetectionEvent::TrackRemoved:
+        json.insert("type", QString("trackRemoved"));
+        json.insert("track", (double)event.m_trackId);
+        json.insert("positives", event.m_posCounter);
+        json.insert("negatives", event.m_negCounter);
+        json.insert("birds", event.m_birdCounter);
+        break;
+    case DetectionEvent::RecordingStarted:
+        json.insert("type", QString("recordingStarted"));
+        break;
+    case DetectionEvent::RecordingFinished:
+        json.insert("type", QString("recordingFinished"));
+        json.insert("result", event.m_result ? QJsonValue(QString(event.m_result)) : QJsonValue());
+        json.insert("videoSaved", event.m_videoSaved);
+        break;
+    }
+    return QJsonDocument(json).toJson(QJsonDocument::Compact);
+}
+
+void DetectionEventLog::writerThread()
+{
+    std::vector<DetectionEvent> batch;
+    batch.reserve(RING_SIZE);
+    QByteArray lines;
+
+    while (true) {
+        bool running;
+        size_t head;
+        size_t count;
+        batch.clear();
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (m_running && (m_count < RING_SIZE / 2)) {
+                m_eventsAvailable.wait_for(lock, std::chrono::milliseconds(FLUSH_INTERVAL_MS));
+            }
+            head = m_head;
+            count = m_count;
+            running = m_running;
+        }
+        // copied outside the lock, add() doesn't reuse these slots before m_head moves past them
+        for (size_t i = 0; i < count; i++) {
+            batch.push_back(m_ring[(head + i) % RING_SIZE]);
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_head = (m_head + count) % RING_SIZE;
+            m_count -= count;
+        }
+        // formatting and writing outside the lock
+        lines.clear();
+        for (unsigned int i = 0; i < batch.size(); i++) {
+            lines += toJson(batch[i]);
+            lines += '\n';
+        }
+        if (!lines.isEmpty()) {
+            m_file.write(lines);
+            m_file.flush();
+        }
+        if (!running) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,147 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DETECTIONEVENTLOG_H
+#define DETECTIONEVENTLOG_H
+
+#include <QString>
+#include <QFile>
+#include <QByteArray>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <vector>
+#include <memory>
+
+/**
+ * @brief A detection event. Fields not used by the event type are zero.
+ *
+ * Plain data, so adding an event is a copy into the ring buffer.
+ */
+struct DetectionEvent {
+    enum Type {
+        Frame,              ///< processed frame with motion
+        TrackCreated,
+        TrackRemoved,       ///< track lost, with its final counters
+        RecordingStarted,
+        RecordingFinished   ///< with detection result
+    };
+
+    Type m_type;
+    qint64 m_timestamp;     ///< milliseconds since epoch
+    quint64 m_frame;        ///< index of the processed frame since detection start
+
+    // Frame
+    int m_motionPixels;     ///< amount of motion in the detection area
+    int m_objects;          ///< objects found by the object detector
+    int m_positives;        ///< bright objects counted as positive detections
+    int m_negatives;        ///< dark objects
+    int m_ambientLevel;     ///< average brightness of the frame
+    bool m_isNight;
+
+    // TrackCreated, TrackRemoved
+    quint64 m_trackId;
+    int m_posCounter;
+    int m_negCounter;
+    int m_birdCounter;
+
+    // RecordingFinished
+    const char* m_result;   ///< static string, NULL if recording was stopped without result
+    bool m_videoSaved;
+
+    /**
+     * @brief Event with current time and all other fields zero.
+     */
+    static DetectionEvent create(Type type, quint64 frame);
+};
+
+/**
+ * @brief Writes detection events as newline-delimited JSON, one object per line.
+ *
+ * The detection thread adds events with add(), which only copies the event
+ * into a fixed size ring buffer and doesn't allocate. A writer thread copies
+ * the events out of the ring, then formats and appends them to the file every
+ * FLUSH_INTERVAL_MS, or earlier when the ring is half full. Both sides hold
+ * the lock only to update the ring indices, so add() waits at most for a few
+ * assignments. If the writer falls behind and the ring is full, events are
+ * dropped and counted.
+ *
+ * Each line has "type", "time" (milliseconds since epoch) and "frame", plus
+ * the fields of the event type, e.g.
+ * {"ambient":85,"frame":120,"motion":2310,"negatives":0,"night":false,"objects":2,"positives":1,"time":1500000000000,"type":"frame"}
+ */
+class DetectionEventLog
+{
+public:
+    DetectionEventLog();
+
+    /**
+     * @brief Write remaining events and stop.
+     */
+    ~DetectionEventLog();
+
+    /**
+     * @brief Open the file for appending and start the writer thread. Resets the dropped count.
+     * @return false if the file can't be opened
+     */
+    bool start(const QString& fileName);
+
+    /**
+     * @brief Write remaining events, close the file and stop the writer thread.
+     */
+    void stop();
+
+    bool isRunning() const;
+
+    /**
+     * @brief Queue an event. Waits only while the writer thread updates the ring indices.
+     * @return false if the event was dropped because the ring is full or the log is stopped
+     */
+    bool add(const DetectionEvent& event);
+
+    /**
+     * @brief Events dropped since start().
+     */
+    uint64_t droppedCount() const;
+
+    /**
+     * @brief Event as a JSON line, without the newline.
+     */
+    static QByteArray toJson(const DetectionEvent& event);
+
+#ifndef _UNIT_TEST_
+private:
+#endif
+    static const size_t RING_SIZE = 4096;
+    static const int FLUSH_INTERVAL_MS = 1000;
+
+    QFile m_file;
+    std::unique_ptr<std::thread> m_writerThread;
+    mutable std::mutex m_mutex;         ///< guards m_head, m_count and m_running
+    std::condition_variable m_eventsAvailable;
+    std::vector<DetectionEvent> m_ring;
+    size_t m_head;                      ///< index of the oldest event
+    size_t m_count;                     ///< events in the ring
+    bool m_running;
+    std::atomic<uint64_t> m_droppedCount;
+
+    void writerThread();
+};
+
+#endif // DETECTIONEVENTLOG_H
@@ -0,0 +1,214 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "detectionsession.h"
+#include <QDir>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonArray>
+
+QString DetectionSession::frameFileName(const QString& directory, int index)
+{
+    return directory + "/" + FRAME_FOLDER + "/" + QString("%1.png").arg(index, 6, 10, QChar('0'));
+}
+
+SessionRecorder::SessionRecorder()
+{
+    m_frameCount = 0;
+    m_running = false;
+}
+
+SessionRecorder::~SessionRecorder()
+{
+    stop();
+}
+
+bool SessionRecorder::start(const QString& directory, const QJsonObject& settings, const cv::Mat& regionMask)
+{
+    if (m_running) {
+        return false;
+    }
+    QDir dir(directory);
+    if (!dir.mkpath(DetectionSession::FRAME_FOLDER)) {
+        return false;
+    }
+    if (!cv::imwrite(QString(directory + "/" + DetectionSession::REGION_FILE).toStdString(), regionMask)) {
+        return false;
+    }
+    m_directory = directory;
+    m_settings = settings;
+    m_frameCount = 0;
+    m_planeCounts.clear();
+    m_running = true;
+    m_writerThread.reset(new std::thread(&SessionRecorder::writerThread, this));
+    return true;
+}
+
+void SessionRecorder::addFrame(const cv::Mat& bgrFrame)
+{
+    cv::Mat frame = bgrFrame.clone();
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (m_running && (m_frames.size() >= MAX_QUEUED_FRAMES)) {
+        m_frameWritten.wait(lock);
+    }
+    if (!m_running) {
+        return;
+    }
+    m_frames.push_back(std::make_pair((int)m_frameCount, frame));
+    m_frameCount++;
+    m_frameQueued.notify_one();
+}
+
+void SessionRecorder::addPlaneCount(int planes)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_running) {
+        m_planeCounts.push_back(std::make_pair((int)m_frameCount, planes));
+    }
+}
+
+void SessionRecorder::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_running) {
+            return;
+        }
+        m_running = false;
+        m_frameQueued.notify_all();
+        m_frameWritten.notify_all();
+    }
+    // the writer empties the queue before quitting
+    m_writerThread->join();
+    m_writerThread.reset();
+
+    QJsonArray planeCounts;
+    for (unsigned int i = 0; i < m_planeCounts.size(); i++) {
+        QJsonObject planeCount;
+        planeCount.insert("frame", m_planeCounts[i].first);
+        planeCount.insert("planes", m_planeCounts[i].second);
+        planeCounts.append(planeCount);
+    }
+    QJsonObject session;
+    session.insert("version", 1);
+    session.insert("frameCount", (int)m_frameCount);
+    session.insert("initialFrames", DetectionSession::INITIAL_FRAME_COUNT);
+    session.insert("settings", m_settings);
+    session.insert("planeCounts", planeCounts);
+
+    QFile sessionFile(m_directory + "/" + DetectionSession::SESSION_FILE);
+    if (sessionFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        sessionFile.write(QJsonDocument(session).toJson());
+    }
+}
+
+bool SessionRecorder::isRecording()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_running;
+}
+
+void SessionRecorder::writerThread()
+{
+    while (true) {
+        std::pair<int, cv::Mat> frame;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            while (m_running && m_frames.empty()) {
+                m_frameQueued.wait(lock);
+            }
+            if (m_frames.empty()) {
+                return;
+            }
+            frame = m_frames.front();
+            m_frames.pop_front();
+            m_frameWritten.notify_all();
+        }
+        cv::imwrite(DetectionSession::frameFileName(m_directory, frame.first).toStdString(), frame.second);
+    }
+}
+
+SessionReader::SessionReader()
+{
+    m_frameCount = 0;
+}
+
+bool SessionReader::open(const QString& directory)
+{
+    QFile sessionFile(directory + "/" + DetectionSession::SESSION_FILE);
+    if (!sessionFile.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QJsonObject session = QJsonDocument::fromJson(sessionFile.readAll()).object();
+    if (session.value("version").toInt() != 1) {
+        return false;
+    }
+    m_regionMask = cv::imread(QString(directory + "/" + DetectionSession::REGION_FILE).toStdString(), 0);
+    if (m_regionMask.empty()) {
+        return false;
+    }
+    m_directory = directory;
+    m_settings = session.value("settings").toObject();
+    m_frameCount = session.value("frameCount").toInt();
+    m_planeCounts.clear();
+    QJsonArray planeCounts = session.value("planeCounts").toArray();
+    for (int i = 0; i < planeCounts.size(); i++) {
+        QJsonObject planeCount = planeCounts.at(i).toObject();
+        m_planeCounts.push_back(std::make_pair(planeCount.value("frame").toInt(), planeCount.value("planes").toInt()));
+    }
+    return m_frameCount >= DetectionSession::INITIAL_FRAME_COUNT;
+}
+
+QString SessionReader::directory() const
+{
+    return m_directory;
+}
+
+const QJsonObject& SessionReader::settings() const
+{
+    return m_settings;
+}
+
+int SessionReader::frameCount() const
+{
+    return m_frameCount;
+}
+
+std::vector<cv::Point> SessionReader::region() const
+{
+    std::vector<cv::Point> region;
+    for (int y = 0; y < m_regionMask.rows; y++) {
+        const uchar* row = m_regionMask.ptr<uchar>(y);
+        for (int x = 0; x < m_regionMask.cols; x++) {
+            if (row[x]) {
+                region.push_back(cv::Point(x, y));
+            }
+        }
+    }
+    return region;
+}
+
+cv::Mat SessionReader::frame(int index) const
+{
+    return cv::imread(DetectionSession::frameFileName(m_directory, index).toStdString());
+}
+
+const std::vector<std::pair<int, int> >& SessionReader::planeCounts() const
+{
+    return m_planeCounts;
+}
@@ -0,0 +1,156 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DETECTIONSESSION_H
+#define DETECTIONSESSION_H
+
+#include <QString>
+#include <QJsonObject>
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <utility>
+
+/**
+ * @brief Files of a recorded detection session.
+ *
+ * A session folder has session.json with detector settings, frame count and
+ * plane counts, region.png with the detection area as a mask, and the camera
+ * frames as losslessly compressed PNG images in subfolder "frames". The first
+ * INITIAL_FRAME_COUNT frames are the ones read at detector initialization.
+ */
+namespace DetectionSession {
+    const int INITIAL_FRAME_COUNT = 3;
+    const char* const SESSION_FILE = "session.json";
+    const char* const REGION_FILE = "region.png";
+    const char* const FRAME_FOLDER = "frames";
+
+    QString frameFileName(const QString& directory, int index);
+}
+
+/**
+ * @brief Records camera frames and detector inputs for replaying later.
+ *
+ * Frames are compressed and written by a writer thread. The detection thread
+ * waits only if the writer falls MAX_QUEUED_FRAMES behind, since a session
+ * with missing frames can't be replayed.
+ */
+class SessionRecorder
+{
+public:
+    SessionRecorder();
+    ~SessionRecorder();
+
+    /**
+     * @brief Create session folder and start the writer thread.
+     * @param directory session folder, created if it doesn't exist
+     * @param settings detector settings stored with the session
+     * @param regionMask detection area, 255 = inside
+     * @return false if the folder or region mask can't be written
+     */
+    bool start(const QString& directory, const QJsonObject& settings, const cv::Mat& regionMask);
+
+    /**
+     * @brief Queue a frame for writing. Called by the detection thread.
+     * @param bgrFrame camera frame, copied
+     */
+    void addFrame(const cv::Mat& bgrFrame);
+
+    /**
+     * @brief Record number of planes reported by plane checker. Takes effect from the next frame.
+     */
+    void addPlaneCount(int planes);
+
+    /**
+     * @brief Write remaining frames and session.json and stop the writer thread.
+     */
+    void stop();
+
+    bool isRecording();
+
+#ifndef _UNIT_TEST_
+private:
+#endif
+    const size_t MAX_QUEUED_FRAMES = 50;
+
+    QString m_directory;
+    QJsonObject m_settings;
+    std::unique_ptr<std::thread> m_writerThread;
+    std::mutex m_mutex;                     ///< guards the queue and plane counts
+    std::condition_variable m_frameQueued;
+    std::condition_variable m_frameWritten;
+    std::deque<std::pair<int, cv::Mat> > m_frames;  ///< frames waiting to be written, with index
+    std::vector<std::pair<int, int> > m_planeCounts; ///< frame index and number of planes
+    std::atomic<int> m_frameCount;          ///< frames added
+    bool m_running;
+
+    void writerThread();
+};
+
+/**
+ * @brief Reads a session written by SessionRecorder.
+ */
+class SessionReader
+{
+public:
+    SessionReader();
+
+    /**
+     * @brief Read session.json and region mask.
+     * @return false if the folder is not a valid session
+     */
+    bool open(const QString& directory);
+
+    QString directory() const;
+    const QJsonObject& settings() const;
+    int frameCount() const;
+
+    /**
+     * @brief Detection area points, as ActualDetector uses them.
+     */
+    std::vector<cv::Point> region() const;
+
+    /**
+     * @brief Read a frame.
+     * @param index 0...frameCount()-1
+     * @return BGR frame, empty if the file can't be read
+     */
+    cv::Mat frame(int index) const;
+
+    /**
+     * @brief Plane counts by frame index, in frame order.
+     */
+    const std::vector<std::pair<int, int> >& planeCounts() const;
+
+#ifndef _UNIT_TEST_
+private:
+#endif
+    QString m_directory;
+    QJsonObject m_settings;
+    int m_frameCount;
+    cv::Mat m_regionMask;
+    std::vector<std::pair<int, int> > m_planeCounts;
+};
+
+#endif // DETECTIONSESSION_H
@@ -16,13 +16,14 @@ DetectorState::DetectorState(QObject *parent, Recorder *rec) : QObject(parent),
 
 }
 
-void DetectorState::finishRecording()
+DetectorState::DetectionResult DetectorState::finishRecording()
 {
+    DetectionResult result;
 
     if(!tracker.removedTrackWithPositive)
     {
         // All detected objects had more negative than positive detections
-        emit foundDetectionResult(ALL_NEGATIVE);
+        result = ALL_NEGATIVE;
     }
     else
     {
@@ -31,29 +32,49 @@ void DetectorState::finishRecording()
             if (wasPlane)
             {
                 // All objects where aircraft
-                emit foundDetectionResult(AIRPLANE);
+                result = AIRPLANE;
             }
             else if(tracker.wasBird)
             {
                 // All objects where a bird
-                emit foundDetectionResult(BIRD);
+                result = BIRD;
             }
             else
             {
                 // At least one object was unkown
-                emit foundDetectionResult(UNKNOWN);
+                result = UNKNOWN;
             }
 
         }
         else
         {
             // Minimum positive required not reached
-            emit foundDetectionResult(MIN_POSITIVE_NOT_REACHED);
+            result = MIN_POSITIVE_NOT_REACHED;
         }
     }
+    emit foundDetectionResult(result);
+    return result;
 
 }
 
+bool DetectorState::willSaveVideo(DetectionResult result) const
+{
+    return map_result.at(result).willSaveVideo;
+}
+
+const char* DetectorState::resultName(DetectionResult result)
+{
+    switch (result)
+    {
+    case UNKNOWN: return "unknown";
+    case AIRPLANE: return "airplane";
+    case BIRD: return "bird";
+    case ALL_NEGATIVE: return "allNegative";
+    case MIN_POSITIVE_NOT_REACHED: return "minPositiveNotReached";
+    }
+    return "";
+}
+
 void DetectorState::resetState()
 {
     tracker.removedTrackWithPositive=false;
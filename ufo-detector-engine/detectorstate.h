@@ -13,7 +13,6 @@ class DetectorState : public QObject
     Q_OBJECT
 public:
     explicit DetectorState(QObject *parent = 0, Recorder *rec = 0);
-    void finishRecording();
     void resetState();
 
     CTracker tracker;
@@ -40,6 +39,21 @@ public:
 
     };
 
+    /**
+     * @brief Decide the detection result and emit foundDetectionResult().
+     */
+    DetectionResult finishRecording();
+
+    /**
+     * @brief Whether the video is kept with a result.
+     */
+    bool willSaveVideo(DetectionResult result) const;
+
+    /**
+     * @brief Name of a result for event logs, e.g. "minPositiveNotReached".
+     */
+    static const char* resultName(DetectionResult result);
+
 
 
 private:
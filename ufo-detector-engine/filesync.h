@@ -0,0 +1,41 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FILESYNC_H
+#define FILESYNC_H
+
+#include <QFile>
+#include <QString>
+
+/**
+ * @brief Syncing written files to disk, so that they survive a power cut.
+ */
+namespace FileSync {
+    /**
+     * @brief Sync the content of an open file.
+     */
+    void syncFile(QFile& file);
+
+    /**
+     * @brief Sync a folder so that new file entries in it survive a power cut.
+     * Does nothing on Windows, where folders can't be synced.
+     */
+    void syncDirectory(const QString& directory);
+}
+
+#endif // FILESYNC_H
@@ -0,0 +1,321 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "metrics.h"
+#include <QRegExp>
+
+LatencyHistogram::LatencyHistogram()
+{
+    reset();
+}
+
+void LatencyHistogram::record(uint64_t valueUs)
+{
+    m_buckets[bucketIndex(valueUs)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_total.fetch_add(valueUs, std::memory_order_relaxed);
+    uint64_t max = m_max.load(std::memory_order_relaxed);
+    while ((valueUs > max) && !m_max.compare_exchange_weak(max, valueUs, std::memory_order_relaxed)) {
+    }
+}
+
+void LatencyHistogram::reset()
+{
+    for (int i = 0; i < BUCKET_COUNT; i++) {
+        m_buckets[i].store(0, std::memory_order_relaxed);
+    }
+    m_count.store(0, std::memory_order_relaxed);
+    m_total.store(0, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::count() const
+{
+    return m_count.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::total() const
+{
+    return m_total.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::max() const
+{
+    return m_max.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::percentile(double percentile) const
+{
+    // bucket counts may be a little ahead of m_count while recording, so sum them here
+    uint64_t counts[BUCKET_COUNT];
+    uint64_t total = 0;
+    for (int i = 0; i < BUCKET_COUNT; i++) {
+        counts[i] = m_buckets[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+    uint64_t rank = (uint64_t)((percentile / 100.0) * (double)total + 0.5);
+    if (rank < 1) rank = 1;
+    if (rank > total) rank = total;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKET_COUNT; i++) {
+        seen += counts[i];
+        if (seen >= rank) {
+            uint64_t width = (i + 1 < BUCKET_COUNT) ? bucketLowerBound(i + 1) - bucketLowerBound(i) : 1;
+            return bucketLowerBound(i) + width / 2;
+        }
+    }
+    return bucketLowerBound(BUCKET_COUNT - 1);
+}
+
+int LatencyHistogram::bucketIndex(uint64_t value)
+{
+    const uint64_t maxValue = ((uint64_t)1 << MAX_VALUE_BITS) - 1;
+    if (value > maxValue) {
+        value = maxValue;
+    }
+    if (value < (uint64_t)(2 * SUB_BUCKET_COUNT)) {
+        return (int)value;
+    }
+    int highestBit = SUB_BUCKET_BITS + 1;
+    while ((value >> (highestBit + 1)) != 0) {
+        highestBit++;
+    }
+    int group = highestBit - SUB_BUCKET_BITS + 1;
+    int subBucket = (int)(value >> (highestBit - SUB_BUCKET_BITS)) - SUB_BUCKET_COUNT;
+    return group * SUB_BUCKET_COUNT + subBucket;
+}
+
+uint64_t LatencyHistogram::bucketLowerBound(int index)
+{
+    int group = index / SUB_BUCKET_COUNT;
+    int subBucket = index % SUB_BUCKET_COUNT;
+    if (group == 0) {
+        return subBucket;
+    }
+    return (uint64_t)(SUB_BUCKET_COUNT + subBucket) << (group - 1);
+}
+
+MetricsSnapshot::MetricsSnapshot()
+{
+    m_timestampMs = 0;
+}
+
+QString MetricsSnapshot::toString() const
+{
+    QString text;
+    for (unsigned int i = 0; i < m_stages.size(); i++) {
+        const StageLatency& stage = m_stages[i];
+        if (stage.m_count == 0) {
+            continue;
+        }
+        text += QString("%1: n=%2 mean=%3 p50=%4 p90=%5 p99=%6 max=%7 us; ")
+                .arg(Metrics::stageName((Metrics::Stage)i))
+                .arg(stage.m_count)
+                .arg(stage.m_meanUs, 0, 'f', 1)
+                .arg(stage.m_p50Us).arg(stage.m_p90Us).arg(stage.m_p99Us).arg(stage.m_maxUs);
+    }
+    for (unsigned int i = 0; i < m_counters.size(); i++) {
+        text += QString("%1=%2 ").arg(Metrics::counterName((Metrics::Counter)i)).arg(m_counters[i]);
+    }
+    for (unsigned int i = 0; i < m_gauges.size(); i++) {
+        text += QString("%1=%2 ").arg(Metrics::gaugeName((Metrics::Gauge)i)).arg(m_gauges[i]);
+    }
+    return text.trimmed();
+}
+
+double MetricsSnapshot::captureFps(const MetricsSnapshot& previous) const
+{
+    if ((m_timestampMs <= previous.m_timestampMs) || previous.m_counters.empty() || m_counters.empty()) {
+        return 0;
+    }
+    uint64_t frames = m_counters[Metrics::FramesRead] - previous.m_counters[Metrics::FramesRead];
+    return (double)frames * 1000.0 / (double)(m_timestampMs - previous.m_timestampMs);
+}
+
+double MetricsSnapshot::detectionFps(const MetricsSnapshot& previous) const
+{
+    if ((m_timestampMs <= previous.m_timestampMs) || previous.m_stages.empty() || m_stages.empty()) {
+        return 0;
+    }
+    uint64_t frames = m_stages[Metrics::FrameStage].m_count - previous.m_stages[Metrics::FrameStage].m_count;
+    return (double)frames * 1000.0 / (double)(m_timestampMs - previous.m_timestampMs);
+}
+
+QString MetricsSnapshot::toPrometheusText(double captureFps, double detectionFps) const
+{
+    const char* counterHelp[Metrics::COUNTER_COUNT] = {
+        "Frames read from camera.",
+        "Recorder frames not accepted by video buffer.",
+        "Recorder frame periods without a camera frame.",
+        "Frames written again to video in place of skipped ones.",
+        "Result images not accepted by image writer.",
+        "Camera frames replaced by a newer one before detection took them."
+    };
+    const char* gaugeHelp[Metrics::GAUGE_COUNT] = {
+        "Frames waiting in video buffer.",
+        "Largest number of frames in video buffer.",
+        "Whether a video is being recorded.",
+        "Videos being encoded."
+    };
+    QString text;
+
+    for (unsigned int i = 0; i < m_counters.size(); i++) {
+        // framesRead -> ufo_frames_read_total
+        QString name = QString(Metrics::counterName((Metrics::Counter)i))
+                .replace(QRegExp("([A-Z])"), "_\\1").toLower();
+        text += QString("# HELP ufo_%1_total %2\n# TYPE ufo_%1_total counter\nufo_%1_total %3\n")
+                .arg(name).arg(counterHelp[i]).arg(m_counters[i]);
+    }
+    for (unsigned int i = 0; i < m_gauges.size(); i++) {
+        QString name = QString(Metrics::gaugeName((Metrics::Gauge)i))
+                .replace(QRegExp("([A-Z])"), "_\\1").toLower();
+        text += QString("# HELP ufo_%1 %2\n# TYPE ufo_%1 gauge\nufo_%1 %3\n")
+                .arg(name).arg(gaugeHelp[i]).arg(m_gauges[i]);
+    }
+    text += QString("# HELP ufo_capture_fps Frames read from camera per second.\n"
+                    "# TYPE ufo_capture_fps gauge\nufo_capture_fps %1\n").arg(captureFps, 0, 'f', 2);
+    text += QString("# HELP ufo_detection_fps Frames processed by detection per second.\n"
+                    "# TYPE ufo_detection_fps gauge\nufo_detection_fps %1\n").arg(detectionFps, 0, 'f', 2);
+
+    text += "# HELP ufo_stage_latency_microseconds Detection stage latency.\n"
+            "# TYPE ufo_stage_latency_microseconds summary\n";
+    for (unsigned int i = 0; i < m_stages.size(); i++) {
+        const StageLatency& stage = m_stages[i];
+        QString label = QString("stage=\"%1\"").arg(Metrics::stageName((Metrics::Stage)i));
+        text += QString("ufo_stage_latency_microseconds{%1,quantile=\"0.5\"} %2\n").arg(label).arg(stage.m_p50Us);
+        text += QString("ufo_stage_latency_microseconds{%1,quantile=\"0.9\"} %2\n").arg(label).arg(stage.m_p90Us);
+        text += QString("ufo_stage_latency_microseconds{%1,quantile=\"0.99\"} %2\n").arg(label).arg(stage.m_p99Us);
+        text += QString("ufo_stage_latency_microseconds_sum{%1} %2\n").arg(label).arg(stage.m_totalUs);
+        text += QString("ufo_stage_latency_microseconds_count{%1} %2\n").arg(label).arg(stage.m_count);
+    }
+    return text;
+}
+
+Metrics::Metrics()
+{
+    m_enabled = true;
+    reset();
+}
+
+Metrics& Metrics::instance()
+{
+    static Metrics metrics;
+    return metrics;
+}
+
+const char* Metrics::stageName(Stage stage)
+{
+    static const char* names[STAGE_COUNT] = {
+        "frame", "grayFrame", "coarseMotion", "motionMask", "detectMotion", "detect",
+        "trackerUpdate", "lightDetection", "birdClassification", "recorderWrite", "imageWrite",
+        "detectorStart", "detectorStop"
+    };
+    return names[stage];
+}
+
+const char* Metrics::counterName(Counter counter)
+{
+    static const char* names[COUNTER_COUNT] = {
+        "framesRead", "framesDropped", "framesSkipped", "framesDuplicated", "imagesDropped",
+        "framesMissed"
+    };
+    return names[counter];
+}
+
+const char* Metrics::gaugeName(Gauge gauge)
+{
+    static const char* names[GAUGE_COUNT] = {
+        "videoBufferDepth", "videoBufferMaxDepth", "recording", "encoderQueueDepth"
+    };
+    return names[gauge];
+}
+
+void Metrics::setEnabled(bool enabled)
+{
+    m_enabled = enabled;
+}
+
+bool Metrics::isEnabled() const
+{
+#ifndef UFO_METRICS_DISABLED
+    return m_enabled.load(std::memory_order_relaxed);
+#else
+    return false;
+#endif
+}
+
+void Metrics::setGauge(Gauge gauge, int64_t value)
+{
+#ifndef UFO_METRICS_DISABLED
+    if (!m_enabled.load(std::memory_order_relaxed)) {
+        return;
+    }
+    m_gauges[gauge].store(value, std::memory_order_relaxed);
+    if (gauge == VideoBufferDepth) {
+        int64_t max = m_gauges[VideoBufferMaxDepth].load(std::memory_order_relaxed);
+        while ((value > max) && !m_gauges[VideoBufferMaxDepth].compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+        }
+    }
+#else
+    Q_UNUSED(gauge);
+    Q_UNUSED(value);
+#endif
+}
+
+MetricsSnapshot Metrics::snapshot() const
+{
+    MetricsSnapshot snapshot;
+    snapshot.m_timestampMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        const LatencyHistogram& histogram = m_stages[i];
+        MetricsSnapshot::StageLatency stage;
+        stage.m_count = histogram.count();
+        stage.m_totalUs = histogram.total();
+        stage.m_meanUs = stage.m_count ? (double)stage.m_totalUs / (double)stage.m_count : 0;
+        stage.m_p50Us = histogram.percentile(50);
+        stage.m_p90Us = histogram.percentile(90);
+        stage.m_p99Us = histogram.percentile(99);
+        stage.m_maxUs = histogram.max();
+        snapshot.m_stages.push_back(stage);
+    }
+    for (int i = 0; i < COUNTER_COUNT; i++) {
+        snapshot.m_counters.push_back(m_counters[i].load(std::memory_order_relaxed));
+    }
+    for (int i = 0; i < GAUGE_COUNT; i++) {
+        snapshot.m_gauges.push_back(m_gauges[i].load(std::memory_order_relaxed));
+    }
+    return snapshot;
+}
+
+void Metrics::reset()
+{
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        m_stages[i].reset();
+    }
+    for (int i = 0; i < COUNTER_COUNT; i++) {
+        m_counters[i] = 0;
+    }
+    for (int i = 0; i < GAUGE_COUNT; i++) {
+        m_gauges[i] = 0;
+    }
+}
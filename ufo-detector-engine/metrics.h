@@ -0,0 +1,273 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <QString>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <cstdint>
+
+/**
+ * @brief Latency histogram with logarithmic buckets, in microseconds.
+ *
+ * Values below 2 * SUB_BUCKET_COUNT get a bucket of their own. Above that each
+ * power of two range is split into SUB_BUCKET_COUNT buckets, so the relative
+ * error of a percentile is at most 1 / SUB_BUCKET_COUNT. Recording is a few
+ * relaxed atomic increments and never locks, so the histogram can be read by
+ * another thread while being written. Several threads may record at the same
+ * time without losing measurements, e.g. the bird classifier workers or the
+ * pool threads running detection. They then share the counters' cache lines,
+ * which costs little at a few records per frame.
+ */
+class LatencyHistogram
+{
+public:
+    static const int SUB_BUCKET_BITS = 4;
+    static const int SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+    static const int MAX_VALUE_BITS = 36;     ///< values up to about 19 hours
+    static const int BUCKET_COUNT = SUB_BUCKET_COUNT * (MAX_VALUE_BITS - SUB_BUCKET_BITS + 1);
+
+    LatencyHistogram();
+
+    /**
+     * @brief Add one measurement.
+     * @param valueUs measured time in microseconds
+     */
+    void record(uint64_t valueUs);
+
+    /**
+     * @brief Remove all measurements. Not to be called while another thread records.
+     */
+    void reset();
+
+    uint64_t count() const;
+    uint64_t total() const;
+    uint64_t max() const;
+
+    /**
+     * @brief Value below which the given share of measurements are.
+     * @param percentile 0...100
+     * @return middle of the bucket containing the percentile, 0 if there are no measurements
+     */
+    uint64_t percentile(double percentile) const;
+
+    static int bucketIndex(uint64_t value);
+    static uint64_t bucketLowerBound(int index);
+
+private:
+    std::atomic<uint32_t> m_buckets[BUCKET_COUNT];
+    std::atomic<uint64_t> m_count;
+    std::atomic<uint64_t> m_total;
+    std::atomic<uint64_t> m_max;
+};
+
+/**
+ * @brief Current values of all metrics, see Metrics::snapshot().
+ */
+struct MetricsSnapshot {
+    /**
+     * @brief Latency statistics of one stage.
+     */
+    struct StageLatency {
+        uint64_t m_count;
+        uint64_t m_totalUs;
+        double m_meanUs;
+        uint64_t m_p50Us;
+        uint64_t m_p90Us;
+        uint64_t m_p99Us;
+        uint64_t m_maxUs;
+    };
+
+    std::vector<StageLatency> m_stages;     ///< indexed by Metrics::Stage
+    std::vector<uint64_t> m_counters;       ///< indexed by Metrics::Counter
+    std::vector<int64_t> m_gauges;          ///< indexed by Metrics::Gauge
+    int64_t m_timestampMs;                  ///< monotonic time of the snapshot
+
+    MetricsSnapshot();
+
+    /**
+     * @brief Single line summary of non-empty stages, counters and gauges for logging.
+     */
+    QString toString() const;
+
+    /**
+     * @brief Frames read from camera per second since an earlier snapshot.
+     */
+    double captureFps(const MetricsSnapshot& previous) const;
+
+    /**
+     * @brief Detection loop iterations per second since an earlier snapshot.
+     */
+    double detectionFps(const MetricsSnapshot& previous) const;
+
+    /**
+     * @brief All metrics in Prometheus text exposition format.
+     * @param captureFps camera frame rate, see captureFps()
+     * @param detectionFps detection frame rate, see detectionFps()
+     */
+    QString toPrometheusText(double captureFps, double detectionFps) const;
+};
+
+/**
+ * @brief Process wide hot path instrumentation.
+ *
+ * Detection stages are timed with MetricsScopedTimer into one LatencyHistogram
+ * per stage. Counters and gauges track frame flow and video buffer depth.
+ * Everything is updated with relaxed atomics, so the hot path never waits for
+ * a reader; snapshot() can be called from any thread.
+ *
+ * Metrics are enabled by default and can be switched off at run time with
+ * setEnabled(). Defining UFO_METRICS_DISABLED compiles all updates out.
+ */
+class Metrics
+{
+public:
+    enum Stage {
+        FrameStage = 0,         ///< one detection loop iteration
+        GrayFrameStage,
+        CoarseMotionStage,
+        MotionMaskStage,
+        DetectMotionStage,
+        DetectStage,
+        TrackerUpdateStage,
+        LightDetectionStage,
+        BirdClassificationStage,
+        RecorderWriteStage,
+        ImageWriteStage,        ///< encoding and writing one result image
+        DetectorStartStage,     ///< ActualDetector::start() until the detection thread runs
+        DetectorStopStage,      ///< ActualDetector::stopThread() until threads and writers have finished
+        STAGE_COUNT
+    };
+
+    enum Counter {
+        FramesRead = 0,         ///< frames read from camera
+        FramesDropped,          ///< recorder frames not accepted by video buffer
+        FramesSkipped,          ///< camera frames the recorder left out (decimation, period already filled)
+        FramesDuplicated,       ///< frames written again to video for periods without a camera frame
+        ImagesDropped,          ///< result images not accepted by image writer
+        FramesMissed,           ///< camera frames replaced by a newer one before detection took them
+        COUNTER_COUNT
+    };
+
+    enum Gauge {
+        VideoBufferDepth = 0,
+        VideoBufferMaxDepth,
+        Recording,              ///< 1 while recording a video
+        EncoderQueueDepth,      ///< videos being encoded
+        GAUGE_COUNT
+    };
+
+    static Metrics& instance();
+
+    static const char* stageName(Stage stage);
+    static const char* counterName(Counter counter);
+    static const char* gaugeName(Gauge gauge);
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const;
+
+    inline void recordLatency(Stage stage, uint64_t valueUs) {
+#ifndef UFO_METRICS_DISABLED
+        if (m_enabled.load(std::memory_order_relaxed)) {
+            m_stages[stage].record(valueUs);
+        }
+#else
+        Q_UNUSED(stage);
+        Q_UNUSED(valueUs);
+#endif
+    }
+
+    inline void count(Counter counter, uint64_t amount = 1) {
+#ifndef UFO_METRICS_DISABLED
+        if (m_enabled.load(std::memory_order_relaxed)) {
+            m_counters[counter].fetch_add(amount, std::memory_order_relaxed);
+        }
+#else
+        Q_UNUSED(counter);
+        Q_UNUSED(amount);
+#endif
+    }
+
+    /**
+     * @brief Set gauge value. VideoBufferDepth also raises VideoBufferMaxDepth.
+     */
+    void setGauge(Gauge gauge, int64_t value);
+
+    MetricsSnapshot snapshot() const;
+
+    /**
+     * @brief Clear all metrics. Not to be called while detecting.
+     */
+    void reset();
+
+#ifndef _UNIT_TEST_
+private:
+#endif
+    Metrics();
+
+    std::atomic<bool> m_enabled;
+    LatencyHistogram m_stages[STAGE_COUNT];
+    std::atomic<uint64_t> m_counters[COUNTER_COUNT];
+    std::atomic<int64_t> m_gauges[GAUGE_COUNT];
+};
+
+#ifndef UFO_METRICS_DISABLED
+/**
+ * @brief Records the time from construction to stop() or destruction as stage latency.
+ */
+class MetricsScopedTimer
+{
+public:
+    explicit MetricsScopedTimer(Metrics::Stage stage) : m_stage(stage) {
+        m_running = Metrics::instance().isEnabled();
+        if (m_running) {
+            m_start = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~MetricsScopedTimer() {
+        stop();
+    }
+
+    void stop() {
+        if (m_running) {
+            m_running = false;
+            std::chrono::microseconds elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() - m_start);
+            Metrics::instance().recordLatency(m_stage, (uint64_t)elapsed.count());
+        }
+    }
+
+private:
+    Metrics::Stage m_stage;
+    bool m_running;
+    std::chrono::steady_clock::time_point m_start;
+};
+#else
+class MetricsScopedTimer
+{
+public:
+    explicit MetricsScopedTimer(Metrics::Stage) {}
+    void stop() {}
+};
+#endif
+
+#endif // METRICS_H
@@ -0,0 +1,103 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "motionmodel.h"
+
+MotionModel* MotionModel::create(int type)
+{
+    if (type == MotionModel::Background) {
+        return new BackgroundMotionModel();
+    }
+    return new FrameDifferenceMotionModel();
+}
+
+void FrameDifferenceMotionModel::reset()
+{
+    m_prevFrame.release();
+    m_currentFrame.release();
+}
+
+void FrameDifferenceMotionModel::apply(const cv::Mat& grayFrame, int threshold, cv::Mat& motion, const cv::Rect& roi)
+{
+    motion.create(grayFrame.size(), CV_8UC1);
+    if (m_prevFrame.empty() || m_currentFrame.empty() || (roi.area() == 0)) {
+        motion.setTo(cv::Scalar(0));
+    } else {
+        if (roi.area() < grayFrame.size().area()) {
+            motion.setTo(cv::Scalar(0));
+        }
+        cv::Mat roiMotion = motion(roi);
+        cv::absdiff(m_prevFrame(roi), grayFrame(roi), m_d1);
+        cv::absdiff(m_currentFrame(roi), grayFrame(roi), m_d2);
+        cv::bitwise_and(m_d1, m_d2, roiMotion);
+        cv::threshold(roiMotion, roiMotion, threshold, 255, CV_THRESH_BINARY);
+    }
+    m_prevFrame = m_currentFrame;
+    m_currentFrame = grayFrame;
+}
+
+BackgroundMotionModel::BackgroundMotionModel()
+{
+    m_frameCounter = 0;
+}
+
+void BackgroundMotionModel::reset()
+{
+    m_frameCounter = 0;
+    m_mean.release();
+    m_variance.release();
+}
+
+void BackgroundMotionModel::apply(const cv::Mat& grayFrame, int threshold, cv::Mat& motion, const cv::Rect& roi)
+{
+    if (m_mean.empty() || (m_mean.size() != grayFrame.size())) {
+        grayFrame.convertTo(m_mean, CV_32F);
+        m_variance = cv::Mat(grayFrame.size(), CV_32FC1, cv::Scalar(INITIAL_VARIANCE));
+        m_frameCounter = 0;
+        motion = cv::Mat::zeros(grayFrame.size(), CV_8UC1);
+        return;
+    }
+
+    motion.create(grayFrame.size(), CV_8UC1);
+    if (roi.area() < grayFrame.size().area()) {
+        motion.setTo(cv::Scalar(0));
+    }
+    if (roi.area() > 0) {
+        cv::Mat roiMotion = motion(roi);
+        grayFrame(roi).convertTo(m_frame, CV_32F);
+        cv::absdiff(m_frame, m_mean(roi), m_diff);
+        cv::sqrt(m_variance(roi), m_limit);
+        m_limit.convertTo(m_limit, CV_32F, VARIANCE_FACTOR);
+        cv::max(m_limit, (double)threshold, m_limit);
+        cv::compare(m_diff, m_limit, roiMotion, cv::CMP_GT);
+    }
+
+    if (++m_frameCounter >= UPDATE_INTERVAL) {
+        m_frameCounter = 0;
+        grayFrame.convertTo(m_frame, CV_32F);
+        cv::absdiff(m_frame, m_mean, m_diff);
+        cv::bitwise_not(motion, m_stillPixels);
+        cv::multiply(m_diff, m_diff, m_diff);
+        cv::accumulateWeighted(m_frame, m_mean, LEARNING_RATE, m_stillPixels);
+        cv::accumulateWeighted(m_diff, m_variance, LEARNING_RATE, m_stillPixels);
+        // moving pixels are learned too, slowly, so a lasting change such as
+        // a brightness step doesn't stay in the motion mask forever
+        cv::accumulateWeighted(m_frame, m_mean, FOREGROUND_LEARNING_RATE, motion);
+        cv::accumulateWeighted(m_diff, m_variance, FOREGROUND_LEARNING_RATE, motion);
+    }
+}
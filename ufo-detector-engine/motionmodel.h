@@ -0,0 +1,129 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MOTIONMODEL_H
+#define MOTIONMODEL_H
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+/**
+ * @brief Finds moving pixels in consecutive gray frames.
+ */
+class MotionModel
+{
+public:
+    /**
+     * @brief Available motion models. The values are used in the settings file.
+     */
+    enum Type {
+        FrameDifference = 0,    ///< difference of three consecutive frames
+        Background = 1          ///< running average background with per-pixel variance
+    };
+
+    virtual ~MotionModel() {}
+
+    /**
+     * @brief Create motion model.
+     * @param type Type value, unknown values create a FrameDifference model
+     * @return new motion model, ownership is given to caller
+     */
+    static MotionModel* create(int type);
+
+    /**
+     * @brief Forget all previous frames.
+     */
+    virtual void reset() = 0;
+
+    /**
+     * @brief Give the next frame and get its motion mask.
+     * @param grayFrame next gray frame, must not be modified by the caller afterwards
+     * @param threshold minimum brightness change of moving pixels
+     * @param motion binary mask of moving pixels (255) is stored here
+     */
+    void apply(const cv::Mat& grayFrame, int threshold, cv::Mat& motion)
+    {
+        apply(grayFrame, threshold, motion, cv::Rect(0, 0, grayFrame.cols, grayFrame.rows));
+    }
+
+    /**
+     * @brief Give the next frame and get its motion mask inside a region of interest.
+     * The frame is still remembered as a whole. Motion outside the region is zero.
+     * @param roi region of interest, may be empty
+     */
+    virtual void apply(const cv::Mat& grayFrame, int threshold, cv::Mat& motion, const cv::Rect& roi) = 0;
+};
+
+/**
+ * @brief Motion is a change from both of the two previous frames.
+ */
+class FrameDifferenceMotionModel : public MotionModel
+{
+public:
+    using MotionModel::apply;
+    void reset();
+    void apply(const cv::Mat& grayFrame, int threshold, cv::Mat& motion, const cv::Rect& roi);
+
+#ifndef _UNIT_TEST_
+private:
+#endif
+    cv::Mat m_prevFrame;
+    cv::Mat m_currentFrame;
+    cv::Mat m_d1;
+    cv::Mat m_d2;
+};
+
+/**
+ * @brief Motion is a change from a slowly adapting background.
+ *
+ * Each pixel has a running average and variance. A pixel is moving if it
+ * differs from the average by more than VARIANCE_FACTOR standard deviations,
+ * and at least by the threshold, so flickering leaves and cloud edges raise
+ * their own limit. The background is learned from every UPDATE_INTERVAL-th
+ * frame only. Moving pixels are learned ten times slower than still pixels,
+ * so passing objects hardly change the background but lasting changes are
+ * absorbed. Learning covers the whole frame even if motion is searched only
+ * in a region of interest.
+ */
+class BackgroundMotionModel : public MotionModel
+{
+public:
+    using MotionModel::apply;
+    BackgroundMotionModel();
+    void reset();
+    void apply(const cv::Mat& grayFrame, int threshold, cv::Mat& motion, const cv::Rect& roi);
+
+#ifndef _UNIT_TEST_
+private:
+#endif
+    const int UPDATE_INTERVAL = 4;          ///< learn background from every 4th frame
+    const double LEARNING_RATE = 0.05;      ///< weight of a new frame in the background
+    const double FOREGROUND_LEARNING_RATE = LEARNING_RATE / 10; ///< weight of a new frame for moving pixels
+    const double VARIANCE_FACTOR = 3.0;     ///< moving pixels differ by this many standard deviations
+    const double INITIAL_VARIANCE = 25.0;
+
+    int m_frameCounter;     ///< frames since the last background update
+    cv::Mat m_mean;         ///< CV_32F background
+    cv::Mat m_variance;     ///< CV_32F per-pixel variance
+    cv::Mat m_frame;        ///< CV_32F frame or region of interest
+    cv::Mat m_diff;
+    cv::Mat m_limit;
+    cv::Mat m_stillPixels;
+};
+
+#endif // MOTIONMODEL_H
@@ -17,6 +17,12 @@
  */
 
 #include "recorder.h"
+#include <cmath>
+#if defined(Q_OS_WIN)
+#include <qt_windows.h>
+#elif defined(Q_OS_LINUX)
+#include <unistd.h>
+#endif
 
 Recorder::Recorder(Camera* cameraPtr, Config* configPtr, Logger *logger, DataManager* dataManager) :
     m_camera(cameraPtr), m_config(configPtr), m_logger(logger), m_dataManager(dataManager)
@@ -41,6 +47,11 @@ Recorder::Recorder(Camera* cameraPtr, Config* configPtr, Logger *logger, DataMan
     m_objectRectangleColor = m_objectPositiveColor;
     m_videoResolution = Size(width, height);
     m_videoBuffer = NULL;
+    m_encodingQueue = NULL;
+    m_videoFrameRate = DEFAULT_FRAME_RATE;
+    m_frameDecimation = 1;
+    m_firstFrameTimestampUs = -1;
+    m_framePeriodsFilled = 0;
 
     double aspectRatio = (double)width / (double)height;
     m_defaultThumbnailSideLength = 80;
@@ -61,9 +72,19 @@ void Recorder::startRecording(Mat &firstFrame)
 {
     if (!m_recording)
     {
+        std::shared_ptr<const ConfigSnapshot> settings = m_config->snapshot();
         m_firstFrame = firstFrame;
-        m_videoBuffer = new VideoBuffer(VIDEO_BUFFER_CAPACITY);
+        m_drawRectangles = settings->m_resultVideoWithObjectRectangles;
+        m_frameDecimation = qMax(1, settings->m_resultVideoFrameDecimation);
+        double cameraFrameRate = m_camera->frameRate();
+        m_videoFrameRate = ((cameraFrameRate > 0) ? cameraFrameRate : DEFAULT_FRAME_RATE) / m_frameDecimation;
+        // the buffer holds camera frames, which need not have the configured video resolution
+        Size frameSize = firstFrame.empty() ? m_videoResolution : firstFrame.size();
+        m_videoBuffer = new VideoBuffer(videoBufferCapacity(m_videoFrameRate, frameSize, availableMemoryBytes()));
+        m_firstFrameTimestampUs = -1;
+        m_framePeriodsFilled = 0;
         m_recording = true;
+        Metrics::instance().setGauge(Metrics::Recording, 1);
         //m_currentFrame = m_camera->getWebcamFrame();
         if (!m_frameUpdateThread)
         {
@@ -98,9 +119,9 @@ void Recorder::recordThread(){
             recordCodecIsFinal = false;
         }
     }
-    m_videoWriter.open(filenameTemp.toStdString(), recordCodec, OUTPUT_FPS, m_videoResolution, true);
+    m_videoWriter.open(filenameTemp.toStdString(), recordCodec, m_videoFrameRate, m_videoResolution, true);
 
-    m_logger->print("Video timestamp " + dateTime);
+    m_logger->print("Video timestamp " + dateTime + ", " + QString::number(m_videoFrameRate, 'f', 2) + " FPS");
 
     if (!m_videoWriter.isOpened())
     {
@@ -112,7 +133,7 @@ void Recorder::recordThread(){
     timer.start();
     if (m_firstFrame.data)
     {
-        m_videoWriter.write(m_firstFrame);
+        writeFrame(m_firstFrame, 1);
     }
 
     while(m_recording)
@@ -120,9 +141,7 @@ void Recorder::recordThread(){
         BufferedVideoFrame* frame = m_videoBuffer->waitNextFrame();
         if (frame) {
             if (frame->m_frame && frame->m_frame->data) {
-                for (int i=0; i <= frame->m_duplicateCount; i++) {
-                    m_videoWriter.write(*(frame->m_frame));
-                }
+                writeFrame(*(frame->m_frame), frame->m_duplicateCount + 1);
                 frame->m_frame->release();
             }
             delete frame->m_frame;
@@ -162,10 +181,26 @@ void Recorder::recordThread(){
     }
 }
 
+void Recorder::writeFrame(const Mat& frame, int count)
+{
+    auto write = [this, &frame, count]() {
+        MetricsScopedTimer writeTimer(Metrics::RecorderWriteStage);
+        for (int i = 0; i < count; i++) {
+            m_videoWriter.write(frame);
+        }
+    };
+    if (m_encodingQueue) {
+        m_encodingQueue->run(write);
+    } else {
+        write();
+    }
+}
+
 void Recorder::startEncodingVideo(QString tempVideoFileName, QString targetVideoFileName)
 {
     QProcess* proc = new QProcess();
     m_encoderProcesses.push_back(proc);
+    Metrics::instance().setGauge(Metrics::EncoderQueueDepth, m_encoderProcesses.size());
     m_tempVideoFiles.push_back(tempVideoFileName);
     QStringList args;
     int codec = m_config->resultVideoCodec();
@@ -208,6 +243,7 @@ void Recorder::onVideoEncodingFinished()
         remove(tempVideoFile.toStdString().c_str());
         m_tempVideoFiles.erase(m_tempVideoFiles.begin() + i);
     }
+    Metrics::instance().setGauge(Metrics::EncoderQueueDepth, m_encoderProcesses.size());
 
     if(m_encoderProcesses.size() == 0)
     {
@@ -221,47 +257,84 @@ void Recorder::onVideoEncodingFinished()
  */
 void Recorder::readFrameThread()
 {
-    Mat temp;
+    CameraFrame cameraFrame;
     Rect oldRectangle;
-    chrono::high_resolution_clock::time_point prevTime, nextTime, currentTime;
-    int skippedFrames = 0;    // how many frames were skipped (couldn't be read in time)
+    quint64 frameSequence = 0;
+    int frameCount = 0;
+    int writes = 0;
     BufferedVideoFrame* frame = NULL;
 
-    prevTime = chrono::high_resolution_clock::now();
-    nextTime = prevTime + frame_period{1}; /// @todo decrease time from start to here for more accuracy
-
     while(m_recording)
     {
-        skippedFrames = 0;
-        this_thread::sleep_until(nextTime);
-
-        temp = m_camera->getWebcamFrame();
-        currentTime = chrono::high_resolution_clock::now();
-
-        nextTime += frame_period{1};
-
-        // if frame exposure took more than frame_period(1), next time has already gone
-        while (nextTime < currentTime) {
-            skippedFrames++;
-            nextTime += frame_period{1};
+        cameraFrame = m_camera->waitNextFrame(frameSequence);
+        if (cameraFrame.empty())
+        {
+            continue;
         }
-
-        if (m_drawRectangles && (m_motionRectangle != oldRectangle))
+        writes = frameWriteCount(cameraFrame.timestampUs(), frameCount++);
+        if (writes == 0)
         {
-            rectangle(temp, m_motionRectangle, m_objectRectangleColor);
-            oldRectangle=m_motionRectangle;
+            continue;
         }
 
         frame = new BufferedVideoFrame;
         frame->m_frame = new Mat();
-        *(frame->m_frame) = temp.clone();
-        frame->m_duplicateCount = skippedFrames;
+        *(frame->m_frame) = cameraFrame.bgr();
+        frame->m_duplicateCount = writes - 1;
+
+        if (m_drawRectangles && (m_motionRectangle != oldRectangle))
+        {
+            // the camera frame is shared with the detector
+            *(frame->m_frame) = frame->m_frame->clone();
+            rectangle(*(frame->m_frame), m_motionRectangle, m_objectRectangleColor);
+            oldRectangle=m_motionRectangle;
+        }
 
         if (m_videoBuffer->count() >= m_videoBuffer->capacity()) {
             m_logger->print("Alert: video buffer is full. Decrease video frame rate.");
         }
-        m_videoBuffer->pushFrame(frame);
+        if (!m_videoBuffer->pushFrame(frame)) {
+            Metrics::instance().count(Metrics::FramesDropped);
+            delete frame->m_frame;
+            delete frame;
+        }
+    }
+}
+
+int Recorder::frameWriteCount(qint64 timestampUs, int frameNumber)
+{
+    if ((frameNumber % m_frameDecimation) != 0)
+    {
+        Metrics::instance().count(Metrics::FramesSkipped);
+        return 0;
+    }
+    int periods = framePeriodsToFill(timestampUs);
+    if (periods == 0)
+    {
+        // frame came too soon after the previous one
+        Metrics::instance().count(Metrics::FramesSkipped);
+        return 0;
     }
+    // periods without an own camera frame get this frame again
+    Metrics::instance().count(Metrics::FramesDuplicated, periods - 1);
+    return periods;
+}
+
+int Recorder::framePeriodsToFill(qint64 timestampUs)
+{
+    if (m_firstFrameTimestampUs < 0)
+    {
+        m_firstFrameTimestampUs = timestampUs;
+    }
+    // periods up to and including the one nearest to the capture time
+    qint64 periods = qRound64((double)(timestampUs - m_firstFrameTimestampUs) * m_videoFrameRate / 1000000.0) + 1;
+    if (periods <= m_framePeriodsFilled)
+    {
+        return 0;
+    }
+    int periodsToFill = (int)(periods - m_framePeriodsFilled);
+    m_framePeriodsFilled = periods;
+    return periodsToFill;
 }
 
 void Recorder::saveVideoThumbnailImage(Mat& image, QString dateTime) {
@@ -284,11 +357,80 @@ void Recorder::stopRecording(bool willSaveVideo)
         m_videoBuffer->stopWait();
         m_recorderThread->join(); m_recorderThread.reset();
         m_frameUpdateThread->join(); m_frameUpdateThread.reset();
+        Metrics::instance().setGauge(Metrics::Recording, 0);
     }
     delete m_videoBuffer;
     m_videoBuffer = NULL;
 }
 
+void Recorder::setWorkerQueue(WorkerPool::Queue* queue)
+{
+    m_encodingQueue = queue;
+}
+
+int Recorder::videoBufferCapacity(double frameRate, Size resolution, qint64 availableBytes)
+{
+    int capacity = (int)std::ceil(frameRate * VIDEO_BUFFER_SECONDS);
+    if (availableBytes > 0)
+    {
+        qint64 frameBytes = (qint64)resolution.width * resolution.height * 3;
+        qint64 memoryCapacity = availableBytes / VIDEO_BUFFER_MEMORY_SHARE / qMax((qint64)1, frameBytes);
+        capacity = (int)qMin((qint64)capacity, memoryCapacity);
+    }
+    return qMax((int)MIN_VIDEO_BUFFER_CAPACITY, capacity);
+}
+
+qint64 Recorder::availableMemoryBytes()
+{
+#if defined(Q_OS_WIN)
+    MEMORYSTATUSEX status;
+    status.dwLength = sizeof(status);
+    if (GlobalMemoryStatusEx(&status))
+    {
+        return (qint64)status.ullAvailPhys;
+    }
+#elif defined(Q_OS_LINUX)
+    // free pages alone leave out the page cache, which is most of the memory on a long running system
+    QFile meminfo("/proc/meminfo");
+    if (meminfo.open(QIODevice::ReadOnly))
+    {
+        qint64 bytes = parseMemAvailable(meminfo.readAll());
+        if (bytes >= 0)
+        {
+            return bytes;
+        }
+    }
+    long pages = sysconf(_SC_AVPHYS_PAGES);
+    long pageSize = sysconf(_SC_PAGESIZE);
+    if ((pages > 0) && (pageSize > 0))
+    {
+        return (qint64)pages * pageSize;
+    }
+#endif
+    return -1;
+}
+
+qint64 Recorder::parseMemAvailable(const QByteArray& meminfo)
+{
+    foreach (const QByteArray& line, meminfo.split('\n'))
+    {
+        // e.g. "MemAvailable:    8123456 kB"
+        if (!line.startsWith("MemAvailable:"))
+        {
+            continue;
+        }
+        QList<QByteArray> fields = line.mid(13).simplified().split(' ');
+        bool ok = false;
+        qint64 value = fields.value(0).toLongLong(&ok);
+        if (!ok || (value < 0))
+        {
+            return -1;
+        }
+        return (fields.value(1) == "kB") ? value * 1024 : value;
+    }
+    return -1;
+}
+
 /*
  * Called from ActualDetector to pass the rectangle that highlights the detected object and bool isPositive to specify the color of the rectangle
  * Red = positive detection | Blue = negative detection
@@ -24,6 +24,7 @@
 #include "camera.h"
 #include "videobuffer.h"
 #include "datamanager.h"
+#include "workerpool.h"
 #include <QDomDocument>
 #include <QFile>
 #include <QObject>
@@ -43,32 +44,68 @@
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 
-#define OUTPUT_FPS 25
-#define VIDEO_BUFFER_CAPACITY (OUTPUT_FPS * 5)
-
 using namespace cv;
 using namespace std;
-using frame_period = std::chrono::duration<long long, std::ratio<1, OUTPUT_FPS>>;
-using hr_duration = std::chrono::high_resolution_clock::duration;
 
 class ActualDetector;
 
 /**
  * @brief The class for recording videos from web camera.
+ *
+ * Videos are recorded at the frame rate the camera was measured to deliver,
+ * optionally decimated by Config::resultVideoFrameDecimation(). Camera frames
+ * are placed into video frame periods by their capture timestamps, so video
+ * time follows capture time even when the camera stalls.
  */
 class Recorder : public QObject {
 Q_OBJECT
 
 public:
+    static const int DEFAULT_FRAME_RATE = 25;   ///< video frame rate when the camera frame rate isn't known yet
+
     explicit Recorder(Camera* cameraPtr, Config* configPtr, Logger* logger, DataManager* dataManager);
     void startRecording(cv::Mat &firstFrame);
     void stopRecording(bool willSaveVideo);
     void setRectangle(cv::Rect &r, bool isRed);
 
+    /**
+     * @brief Write video frames in tasks of a shared worker pool.
+     * The recorder thread then only waits for frames and hands them over.
+     * @param queue pool queue with concurrency 1, NULL = write in recorder thread
+     */
+    void setWorkerQueue(WorkerPool::Queue* queue);
+
+    /**
+     * @brief Number of frames the video buffer holds.
+     * Enough for VIDEO_BUFFER_SECONDS of video, but at most a share of the available memory.
+     * @param frameRate video frame rate
+     * @param resolution resolution of the buffered camera frames
+     * @param availableBytes available physical memory, -1 = unknown
+     * @return buffer capacity in frames
+     */
+    static int videoBufferCapacity(double frameRate, cv::Size resolution, qint64 availableBytes);
+
+    /**
+     * @brief Physical memory available for new allocations.
+     * On Linux MemAvailable of /proc/meminfo, which includes reclaimable page cache,
+     * or free memory if the kernel doesn't report it.
+     * @return bytes, or -1 if not known on this platform
+     */
+    static qint64 availableMemoryBytes();
+
+    /**
+     * @brief Parse MemAvailable from the content of /proc/meminfo.
+     * @return bytes, or -1 if the field is missing or invalid
+     */
+    static qint64 parseMemAvailable(const QByteArray& meminfo);
+
 #ifndef _UNIT_TEST_
 private:
 #endif
     const int DEFAULT_CODEC = 0;
+    static const int VIDEO_BUFFER_SECONDS = 5;      ///< seconds of video the buffer is sized for
+    static const int VIDEO_BUFFER_MEMORY_SHARE = 4; ///< buffer takes at most 1/n of available memory
+    static const int MIN_VIDEO_BUFFER_CAPACITY = 10;
 
     Camera* m_camera;
     Config* m_config;
@@ -89,11 +126,16 @@ private:
     QString m_videoFileExtension;
     QString m_thumbnailExtension;
 
+    WorkerPool::Queue* m_encodingQueue;    ///< shared pool queue for writing frames, may be NULL
     std::unique_ptr<std::thread> m_recorderThread;
     std::unique_ptr<std::thread> m_frameUpdateThread;
     std::atomic<bool> m_recording;
     bool m_willSaveVideo;       ///< whether to save video or reject it
     bool m_drawRectangles;      ///< whether or not to draw rectangles around detected objects
+    double m_videoFrameRate;        ///< frame rate of the video being recorded
+    int m_frameDecimation;          ///< every how many camera frames one is recorded
+    qint64 m_firstFrameTimestampUs; ///< capture timestamp of the first frame read, -1 = none yet
+    qint64 m_framePeriodsFilled;    ///< video frame periods that have a frame since the first one
 
     std::vector<QProcess*> m_encoderProcesses;
     std::vector<QString> m_tempVideoFiles;
@@ -101,12 +143,35 @@ private:
     void recordThread();
 
     /**
-     * @brief camera frame reader thread
-     *
-     * @todo use a single source of frames
+     * @brief Write frame into video, in encoding queue if set.
+     * @param frame
+     * @param count how many times the frame is written
+     */
+    void writeFrame(const cv::Mat& frame, int count);
+
+    /**
+     * @brief camera frame reader thread, wakes up for each new camera frame
      */
     void readFrameThread();
 
+    /**
+     * @brief How many video frame periods a camera frame fills, by its capture timestamp.
+     * Frames go to the nearest period, so timestamp jitter doesn't move them between periods.
+     * A frame after a camera stall also fills the periods without a frame.
+     * @param timestampUs capture timestamp of the frame
+     * @return number of times to write the frame, 0 if its period has a frame already
+     */
+    int framePeriodsToFill(qint64 timestampUs);
+
+    /**
+     * @brief How many times a camera frame is written to the video, counts skipped and duplicated frames.
+     * Frames left out by decimation or because their period has a frame already are skipped.
+     * @param timestampUs capture timestamp of the frame
+     * @param frameNumber number of camera frames read before this one while recording
+     * @return number of times to write the frame, 0 if it is skipped
+     */
+    int frameWriteCount(qint64 timestampUs, int frameNumber);
+
     /**
      * @brief Save video thumbnail image.
      * @param image
@@ -0,0 +1,210 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "resultimagewriter.h"
+#include "filesync.h"
+#include <QFile>
+#include <QFileInfo>
+#include <set>
+
+ResultImageWriter::ResultImageWriter(int threadCount)
+{
+    m_threadCount = std::max(1, threadCount);
+    m_running = false;
+    m_droppedCount = 0;
+    m_writtenCount = 0;
+    m_failedCount = 0;
+}
+
+ResultImageWriter::~ResultImageWriter()
+{
+    stop();
+}
+
+void ResultImageWriter::start()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_running) {
+        return;
+    }
+    m_droppedCount = 0;
+    m_writtenCount = 0;
+    m_failedCount = 0;
+    m_running = true;
+    for (int i = 0; i < m_threadCount; i++) {
+        m_workers.push_back(std::unique_ptr<std::thread>(
+                new std::thread(&ResultImageWriter::workerThread, this)));
+    }
+}
+
+void ResultImageWriter::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running = false;
+        m_jobAvailable.notify_all();
+    }
+    // workers leave when the queue is empty
+    for (unsigned int i = 0; i < m_workers.size(); i++) {
+        m_workers[i]->join();
+    }
+    m_workers.clear();
+    m_archive.close();
+}
+
+bool ResultImageWriter::openArchive(const QString& fileName)
+{
+    return m_archive.open(fileName);
+}
+
+bool ResultImageWriter::write(const std::string& fileName, cv::Mat& image)
+{
+    Job job;
+    job.m_fileName = fileName;
+    job.m_image = image;
+    image = cv::Mat();
+    return queue(job);
+}
+
+bool ResultImageWriter::writeCrop(const CropArchiveEntry& entry, cv::Mat& image, cv::Mat& mask)
+{
+    Job job;
+    job.m_image = image;
+    job.m_mask = mask;
+    job.m_entry = entry;
+    image = cv::Mat();
+    mask = cv::Mat();
+    if (!m_archive.isOpen()) {
+        m_failedCount++;
+        return false;
+    }
+    return queue(job);
+}
+
+bool ResultImageWriter::queue(Job& job)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_running || (m_jobs.size() >= MAX_PENDING_IMAGES)) {
+        m_droppedCount++;
+        Metrics::instance().count(Metrics::ImagesDropped);
+        return false;
+    }
+    m_jobs.push_back(job);
+    m_jobAvailable.notify_one();
+    return true;
+}
+
+uint64_t ResultImageWriter::droppedCount() const
+{
+    return m_droppedCount;
+}
+
+uint64_t ResultImageWriter::writtenCount() const
+{
+    return m_writtenCount;
+}
+
+uint64_t ResultImageWriter::failedCount() const
+{
+    return m_failedCount;
+}
+
+void ResultImageWriter::workerThread()
+{
+    std::vector<Job> batch;
+
+    while (true) {
+        batch.clear();
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            while (m_running && m_jobs.empty()) {
+                m_jobAvailable.wait(lock);
+            }
+            if (m_jobs.empty()) {
+                // stopped and everything written
+                return;
+            }
+            while (!m_jobs.empty() && (batch.size() < SYNC_BATCH_SIZE)) {
+                batch.push_back(m_jobs.front());
+                m_jobs.pop_front();
+            }
+        }
+        writeBatch(batch);
+    }
+}
+
+void ResultImageWriter::writeBatch(const std::vector<Job>& batch)
+{
+    std::vector<std::unique_ptr<QFile> > files;
+    std::set<QString> directories;
+    std::vector<uchar> encoded;
+    std::vector<uchar> encodedMask;
+    bool cropsAppended = false;
+
+    for (unsigned int i = 0; i < batch.size(); i++) {
+        MetricsScopedTimer writeTimer(Metrics::ImageWriteStage);
+        const Job& job = batch[i];
+        if (job.m_fileName.empty()) {
+            encodedMask.clear();
+            bool encodedOk = false;
+            try {
+                encodedOk = cv::imencode(".jpg", job.m_image, encoded)
+                        && (job.m_mask.empty() || cv::imencode(".png", job.m_mask, encodedMask));
+            } catch (cv::Exception& e) {
+                encodedOk = false;
+            }
+            if (!encodedOk || !m_archive.append(job.m_entry, encoded, encodedMask)) {
+                m_failedCount++;
+                continue;
+            }
+            cropsAppended = true;
+            m_writtenCount++;
+            continue;
+        }
+        size_t extensionPos = job.m_fileName.rfind('.');
+        std::string extension = (extensionPos != std::string::npos) ? job.m_fileName.substr(extensionPos) : ".jpg";
+        bool encodedOk = false;
+        try {
+            encodedOk = cv::imencode(extension, job.m_image, encoded);
+        } catch (cv::Exception& e) {
+            encodedOk = false;
+        }
+        std::unique_ptr<QFile> file(new QFile(QString::fromStdString(job.m_fileName)));
+        if (!encodedOk || !file->open(QIODevice::WriteOnly)
+                || (file->write((const char*)encoded.data(), encoded.size()) != (qint64)encoded.size())
+                || !file->flush()) {
+            m_failedCount++;
+            continue;
+        }
+        directories.insert(QFileInfo(*file).absolutePath());
+        files.push_back(std::move(file));
+        m_writtenCount++;
+    }
+
+    // one sync round for the whole batch
+    for (unsigned int i = 0; i < files.size(); i++) {
+        FileSync::syncFile(*files[i]);
+        files[i]->close();
+    }
+    for (std::set<QString>::const_iterator it = directories.begin(); it != directories.end(); ++it) {
+        FileSync::syncDirectory(*it);
+    }
+    if (cropsAppended) {
+        m_archive.sync();
+    }
+}
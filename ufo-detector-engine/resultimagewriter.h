@@ -0,0 +1,151 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RESULTIMAGEWRITER_H
+#define RESULTIMAGEWRITER_H
+
+#include "metrics.h"
+#include "croparchive.h"
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <string>
+
+/**
+ * @brief Writes result images in background threads.
+ *
+ * The detection thread hands images over with write(), which never blocks:
+ * if writing falls behind and MAX_PENDING_IMAGES are already waiting, the
+ * image is dropped and counted. Worker threads encode the images and write
+ * them in batches of up to SYNC_BATCH_SIZE files, which are synced to disk
+ * together at the end of the batch instead of one by one.
+ *
+ * Crops given to writeCrop() are appended into a single crop archive file
+ * instead, together with their threshold mask and metadata.
+ */
+class ResultImageWriter
+{
+public:
+    /**
+     * @brief Constructor. Threads are started with start().
+     * @param threadCount number of encoding threads
+     */
+    explicit ResultImageWriter(int threadCount = 2);
+
+    /**
+     * @brief Write queued images and stop.
+     */
+    ~ResultImageWriter();
+
+    /**
+     * @brief Start worker threads and reset counters.
+     */
+    void start();
+
+    /**
+     * @brief Write queued images, sync them to disk and stop worker threads.
+     * An open crop archive is closed.
+     */
+    void stop();
+
+    /**
+     * @brief Create the crop archive for writeCrop(). Call before start().
+     * @param fileName archive file name, an existing file is replaced
+     * @return false if the archive can't be created
+     */
+    bool openArchive(const QString& fileName);
+
+    /**
+     * @brief Queue an image for writing. Never blocks.
+     * @param fileName file name, the extension selects the image format
+     * @param image image, ownership is taken over; must not be a view into an image that is still changed
+     * @return false if the image was dropped because the queue is full or the writer is stopped
+     */
+    bool write(const std::string& fileName, cv::Mat& image);
+
+    /**
+     * @brief Queue a crop for appending into the crop archive. Never blocks.
+     * @param entry crop metadata
+     * @param image crop image, ownership is taken over
+     * @param mask threshold mask, may be empty; ownership is taken over
+     * @return false if the crop was dropped because the queue is full, the writer is stopped or no archive is open
+     */
+    bool writeCrop(const CropArchiveEntry& entry, cv::Mat& image, cv::Mat& mask);
+
+    /**
+     * @brief Images dropped since start().
+     */
+    uint64_t droppedCount() const;
+
+    /**
+     * @brief Images written since start().
+     */
+    uint64_t writtenCount() const;
+
+    /**
+     * @brief Images that couldn't be encoded or written since start().
+     */
+    uint64_t failedCount() const;
+
+#ifndef _UNIT_TEST_
+private:
+#endif
+    /**
+     * @brief A queued image.
+     */
+    struct Job {
+        std::string m_fileName;     ///< empty for crops going into the archive
+        cv::Mat m_image;
+        cv::Mat m_mask;
+        CropArchiveEntry m_entry;
+    };
+
+    const size_t MAX_PENDING_IMAGES = 32;
+    const size_t SYNC_BATCH_SIZE = 16;  ///< max. number of files synced at once
+
+    int m_threadCount;
+    std::vector<std::unique_ptr<std::thread> > m_workers;
+    std::mutex m_mutex;                 ///< guards m_jobs and m_running
+    std::condition_variable m_jobAvailable;
+    std::deque<Job> m_jobs;
+    CropArchiveWriter m_archive;
+    bool m_running;
+    std::atomic<uint64_t> m_droppedCount;
+    std::atomic<uint64_t> m_writtenCount;
+    std::atomic<uint64_t> m_failedCount;
+
+    void workerThread();
+
+    /**
+     * @brief Queue a job unless the queue is full or the writer is stopped.
+     */
+    bool queue(Job& job);
+
+    /**
+     * @brief Encode and write a batch of images, then sync the files, their folders and the archive.
+     */
+    void writeBatch(const std::vector<Job>& batch);
+};
+
+#endif // RESULTIMAGEWRITER_H
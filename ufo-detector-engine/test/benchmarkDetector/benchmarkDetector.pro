@@ -0,0 +1,86 @@
+#-------------------------------------------------
+#
+# Detection pipeline benchmark on a synthetic sky video
+#
+#-------------------------------------------------
+
+QT       += widgets testlib xml network
+
+TARGET = benchmarkdetector
+CONFIG += console testcase
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+QMAKE_CXXFLAGS += -std=c++14
+CONFIG += c++14
+
+DEFINES += SRCDIR=\\\"$$PWD/\\\" \
+    _UNIT_TEST_
+
+include(../../opencv.pri)
+
+INCLUDEPATH += . \
+    ../.. \
+    ../mock
+
+SOURCES += \
+    benchmarkdetector.cpp \
+    skygenerator.cpp \
+    ../../actualdetector.cpp \
+    ../../cameraframe.cpp \
+    ../../Ctracker.cpp \
+    ../../SpatialGrid.cpp \
+    ../../Detector.cpp \
+    ../../birdclassifier.cpp \
+    ../../brightnessthresholds.cpp \
+    ../../ambientbrightness.cpp \
+    ../../motionmodel.cpp \
+    ../../metrics.cpp \
+    ../../workerpool.cpp \
+    ../../croparchive.cpp \
+    ../../filesync.cpp \
+    ../../resultimagewriter.cpp \
+    ../../detectioneventlog.cpp \
+    ../../detectionsession.cpp \
+    ../../Kalman.cpp \
+    ../../HungarianAlg.cpp \
+    ../../planechecker.cpp \
+    ../../detectorstate.cpp \
+    ../../logger.cpp \
+    ../mock/mockconfig.cpp \
+    ../../configsnapshot.cpp \
+    ../mock/mockcamera.cpp \
+    ../mock/mockRecorder.cpp \
+    ../mock/mockVideoCodecSupportInfo.cpp \
+    ../mock/mockdatamanager.cpp
+
+HEADERS += \
+    skygenerator.h \
+    ../../actualdetector.h \
+    ../../config.h \
+    ../../configsnapshot.h \
+    ../../camera.h \
+    ../../cameraframe.h \
+    ../../recorder.h \
+    ../../Ctracker.h \
+    ../../SpatialGrid.h \
+    ../../Detector.h \
+    ../../birdclassifier.h \
+    ../../brightnessthresholds.h \
+    ../../ambientbrightness.h \
+    ../../motionmodel.h \
+    ../../metrics.h \
+    ../../workerpool.h \
+    ../../croparchive.h \
+    ../../filesync.h \
+    ../../resultimagewriter.h \
+    ../../detectioneventlog.h \
+    ../../detectionsession.h \
+    ../../Kalman.h \
+    ../../HungarianAlg.h \
+    ../../videocodecsupportinfo.h \
+    ../../planechecker.h \
+    ../../detectorstate.h \
+    ../../datamanager.h \
+    ../../logger.h
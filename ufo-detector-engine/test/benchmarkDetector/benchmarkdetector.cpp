@@ -0,0 +1,233 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "actualdetector.h"
+#include "config.h"
+#include "camera.h"
+#include "datamanager.h"
+#include "logger.h"
+#include "skygenerator.h"
+#include "metrics.h"
+#include <QString>
+#include <QtTest>
+#include <QCoreApplication>
+#include <QTemporaryDir>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QFile>
+#include <opencv2/highgui/highgui.hpp>
+#include <chrono>
+
+/**
+ * @brief Detection pipeline benchmark.
+ *
+ * Runs the detection loop on a synthetic sky video and reports the latency
+ * of each stage from the Metrics histograms. Results are written as JSON so that runs before and
+ * after a change can be compared. The run is controlled with environment
+ * variables:
+ *
+ * - UFO_BENCHMARK_WIDTH, UFO_BENCHMARK_HEIGHT: frame size (default 640x480)
+ * - UFO_BENCHMARK_FRAMES: number of frames (default 500)
+ * - UFO_BENCHMARK_SEED: synthetic video seed (default 1)
+ * - UFO_BENCHMARK_MOTION_MODEL: MotionModel::Type (default 0)
+ * - UFO_BENCHMARK_OUTPUT: JSON result file (default benchmark.json)
+ */
+class BenchmarkDetector : public QObject
+{
+    Q_OBJECT
+
+public:
+    BenchmarkDetector();
+
+private:
+    Config* m_config;
+    Camera* m_camera;
+    DataManager* m_dataManager;
+    Logger* m_logger;
+
+    int environmentValue(const char* name, int defaultValue);
+    QJsonObject stageStatistics(const MetricsSnapshot::StageLatency& latency);
+
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+    void skyGeneratorIsDeterministic();
+    void detectionPipeline();
+};
+
+BenchmarkDetector::BenchmarkDetector() {
+    m_config = NULL;
+    m_camera = NULL;
+    m_dataManager = NULL;
+    m_logger = NULL;
+}
+
+void BenchmarkDetector::initTestCase() {
+    m_config = new Config();
+    m_camera = new Camera(m_config->cameraIndex(), m_config->cameraWidth(), m_config->cameraHeight());
+    m_dataManager = new DataManager(m_config);
+    m_logger = new Logger();
+    m_logger->setOutputToFileEnabled(false);
+    m_logger->setOutputToStdioEnabled(false);
+}
+
+void BenchmarkDetector::cleanupTestCase() {
+    delete m_logger;
+    delete m_dataManager;
+    delete m_camera;
+    delete m_config;
+}
+
+void BenchmarkDetector::skyGeneratorIsDeterministic() {
+    SkyGenerator first(cv::Size(320, 240), 7);
+    SkyGenerator second(cv::Size(320, 240), 7);
+    SkyGenerator other(cv::Size(320, 240), 8);
+    for (int i = 0; i < 10; i++) {
+        cv::Mat frame = first.nextFrame();
+        QCOMPARE(frame.type(), CV_8UC3);
+        QCOMPARE(frame.cols, 320);
+        QCOMPARE(frame.rows, 240);
+        QCOMPARE(cv::norm(frame, second.nextFrame(), cv::NORM_INF), 0.0);
+        QVERIFY(cv::norm(frame, other.nextFrame(), cv::NORM_INF) > 0);
+    }
+    QCOMPARE(first.frameCount(), 10);
+}
+
+/*
+ * Runs ActualDetector::processFrame() on every frame like the detection thread,
+ * without night checking. Bird classification is synchronous so that it is
+ * part of the frame time. Stage latencies come from the Metrics histograms
+ * which processFrame() fills.
+ */
+void BenchmarkDetector::detectionPipeline() {
+    const int width = environmentValue("UFO_BENCHMARK_WIDTH", 640);
+    const int height = environmentValue("UFO_BENCHMARK_HEIGHT", 480);
+    const int frameCount = environmentValue("UFO_BENCHMARK_FRAMES", 500);
+    const int seed = environmentValue("UFO_BENCHMARK_SEED", 1);
+    const int motionModelType = environmentValue("UFO_BENCHMARK_MOTION_MODEL", MotionModel::FrameDifference);
+    QString outputFileName = qgetenv("UFO_BENCHMARK_OUTPUT");
+    if (outputFileName.isEmpty()) {
+        outputFileName = "benchmark.json";
+    }
+    QVERIFY(width > 0 && height > 0 && frameCount > 0);
+
+    SkyGenerator generator(cv::Size(width, height), seed);
+    ActualDetector detector(m_camera, m_config, m_logger, m_dataManager);
+    detector.m_cameraWidth = width;
+    detector.m_cameraHeight = height;
+    detector.m_motionModelType = motionModelType;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            detector.m_region.push_back(cv::Point(x, y));
+        }
+    }
+
+    detector.m_birdClassifier->setSynchronous(true);
+    detector.m_isCascadeFound = detector.m_birdClassifier->init(SRCDIR"../resources/cascade.xml",
+                                                                detector.CLASSIFIER_DIMENSION_SIZE);
+    if (!detector.m_isCascadeFound) {
+        qWarning() << "Bird classifier training file not found, bird classification not measured";
+    }
+    detector.m_isInNightMode = !detector.m_isCascadeFound;
+
+    std::vector<CameraFrame> initialFrames;
+    for (int i = 0; i < 3; i++) {
+        initialFrames.push_back(CameraFrame(generator.nextFrame()));
+    }
+    detector.initializeDetection(initialFrames);
+
+    QTemporaryDir videoDir;
+    cv::VideoWriter videoWriter;
+    videoWriter.open(QString(videoDir.path() + "/benchmark.avi").toStdString(),
+                     CV_FOURCC('M', 'J', 'P', 'G'), Recorder::DEFAULT_FRAME_RATE, cv::Size(width, height), true);
+    if (!videoWriter.isOpened()) {
+        qWarning() << "Cannot open video writer, recorder writes not measured";
+    }
+
+    int positives = 0;
+    int negatives = 0;
+    QObject::connect(&detector, &ActualDetector::positiveMessage, [&positives]() { positives++; });
+    QObject::connect(&detector, &ActualDetector::negativeMessage, [&negatives]() { negatives++; });
+
+    Metrics::instance().setEnabled(true);
+    Metrics::instance().reset();
+    std::chrono::steady_clock::time_point pipelineStart = std::chrono::steady_clock::now();
+
+    for (int frameIndex = 0; frameIndex < frameCount; frameIndex++) {
+        CameraFrame cameraFrame(generator.nextFrame());
+        detector.processFrame(cameraFrame);
+        if (videoWriter.isOpened()) {
+            // the recorder thread writes the same frames
+            MetricsScopedTimer writeTimer(Metrics::RecorderWriteStage);
+            videoWriter.write(cameraFrame.bgr());
+        }
+    }
+
+    double pipelineSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - pipelineStart).count();
+    MetricsSnapshot snapshot = Metrics::instance().snapshot();
+
+    QJsonObject stages;
+    for (int stage = 0; stage < Metrics::STAGE_COUNT; stage++) {
+        if (snapshot.m_stages[stage].m_count > 0) {
+            stages.insert(Metrics::stageName((Metrics::Stage)stage), stageStatistics(snapshot.m_stages[stage]));
+        }
+    }
+    QJsonObject result;
+    result.insert("width", width);
+    result.insert("height", height);
+    result.insert("frames", frameCount);
+    result.insert("seed", seed);
+    result.insert("motionModel", motionModelType);
+    result.insert("coarseMotion", detector.m_useCoarseMotion);
+    result.insert("objects", (double)snapshot.m_stages[Metrics::LightDetectionStage].m_count);
+    result.insert("positives", positives);
+    result.insert("negatives", negatives);
+    result.insert("framesPerSecond", frameCount / pipelineSeconds);
+    result.insert("stages", stages);
+
+    QFile outputFile(outputFileName);
+    QVERIFY(outputFile.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    outputFile.write(QJsonDocument(result).toJson());
+    outputFile.close();
+    qDebug() << "Benchmark results written to" << outputFileName;
+
+    QCOMPARE(snapshot.m_stages[Metrics::FrameStage].m_count, (uint64_t)frameCount);
+    QCOMPARE(snapshot.m_stages[Metrics::MotionMaskStage].m_count, (uint64_t)frameCount);
+}
+
+int BenchmarkDetector::environmentValue(const char* name, int defaultValue) {
+    bool ok = false;
+    int value = qgetenv(name).toInt(&ok);
+    return ok ? value : defaultValue;
+}
+
+QJsonObject BenchmarkDetector::stageStatistics(const MetricsSnapshot::StageLatency& latency) {
+    QJsonObject statistics;
+    statistics.insert("calls", (double)latency.m_count);
+    statistics.insert("totalUs", (double)latency.m_totalUs);
+    statistics.insert("meanUs", latency.m_meanUs);
+    statistics.insert("p50Us", (double)latency.m_p50Us);
+    statistics.insert("p90Us", (double)latency.m_p90Us);
+    statistics.insert("p99Us", (double)latency.m_p99Us);
+    statistics.insert("maxUs", (double)latency.m_maxUs);
+    return statistics;
+}
+
+QTEST_MAIN(BenchmarkDetector)
+
+#include "benchmarkdetector.moc"
@@ -0,0 +1,190 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "skygenerator.h"
+#include <cmath>
+
+SkyScene::SkyScene()
+{
+    m_dots = 2;
+    m_birds = 2;
+    m_planes = 1;
+    m_clouds = 3;
+    m_noiseSigma = 2.0;
+}
+
+SkyGenerator::SkyGenerator(cv::Size frameSize, uint64 seed, const SkyScene& scene) :
+    m_frameSize(frameSize), m_scene(scene), m_rng(seed)
+{
+    m_frameCount = 0;
+
+    // darker blue at the top, lighter towards the horizon
+    const cv::Vec3f top(130, 70, 40);
+    const cv::Vec3f horizon(210, 190, 170);
+    m_sky.create(frameSize, CV_8UC3);
+    for (int y = 0; y < frameSize.height; y++) {
+        float t = (float)y / (float)std::max(1, frameSize.height - 1);
+        cv::Vec3f color = top * (1.0f - t) + horizon * t;
+        m_sky.row(y).setTo(cv::Scalar(color[0], color[1], color[2]));
+    }
+
+    // sizes relative to a 640 pixel wide frame
+    float scale = (float)frameSize.width / 640.0f;
+    for (int i = 0; i < scene.m_dots; i++) {
+        m_dots.push_back(randomObject(1.0f * scale, 3.0f * scale, 1.0f, 2.0f * scale));
+    }
+    for (int i = 0; i < scene.m_birds; i++) {
+        m_birds.push_back(randomObject(2.0f * scale, 5.0f * scale, 4.0f * scale, 8.0f * scale));
+    }
+    for (int i = 0; i < scene.m_planes; i++) {
+        MovingObject plane = randomObject(1.0f * scale, 2.0f * scale, 15.0f * scale, 25.0f * scale);
+        // planes fly mostly horizontally
+        plane.m_velocity.y *= 0.2f;
+        m_planes.push_back(plane);
+    }
+    for (int i = 0; i < scene.m_clouds; i++) {
+        Cloud cloud;
+        cloud.m_motion = randomObject(0.1f * scale, 0.5f * scale, 40.0f * scale, 120.0f * scale);
+        cloud.m_motion.m_velocity.y = 0;
+        int width = std::max(4, (int)(cloud.m_motion.m_size * 2));
+        int height = std::max(4, width / 3 + (int)m_rng.uniform(0, width / 4 + 1));
+        cv::Mat alpha(height, width, CV_32FC1, cv::Scalar(0));
+        cv::ellipse(alpha, cv::Point(width / 2, height / 2), cv::Size(width / 3, height / 3),
+                    0, 0, 360, cv::Scalar(m_rng.uniform(0.4, 0.8)), -1);
+        int kernel = (std::min(width, height) / 3) | 1;
+        cv::GaussianBlur(alpha, cloud.m_alpha, cv::Size(kernel, kernel), 0);
+        m_clouds.push_back(cloud);
+    }
+}
+
+cv::Mat SkyGenerator::nextFrame()
+{
+    cv::Mat frame = m_sky.clone();
+
+    for (unsigned int i = 0; i < m_clouds.size(); i++) {
+        move(m_clouds[i].m_motion, (float)m_clouds[i].m_alpha.cols);
+        drawCloud(frame, m_clouds[i]);
+    }
+    for (unsigned int i = 0; i < m_planes.size(); i++) {
+        move(m_planes[i], m_planes[i].m_size);
+        drawPlane(frame, m_planes[i]);
+    }
+    for (unsigned int i = 0; i < m_birds.size(); i++) {
+        move(m_birds[i], m_birds[i].m_size);
+        drawBird(frame, m_birds[i]);
+    }
+    for (unsigned int i = 0; i < m_dots.size(); i++) {
+        // a little wobble, like a distant object seen through air turbulence
+        m_dots[i].m_velocity.x += m_rng.uniform(-0.1f, 0.1f);
+        m_dots[i].m_velocity.y += m_rng.uniform(-0.1f, 0.1f);
+        move(m_dots[i], m_dots[i].m_size);
+        cv::circle(frame, m_dots[i].m_position, (int)std::ceil(m_dots[i].m_size),
+                   cv::Scalar(255, 245, 240), -1, CV_AA);
+    }
+
+    if (m_scene.m_noiseSigma > 0) {
+        m_noise.create(m_frameSize, CV_16SC3);
+        m_rng.fill(m_noise, cv::RNG::NORMAL, cv::Scalar::all(0), cv::Scalar::all(m_scene.m_noiseSigma));
+        frame.convertTo(m_noisyFrame, CV_16SC3);
+        m_noisyFrame += m_noise;
+        m_noisyFrame.convertTo(frame, CV_8UC3);
+    }
+
+    m_frameCount++;
+    return frame;
+}
+
+cv::Size SkyGenerator::frameSize() const
+{
+    return m_frameSize;
+}
+
+int SkyGenerator::frameCount() const
+{
+    return m_frameCount;
+}
+
+SkyGenerator::MovingObject SkyGenerator::randomObject(float minSpeed, float maxSpeed, float minSize, float maxSize)
+{
+    MovingObject object;
+    object.m_position = cv::Point2f(m_rng.uniform(0.0f, (float)m_frameSize.width),
+                                    m_rng.uniform(0.0f, (float)m_frameSize.height));
+    float speed = m_rng.uniform(minSpeed, maxSpeed);
+    float angle = m_rng.uniform(0.0f, (float)(2 * CV_PI));
+    object.m_velocity = cv::Point2f(speed * std::cos(angle), speed * std::sin(angle));
+    object.m_size = m_rng.uniform(minSize, maxSize);
+    object.m_phase = m_rng.uniform(0.0f, (float)(2 * CV_PI));
+    return object;
+}
+
+void SkyGenerator::move(MovingObject& object, float margin)
+{
+    object.m_position += object.m_velocity;
+    float width = (float)m_frameSize.width;
+    float height = (float)m_frameSize.height;
+    if (object.m_position.x < -margin) object.m_position.x += width + 2 * margin;
+    if (object.m_position.x > width + margin) object.m_position.x -= width + 2 * margin;
+    if (object.m_position.y < -margin) object.m_position.y += height + 2 * margin;
+    if (object.m_position.y > height + margin) object.m_position.y -= height + 2 * margin;
+}
+
+void SkyGenerator::drawCloud(cv::Mat& frame, const Cloud& cloud)
+{
+    cv::Rect cloudRect((int)cloud.m_motion.m_position.x - cloud.m_alpha.cols / 2,
+                       (int)cloud.m_motion.m_position.y - cloud.m_alpha.rows / 2,
+                       cloud.m_alpha.cols, cloud.m_alpha.rows);
+    cv::Rect visible = cloudRect & cv::Rect(cv::Point(0, 0), m_frameSize);
+    if (visible.area() == 0) {
+        return;
+    }
+    const float cloudColor = 235.0f;
+    for (int y = 0; y < visible.height; y++) {
+        cv::Vec3b* frameRow = frame.ptr<cv::Vec3b>(visible.y + y);
+        const float* alphaRow = cloud.m_alpha.ptr<float>(visible.y - cloudRect.y + y);
+        for (int x = 0; x < visible.width; x++) {
+            float alpha = alphaRow[visible.x - cloudRect.x + x];
+            cv::Vec3b& pixel = frameRow[visible.x + x];
+            for (int c = 0; c < 3; c++) {
+                pixel[c] = cv::saturate_cast<uchar>(pixel[c] * (1.0f - alpha) + cloudColor * alpha);
+            }
+        }
+    }
+}
+
+void SkyGenerator::drawBird(cv::Mat& frame, const MovingObject& bird)
+{
+    float flap = std::sin(bird.m_phase + (float)m_frameCount * 0.6f);
+    cv::Point2f leftWing(bird.m_position.x - bird.m_size, bird.m_position.y - bird.m_size * flap);
+    cv::Point2f rightWing(bird.m_position.x + bird.m_size, bird.m_position.y - bird.m_size * flap);
+    int thickness = std::max(1, (int)(bird.m_size / 4));
+    cv::line(frame, bird.m_position, leftWing, cv::Scalar(35, 30, 30), thickness, CV_AA);
+    cv::line(frame, bird.m_position, rightWing, cv::Scalar(35, 30, 30), thickness, CV_AA);
+}
+
+void SkyGenerator::drawPlane(cv::Mat& frame, const MovingObject& plane)
+{
+    float speed = std::sqrt(plane.m_velocity.dot(plane.m_velocity));
+    cv::Point2f direction = plane.m_velocity * (1.0f / std::max(speed, 0.001f));
+    cv::Point2f tail = plane.m_position - direction * plane.m_size;
+    int thickness = std::max(1, (int)(plane.m_size / 10));
+    cv::line(frame, tail, plane.m_position, cv::Scalar(200, 200, 205), thickness, CV_AA);
+    // light blinks once per second at 25 fps
+    if (((m_frameCount + (int)(plane.m_phase * 4)) % 25) < 3) {
+        cv::circle(frame, plane.m_position, thickness + 1, cv::Scalar(255, 255, 255), -1, CV_AA);
+    }
+}
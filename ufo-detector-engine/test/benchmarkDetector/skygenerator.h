@@ -0,0 +1,104 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SKYGENERATOR_H
+#define SKYGENERATOR_H
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <vector>
+
+/**
+ * @brief Contents of a synthetic sky video.
+ */
+struct SkyScene {
+    SkyScene();
+
+    int m_dots;             ///< small bright objects, the kind the detector is looking for
+    int m_birds;            ///< dark flapping objects
+    int m_planes;           ///< long streaks with a blinking light
+    int m_clouds;           ///< large soft shapes drifting slowly
+    double m_noiseSigma;    ///< standard deviation of sensor noise
+};
+
+/**
+ * @brief Generates a deterministic synthetic sky video for benchmarking.
+ *
+ * The sky is a vertical gradient with drifting clouds, moving bright dots,
+ * birds and planes on top, plus Gaussian sensor noise. All randomness comes
+ * from one cv::RNG seeded in the constructor, so the same size, seed and scene
+ * always give the same frames. Objects leaving the frame come back from the
+ * opposite side.
+ */
+class SkyGenerator
+{
+public:
+    SkyGenerator(cv::Size frameSize, uint64 seed, const SkyScene& scene = SkyScene());
+
+    /**
+     * @brief Render the next frame.
+     * @return BGR frame, not shared with the generator
+     */
+    cv::Mat nextFrame();
+
+    cv::Size frameSize() const;
+
+    /**
+     * @brief Number of frames rendered so far.
+     */
+    int frameCount() const;
+
+private:
+    /**
+     * @brief An object moving over the sky.
+     */
+    struct MovingObject {
+        cv::Point2f m_position;
+        cv::Point2f m_velocity;
+        float m_size;
+        float m_phase;      ///< wing flap or light blink phase
+    };
+
+    /**
+     * @brief A cloud with its alpha mask.
+     */
+    struct Cloud {
+        MovingObject m_motion;
+        cv::Mat m_alpha;    ///< CV_32FC1, 0 = clear sky, 1 = cloud
+    };
+
+    cv::Size m_frameSize;
+    SkyScene m_scene;
+    cv::RNG m_rng;
+    int m_frameCount;
+    cv::Mat m_sky;          ///< gradient background
+    cv::Mat m_noise;        ///< CV_16SC3 noise buffer
+    cv::Mat m_noisyFrame;   ///< CV_16SC3 frame buffer for adding noise
+    std::vector<MovingObject> m_dots;
+    std::vector<MovingObject> m_birds;
+    std::vector<MovingObject> m_planes;
+    std::vector<Cloud> m_clouds;
+
+    MovingObject randomObject(float minSpeed, float maxSpeed, float minSize, float maxSize);
+    void move(MovingObject& object, float margin);
+    void drawCloud(cv::Mat& frame, const Cloud& cloud);
+    void drawBird(cv::Mat& frame, const MovingObject& bird);
+    void drawPlane(cv::Mat& frame, const MovingObject& plane);
+};
+
+#endif // SKYGENERATOR_H
@@ -22,9 +22,10 @@ int mockRecorderStartCount;
 int mockRecorderStopCount;
 
 
-Recorder::Recorder(Camera* cameraPtr, Config* configPtr, DataManager* dataManager) {
+Recorder::Recorder(Camera* cameraPtr, Config* configPtr, Logger* logger, DataManager* dataManager) {
     Q_UNUSED(cameraPtr);
     Q_UNUSED(configPtr);
+    Q_UNUSED(logger);
     Q_UNUSED(dataManager);
 }
 
@@ -52,3 +53,7 @@ void Recorder::startEncodingVideo(QString tempVideoFileName, QString targetVideo
 
 void Recorder::onVideoEncodingFinished() {
 }
+
+void Recorder::setWorkerQueue(WorkerPool::Queue* queue) {
+    Q_UNUSED(queue);
+}
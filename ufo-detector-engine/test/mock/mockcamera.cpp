@@ -36,9 +36,14 @@
  *
  * There's a usage example of this in ActualDetector unit test, more specifically
  * in TestActualDetector::mockCameraBlockNextFrame().
+ *
+ * Camera::waitNextFrame() blocks the same way. Without blocking it delivers
+ * frames at mockCameraFps, like a real camera would.
  */
 
 cv::Mat mockCameraNextFrame;    ///< next frame to be given by Camera::getWebcamFrame()
+int mockCameraFps = 25;         ///< frame rate of Camera::waitNextFrame() without blocking
+std::atomic<quint64> mockCamera_frameSequence(0);
 
 /**
  * @brief Enable Camera::getWebcamFrame() blocking.
@@ -103,6 +108,9 @@ Camera::Camera(int index, int width, int height) {
     mockCamera_blockFrameEnabled = false;
 }
 
+Camera::~Camera() {
+}
+
 bool Camera::init() {
     return true;
 }
@@ -125,6 +133,30 @@ cv::Mat Camera::getWebcamFrame() {
     return mockCameraNextFrame;
 }
 
+CameraFrame Camera::getCameraFrame() {
+    return CameraFrame(getWebcamFrame().clone());
+}
+
+CameraFrame Camera::waitNextFrame(quint64& sequence, int timeoutMs) {
+    Q_UNUSED(timeoutMs);
+    if (!mockCamera_blockFrameEnabled) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1000 / mockCameraFps));
+    }
+    CameraFrame frame = getCameraFrame();
+    frame.setTimestampUs(steadyClockUs());
+    sequence = ++mockCamera_frameSequence;
+    return frame;
+}
+
+double Camera::frameRate() {
+    return mockCameraFps;
+}
+
+qint64 Camera::steadyClockUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 bool Camera::isWebcamOpen() {
     return true;
 }
@@ -133,7 +165,9 @@ int Camera::index() {
     return 0;
 }
 
-bool Camera::queryAvailableResolutions() {
+bool Camera::queryAvailableResolutions(bool verboseQuery, bool refresh) {
+    Q_UNUSED(verboseQuery);
+    Q_UNUSED(refresh);
     return true;
 }
 
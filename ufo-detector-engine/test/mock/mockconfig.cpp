@@ -21,14 +21,21 @@
 
 QString mockConfigResultDataDir;
 int mockConfigResultVideoCodec;
+int mockConfigMotionThreshold;
+int mockConfigMotionModel;
+int mockConfigResultVideoFrameDecimation;
 QString mockConfigResultVideoCodecStr;
 QString testResourceFolder();
 
 
-Config::Config(QObject *parent) {
+Config::Config(QObject *parent, int cameraSlot) {
     Q_UNUSED(parent);
+    m_cameraSlot = cameraSlot;
     mockConfigResultVideoCodec = 0;
     mockConfigResultVideoCodecStr = "";
+    mockConfigMotionThreshold = 10;
+    mockConfigMotionModel = 0;
+    mockConfigResultVideoFrameDecimation = 1;
     QString encoderLocation = "";
 #if defined(Q_OS_LINUX) || defined(Q_OS_UNIX)
     encoderLocation = "/usr/bin/avconv";
@@ -38,6 +45,9 @@ Config::Config(QObject *parent) {
     QVERIFY(!encoderLocation.isEmpty());
     m_videoCodecSupportInfo = new VideoCodecSupportInfo(encoderLocation);
     m_videoCodecSupportInfo->init();
+    m_fileWatcher = NULL;
+    m_snapshotGeneration = 1;
+    m_snapshot = ConfigSnapshot::create(this, m_snapshotGeneration);
 }
 
 Config::~Config() {
@@ -80,7 +90,11 @@ int Config::noiseFilterPixelSize() {
 }
 
 int Config::motionThreshold() {
-    return 10;
+    return mockConfigMotionThreshold;
+}
+
+int Config::motionModel() {
+    return mockConfigMotionModel;
 }
 
 int Config::minPositiveDetections() {
@@ -125,6 +139,10 @@ bool Config::resultVideoWithObjectRectangles() {
     return false;
 }
 
+int Config::resultVideoFrameDecimation() {
+    return mockConfigResultVideoFrameDecimation;
+}
+
 QString Config::videoEncoderLocation() {
     return "/usr/bin/avconv";
 }
@@ -141,6 +159,10 @@ QString Config::userTokenAtUfoId() {
     return "";
 }
 
+QString Config::brightnessThresholds() {
+    return "";
+}
+
 VideoCodecSupportInfo* Config::videoCodecSupportInfo() {
     return m_videoCodecSupportInfo;
 }
@@ -180,6 +202,10 @@ void Config::setMotionThreshold(int threshold) {
     Q_UNUSED(threshold);
 }
 
+void Config::setMotionModel(int type) {
+    Q_UNUSED(type);
+}
+
 void Config::setMinPositiveDetections(int detectionCount) {
     Q_UNUSED(detectionCount);
 }
@@ -196,6 +222,10 @@ void Config::setResultVideoWithObjectRectangles(bool drawRectangles) {
     Q_UNUSED(drawRectangles);
 }
 
+void Config::setResultVideoFrameDecimation(int decimation) {
+    mockConfigResultVideoFrameDecimation = decimation;
+}
+
 void Config::setResultImageDir(QString dirName) {
     Q_UNUSED(dirName);
 }
@@ -208,7 +238,27 @@ void Config::setUserTokenAtUfoId(QString token) {
     Q_UNUSED(token);
 }
 
+void Config::setBrightnessThresholds(QString definition) {
+    Q_UNUSED(definition);
+}
+
 void Config::setClassifierVersion(int version) {
     Q_UNUSED(version);
 }
 
+bool Config::checkAirplanes() {
+    return false;
+}
+
+std::shared_ptr<const ConfigSnapshot> Config::snapshot() {
+    return std::atomic_load(&m_snapshot);
+}
+
+void Config::publishSnapshot() {
+    m_snapshotGeneration++;
+    std::atomic_store(&m_snapshot, ConfigSnapshot::create(this, m_snapshotGeneration));
+}
+
+void Config::onConfigFileChanged(QString fileName) {
+    Q_UNUSED(fileName);
+}
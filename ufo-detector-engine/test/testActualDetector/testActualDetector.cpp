@@ -20,10 +20,12 @@
 #include "config.h"
 #include "camera.h"
 #include "datamanager.h"
+#include "logger.h"
 #include <QString>
 #include <QtTest>
 #include <QCoreApplication>
 #include <QDir>
+#include <QTemporaryDir>
 
 extern cv::Mat mockCameraNextFrame;
 extern std::atomic<bool> isReadingVideo;
@@ -59,10 +61,36 @@ private Q_SLOTS:
     void testBird();
     void setShowCameraVideo();
 
+    /**
+     * Start and stop must finish as soon as the threads do, without fixed waits.
+     */
+    void startStopLatency();
+
+    /**
+     * A bright object must not count as positive while its bird verdict is pending.
+     */
+    void pendingBirdVerdict();
+    void noRecordingFinishedWithoutRecording();
+
+    /**
+     * The coarse motion pass of large frames must not lose objects of a few pixels.
+     */
+    void coarseMotion_smallObject();
+
 
 private:
+    /**
+     * @brief How bird classification requests are answered in framesUntilRecording().
+     */
+    enum VerdictMode {
+        BirdVerdicts,
+        NonBirdVerdicts,
+        NoVerdicts
+    };
+
     ActualDetector* m_actualDetector;
     Config* m_config;
+    Logger* m_logger;
     Camera* m_camera;
     DataManager* m_dataManager;
 
@@ -79,6 +107,14 @@ private:
 
     void makeDetectionAreaFile();
 
+    /**
+     * @brief Move a bright object over day time frames with processFrame() and answer
+     * bird classification requests of its tracks on the next frame.
+     * @param framesWithTracks set to the number of processed frames which had tracks
+     * @return number of frames with tracks before recording started, -1 if it did not start
+     */
+    int framesUntilRecording(VerdictMode mode, int& framesWithTracks);
+
 private slots:
     void onActualDetectorStartProgressChanged(int progress);
     void onActualDetectorCameraFrameUpdated(QImage pixmap);
@@ -87,6 +123,7 @@ private slots:
 TestActualDetector::TestActualDetector() {
     m_actualDetector = NULL;
     m_config = NULL;
+    m_logger = NULL;
     m_camera = NULL;
     m_dataManager = NULL;
     m_cameraFrameConsumerThread = NULL;
@@ -100,11 +137,12 @@ TestActualDetector::TestActualDetector() {
 void TestActualDetector::initTestCase() {
     m_config = new Config();
     QVERIFY(NULL != m_config);
+    m_logger = new Logger();
     m_camera = new Camera(m_config->cameraIndex(), m_config->cameraWidth(), m_config->cameraHeight());
     QVERIFY(NULL != m_camera);
     m_dataManager = new DataManager(m_config);
     QVERIFY(NULL != m_dataManager);
-    m_actualDetector = new ActualDetector(m_camera, m_config, m_dataManager);
+    m_actualDetector = new ActualDetector(m_camera, m_config, m_logger, m_dataManager);
     QVERIFY(NULL != m_actualDetector);
     m_cameraFps = 25;
 
@@ -123,6 +161,7 @@ void TestActualDetector::cleanupTestCase() {
     m_actualDetector->deleteLater();
     m_dataManager->deleteLater();
     m_camera->deleteLater();
+    m_logger->deleteLater();
     m_config->deleteLater();
 }
 
@@ -255,7 +294,7 @@ void TestActualDetector::detectBrightObjects() {
     }
     mockCameraNextFrame = cv::Mat(m_config->cameraHeight(), m_config->cameraWidth(), CV_8UC3, backgroundColor);
 
-    // ActualDetector::start() uses getCameraFrame() outside threads so only enable blocking
+    // ActualDetector::start() uses waitNextFrame() outside threads so only enable blocking
     // just before threads start. Luckily, progress value tells when it can be done.
     connect(m_actualDetector, SIGNAL(progressValueChanged(int)), this,
             SLOT(onActualDetectorStartProgressChanged(int)));
@@ -408,6 +447,192 @@ void TestActualDetector::setShowCameraVideo() {
             SLOT(onActualDetectorCameraFrameUpdated(QImage)));
 }
 
+void TestActualDetector::startStopLatency() {
+    const int maxStartMs = 1000;    // reads three frames and loads the classifier
+    const int maxStopMs = 500;
+    QFile detectionAreaFile(m_config->detectionAreaFile());
+    if (!detectionAreaFile.exists()) {
+        makeDetectionAreaFile();
+    }
+    mockCameraNextFrame = cv::Mat(m_config->cameraHeight(), m_config->cameraWidth(),
+                                  CV_8UC3, cv::Scalar(127, 127, 127));
+    mockCamera_setFrameBlockingEnabled(false);
+    QCOMPARE(m_actualDetector->runState(), ActualDetector::Stopped);
+    uint64_t startCount = Metrics::instance().snapshot().m_stages[Metrics::DetectorStartStage].m_count;
+    uint64_t stopCount = Metrics::instance().snapshot().m_stages[Metrics::DetectorStopStage].m_count;
+
+    for (int i = 0; i < 3; i++) {
+        QElapsedTimer timer;
+        timer.start();
+        QVERIFY(m_actualDetector->start());
+        qint64 startMs = timer.elapsed();
+        QCOMPARE(m_actualDetector->runState(), ActualDetector::Running);
+        // starting again does nothing
+        QVERIFY(m_actualDetector->start());
+
+        timer.restart();
+        m_actualDetector->stopThread();
+        qint64 stopMs = timer.elapsed();
+        QCOMPARE(m_actualDetector->runState(), ActualDetector::Stopped);
+        qDebug() << "start" << startMs << "ms, stop" << stopMs << "ms";
+        QVERIFY(startMs < maxStartMs);
+        QVERIFY(stopMs < maxStopMs);
+    }
+    // stopping a stopped detector returns right away
+    m_actualDetector->stopThread();
+    QVERIFY(m_actualDetector->waitForRunState(ActualDetector::Stopped, 0));
+
+    QCOMPARE(Metrics::instance().snapshot().m_stages[Metrics::DetectorStartStage].m_count, startCount + 3);
+    QCOMPARE(Metrics::instance().snapshot().m_stages[Metrics::DetectorStopStage].m_count, stopCount + 3);
+}
+
+void TestActualDetector::pendingBirdVerdict() {
+    int framesWithTracks = 0;
+
+    int bird = framesUntilRecording(BirdVerdicts, framesWithTracks);
+    QVERIFY(framesWithTracks > 0);
+    QCOMPARE(bird, -1);
+
+    int nonBird = framesUntilRecording(NonBirdVerdicts, framesWithTracks);
+    qDebug() << "recording started after" << nonBird << "frames with non-bird verdicts";
+    // a new track is never positive on its first frame
+    QVERIFY(nonBird >= 1);
+    QVERIFY(nonBird < (int)m_actualDetector->BIRD_VERDICT_TIMEOUT_FRAMES);
+
+    // classifier did not answer, the object counts once the wait times out
+    int noVerdict = framesUntilRecording(NoVerdicts, framesWithTracks);
+    qDebug() << "recording started after" << noVerdict << "frames without verdicts";
+    QVERIFY(noVerdict >= (int)m_actualDetector->BIRD_VERDICT_TIMEOUT_FRAMES);
+}
+
+/*
+ * The detection state may be reset on a still frame without a recording,
+ * which must not be logged as a finished recording
+ */
+void TestActualDetector::noRecordingFinishedWithoutRecording() {
+    const int width = m_config->cameraWidth();
+    const int height = m_config->cameraHeight();
+    cv::Scalar backgroundColor = cv::Scalar(127, 127, 127);
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+    QString eventFileName = directory.path() + "/events.jsonl";
+
+    ActualDetector detector(m_camera, m_config, m_logger, m_dataManager);
+    detector.m_cameraWidth = width;
+    detector.m_cameraHeight = height;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            detector.m_region.push_back(cv::Point(x, y));
+        }
+    }
+    detector.m_eventLog.reset(new DetectionEventLog());
+    QVERIFY(detector.m_eventLog->start(eventFileName));
+
+    std::vector<CameraFrame> initialFrames;
+    for (int i = 0; i < 3; i++) {
+        initialFrames.push_back(CameraFrame(cv::Mat(height, width, CV_8UC3, backgroundColor)));
+    }
+    detector.initializeDetection(initialFrames);
+    detector.state->negAndNoMotionCounter = 701;
+    CameraFrame frame(cv::Mat(height, width, CV_8UC3, backgroundColor));
+    detector.processFrame(frame);
+    QVERIFY(!detector.m_startedRecording);
+    detector.m_eventLog->stop();
+
+    QFile eventFile(eventFileName);
+    QVERIFY(eventFile.open(QIODevice::ReadOnly));
+    QVERIFY(!eventFile.readAll().contains("recordingFinished"));
+}
+
+void TestActualDetector::coarseMotion_smallObject() {
+    const int width = 1280;
+    const int height = 720;
+    const int numFrames = 10;
+    cv::Scalar backgroundColor = cv::Scalar(127, 127, 127);
+    // above the motion threshold at full resolution, but averaged over the 4x4 blocks
+    // it straddles it would change a coarse pixel by 4 at most
+    cv::Scalar objectColor = cv::Scalar(143, 143, 143);
+
+    ActualDetector detector(m_camera, m_config, m_logger, m_dataManager);
+    detector.m_cameraWidth = width;
+    detector.m_cameraHeight = height;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            detector.m_region.push_back(cv::Point(x, y));
+        }
+    }
+    QVERIFY(width >= detector.COARSE_MOTION_MIN_WIDTH);
+
+    std::vector<CameraFrame> initialFrames;
+    for (int i = 0; i < 3; i++) {
+        initialFrames.push_back(CameraFrame(cv::Mat(height, width, CV_8UC3, backgroundColor)));
+    }
+    detector.initializeDetection(initialFrames);
+    QVERIFY(detector.m_useCoarseMotion);
+
+    for (int i = 0; i < numFrames; i++) {
+        cv::Mat frameData(height, width, CV_8UC3, backgroundColor);
+        // 3x3 pixels starting at the last pixel of a block
+        cv::Rect object(403 + i * 8, 303, 3, 3);
+        frameData(object).setTo(objectColor);
+        CameraFrame frame(frameData);
+        int numberOfChanges = detector.processFrame(frame);
+        QVERIFY2(numberOfChanges >= detector.m_minAmountOfMotion, qPrintable(QString("frame %1").arg(i)));
+        QVERIFY(detector.m_rect.contains(object.tl()));
+    }
+}
+
+int TestActualDetector::framesUntilRecording(VerdictMode mode, int& framesWithTracks) {
+    const int numFrames = 25;
+    const int width = m_config->cameraWidth();
+    const int height = m_config->cameraHeight();
+    cv::Scalar backgroundColor = cv::Scalar(127, 127, 127);
+    cv::Scalar objectColor = cv::Scalar(255, 255, 255);
+
+    ActualDetector detector(m_camera, m_config, m_logger, m_dataManager);
+    detector.m_cameraWidth = width;
+    detector.m_cameraHeight = height;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            detector.m_region.push_back(cv::Point(x, y));
+        }
+    }
+    // day time, the classifier is not started so only the verdicts given here arrive
+    detector.m_isCascadeFound = true;
+    detector.m_isInNightMode = false;
+
+    std::vector<CameraFrame> initialFrames;
+    for (int i = 0; i < 3; i++) {
+        initialFrames.push_back(CameraFrame(cv::Mat(height, width, CV_8UC3, backgroundColor)));
+    }
+    detector.initializeDetection(initialFrames);
+
+    framesWithTracks = 0;
+    for (int i = 0; i < numFrames; i++) {
+        cv::Mat frameData(height, width, CV_8UC3, backgroundColor);
+        cv::circle(frameData, Point(i * width / numFrames, height / 2), 5, objectColor, -1);
+        CameraFrame frame(frameData);
+        detector.processFrame(frame);
+        if (detector.m_startedRecording) {
+            return framesWithTracks;
+        }
+        if (detector.state->tracker.tracks.empty()) {
+            continue;
+        }
+        framesWithTracks++;
+        if (mode != NoVerdicts) {
+            std::lock_guard<std::mutex> lock(detector.m_birdClassifier->m_mutex);
+            for (unsigned int t = 0; t < detector.state->tracker.tracks.size(); t++) {
+                BirdClassificationResult result;
+                result.m_trackId = detector.state->tracker.tracks[t]->track_id;
+                result.m_isBird = (mode == BirdVerdicts);
+                detector.m_birdClassifier->m_results.push_back(result);
+            }
+        }
+    }
+    return -1;
+}
+
 void TestActualDetector::makeDetectionAreaFile() {
     QFile detectionAreaFile(m_config->detectionAreaFile());
     QVERIFY(detectionAreaFile.open(QFile::ReadWrite));
@@ -30,30 +30,60 @@ INCLUDEPATH += . \
 SOURCES += \
     ../../actualdetector.cpp \
     ../mock/mockconfig.cpp \
+    ../../configsnapshot.cpp \
     ../mock/mockcamera.cpp \
+    ../../cameraframe.cpp \
     ../mock/mockRecorder.cpp \
     ../../Ctracker.cpp \
+    ../../SpatialGrid.cpp \
     ../../Detector.cpp \
+    ../../birdclassifier.cpp \
+    ../../brightnessthresholds.cpp \
+    ../../ambientbrightness.cpp \
+    ../../motionmodel.cpp \
+    ../../metrics.cpp \
+    ../../workerpool.cpp \
+    ../../croparchive.cpp \
+    ../../filesync.cpp \
+    ../../resultimagewriter.cpp \
+    ../../detectioneventlog.cpp \
+    ../../detectionsession.cpp \
     ../../Kalman.cpp \
     ../../HungarianAlg.cpp \
     ../mock/mockVideoCodecSupportInfo.cpp \
     testActualDetector.cpp\
     ../../planechecker.cpp \
    ../../detectorstate.cpp \
+    ../../logger.cpp \
     ../mock/mockdatamanager.cpp
 
 
 HEADERS += ../../actualdetector.h \
     ../../config.h \
+    ../../configsnapshot.h \
     ../../camera.h \
+    ../../cameraframe.h \
     ../../recorder.h \
     ../../Ctracker.h \
+    ../../SpatialGrid.h \
     ../../Detector.h \
+    ../../birdclassifier.h \
+    ../../brightnessthresholds.h \
+    ../../ambientbrightness.h \
+    ../../motionmodel.h \
+    ../../metrics.h \
+    ../../workerpool.h \
+    ../../croparchive.h \
+    ../../filesync.h \
+    ../../resultimagewriter.h \
+    ../../detectioneventlog.h \
+    ../../detectionsession.h \
     ../../Kalman.h \
     ../../HungarianAlg.h \
     ../../videocodecsupportinfo.h \
     ../../planechecker.h \
     ../../detectorstate.h \
-    ../../datamanager.h
+    ../../datamanager.h \
+    ../../logger.h
 
 
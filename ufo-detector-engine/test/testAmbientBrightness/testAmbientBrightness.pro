@@ -0,0 +1,29 @@
+#-------------------------------------------------
+#
+# Ambient brightness statistics test
+#
+#-------------------------------------------------
+
+QT       += testlib
+
+QT       -= gui
+
+TARGET = testambientbrightness
+CONFIG += console testcase
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+QMAKE_CXXFLAGS += -std=c++11
+CONFIG += c++11
+
+include(../../opencv.pri)
+
+INCLUDEPATH += ../..
+
+SOURCES += testambientbrightness.cpp \
+    ../../ambientbrightness.cpp
+HEADERS += ../../ambientbrightness.h
+
+DEFINES += SRCDIR=\\\"$$PWD/\\\" \
+    _UNIT_TEST_
@@ -0,0 +1,136 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ambientbrightness.h"
+#include <QString>
+#include <QtTest>
+#include <QTest>
+
+#define TEST_FRAME_WIDTH 640
+#define TEST_FRAME_HEIGHT 480
+
+/**
+ * @brief AmbientBrightness unit test class
+ */
+class TestAmbientBrightness : public QObject
+{
+    Q_OBJECT
+
+private:
+    std::vector<cv::Point> m_region;    ///< left half of the frame
+
+    cv::Mat makeFrame(int regionBrightness, int otherBrightness);
+
+private Q_SLOTS:
+    void initTestCase();
+    void noRegion();
+    void firstMeasurement();
+    void onlyRegionIsMeasured();
+    void updateInterval();
+    void hysteresis();
+};
+
+void TestAmbientBrightness::initTestCase()
+{
+    for (int y = 0; y < TEST_FRAME_HEIGHT; y++) {
+        for (int x = 0; x < TEST_FRAME_WIDTH / 2; x++) {
+            m_region.push_back(cv::Point(x, y));
+        }
+    }
+}
+
+cv::Mat TestAmbientBrightness::makeFrame(int regionBrightness, int otherBrightness)
+{
+    cv::Mat frame(TEST_FRAME_HEIGHT, TEST_FRAME_WIDTH, CV_8UC1, cv::Scalar(otherBrightness));
+    frame(cv::Rect(0, 0, TEST_FRAME_WIDTH / 2, TEST_FRAME_HEIGHT)).setTo(cv::Scalar(regionBrightness));
+    return frame;
+}
+
+void TestAmbientBrightness::noRegion()
+{
+    AmbientBrightness ambient;
+    QVERIFY(!ambient.update(makeFrame(0, 0)));
+    QVERIFY(!ambient.hasMeasurement());
+}
+
+void TestAmbientBrightness::firstMeasurement()
+{
+    AmbientBrightness ambient(1, 0.1, 90, 110);
+    ambient.setRegion(m_region, cv::Size(TEST_FRAME_WIDTH, TEST_FRAME_HEIGHT));
+    QVERIFY(ambient.update(makeFrame(20, 20)));
+    QVERIFY(ambient.hasMeasurement());
+    QVERIFY(ambient.isNight());
+    QCOMPARE(ambient.averageBrightness(), 20);
+    QCOMPARE(ambient.brightnessMap().cols, TEST_FRAME_WIDTH / AmbientBrightness::MAP_SCALE);
+}
+
+void TestAmbientBrightness::onlyRegionIsMeasured()
+{
+    AmbientBrightness ambient(1, 0.1, 90, 110);
+    ambient.setRegion(m_region, cv::Size(TEST_FRAME_WIDTH, TEST_FRAME_HEIGHT));
+    ambient.update(makeFrame(200, 0));
+    QCOMPARE(ambient.averageBrightness(), 200);
+    QVERIFY(!ambient.isNight());
+}
+
+void TestAmbientBrightness::updateInterval()
+{
+    AmbientBrightness ambient(5, 1.0, 90, 110);
+    ambient.setRegion(m_region, cv::Size(TEST_FRAME_WIDTH, TEST_FRAME_HEIGHT));
+    ambient.update(makeFrame(200, 200));
+    // frames between measurements are ignored
+    for (int i = 0; i < 4; i++) {
+        QVERIFY(!ambient.update(makeFrame(0, 0)));
+        QCOMPARE(ambient.averageBrightness(), 200);
+    }
+    QVERIFY(ambient.update(makeFrame(0, 0)));
+    QCOMPARE(ambient.averageBrightness(), 0);
+
+    // the frame counter wraps at the interval instead of growing with the session,
+    // every measurement switches between day and night
+    for (int i = 0; i < 23; i++) {
+        int brightness = (((i + 1) / 5) % 2) ? 200 : 0;
+        QCOMPARE(ambient.update(makeFrame(brightness, brightness)), ((i + 1) % 5) == 0);
+        QVERIFY(ambient.m_frameCounter < 5);
+    }
+}
+
+void TestAmbientBrightness::hysteresis()
+{
+    AmbientBrightness ambient(1, 1.0, 90, 110);
+    ambient.setRegion(m_region, cv::Size(TEST_FRAME_WIDTH, TEST_FRAME_HEIGHT));
+    ambient.update(makeFrame(150, 150));
+    QVERIFY(!ambient.isNight());
+
+    // between the levels: no change
+    QVERIFY(!ambient.update(makeFrame(95, 95)));
+    QVERIFY(!ambient.isNight());
+
+    QVERIFY(ambient.update(makeFrame(80, 80)));
+    QVERIFY(ambient.isNight());
+
+    QVERIFY(!ambient.update(makeFrame(105, 105)));
+    QVERIFY(ambient.isNight());
+
+    QVERIFY(ambient.update(makeFrame(120, 120)));
+    QVERIFY(!ambient.isNight());
+}
+
+QTEST_MAIN(TestAmbientBrightness)
+
+#include "testambientbrightness.moc"
@@ -0,0 +1,32 @@
+#-------------------------------------------------
+#
+# Bird classifier accuracy and throughput test
+#
+#-------------------------------------------------
+
+QT       += testlib
+
+QT       -= gui
+
+TARGET = testbirdclassifier
+CONFIG += console testcase
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+QMAKE_CXXFLAGS += -std=c++14
+
+include(../../opencv.pri)
+
+INCLUDEPATH += ../..
+
+SOURCES += testbirdclassifier.cpp \
+    ../../birdclassifier.cpp \
+    ../../metrics.cpp \
+    ../../workerpool.cpp
+HEADERS += ../../birdclassifier.h \
+    ../../metrics.h \
+    ../../workerpool.h
+
+DEFINES += SRCDIR=\\\"$$PWD/\\\" \
+    _UNIT_TEST_
@@ -0,0 +1,393 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "birdclassifier.h"
+#include <QString>
+#include <QDir>
+#include <QtTest>
+#include <QTest>
+#include <opencv2/highgui/highgui.hpp>
+#include <algorithm>
+
+#define TEST_MIN_OBJECT_SIZE 30
+#define TEST_GENERATED_CROPS 60
+#define TEST_MIN_GENERATED_SIZE 36
+#define TEST_MAX_GENERATED_SIZE 110
+#define TEST_NOISE_LEVEL 2.0
+
+/**
+ * @brief BirdClassifier unit test class.
+ *
+ * Accuracy and bird recall of the two classification methods are compared on
+ * a labelled crop set in test/resources/birdcrops: gray or color object images
+ * in subfolder "bird" and everything else in subfolder "other". The crop set
+ * is not part of the repository, the comparison is skipped without it.
+ *
+ * Throughput and the verdicts of requestClassification() are checked on
+ * generated crops, the same on all platforms: dark bird silhouettes, and
+ * planes, lights, cloud edges and empty sky. The cascade is close to chance on
+ * them, so they say nothing about accuracy.
+ */
+class TestBirdClassifier : public QObject
+{
+    Q_OBJECT
+
+public:
+    TestBirdClassifier();
+
+private:
+    BirdClassifier* m_birdClassifier;
+    cv::CascadeClassifier* m_cascade;
+    std::vector<cv::Mat> m_crops;   ///< labelled crops from test/resources/birdcrops
+    std::vector<bool> m_labels;     ///< true for bird crops
+    std::vector<cv::Mat> m_generatedCrops;
+    quint64 m_randomState;          ///< state of random()
+
+    void loadCrops(QString folder, bool isBird);
+
+    /**
+     * @brief Generate the synthetic crop set, half of it birds, into m_generatedCrops.
+     */
+    void generateCrops(int count);
+
+    /**
+     * @brief Uniformly distributed value in [min, max) from a fixed generator, same on all platforms.
+     */
+    double random(double min, double max);
+
+    cv::Mat generateBird();
+
+    /**
+     * @brief Generate an object which is not a bird.
+     * @param kind 0 = plane, 1 = light, 2 = cloud edge, 3 = empty sky
+     */
+    cv::Mat generateOther(int kind);
+
+    /**
+     * @brief Sky background with a vertical gradient, random size and brightness.
+     * @param skyLevel set to the average sky brightness
+     */
+    cv::Mat generateSky(double& skyLevel);
+
+    /**
+     * @brief Blur, add sensor noise and convert to a gray crop.
+     */
+    cv::Mat finishCrop(cv::Mat& image, double blur);
+
+    int countCorrect(const std::vector<bool>& verdicts);
+    int countBirdsFound(const std::vector<bool>& verdicts);
+    std::vector<bool> classifyAllBatched(const std::vector<cv::Mat>& crops);
+    std::vector<bool> classifyAllFullScale(const std::vector<cv::Mat>& crops);
+
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+    void classifyBatch_emptyBatch();
+    void classifyBatch_tooSmallImage();
+    void classifyBatch_verdictPerImage();
+    void requestClassification_fullScale();
+    void accuracy();
+    void throughputFullScale();
+    void throughputBatched();
+};
+
+TestBirdClassifier::TestBirdClassifier()
+{
+    m_birdClassifier = nullptr;
+    m_cascade = nullptr;
+    m_randomState = 1;
+}
+
+void TestBirdClassifier::initTestCase()
+{
+    m_birdClassifier = new BirdClassifier();
+    QVERIFY(m_birdClassifier->init(SRCDIR"../resources/cascade.xml", TEST_MIN_OBJECT_SIZE, 1));
+    m_cascade = m_birdClassifier->m_classifiers[0].get();
+
+    QString cropFolder = SRCDIR"../resources/birdcrops/";
+    loadCrops(cropFolder + "bird", true);
+    loadCrops(cropFolder + "other", false);
+    generateCrops(TEST_GENERATED_CROPS);
+}
+
+void TestBirdClassifier::cleanupTestCase()
+{
+    delete m_birdClassifier;
+}
+
+void TestBirdClassifier::loadCrops(QString folder, bool isBird)
+{
+    QDir dir(folder);
+    QStringList files = dir.entryList(QStringList() << "*.png" << "*.jpg" << "*.bmp", QDir::Files, QDir::Name);
+    foreach (QString file, files) {
+        cv::Mat crop = cv::imread(dir.filePath(file).toStdString(), CV_LOAD_IMAGE_GRAYSCALE);
+        if (!crop.empty()) {
+            m_crops.push_back(crop);
+            m_labels.push_back(isBird);
+        }
+    }
+}
+
+void TestBirdClassifier::generateCrops(int count)
+{
+    m_randomState = 1;
+    for (int i = 0; i < count / 2; i++) {
+        m_generatedCrops.push_back(generateBird());
+        m_generatedCrops.push_back(generateOther(i % 4));
+    }
+}
+
+double TestBirdClassifier::random(double min, double max)
+{
+    m_randomState = m_randomState * 6364136223846793005ULL + 1442695040888963407ULL;
+    return min + (max - min) * ((double)(m_randomState >> 11) / 9007199254740992.0);
+}
+
+cv::Mat TestBirdClassifier::generateSky(double& skyLevel)
+{
+    int width = (int)random(TEST_MIN_GENERATED_SIZE, TEST_MAX_GENERATED_SIZE);
+    int height = std::max(TEST_MIN_OBJECT_SIZE, (int)(width * random(0.6, 1.0)));
+    skyLevel = random(100, 230);
+    cv::Mat image(height, width, CV_32FC1);
+    for (int y = 0; y < height; y++) {
+        image.row(y).setTo(cv::Scalar(skyLevel - 10.0 + 20.0 * y / height));
+    }
+    return image;
+}
+
+cv::Mat TestBirdClassifier::finishCrop(cv::Mat& image, double blur)
+{
+    if (blur > 0.1) {
+        cv::GaussianBlur(image, image, cv::Size(), blur);
+    }
+    for (int y = 0; y < image.rows; y++) {
+        for (int x = 0; x < image.cols; x++) {
+            // sum of four uniform values is close enough to a normal distribution
+            double sum = random(0, 1);
+            sum += random(0, 1);
+            sum += random(0, 1);
+            sum += random(0, 1);
+            image.at<float>(y, x) += (float)((sum - 2.0) * TEST_NOISE_LEVEL * 1.7320508075688772);
+        }
+    }
+    cv::Mat crop;
+    image.convertTo(crop, CV_8U);
+    return crop;
+}
+
+cv::Mat TestBirdClassifier::generateBird()
+{
+    double skyLevel;
+    cv::Mat image = generateSky(skyLevel);
+    double span = random(0.5, 1.0);
+    double flap = random(-0.4, 0.6);
+    double bend = random(-0.3, 0.5);
+    double thickness = random(0.08, 0.3);
+    double darkness = random(10, 90);
+    double blur = random(0, 2);
+    double angle = random(-30, 30);
+
+    double centerX = image.cols / 2.0;
+    double centerY = image.rows / 2.0;
+    double halfSpan = span * image.cols / 2.0;
+    for (int side = -1; side <= 1; side += 2) {
+        cv::Point shoulder((int)(centerX + side * halfSpan * 0.08), (int)centerY);
+        cv::Point elbow((int)(centerX + side * halfSpan * 0.45), (int)(centerY - halfSpan * flap));
+        cv::Point tip((int)(centerX + side * halfSpan), (int)(centerY - halfSpan * flap + halfSpan * bend));
+        cv::line(image, shoulder, elbow, cv::Scalar(darkness), std::max(1, (int)(thickness * halfSpan)), CV_AA);
+        cv::line(image, elbow, tip, cv::Scalar(darkness), std::max(1, (int)(thickness * 0.5 * halfSpan)), CV_AA);
+    }
+    cv::Point body((int)centerX, (int)(centerY + halfSpan * 0.03));
+    cv::Size bodyAxes(std::max(1, (int)(halfSpan * 0.22)), std::max(1, (int)(halfSpan * 0.07)));
+    cv::ellipse(image, body, bodyAxes, angle, 0, 360, cv::Scalar(darkness), -1, CV_AA);
+    return finishCrop(image, blur);
+}
+
+cv::Mat TestBirdClassifier::generateOther(int kind)
+{
+    double skyLevel;
+    cv::Mat image = generateSky(skyLevel);
+    int width = image.cols;
+    int height = image.rows;
+    double blur = 0;
+    if (kind == 0) {
+        // plane with a light at the front
+        cv::Point tail((int)(width * 0.2), (int)(height * random(0.2, 0.8)));
+        cv::Point front((int)(width * 0.8), (int)(height * random(0.2, 0.8)));
+        double brightness = random(200, 250);
+        int thickness = (int)random(1, 4);
+        cv::line(image, tail, front, cv::Scalar(brightness), thickness, CV_AA);
+        int lightRadius = (int)random(2, 5);
+        cv::circle(image, front, lightRadius, cv::Scalar(255), -1, CV_AA);
+        blur = random(0, 1);
+    } else if (kind == 1) {
+        // blurred light
+        int radius = std::max(1, (int)(std::min(width, height) * random(0.1, 0.3)));
+        int x = (int)(width * random(0.3, 0.7));
+        int y = (int)(height * random(0.3, 0.7));
+        double brightness = random(220, 255);
+        cv::circle(image, cv::Point(x, y), radius, cv::Scalar(brightness), -1, CV_AA);
+        blur = random(1.5, 3);
+    } else if (kind == 2) {
+        // soft cloud edge
+        int x = (int)(width * random(0, 1));
+        int y = (int)(height * random(0, 1));
+        int axisX = (int)(width * random(0.3, 0.8));
+        int axisY = (int)(height * random(0.2, 0.5));
+        double angle = random(0, 180);
+        double brightness = skyLevel + random(-30, 30);
+        cv::ellipse(image, cv::Point(x, y), cv::Size(axisX, axisY), angle, 0, 360, cv::Scalar(brightness), -1, CV_AA);
+        blur = random(4, 8);
+    }
+    return finishCrop(image, blur);
+}
+
+int TestBirdClassifier::countCorrect(const std::vector<bool>& verdicts)
+{
+    int correct = 0;
+    for (unsigned int i = 0; i < verdicts.size(); i++) {
+        if (verdicts[i] == m_labels[i]) {
+            correct++;
+        }
+    }
+    return correct;
+}
+
+int TestBirdClassifier::countBirdsFound(const std::vector<bool>& verdicts)
+{
+    int found = 0;
+    for (unsigned int i = 0; i < verdicts.size(); i++) {
+        if (verdicts[i] && m_labels[i]) {
+            found++;
+        }
+    }
+    return found;
+}
+
+std::vector<bool> TestBirdClassifier::classifyAllBatched(const std::vector<cv::Mat>& crops)
+{
+    std::vector<bool> verdicts;
+    for (size_t first = 0; first < crops.size(); first += m_birdClassifier->BATCH_SIZE) {
+        size_t last = std::min(first + m_birdClassifier->BATCH_SIZE, crops.size());
+        std::vector<cv::Mat> batch(crops.begin() + first, crops.begin() + last);
+        std::vector<bool> batchVerdicts = m_birdClassifier->classifyBatch(m_cascade, batch);
+        verdicts.insert(verdicts.end(), batchVerdicts.begin(), batchVerdicts.end());
+    }
+    return verdicts;
+}
+
+std::vector<bool> TestBirdClassifier::classifyAllFullScale(const std::vector<cv::Mat>& crops)
+{
+    std::vector<bool> verdicts;
+    for (unsigned int i = 0; i < crops.size(); i++) {
+        verdicts.push_back(m_birdClassifier->classifyFullScale(m_cascade, crops[i]));
+    }
+    return verdicts;
+}
+
+void TestBirdClassifier::classifyBatch_emptyBatch()
+{
+    std::vector<cv::Mat> images;
+    QVERIFY(m_birdClassifier->classifyBatch(m_cascade, images).empty());
+}
+
+void TestBirdClassifier::classifyBatch_tooSmallImage()
+{
+    std::vector<cv::Mat> images;
+    images.push_back(cv::Mat(TEST_MIN_OBJECT_SIZE - 1, 100, CV_8UC1, cv::Scalar(128)));
+    std::vector<bool> verdicts = m_birdClassifier->classifyBatch(m_cascade, images);
+    QCOMPARE(verdicts.size(), (size_t)1);
+    QVERIFY(!verdicts[0]);
+}
+
+void TestBirdClassifier::classifyBatch_verdictPerImage()
+{
+    std::vector<cv::Mat> images;
+    images.push_back(cv::Mat(40, 40, CV_8UC1, cv::Scalar(0)));
+    images.push_back(cv::Mat(10, 10, CV_8UC1, cv::Scalar(0)));
+    images.push_back(cv::Mat(200, 120, CV_8UC1, cv::Scalar(255)));
+    std::vector<bool> verdicts = m_birdClassifier->classifyBatch(m_cascade, images);
+    QCOMPARE(verdicts.size(), images.size());
+    // plain images contain no birds
+    QVERIFY(!verdicts[0] && !verdicts[1] && !verdicts[2]);
+}
+
+/*
+ * Detection uses the full scale search, so it finds every bird that search finds
+ */
+void TestBirdClassifier::requestClassification_fullScale()
+{
+    std::vector<cv::Mat> crops = m_generatedCrops;
+    crops.insert(crops.end(), m_crops.begin(), m_crops.end());
+    std::vector<bool> expected = classifyAllFullScale(crops);
+
+    m_birdClassifier->setSynchronous(true);
+    std::vector<BirdClassificationResult> results;
+    for (unsigned int i = 0; i < crops.size(); i++) {
+        cv::Mat crop = crops[i];
+        QVERIFY(m_birdClassifier->requestClassification(i, crop));
+    }
+    m_birdClassifier->setSynchronous(false);
+    m_birdClassifier->takeResults(results);
+
+    QCOMPARE(results.size(), crops.size());
+    for (unsigned int i = 0; i < results.size(); i++) {
+        QCOMPARE(results[i].m_trackId, (size_t)i);
+        QCOMPARE(results[i].m_isBird, (bool)expected[i]);
+    }
+}
+
+/*
+ * classifyBatch() may replace the full scale search only if it passes this
+ * on real crops: no fewer birds found and no fewer correct verdicts
+ */
+void TestBirdClassifier::accuracy()
+{
+    if (m_crops.empty()) {
+        QSKIP("no labelled crops in test/resources/birdcrops");
+    }
+    std::vector<bool> fullScale = classifyAllFullScale(m_crops);
+    std::vector<bool> batched = classifyAllBatched(m_crops);
+    int birds = (int)std::count(m_labels.begin(), m_labels.end(), true);
+    qDebug() << "crops:" << m_crops.size() << "birds:" << birds;
+    qDebug() << "full scale: correct" << countCorrect(fullScale) << "birds found" << countBirdsFound(fullScale);
+    qDebug() << "batched: correct" << countCorrect(batched) << "birds found" << countBirdsFound(batched);
+
+    QVERIFY(countBirdsFound(batched) >= countBirdsFound(fullScale));
+    QVERIFY(countCorrect(batched) >= countCorrect(fullScale));
+}
+
+void TestBirdClassifier::throughputFullScale()
+{
+    QVERIFY(!m_generatedCrops.empty());
+    QBENCHMARK {
+        classifyAllFullScale(m_generatedCrops);
+    }
+}
+
+void TestBirdClassifier::throughputBatched()
+{
+    QVERIFY(!m_generatedCrops.empty());
+    QBENCHMARK {
+        classifyAllBatched(m_generatedCrops);
+    }
+}
+
+QTEST_MAIN(TestBirdClassifier)
+
+#include "testbirdclassifier.moc"
@@ -0,0 +1,27 @@
+#-------------------------------------------------
+#
+# Brightness threshold table test
+#
+#-------------------------------------------------
+
+QT       += testlib
+
+QT       -= gui
+
+TARGET = testbrightnessthresholds
+CONFIG += console testcase
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+QMAKE_CXXFLAGS += -std=c++11
+CONFIG += c++11
+
+INCLUDEPATH += ../..
+
+SOURCES += testbrightnessthresholds.cpp \
+    ../../brightnessthresholds.cpp
+HEADERS += ../../brightnessthresholds.h
+
+DEFINES += SRCDIR=\\\"$$PWD/\\\" \
+    _UNIT_TEST_
@@ -0,0 +1,131 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "brightnessthresholds.h"
+#include <QString>
+#include <QtTest>
+#include <QTest>
+
+// the default thresholds are usable in constant expressions
+static_assert(defaultBrightnessThresholds(0).minLight == 50, "wrong default threshold");
+static_assert(defaultBrightnessThresholds(255).minBlack == 240, "wrong default threshold");
+
+/**
+ * @brief BrightnessThresholdTable unit test class
+ */
+class TestBrightnessThresholds : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void defaultTable_data();
+    void defaultTable();
+    void lookup_clamps();
+    void load_valid();
+    void load_empty();
+    void load_invalid_data();
+    void load_invalid();
+};
+
+void TestBrightnessThresholds::defaultTable_data()
+{
+    QTest::addColumn<int>("brightness");
+    QTest::addColumn<int>("minLight");
+    QTest::addColumn<int>("minBlack");
+
+    // limits of the original if/else ladder
+    QTest::newRow("0") << 0 << 50 << 30;
+    QTest::newRow("9") << 9 << 50 << 30;
+    QTest::newRow("10") << 10 << 90 << 75;
+    QTest::newRow("69") << 69 << 90 << 75;
+    QTest::newRow("70") << 70 << 110 << 85;
+    QTest::newRow("100") << 100 << 150 << 130;
+    QTest::newRow("130") << 130 << 160 << 145;
+    QTest::newRow("150") << 150 << 190 << 170;
+    QTest::newRow("180") << 180 << 215 << 205;
+    QTest::newRow("210") << 210 << 235 << 225;
+    QTest::newRow("230") << 230 << 243 << 235;
+    QTest::newRow("240") << 240 << 243 << 235;
+    QTest::newRow("241") << 241 << 250 << 240;
+    QTest::newRow("255") << 255 << 250 << 240;
+}
+
+void TestBrightnessThresholds::defaultTable()
+{
+    QFETCH(int, brightness);
+    QFETCH(int, minLight);
+    QFETCH(int, minBlack);
+
+    BrightnessThresholdTable table;
+    QCOMPARE(table.lookup(brightness).minLight, minLight);
+    QCOMPARE(table.lookup(brightness).minBlack, minBlack);
+    QCOMPARE(BrightnessThresholdTable::defaultTable()[brightness].minLight, minLight);
+    QCOMPARE(defaultBrightnessThresholds(brightness).minBlack, minBlack);
+}
+
+void TestBrightnessThresholds::lookup_clamps()
+{
+    BrightnessThresholdTable table;
+    QCOMPARE(table.lookup(-5).minLight, table.lookup(0).minLight);
+    QCOMPARE(table.lookup(1000).minLight, table.lookup(255).minLight);
+}
+
+void TestBrightnessThresholds::load_valid()
+{
+    BrightnessThresholdTable table;
+    QVERIFY(table.load("100:120:80; 256:200:150"));
+    QCOMPARE(table.lookup(0).minLight, 120);
+    QCOMPARE(table.lookup(99).minBlack, 80);
+    QCOMPARE(table.lookup(100).minLight, 200);
+    QCOMPARE(table.lookup(255).minBlack, 150);
+}
+
+void TestBrightnessThresholds::load_empty()
+{
+    BrightnessThresholdTable table;
+    QVERIFY(table.load("256:1:1"));
+    QVERIFY(table.load(""));
+    QCOMPARE(table.lookup(0).minLight, 50);
+}
+
+void TestBrightnessThresholds::load_invalid_data()
+{
+    QTest::addColumn<QString>("definition");
+
+    QTest::newRow("not covering 255") << QString("100:120:80");
+    QTest::newRow("descending limits") << QString("100:120:80;50:1:1;256:1:1");
+    QTest::newRow("limit too large") << QString("300:120:80");
+    QTest::newRow("light out of range") << QString("256:300:80");
+    QTest::newRow("missing value") << QString("256:120");
+    QTest::newRow("not a number") << QString("256:abc:80");
+}
+
+void TestBrightnessThresholds::load_invalid()
+{
+    QFETCH(QString, definition);
+
+    BrightnessThresholdTable table;
+    QVERIFY(!table.load(definition));
+    // table is not changed
+    QCOMPARE(table.lookup(0).minLight, 50);
+    QCOMPARE(table.lookup(255).minBlack, 240);
+}
+
+QTEST_MAIN(TestBrightnessThresholds)
+
+#include "testbrightnessthresholds.moc"
@@ -0,0 +1,29 @@
+#-------------------------------------------------
+#
+# Camera frame test
+#
+#-------------------------------------------------
+
+QT       += testlib
+
+QT       -= gui
+
+TARGET = testcameraframe
+CONFIG += console testcase
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+QMAKE_CXXFLAGS += -std=c++11
+CONFIG += c++11
+
+include(../../opencv.pri)
+
+INCLUDEPATH += ../..
+
+SOURCES += testcameraframe.cpp \
+    ../../cameraframe.cpp
+HEADERS += ../../cameraframe.h
+
+DEFINES += SRCDIR=\\\"$$PWD/\\\" \
+    _UNIT_TEST_
@@ -0,0 +1,207 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "cameraframe.h"
+#include <QString>
+#include <QtTest>
+#include <QTest>
+#include <thread>
+#include <vector>
+
+#define TEST_FRAME_WIDTH 64
+#define TEST_FRAME_HEIGHT 48
+
+/**
+ * @brief CameraFrame unit test class
+ */
+class TestCameraFrame : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void emptyFrame();
+    void bgr_grayIsCached();
+    void nv12_grayIsYPlane();
+    void yuyv_gray();
+    void fromRawData_data();
+    void fromRawData();
+    void downscaledGray();
+    void downscaledGray_keepsSmallObjects();
+    void copies_shareConvertedImages();
+    void copies_convertOnceAcrossThreads();
+};
+
+void TestCameraFrame::emptyFrame()
+{
+    CameraFrame frame;
+    QVERIFY(frame.empty());
+    QVERIFY(frame.gray().empty());
+    QVERIFY(frame.bgr().empty());
+    QVERIFY(frame.downscaledGrayMax(4).empty());
+    QVERIFY(frame.downscaledGrayMin(4).empty());
+}
+
+void TestCameraFrame::bgr_grayIsCached()
+{
+    cv::Mat image(TEST_FRAME_HEIGHT, TEST_FRAME_WIDTH, CV_8UC3, cv::Scalar(10, 100, 200));
+    CameraFrame frame(image);
+    QCOMPARE(frame.size(), cv::Size(TEST_FRAME_WIDTH, TEST_FRAME_HEIGHT));
+    QVERIFY(frame.bgr().data == image.data);
+
+    cv::Mat expected;
+    cv::cvtColor(image, expected, CV_RGB2GRAY);
+    const cv::Mat& gray = frame.gray();
+    QCOMPARE(cv::countNonZero(gray != expected), 0);
+    // computed only once
+    QVERIFY(frame.gray().data == gray.data);
+}
+
+void TestCameraFrame::nv12_grayIsYPlane()
+{
+    cv::Mat data(TEST_FRAME_HEIGHT * 3 / 2, TEST_FRAME_WIDTH, CV_8UC1, cv::Scalar(128));
+    data.rowRange(0, TEST_FRAME_HEIGHT).setTo(cv::Scalar(77));
+    CameraFrame frame(data, CameraFrame::NV12);
+    QCOMPARE(frame.size(), cv::Size(TEST_FRAME_WIDTH, TEST_FRAME_HEIGHT));
+
+    const cv::Mat& gray = frame.gray();
+    QCOMPARE(gray.size(), cv::Size(TEST_FRAME_WIDTH, TEST_FRAME_HEIGHT));
+    QVERIFY(gray.data == data.data);
+    QCOMPARE((int)gray.at<uchar>(TEST_FRAME_HEIGHT - 1, 0), 77);
+    QCOMPARE(frame.bgr().size(), cv::Size(TEST_FRAME_WIDTH, TEST_FRAME_HEIGHT));
+}
+
+void TestCameraFrame::yuyv_gray()
+{
+    cv::Mat data(TEST_FRAME_HEIGHT, TEST_FRAME_WIDTH, CV_8UC2, cv::Scalar(90, 128));
+    CameraFrame frame(data, CameraFrame::YUYV);
+    const cv::Mat& gray = frame.gray();
+    QCOMPARE(gray.type(), CV_8UC1);
+    QCOMPARE(gray.size(), cv::Size(TEST_FRAME_WIDTH, TEST_FRAME_HEIGHT));
+    QCOMPARE((int)gray.at<uchar>(5, 5), 90);
+    QCOMPARE(frame.bgr().type(), CV_8UC3);
+}
+
+void TestCameraFrame::fromRawData_data()
+{
+    QTest::addColumn<int>("format");
+    QTest::addColumn<int>("bytes");
+    QTest::addColumn<bool>("isValid");
+
+    const int pixels = TEST_FRAME_WIDTH * TEST_FRAME_HEIGHT;
+    QTest::newRow("YUYV") << (int)CameraFrame::YUYV << pixels * 2 << true;
+    QTest::newRow("YUYV too short") << (int)CameraFrame::YUYV << pixels * 2 - 1 << false;
+    QTest::newRow("NV12") << (int)CameraFrame::NV12 << pixels * 3 / 2 << true;
+    QTest::newRow("NV12 as BGR") << (int)CameraFrame::BGR << pixels * 3 / 2 << false;
+    QTest::newRow("BGR") << (int)CameraFrame::BGR << pixels * 3 << true;
+}
+
+void TestCameraFrame::fromRawData()
+{
+    QFETCH(int, format);
+    QFETCH(int, bytes);
+    QFETCH(bool, isValid);
+
+    cv::Mat data(1, bytes, CV_8UC1, cv::Scalar(50));
+    CameraFrame frame = CameraFrame::fromRawData(data, (CameraFrame::Format)format, TEST_FRAME_WIDTH, TEST_FRAME_HEIGHT);
+    QCOMPARE(!frame.empty(), isValid);
+    if (isValid) {
+        QCOMPARE(frame.size(), cv::Size(TEST_FRAME_WIDTH, TEST_FRAME_HEIGHT));
+        QCOMPARE(frame.gray().size(), cv::Size(TEST_FRAME_WIDTH, TEST_FRAME_HEIGHT));
+        // raw capture buffers are reused, so the data must have been copied
+        QVERIFY(frame.data().data != data.data);
+    }
+}
+
+void TestCameraFrame::downscaledGray()
+{
+    cv::Mat image(TEST_FRAME_HEIGHT, TEST_FRAME_WIDTH, CV_8UC3, cv::Scalar(60, 60, 60));
+    CameraFrame frame(image);
+    const cv::Mat& small = frame.downscaledGrayMax(4);
+    QCOMPARE(small.size(), cv::Size(TEST_FRAME_WIDTH / 4, TEST_FRAME_HEIGHT / 4));
+    QCOMPARE((int)small.at<uchar>(0, 0), 60);
+    QCOMPARE((int)frame.downscaledGrayMin(4).at<uchar>(0, 0), 60);
+    QVERIFY(frame.downscaledGrayMax(4).data == small.data);
+    QCOMPARE(frame.downscaledGrayMax(2).size(), cv::Size(TEST_FRAME_WIDTH / 2, TEST_FRAME_HEIGHT / 2));
+    QCOMPARE(frame.downscaledGrayMin(2).size(), cv::Size(TEST_FRAME_WIDTH / 2, TEST_FRAME_HEIGHT / 2));
+}
+
+void TestCameraFrame::downscaledGray_keepsSmallObjects()
+{
+    // one bright and one dark pixel at the last pixel of a block, averaging would leave 1/9 of their contrast
+    cv::Mat gray(TEST_FRAME_HEIGHT, TEST_FRAME_WIDTH + 1, CV_8UC1, cv::Scalar(100));
+    gray.at<uchar>(5, 8) = 190;
+    gray.at<uchar>(11, 17) = 10;
+    cv::Mat brightest, darkest;
+    CameraFrame::downscaleGrayExtremes(gray, 3, brightest, darkest);
+    QCOMPARE(brightest.size(), cv::Size(TEST_FRAME_WIDTH / 3, TEST_FRAME_HEIGHT / 3));
+    QCOMPARE(darkest.size(), brightest.size());
+    QCOMPARE((int)brightest.at<uchar>(1, 2), 190);
+    QCOMPARE((int)darkest.at<uchar>(1, 2), 100);
+    QCOMPARE((int)darkest.at<uchar>(3, 5), 10);
+    QCOMPARE((int)brightest.at<uchar>(3, 5), 100);
+    QCOMPARE(cv::countNonZero(brightest != 100), 1);
+    QCOMPARE(cv::countNonZero(darkest != 100), 1);
+}
+
+void TestCameraFrame::copies_shareConvertedImages()
+{
+    cv::Mat data(TEST_FRAME_HEIGHT, TEST_FRAME_WIDTH, CV_8UC2, cv::Scalar(90, 128));
+    CameraFrame frame(data, CameraFrame::YUYV);
+    CameraFrame copy = frame;
+    // converted through one copy, used through the other
+    const cv::Mat& bgr = frame.bgr();
+    QVERIFY(copy.bgr().data == bgr.data);
+    QVERIFY(copy.rgb().data == frame.rgb().data);
+    QVERIFY(copy.gray().data == frame.gray().data);
+
+    // another factor must not replace an image a copy already holds
+    const cv::Mat& small = copy.downscaledGrayMax(4);
+    QVERIFY(frame.downscaledGrayMax(4).data == small.data);
+    QCOMPARE(frame.downscaledGrayMax(2).size(), cv::Size(TEST_FRAME_WIDTH / 2, TEST_FRAME_HEIGHT / 2));
+    QVERIFY(copy.downscaledGrayMax(4).data == small.data);
+    QCOMPARE(small.size(), cv::Size(TEST_FRAME_WIDTH / 4, TEST_FRAME_HEIGHT / 4));
+}
+
+void TestCameraFrame::copies_convertOnceAcrossThreads()
+{
+    const int threadCount = 4;
+    cv::Mat data(TEST_FRAME_HEIGHT, TEST_FRAME_WIDTH, CV_8UC2, cv::Scalar(90, 128));
+    CameraFrame frame(data, CameraFrame::YUYV);
+    std::vector<const uchar*> bgrData(threadCount, NULL);
+    std::vector<const uchar*> grayData(threadCount, NULL);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; t++) {
+        // each thread uses its own copy, like the detector and the recorder
+        CameraFrame copy = frame;
+        threads.push_back(std::thread([copy, t, &bgrData, &grayData]() mutable {
+            bgrData[t] = copy.bgr().data;
+            grayData[t] = copy.gray().data;
+        }));
+    }
+    for (int t = 0; t < threadCount; t++) {
+        threads[t].join();
+    }
+    for (int t = 0; t < threadCount; t++) {
+        QVERIFY(bgrData[t] == frame.bgr().data);
+        QVERIFY(grayData[t] == frame.gray().data);
+    }
+}
+
+QTEST_MAIN(TestCameraFrame)
+
+#include "testcameraframe.moc"
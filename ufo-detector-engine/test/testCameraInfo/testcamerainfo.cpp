@@ -1,6 +1,7 @@
 
 #include "camerainfo.h"
 #include <QString>
+#include <QTemporaryDir>
 #include <QtTest>
 
 /**
@@ -24,10 +25,13 @@ private Q_SLOTS:
     void cameraInfoInit();  // "init" seems to be a reserved word in QTest so using other name
     void compareResolutionsWidthFirst();
     void testListSorting();
+    void resolutionCache();
+    void resolutionCache_otherVersion();
     void testQueryPerformance();
 
 private:
     CameraInfo* m_cameraInfo;
+    QTemporaryDir m_cacheDir;   ///< keeps the user's resolution cache untouched
     QList<int> m_queryProgressEmitted;  ///< list of resolution query progress percentages emitted
 };
 
@@ -45,6 +49,8 @@ void TestCameraInfo::initTestCase()
 {
     m_cameraInfo = new CameraInfo(0);
     QVERIFY(NULL != m_cameraInfo);
+    QVERIFY(m_cacheDir.isValid());
+    m_cameraInfo->setCacheFileName(m_cacheDir.path() + "/CameraResolutions.ini");
     QVERIFY(m_cameraInfo->m_commonResolutions.size() > 0);
     QVERIFY(m_cameraInfo->m_availableResolutions.isEmpty());
     QVERIFY(!m_cameraInfo->m_knownAspectRatios.isEmpty());
@@ -76,8 +82,10 @@ void TestCameraInfo::cameraInfoInit()
     QVERIFY(!m_cameraInfo->knownAspectRatios().isEmpty());
     QVERIFY(m_cameraInfo->m_initialized);
     QVERIFY(m_cameraInfo->isInitialized());
-    QVERIFY(m_queryProgressEmitted.contains(1));    // lowest resolution
-    QVERIFY(m_queryProgressEmitted.contains(2));    // highest resolution
+    if (m_cameraInfo->m_resolutionSource == CameraInfo::Probed) {
+        QVERIFY(m_queryProgressEmitted.contains(1));    // lowest resolution
+        QVERIFY(m_queryProgressEmitted.contains(2));    // highest resolution
+    }
     QVERIFY(m_queryProgressEmitted.contains(100));  // query done
 
     /// @todo check aspect ratio is found for each common and available resolution
@@ -173,6 +181,56 @@ void TestCameraInfo::testListSorting() {
     QVERIFY(testList.at(4) == QSize(50, 10));
 }
 
+void TestCameraInfo::resolutionCache() {
+    // no such camera, so the driver can't be asked and the cache is used
+    QString cacheFileName = m_cacheDir.path() + "/resolutionCache.ini";
+    CameraInfo probed(99);
+    probed.setCacheFileName(cacheFileName);
+    QVERIFY(!probed.initWithoutProbing());
+    probed.m_availableResolutions << QSize(640, 480) << QSize(1280, 720);
+    probed.m_resolutionSource = CameraInfo::Probed;
+    probed.saveToCache();
+
+    CameraInfo cached(99);
+    cached.setCacheFileName(cacheFileName);
+    QVERIFY(cached.initWithoutProbing());
+    QVERIFY(cached.isInitialized());
+    QCOMPARE(cached.m_resolutionSource, CameraInfo::Cached);
+    QCOMPARE(cached.availableResolutions(), probed.m_availableResolutions);
+
+    // other camera index or backend is another device
+    CameraInfo otherCamera(98);
+    otherCamera.setCacheFileName(cacheFileName);
+    QVERIFY(!otherCamera.initWithoutProbing());
+    QVERIFY(otherCamera.deviceIdentity() != cached.deviceIdentity());
+    CameraInfo otherBackend(99, 0, CV_CAP_FFMPEG);
+    otherBackend.setCacheFileName(cacheFileName);
+    QVERIFY(!otherBackend.initWithoutProbing());
+
+    cached.invalidateCache();
+    QVERIFY(!cached.isInitialized());
+    QVERIFY(cached.availableResolutions().isEmpty());
+    CameraInfo invalidated(99);
+    invalidated.setCacheFileName(cacheFileName);
+    QVERIFY(!invalidated.initWithoutProbing());
+}
+
+void TestCameraInfo::resolutionCache_otherVersion() {
+    QString cacheFileName = m_cacheDir.path() + "/resolutionCacheVersion.ini";
+    CameraInfo probed(99);
+    probed.setCacheFileName(cacheFileName);
+    probed.m_availableResolutions << QSize(640, 480);
+    probed.saveToCache();
+    {
+        QSettings cache(cacheFileName, QSettings::IniFormat);
+        cache.setValue("version", CameraInfo::CACHE_VERSION + 1);
+    }
+
+    CameraInfo cached(99);
+    cached.setCacheFileName(cacheFileName);
+    QVERIFY(!cached.initWithoutProbing());
+}
+
 void TestCameraInfo::testQueryPerformance() {
     QList<int> backendList;
     QList<QString> backendStringList;
@@ -194,6 +252,8 @@ void TestCameraInfo::testQueryPerformance() {
         int backend = backendIt.next();
         delete m_cameraInfo;
         m_cameraInfo = new CameraInfo(0, 0, backend);
+        m_cameraInfo->setCacheFileName(m_cacheDir.path() + "/CameraResolutions.ini");
+        m_cameraInfo->invalidateCache();
         duration.start();
         m_cameraInfo->init();
         durationMsecList << duration.elapsed();
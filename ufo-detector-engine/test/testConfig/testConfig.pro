@@ -23,9 +23,11 @@ include(../../opencv.pri)
 
 SOURCES += testconfig.cpp \
     ../../config.cpp \
+    ../../configsnapshot.cpp \
     ../mock/mockVideoCodecSupportInfo.cpp
 
 HEADERS += ../../config.h \
+    ../../configsnapshot.h \
     ../../videocodecsupportinfo.h
 
 DEFINES += SRCDIR=\\\"$$PWD/\\\"
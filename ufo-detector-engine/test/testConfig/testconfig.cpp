@@ -15,6 +15,10 @@ private Q_SLOTS:
     void defaultValues();
     void motionThreshold();
     void videoCodecSupportInfo();
+    void cameraConfig();
+    void snapshot();
+    void snapshot_fileChanged();
+    void snapshot_ownWriteIgnored();
 
 private:
     Config* m_config;
@@ -65,6 +69,7 @@ void TestConfig::defaultValues() {
     QVERIFY(m_config->resultVideoCodecStr() == "FFV1");
     //QCOMPARE(m_config->resultVideoCodec(), CV_FOURCC('F', 'F', 'V', '1'));
     QVERIFY(m_config->resultVideoWithObjectRectangles() == false);
+    QCOMPARE(m_config->resultVideoFrameDecimation(), 1);
     //QVERIFY(m_config->videoEncoderLocation());
     //QVERIFY(m_config->resultImageDir());
     QVERIFY(m_config->saveResultImages() == false);
@@ -90,6 +95,79 @@ void TestConfig::videoCodecSupportInfo() {
     QVERIFY(m_config->videoCodecSupportInfo()->isInitialized());
 }
 
+void TestConfig::cameraConfig() {
+    QCOMPARE(m_config->cameraCount(), 1);
+    QCOMPARE(m_config->cameraSlot(), -1);
+    m_config->setMotionThreshold(20);
+    m_config->setDetectionAreaFile("/tmp/area.xml");
+
+    Config cameraConfig(NULL, 1);
+    QCOMPARE(cameraConfig.cameraSlot(), 1);
+    QCOMPARE(cameraConfig.cameraIndex(), 1);
+    // shared settings are used unless the camera has its own
+    QCOMPARE(cameraConfig.motionThreshold(), 20);
+    cameraConfig.setMotionThreshold(30);
+    QCOMPARE(cameraConfig.motionThreshold(), 30);
+    QCOMPARE(m_config->motionThreshold(), 20);
+    QVERIFY(m_config->m_settings->contains("camera1/motionThreshold"));
+
+    // files and folders are separated per camera
+    QCOMPARE(cameraConfig.detectionAreaFile(), QString("/tmp/area-camera1.xml"));
+    QCOMPARE(cameraConfig.resultVideoDir(), m_config->resultVideoDir() + "/camera1");
+    QVERIFY(cameraConfig.resultDataFile() != m_config->resultDataFile());
+    cameraConfig.setDetectionAreaFile("/tmp/other.xml");
+    QCOMPARE(cameraConfig.detectionAreaFile(), QString("/tmp/other.xml"));
+    cameraConfig.resetDetectionAreaFile();
+    QCOMPARE(cameraConfig.detectionAreaFile(), QString("/tmp/area-camera1.xml"));
+    QCOMPARE(m_config->detectionAreaFile(), QString("/tmp/area.xml"));
+}
+
+void TestConfig::snapshot() {
+    std::shared_ptr<const ConfigSnapshot> first = m_config->snapshot();
+    QVERIFY(first.get() != NULL);
+    QCOMPARE(first->m_motionThreshold, 10);
+    QCOMPARE(first->m_cameraWidth, 640);
+    QVERIFY(m_config->snapshot() == first);
+
+    m_config->setMotionThreshold(20);
+    std::shared_ptr<const ConfigSnapshot> second = m_config->snapshot();
+    QVERIFY(second != first);
+    QCOMPARE(second->m_motionThreshold, 20);
+    QVERIFY(second->m_generation > first->m_generation);
+    // old snapshot is not changed
+    QCOMPARE(first->m_motionThreshold, 10);
+}
+
+void TestConfig::snapshot_fileChanged() {
+    m_config->createDefaultConfig(true);
+    QVERIFY(m_config->setConfigFileWatched(true));
+    QSignalSpy reloadSpy(m_config, SIGNAL(settingsReloaded()));
+
+    {
+        // another process changes the file
+        QSettings otherSettings(m_config->configFileName(), QSettings::NativeFormat);
+        otherSettings.setValue("noiseFilterPixelSize", 5);
+        otherSettings.sync();
+    }
+    QVERIFY(reloadSpy.wait(5000) || (reloadSpy.count() > 0));
+    QCOMPARE(m_config->snapshot()->m_noiseFilterPixelSize, 5);
+    QVERIFY(m_config->setConfigFileWatched(false));
+}
+
+void TestConfig::snapshot_ownWriteIgnored() {
+    m_config->createDefaultConfig(true);
+    QVERIFY(m_config->setConfigFileWatched(true));
+    QSignalSpy changeSpy(m_config, SIGNAL(settingsChanged()));
+    QSignalSpy reloadSpy(m_config, SIGNAL(settingsReloaded()));
+
+    m_config->setMotionThreshold(17);
+    QCOMPARE(changeSpy.count(), 1);
+    QVERIFY(!reloadSpy.wait(1000));
+    QCOMPARE(changeSpy.count(), 1);
+    QCOMPARE(m_config->snapshot()->m_motionThreshold, 17);
+    QVERIFY(m_config->setConfigFileWatched(false));
+}
+
 QTEST_MAIN(TestConfig)
 
 #include "testconfig.moc"
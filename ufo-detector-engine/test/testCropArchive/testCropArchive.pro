@@ -0,0 +1,33 @@
+#-------------------------------------------------
+#
+# Crop archive test
+#
+#-------------------------------------------------
+
+QT       += testlib
+
+QT       -= gui
+
+TARGET = testcroparchive
+CONFIG += console testcase
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+QMAKE_CXXFLAGS += -std=c++11
+CONFIG += c++11
+
+include(../../opencv.pri)
+
+INCLUDEPATH += ../..
+
+SOURCES += testcroparchive.cpp \
+    ../../croparchive.cpp \
+    ../../filesync.cpp
+HEADERS += ../../croparchive.h \
+    ../../filesync.h
+
+DEFINES += SRCDIR=\\\"$$PWD/\\\" \
+    _UNIT_TEST_
+QMAKE_CXXFLAGS += --coverage
+QMAKE_LFLAGS += --coverage
@@ -0,0 +1,183 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "croparchive.h"
+#include <QString>
+#include <QTemporaryDir>
+#include <QtTest>
+
+/**
+ * @brief CropArchiveWriter and CropArchiveReader unit test class.
+ */
+class TestCropArchive : public QObject
+{
+    Q_OBJECT
+
+public:
+    TestCropArchive();
+
+private Q_SLOTS:
+    void readIndex();
+    void readIndex_emptyArchive();
+    void scanRecords_notClosed();
+    void scanRecords_partialRecord();
+    void open_notArchive();
+    void extract();
+
+private:
+    /**
+     * @brief Write an archive with count crops; crop i has i+1 image bytes of value i and i mask bytes.
+     */
+    void writeArchive(CropArchiveWriter& writer, const QString& fileName, int count);
+    void verifyEntries(const CropArchiveReader& reader, int count);
+};
+
+TestCropArchive::TestCropArchive() {
+}
+
+void TestCropArchive::writeArchive(CropArchiveWriter& writer, const QString& fileName, int count) {
+    QVERIFY(writer.open(fileName));
+    for (int i = 0; i < count; i++) {
+        CropArchiveEntry entry;
+        entry.m_timestamp = 1500000000000LL + i;
+        entry.m_trackId = 100 + i;
+        entry.m_rect = cv::Rect(i, 2 * i, 10 + i, 20 + i);
+        entry.m_isBright = (i % 2) == 0;
+        QVERIFY(writer.append(entry, std::vector<uchar>(i + 1, (uchar)i), std::vector<uchar>(i, 255)));
+    }
+    QCOMPARE(writer.entryCount(), count);
+}
+
+void TestCropArchive::verifyEntries(const CropArchiveReader& reader, int count) {
+    QCOMPARE(reader.count(), count);
+    for (int i = 0; i < count; i++) {
+        const CropArchiveEntry& entry = reader.entry(i);
+        QCOMPARE(entry.m_timestamp, 1500000000000LL + i);
+        QCOMPARE(entry.m_trackId, (quint64)(100 + i));
+        QCOMPARE(entry.m_rect, cv::Rect(i, 2 * i, 10 + i, 20 + i));
+        QCOMPARE(entry.m_isBright, (i % 2) == 0);
+        QCOMPARE(reader.imageData(i), QByteArray(i + 1, (char)i));
+        QCOMPARE(reader.maskData(i), QByteArray(i, (char)255));
+    }
+}
+
+void TestCropArchive::readIndex() {
+    QTemporaryDir dir;
+    QString fileName = dir.path() + "/session.ufocrops";
+    CropArchiveWriter writer;
+    writeArchive(writer, fileName, 10);
+    QVERIFY(writer.close());
+
+    CropArchiveReader reader;
+    QVERIFY(reader.open(fileName));
+    QVERIFY(!reader.isIndexRecovered());
+    verifyEntries(reader, 10);
+    QVERIFY(CropArchive::isArchiveFileName(fileName));
+}
+
+void TestCropArchive::readIndex_emptyArchive() {
+    QTemporaryDir dir;
+    QString fileName = dir.path() + "/session.ufocrops";
+    CropArchiveWriter writer;
+    writeArchive(writer, fileName, 0);
+    QVERIFY(writer.close());
+
+    CropArchiveReader reader;
+    QVERIFY(reader.open(fileName));
+    QVERIFY(!reader.isIndexRecovered());
+    QCOMPARE(reader.count(), 0);
+}
+
+void TestCropArchive::scanRecords_notClosed() {
+    QTemporaryDir dir;
+    QString fileName = dir.path() + "/session.ufocrops";
+    CropArchiveWriter writer;
+    writeArchive(writer, fileName, 5);
+    writer.sync();
+
+    // like after a crash: the index was never written
+    CropArchiveReader reader;
+    QVERIFY(reader.open(fileName));
+    QVERIFY(reader.isIndexRecovered());
+    verifyEntries(reader, 5);
+    reader.close();
+    writer.close();
+}
+
+void TestCropArchive::scanRecords_partialRecord() {
+    QTemporaryDir dir;
+    QString fileName = dir.path() + "/session.ufocrops";
+    CropArchiveWriter writer;
+    writeArchive(writer, fileName, 5);
+    QVERIFY(writer.close());
+
+    // cut into the index and the last record
+    QFile file(fileName);
+    qint64 indexSize = 5 * CropArchive::INDEX_ENTRY_SIZE + CropArchive::FOOTER_SIZE;
+    QVERIFY(file.resize(file.size() - indexSize - 3));
+
+    CropArchiveReader reader;
+    QVERIFY(reader.open(fileName));
+    QVERIFY(reader.isIndexRecovered());
+    verifyEntries(reader, 4);
+}
+
+void TestCropArchive::open_notArchive() {
+    QTemporaryDir dir;
+    QString fileName = dir.path() + "/image0.jpg";
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(QByteArray(100, 'x'));
+    file.close();
+
+    CropArchiveReader reader;
+    QVERIFY(!reader.open(fileName));
+    QVERIFY(!reader.open(dir.path() + "/missing.ufocrops"));
+    QVERIFY(!CropArchive::isArchiveFileName(fileName));
+}
+
+void TestCropArchive::extract() {
+    QTemporaryDir dir;
+    QString fileName = dir.path() + "/session.ufocrops";
+    CropArchiveWriter writer;
+    writeArchive(writer, fileName, 3);
+    QVERIFY(writer.close());
+
+    CropArchiveReader reader;
+    QVERIFY(reader.open(fileName));
+    QString extractDir = dir.path() + "/session";
+    QVERIFY(reader.extract(extractDir));
+    for (int i = 0; i < 3; i++) {
+        QFile image(extractDir + "/" + CropArchiveReader::imageFileName(i));
+        QVERIFY(image.open(QIODevice::ReadOnly));
+        QCOMPARE(image.readAll(), QByteArray(i + 1, (char)i));
+    }
+    // first crop has no mask
+    QVERIFY(!QFile::exists(extractDir + "/" + CropArchiveReader::maskFileName(0)));
+    QVERIFY(QFile::exists(extractDir + "/" + CropArchiveReader::maskFileName(1)));
+
+    QFile metadata(extractDir + "/" + CropArchiveReader::METADATA_FILE);
+    QVERIFY(metadata.open(QIODevice::ReadOnly | QIODevice::Text));
+    QList<QByteArray> lines = metadata.readAll().trimmed().split('\n');
+    QCOMPARE(lines.size(), 4);
+    QCOMPARE(lines[2], QByteArray("image1.jpg,imageThresh1.png,1500000000001,101,1,2,11,21,0"));
+}
+
+QTEST_MAIN(TestCropArchive)
+
+#include "testcroparchive.moc"
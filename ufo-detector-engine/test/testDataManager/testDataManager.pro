@@ -23,8 +23,10 @@ INCLUDEPATH += ../../ \
 SOURCES += testdatamanager.cpp \
     ../../datamanager.cpp \
     ../mock/mockconfig.cpp \
+    ../../configsnapshot.cpp \
     ../mock/mockVideoCodecSupportInfo.cpp
 
 HEADERS += ../../datamanager.h \
     ../../config.h \
+    ../../configsnapshot.h \
     ../../videocodecsupportinfo.h
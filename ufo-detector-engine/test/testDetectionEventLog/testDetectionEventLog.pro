@@ -0,0 +1,29 @@
+#-------------------------------------------------
+#
+# Detection event log test
+#
+#-------------------------------------------------
+
+QT       += testlib
+
+QT       -= gui
+
+TARGET = testdetectioneventlog
+CONFIG += console testcase
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+QMAKE_CXXFLAGS += -std=c++11
+CONFIG += c++11
+
+INCLUDEPATH += ../..
+
+SOURCES += testdetectioneventlog.cpp \
+    ../../detectioneventlog.cpp
+HEADERS += ../../detectioneventlog.h
+
+DEFINES += SRCDIR=\\\"$$PWD/\\\" \
+    _UNIT_TEST_
+QMAKE_CXXFLAGS += --coverage
+QMAKE_LFLAGS += --coverage
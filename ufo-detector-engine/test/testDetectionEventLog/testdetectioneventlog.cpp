@@ -0,0 +1,150 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "detectioneventlog.h"
+#include <QString>
+#include <QTemporaryDir>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QtTest>
+
+/**
+ * @brief DetectionEventLog unit test class.
+ */
+class TestDetectionEventLog : public QObject
+{
+    Q_OBJECT
+
+public:
+    TestDetectionEventLog();
+
+private Q_SLOTS:
+    void add_eventsWritten();
+    void add_dropsWhenFull();
+    void add_dropsWhenStopped();
+    void toJson_recordingFinished();
+
+private:
+    QList<QJsonObject> readEvents(const QString& fileName);
+};
+
+TestDetectionEventLog::TestDetectionEventLog() {
+}
+
+QList<QJsonObject> TestDetectionEventLog::readEvents(const QString& fileName) {
+    QList<QJsonObject> events;
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return events;
+    }
+    while (!file.atEnd()) {
+        QByteArray line = file.readLine();
+        events << QJsonDocument::fromJson(line).object();
+    }
+    return events;
+}
+
+void TestDetectionEventLog::add_eventsWritten() {
+    QTemporaryDir dir;
+    QString fileName = dir.path() + "/events.ndjson";
+    DetectionEventLog log;
+    QVERIFY(log.start(fileName));
+
+    DetectionEvent frame = DetectionEvent::create(DetectionEvent::Frame, 10);
+    frame.m_motionPixels = 500;
+    frame.m_objects = 2;
+    frame.m_positives = 1;
+    frame.m_negatives = 1;
+    frame.m_ambientLevel = 80;
+    QVERIFY(log.add(frame));
+    DetectionEvent created = DetectionEvent::create(DetectionEvent::TrackCreated, 10);
+    created.m_trackId = 3;
+    QVERIFY(log.add(created));
+    DetectionEvent removed = DetectionEvent::create(DetectionEvent::TrackRemoved, 25);
+    removed.m_trackId = 3;
+    removed.m_posCounter = 4;
+    removed.m_negCounter = 1;
+    removed.m_birdCounter = 2;
+    QVERIFY(log.add(removed));
+    log.stop();
+    QCOMPARE(log.droppedCount(), (uint64_t)0);
+
+    QList<QJsonObject> events = readEvents(fileName);
+    QCOMPARE(events.size(), 3);
+    QCOMPARE(events[0]["type"].toString(), QString("frame"));
+    QCOMPARE(events[0]["frame"].toInt(), 10);
+    QCOMPARE(events[0]["motion"].toInt(), 500);
+    QCOMPARE(events[0]["objects"].toInt(), 2);
+    QCOMPARE(events[0]["positives"].toInt(), 1);
+    QCOMPARE(events[0]["night"].toBool(), false);
+    QVERIFY(events[0]["time"].toDouble() > 0);
+    QCOMPARE(events[1]["type"].toString(), QString("trackCreated"));
+    QCOMPARE(events[1]["track"].toInt(), 3);
+    QCOMPARE(events[2]["type"].toString(), QString("trackRemoved"));
+    QCOMPARE(events[2]["frame"].toInt(), 25);
+    QCOMPARE(events[2]["positives"].toInt(), 4);
+    QCOMPARE(events[2]["negatives"].toInt(), 1);
+    QCOMPARE(events[2]["birds"].toInt(), 2);
+
+    // a restarted log appends
+    QVERIFY(log.start(fileName));
+    QVERIFY(log.add(DetectionEvent::create(DetectionEvent::RecordingStarted, 0)));
+    log.stop();
+    events = readEvents(fileName);
+    QCOMPARE(events.size(), 4);
+    QCOMPARE(events[3]["type"].toString(), QString("recordingStarted"));
+}
+
+void TestDetectionEventLog::add_dropsWhenFull() {
+    DetectionEventLog log;
+    // running without writer thread, nothing leaves the ring
+    log.m_running = true;
+    DetectionEvent event = DetectionEvent::create(DetectionEvent::Frame, 0);
+    for (size_t i = 0; i < DetectionEventLog::RING_SIZE; i++) {
+        QVERIFY(log.add(event));
+    }
+    QVERIFY(!log.add(event));
+    QCOMPARE(log.droppedCount(), (uint64_t)1);
+    log.m_running = false;
+}
+
+void TestDetectionEventLog::add_dropsWhenStopped() {
+    DetectionEventLog log;
+    QVERIFY(!log.add(DetectionEvent::create(DetectionEvent::Frame, 0)));
+    QCOMPARE(log.droppedCount(), (uint64_t)1);
+}
+
+void TestDetectionEventLog::toJson_recordingFinished() {
+    DetectionEvent event = DetectionEvent::create(DetectionEvent::RecordingFinished, 7);
+    event.m_result = "airplane";
+    QJsonObject json = QJsonDocument::fromJson(DetectionEventLog::toJson(event)).object();
+    QCOMPARE(json["type"].toString(), QString("recordingFinished"));
+    QCOMPARE(json["result"].toString(), QString("airplane"));
+    QCOMPARE(json["videoSaved"].toBool(), false);
+
+    // stopped without result
+    event.m_result = NULL;
+    event.m_videoSaved = true;
+    json = QJsonDocument::fromJson(DetectionEventLog::toJson(event)).object();
+    QVERIFY(json["result"].isNull());
+    QCOMPARE(json["videoSaved"].toBool(), true);
+}
+
+QTEST_MAIN(TestDetectionEventLog)
+
+#include "testdetectioneventlog.moc"
@@ -0,0 +1,27 @@
+#-------------------------------------------------
+#
+# Latency histogram and metrics test
+#
+#-------------------------------------------------
+
+QT       += testlib
+
+QT       -= gui
+
+TARGET = testmetrics
+CONFIG += console testcase
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+QMAKE_CXXFLAGS += -std=c++11
+CONFIG += c++11
+
+INCLUDEPATH += ../..
+
+SOURCES += testmetrics.cpp \
+    ../../metrics.cpp
+HEADERS += ../../metrics.h
+
+DEFINES += SRCDIR=\\\"$$PWD/\\\" \
+    _UNIT_TEST_
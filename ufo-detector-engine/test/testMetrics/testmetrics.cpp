@@ -0,0 +1,265 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "metrics.h"
+#include <QString>
+#include <QtTest>
+#include <QElapsedTimer>
+#include <thread>
+#include <vector>
+#include <memory>
+
+/**
+ * @brief Metrics and LatencyHistogram unit test class.
+ */
+class TestMetrics : public QObject
+{
+    Q_OBJECT
+
+public:
+    TestMetrics();
+
+private Q_SLOTS:
+    void init();
+    void bucketIndex_roundTrip();
+    void bucketIndex_relativeError();
+    void percentile_empty();
+    void percentile_uniform();
+    void max();
+    void counters();
+    void gauges_videoBufferMaxDepth();
+    void disabled();
+    void scopedTimer();
+    void snapshot_toString();
+    void snapshot_frameRates();
+    void snapshot_prometheusText();
+    void scopedTimerOverhead();
+
+    /**
+     * Threads recording into one histogram lose nothing. Prints the cost of
+     * a shared histogram compared with one histogram per thread.
+     */
+    void concurrentWriters();
+};
+
+TestMetrics::TestMetrics() {
+}
+
+void TestMetrics::init() {
+    Metrics::instance().setEnabled(true);
+    Metrics::instance().reset();
+}
+
+void TestMetrics::bucketIndex_roundTrip() {
+    for (int i = 0; i < LatencyHistogram::BUCKET_COUNT; i++) {
+        QCOMPARE(LatencyHistogram::bucketIndex(LatencyHistogram::bucketLowerBound(i)), i);
+    }
+    for (uint64_t value = 0; value < 2 * LatencyHistogram::SUB_BUCKET_COUNT; value++) {
+        QCOMPARE(LatencyHistogram::bucketIndex(value), (int)value);
+    }
+    // too large values go to the last bucket
+    QCOMPARE(LatencyHistogram::bucketIndex((uint64_t)1 << 50), LatencyHistogram::BUCKET_COUNT - 1);
+}
+
+void TestMetrics::bucketIndex_relativeError() {
+    uint64_t values[] = {100, 1000, 12345, 1000000, 60000000};
+    for (unsigned int i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        int index = LatencyHistogram::bucketIndex(values[i]);
+        uint64_t lower = LatencyHistogram::bucketLowerBound(index);
+        uint64_t upper = LatencyHistogram::bucketLowerBound(index + 1);
+        QVERIFY(lower <= values[i]);
+        QVERIFY(values[i] < upper);
+        QVERIFY((double)(upper - lower) / (double)lower <= 1.0 / LatencyHistogram::SUB_BUCKET_COUNT);
+    }
+}
+
+void TestMetrics::percentile_empty() {
+    LatencyHistogram histogram;
+    QCOMPARE(histogram.count(), (uint64_t)0);
+    QCOMPARE(histogram.percentile(50), (uint64_t)0);
+}
+
+void TestMetrics::percentile_uniform() {
+    LatencyHistogram histogram;
+    for (uint64_t value = 1; value <= 1000; value++) {
+        histogram.record(value);
+    }
+    QCOMPARE(histogram.count(), (uint64_t)1000);
+    QCOMPARE(histogram.total(), (uint64_t)500500);
+    uint64_t p50 = histogram.percentile(50);
+    uint64_t p99 = histogram.percentile(99);
+    QVERIFY(qAbs((double)p50 - 500.0) <= 500.0 / LatencyHistogram::SUB_BUCKET_COUNT);
+    QVERIFY(qAbs((double)p99 - 990.0) <= 990.0 / LatencyHistogram::SUB_BUCKET_COUNT);
+    QVERIFY(histogram.percentile(100) >= 992);
+    histogram.reset();
+    QCOMPARE(histogram.count(), (uint64_t)0);
+}
+
+void TestMetrics::max() {
+    LatencyHistogram histogram;
+    histogram.record(7);
+    histogram.record(123456);
+    histogram.record(42);
+    QCOMPARE(histogram.max(), (uint64_t)123456);
+}
+
+void TestMetrics::counters() {
+    Metrics& metrics = Metrics::instance();
+    metrics.count(Metrics::FramesRead);
+    metrics.count(Metrics::FramesRead);
+    metrics.count(Metrics::FramesDuplicated, 5);
+    MetricsSnapshot snapshot = metrics.snapshot();
+    QCOMPARE(snapshot.m_counters.size(), (size_t)Metrics::COUNTER_COUNT);
+    QCOMPARE(snapshot.m_counters[Metrics::FramesRead], (uint64_t)2);
+    QCOMPARE(snapshot.m_counters[Metrics::FramesDuplicated], (uint64_t)5);
+    QCOMPARE(snapshot.m_counters[Metrics::FramesDropped], (uint64_t)0);
+}
+
+void TestMetrics::gauges_videoBufferMaxDepth() {
+    Metrics& metrics = Metrics::instance();
+    metrics.setGauge(Metrics::VideoBufferDepth, 3);
+    metrics.setGauge(Metrics::VideoBufferDepth, 9);
+    metrics.setGauge(Metrics::VideoBufferDepth, 1);
+    MetricsSnapshot snapshot = metrics.snapshot();
+    QCOMPARE(snapshot.m_gauges[Metrics::VideoBufferDepth], (int64_t)1);
+    QCOMPARE(snapshot.m_gauges[Metrics::VideoBufferMaxDepth], (int64_t)9);
+}
+
+void TestMetrics::disabled() {
+    Metrics& metrics = Metrics::instance();
+    metrics.setEnabled(false);
+    QVERIFY(!metrics.isEnabled());
+    metrics.count(Metrics::FramesRead);
+    metrics.recordLatency(Metrics::DetectStage, 10);
+    {
+        MetricsScopedTimer timer(Metrics::FrameStage);
+    }
+    metrics.setEnabled(true);
+    MetricsSnapshot snapshot = metrics.snapshot();
+    QCOMPARE(snapshot.m_counters[Metrics::FramesRead], (uint64_t)0);
+    QCOMPARE(snapshot.m_stages[Metrics::DetectStage].m_count, (uint64_t)0);
+    QCOMPARE(snapshot.m_stages[Metrics::FrameStage].m_count, (uint64_t)0);
+}
+
+void TestMetrics::scopedTimer() {
+    {
+        MetricsScopedTimer timer(Metrics::DetectStage);
+        QTest::qSleep(5);
+        timer.stop();
+        // stopping again or destruction doesn't record a second time
+        timer.stop();
+    }
+    MetricsSnapshot snapshot = Metrics::instance().snapshot();
+    QCOMPARE(snapshot.m_stages[Metrics::DetectStage].m_count, (uint64_t)1);
+    QVERIFY(snapshot.m_stages[Metrics::DetectStage].m_maxUs >= 4000);
+}
+
+void TestMetrics::snapshot_toString() {
+    Metrics::instance().recordLatency(Metrics::LightDetectionStage, 25);
+    Metrics::instance().count(Metrics::FramesSkipped, 3);
+    QString text = Metrics::instance().snapshot().toString();
+    QVERIFY(text.contains("lightDetection: n=1"));
+    QVERIFY(text.contains("framesSkipped=3"));
+    QVERIFY(!text.contains("birdClassification"));
+}
+
+void TestMetrics::snapshot_frameRates() {
+    Metrics& metrics = Metrics::instance();
+    MetricsSnapshot previous = metrics.snapshot();
+    metrics.count(Metrics::FramesRead, 50);
+    for (int i = 0; i < 20; i++) {
+        metrics.recordLatency(Metrics::FrameStage, 1000);
+    }
+    MetricsSnapshot current = metrics.snapshot();
+    current.m_timestampMs = previous.m_timestampMs + 2000;
+    QCOMPARE(current.captureFps(previous), 25.0);
+    QCOMPARE(current.detectionFps(previous), 10.0);
+    // no rate without time difference or earlier snapshot
+    QCOMPARE(current.captureFps(current), 0.0);
+    QCOMPARE(current.captureFps(MetricsSnapshot()), 0.0);
+}
+
+void TestMetrics::snapshot_prometheusText() {
+    Metrics& metrics = Metrics::instance();
+    metrics.count(Metrics::FramesDropped, 2);
+    metrics.setGauge(Metrics::Recording, 1);
+    metrics.recordLatency(Metrics::MotionMaskStage, 20);
+    QString text = metrics.snapshot().toPrometheusText(25, 12.5);
+    QStringList lines = text.split('\n', QString::SkipEmptyParts);
+    QVERIFY(lines.contains("# TYPE ufo_frames_dropped_total counter"));
+    QVERIFY(lines.contains("ufo_frames_dropped_total 2"));
+    QVERIFY(lines.contains("ufo_capture_fps 25.00"));
+    QVERIFY(lines.contains("ufo_detection_fps 12.50"));
+    QVERIFY(lines.contains("ufo_recording 1"));
+    QVERIFY(lines.contains("ufo_encoder_queue_depth 0"));
+    QVERIFY(lines.contains("ufo_video_buffer_max_depth 0"));
+    QVERIFY(lines.contains("ufo_stage_latency_microseconds{stage=\"motionMask\",quantile=\"0.5\"} 20"));
+    QVERIFY(lines.contains("ufo_stage_latency_microseconds_count{stage=\"motionMask\"} 1"));
+    QVERIFY(lines.contains("ufo_stage_latency_microseconds_sum{stage=\"motionMask\"} 20"));
+    foreach (const QString& line, lines) {
+        // metric names use only characters allowed by Prometheus
+        if (!line.startsWith("#")) {
+            QVERIFY2(QRegExp("[a-z_]+(\\{[^}]*\\})? [0-9.]+").exactMatch(line), qPrintable(line));
+        }
+    }
+}
+
+void TestMetrics::scopedTimerOverhead() {
+    QBENCHMARK {
+        MetricsScopedTimer timer(Metrics::FrameStage);
+    }
+}
+
+void TestMetrics::concurrentWriters() {
+    const int recordsPerThread = 1000000;
+    const int threadCount = std::max(2, (int)std::thread::hardware_concurrency());
+    std::vector<std::unique_ptr<LatencyHistogram> > histograms;
+    for (int i = 0; i < threadCount; i++) {
+        histograms.push_back(std::unique_ptr<LatencyHistogram>(new LatencyHistogram()));
+    }
+
+    for (int shared = 1; shared >= 0; shared--) {
+        QElapsedTimer timer;
+        timer.start();
+        std::vector<std::thread> threads;
+        for (int i = 0; i < threadCount; i++) {
+            LatencyHistogram* histogram = histograms[shared ? 0 : i].get();
+            threads.push_back(std::thread([histogram, recordsPerThread]() {
+                for (int value = 0; value < recordsPerThread; value++) {
+                    histogram->record(100 + (value & 1023));
+                }
+            }));
+        }
+        for (unsigned int i = 0; i < threads.size(); i++) {
+            threads[i].join();
+        }
+        double nsPerRecord = (double)timer.nsecsElapsed() / ((double)recordsPerThread * threadCount);
+        qDebug() << threadCount << "threads," << (shared ? "one shared histogram:" : "one histogram each:")
+                 << nsPerRecord << "ns per record";
+    }
+
+    QCOMPARE(histograms[0]->count(), (uint64_t)recordsPerThread * (threadCount + 1));
+    QCOMPARE(histograms[0]->max(), (uint64_t)(100 + 1023));
+    for (int i = 1; i < threadCount; i++) {
+        QCOMPARE(histograms[i]->count(), (uint64_t)recordsPerThread);
+    }
+}
+
+QTEST_APPLESS_MAIN(TestMetrics)
+
+#include "testmetrics.moc"
@@ -0,0 +1,29 @@
+#-------------------------------------------------
+#
+# Motion model test
+#
+#-------------------------------------------------
+
+QT       += testlib
+
+QT       -= gui
+
+TARGET = testmotionmodel
+CONFIG += console testcase
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+QMAKE_CXXFLAGS += -std=c++11
+CONFIG += c++11
+
+include(../../opencv.pri)
+
+INCLUDEPATH += ../..
+
+SOURCES += testmotionmodel.cpp \
+    ../../motionmodel.cpp
+HEADERS += ../../motionmodel.h
+
+DEFINES += SRCDIR=\\\"$$PWD/\\\" \
+    _UNIT_TEST_
@@ -0,0 +1,160 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "motionmodel.h"
+#include <QString>
+#include <QtTest>
+#include <QTest>
+#include <memory>
+
+#define TEST_FRAME_WIDTH 64
+#define TEST_FRAME_HEIGHT 48
+#define TEST_THRESHOLD 10
+
+/**
+ * @brief MotionModel unit test class
+ */
+class TestMotionModel : public QObject
+{
+    Q_OBJECT
+
+private:
+    /**
+     * @brief Dark frame with a bright square at given x coordinate, or no square if x is negative.
+     */
+    cv::Mat makeFrame(int squareX);
+
+private Q_SLOTS:
+    void create();
+    void frameDifference_noHistory();
+    void frameDifference_movingObject();
+    void background_staticScene();
+    void background_newObject();
+    void background_noiseRaisesLimit();
+    void background_brightnessStepIsAbsorbed();
+};
+
+cv::Mat TestMotionModel::makeFrame(int squareX)
+{
+    cv::Mat frame(TEST_FRAME_HEIGHT, TEST_FRAME_WIDTH, CV_8UC1, cv::Scalar(20));
+    if (squareX >= 0) {
+        frame(cv::Rect(squareX, 10, 8, 8)).setTo(cv::Scalar(200));
+    }
+    return frame;
+}
+
+void TestMotionModel::create()
+{
+    std::unique_ptr<MotionModel> model(MotionModel::create(MotionModel::Background));
+    QVERIFY(dynamic_cast<BackgroundMotionModel*>(model.get()) != nullptr);
+    model.reset(MotionModel::create(MotionModel::FrameDifference));
+    QVERIFY(dynamic_cast<FrameDifferenceMotionModel*>(model.get()) != nullptr);
+    model.reset(MotionModel::create(12345));
+    QVERIFY(dynamic_cast<FrameDifferenceMotionModel*>(model.get()) != nullptr);
+}
+
+void TestMotionModel::frameDifference_noHistory()
+{
+    FrameDifferenceMotionModel model;
+    cv::Mat motion;
+    model.apply(makeFrame(-1), TEST_THRESHOLD, motion);
+    model.apply(makeFrame(10), TEST_THRESHOLD, motion);
+    QCOMPARE(cv::countNonZero(motion), 0);
+}
+
+void TestMotionModel::frameDifference_movingObject()
+{
+    FrameDifferenceMotionModel model;
+    cv::Mat motion;
+    model.apply(makeFrame(0), TEST_THRESHOLD, motion);
+    model.apply(makeFrame(20), TEST_THRESHOLD, motion);
+    model.apply(makeFrame(40), TEST_THRESHOLD, motion);
+    // only the newest square differs from both previous frames
+    QCOMPARE(cv::countNonZero(motion), 8 * 8);
+    QCOMPARE((int)motion.at<uchar>(12, 42), 255);
+
+    model.reset();
+    model.apply(makeFrame(40), TEST_THRESHOLD, motion);
+    QCOMPARE(cv::countNonZero(motion), 0);
+}
+
+void TestMotionModel::background_staticScene()
+{
+    BackgroundMotionModel model;
+    cv::Mat motion;
+    for (int i = 0; i < 20; i++) {
+        model.apply(makeFrame(10), TEST_THRESHOLD, motion);
+        QCOMPARE(cv::countNonZero(motion), 0);
+    }
+}
+
+void TestMotionModel::background_newObject()
+{
+    BackgroundMotionModel model;
+    cv::Mat motion;
+    for (int i = 0; i < 20; i++) {
+        model.apply(makeFrame(-1), TEST_THRESHOLD, motion);
+    }
+    model.apply(makeFrame(30), TEST_THRESHOLD, motion);
+    QCOMPARE(cv::countNonZero(motion), 8 * 8);
+}
+
+void TestMotionModel::background_noiseRaisesLimit()
+{
+    BackgroundMotionModel model;
+    cv::Mat motion;
+    cv::Mat dark(TEST_FRAME_HEIGHT, TEST_FRAME_WIDTH, CV_8UC1, cv::Scalar(20));
+    cv::Mat flicker(TEST_FRAME_HEIGHT, TEST_FRAME_WIDTH, CV_8UC1, cv::Scalar(20));
+    flicker(cv::Rect(0, 0, 8, 8)).setTo(cv::Scalar(45));
+
+    // flickering area: first detected as motion, then learned as noise
+    model.apply(dark, TEST_THRESHOLD, motion);
+    model.apply(flicker, TEST_THRESHOLD, motion);
+    QVERIFY(cv::countNonZero(motion) > 0);
+    for (int i = 0; i < 400; i++) {
+        model.apply((i % 3) ? dark : flicker, TEST_THRESHOLD + 20, motion);
+    }
+    model.apply(flicker, TEST_THRESHOLD, motion);
+    QCOMPARE(cv::countNonZero(motion), 0);
+}
+
+void TestMotionModel::background_brightnessStepIsAbsorbed()
+{
+    const int maxFrames = 120;
+    BackgroundMotionModel model;
+    cv::Mat motion;
+    for (int i = 0; i < 20; i++) {
+        model.apply(makeFrame(-1), TEST_THRESHOLD, motion);
+    }
+
+    // whole scene gets brighter for good, e.g. camera exposure changed
+    cv::Mat bright(TEST_FRAME_HEIGHT, TEST_FRAME_WIDTH, CV_8UC1, cv::Scalar(80));
+    int frames = 0;
+    do {
+        model.apply(bright, TEST_THRESHOLD, motion);
+        frames++;
+    } while ((cv::countNonZero(motion) > 0) && (frames <= maxFrames));
+    qDebug() << "brightness step absorbed after" << frames << "frames";
+    // a lasting change is not learned at once
+    QVERIFY(frames > model.UPDATE_INTERVAL);
+    QVERIFY(frames <= maxFrames);
+}
+
+QTEST_MAIN(TestMotionModel)
+
+#include "testmotionmodel.moc"
@@ -27,18 +27,26 @@ INCLUDEPATH += . \
 
 SOURCES += testrecorder.cpp \
     ../mock/mockcamera.cpp \
+    ../../cameraframe.cpp \
     ../mock/mockconfig.cpp \
+    ../../configsnapshot.cpp \
     ../mock/mockdatamanager.cpp \
     ../mock/mockvideobuffer.cpp \
     ../../videocodecsupportinfo.cpp \
     ../../recorder.cpp \
-    ../../camerainfo.cpp
+    ../../camerainfo.cpp \
+    ../../metrics.cpp \
+    ../../workerpool.cpp
 
 HEADERS += ../../recorder.h \
     ../../config.h \
+    ../../configsnapshot.h \
     ../../videocodecsupportinfo.h \
     ../../camera.h \
+    ../../cameraframe.h \
     ../../camerainfo.h \
     ../../datamanager.h \
-    ../../videobuffer.h
+    ../../videobuffer.h \
+    ../../metrics.h \
+    ../../workerpool.h
 
@@ -20,6 +20,7 @@
 #include "camera.h"
 #include "config.h"
 #include "datamanager.h"
+#include "metrics.h"
 #include <QtTest>
 #include <QString>
 #include <QFile>
@@ -58,6 +59,26 @@ private Q_SLOTS:
 
     void saveVideoThumbnailImage();
 
+    /*
+     * Video frame periods must follow capture timestamps, whatever the camera frame rate is.
+     */
+    void framePeriodsToFill();
+
+    /*
+     * Camera frames left out of the video and frames written again are counted separately.
+     */
+    void frameWriteCount();
+
+    /*
+     * Video buffer is sized by frame rate and available memory.
+     */
+    void videoBufferCapacity();
+
+    /*
+     * Available memory is read from MemAvailable of /proc/meminfo.
+     */
+    void parseMemAvailable();
+
 private:
     Recorder* m_recorder;
     Config* m_config;
@@ -305,6 +326,115 @@ void TestRecorder::onVideoEncodingRequested(QString tempFileName, QString target
     m_requestEncodingCounter++;
 }
 
+void TestRecorder::framePeriodsToFill()
+{
+    const qint64 startUs = 5000000;
+
+    // camera at 30 fps with timestamp jitter: one period per frame
+    m_recorder->m_videoFrameRate = 30;
+    m_recorder->m_firstFrameTimestampUs = -1;
+    m_recorder->m_framePeriodsFilled = 0;
+    for (int i = 0; i < 30; i++) {
+        qint64 jitterUs = (i % 3 - 1) * 5000;
+        QCOMPARE(m_recorder->framePeriodsToFill(startUs + i * 1000000 / 30 + jitterUs), 1);
+    }
+
+    // camera at 15 fps: one period per frame, no duplicates
+    m_recorder->m_videoFrameRate = 15;
+    m_recorder->m_firstFrameTimestampUs = -1;
+    m_recorder->m_framePeriodsFilled = 0;
+    for (int i = 0; i < 15; i++) {
+        QCOMPARE(m_recorder->framePeriodsToFill(startUs + i * 1000000 / 15), 1);
+    }
+
+    // a stalled camera: the next frame two seconds from start fills the gap
+    QCOMPARE(m_recorder->framePeriodsToFill(startUs + 2000000), 16);
+    // a frame right after the previous one has no period left
+    QCOMPARE(m_recorder->framePeriodsToFill(startUs + 2010000), 0);
+
+    m_recorder->m_videoFrameRate = Recorder::DEFAULT_FRAME_RATE;
+    m_recorder->m_firstFrameTimestampUs = -1;
+    m_recorder->m_framePeriodsFilled = 0;
+}
+
+void TestRecorder::frameWriteCount()
+{
+    const qint64 startUs = 5000000;
+    MetricsSnapshot before = Metrics::instance().snapshot();
+
+    // camera and video at 30 fps with timestamp jitter: each frame written once
+    m_recorder->m_videoFrameRate = 30;
+    m_recorder->m_frameDecimation = 1;
+    m_recorder->m_firstFrameTimestampUs = -1;
+    m_recorder->m_framePeriodsFilled = 0;
+    int frameNumber = 0;
+    for (int i = 0; i < 10; i++) {
+        qint64 jitterUs = (i % 3 - 1) * 5000;
+        QCOMPARE(m_recorder->frameWriteCount(startUs + i * 1000000 / 30 + jitterUs, frameNumber++), 1);
+    }
+    // a frame in a period that has a frame already is skipped
+    QCOMPARE(m_recorder->frameWriteCount(startUs + 9 * 1000000 / 30 + 10000, frameNumber++), 0);
+    // after a stall of almost a second, the frame fills its own period and 20 without a frame
+    QCOMPARE(m_recorder->frameWriteCount(startUs + 1000000, frameNumber++), 21);
+
+    MetricsSnapshot after = Metrics::instance().snapshot();
+    QCOMPARE(after.m_counters[Metrics::FramesSkipped] - before.m_counters[Metrics::FramesSkipped], (uint64_t)1);
+    QCOMPARE(after.m_counters[Metrics::FramesDuplicated] - before.m_counters[Metrics::FramesDuplicated], (uint64_t)20);
+
+    // every second frame of a 30 fps camera for a 15 fps video
+    before = after;
+    m_recorder->m_videoFrameRate = 15;
+    m_recorder->m_frameDecimation = 2;
+    m_recorder->m_firstFrameTimestampUs = -1;
+    m_recorder->m_framePeriodsFilled = 0;
+    for (int i = 0; i < 6; i++) {
+        QCOMPARE(m_recorder->frameWriteCount(startUs + i * 1000000 / 30, i), (i % 2 == 0) ? 1 : 0);
+    }
+    after = Metrics::instance().snapshot();
+    QCOMPARE(after.m_counters[Metrics::FramesSkipped] - before.m_counters[Metrics::FramesSkipped], (uint64_t)3);
+    QCOMPARE(after.m_counters[Metrics::FramesDuplicated] - before.m_counters[Metrics::FramesDuplicated], (uint64_t)0);
+
+    m_recorder->m_videoFrameRate = Recorder::DEFAULT_FRAME_RATE;
+    m_recorder->m_frameDecimation = 1;
+    m_recorder->m_firstFrameTimestampUs = -1;
+    m_recorder->m_framePeriodsFilled = 0;
+}
+
+void TestRecorder::videoBufferCapacity()
+{
+    cv::Size resolution(640, 480);
+    qint64 frameBytes = 640 * 480 * 3;
+
+    // five seconds of video when available memory is unknown
+    QCOMPARE(Recorder::videoBufferCapacity(25, resolution, -1), 125);
+    QCOMPARE(Recorder::videoBufferCapacity(30, resolution, -1), 150);
+    QCOMPARE(Recorder::videoBufferCapacity(7.5, resolution, -1), 38);
+    QCOMPARE(Recorder::videoBufferCapacity(30, resolution, frameBytes * 1000), 150);
+
+    // at most a quarter of available memory, but never below the minimum
+    QCOMPARE(Recorder::videoBufferCapacity(30, resolution, frameBytes * 200), 50);
+    QCOMPARE(Recorder::videoBufferCapacity(30, resolution, frameBytes * 8), 10);
+}
+
+void TestRecorder::parseMemAvailable()
+{
+    QByteArray meminfo("MemTotal:       16314440 kB\n"
+                       "MemFree:          512000 kB\n"
+                       "MemAvailable:    8123456 kB\n"
+                       "Buffers:          204800 kB\n");
+    QCOMPARE(Recorder::parseMemAvailable(meminfo), (qint64)8123456 * 1024);
+
+    // kernels before 3.14 don't have MemAvailable
+    QCOMPARE(Recorder::parseMemAvailable("MemTotal:       16314440 kB\nMemFree:          512000 kB\n"), (qint64)-1);
+    QCOMPARE(Recorder::parseMemAvailable("MemAvailable:\n"), (qint64)-1);
+    QCOMPARE(Recorder::parseMemAvailable("MemAvailable:   garbage kB\n"), (qint64)-1);
+    QCOMPARE(Recorder::parseMemAvailable(QByteArray()), (qint64)-1);
+
+#ifdef Q_OS_LINUX
+    QVERIFY(Recorder::availableMemoryBytes() > 0);
+#endif
+}
+
 QTEST_MAIN(TestRecorder)
 
 #include "testrecorder.moc"
@@ -0,0 +1,37 @@
+#-------------------------------------------------
+#
+# Background result image writer test
+#
+#-------------------------------------------------
+
+QT       += testlib
+
+QT       -= gui
+
+TARGET = testresultimagewriter
+CONFIG += console testcase
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+QMAKE_CXXFLAGS += -std=c++11
+CONFIG += c++11
+
+include(../../opencv.pri)
+
+INCLUDEPATH += ../..
+
+SOURCES += testresultimagewriter.cpp \
+    ../../croparchive.cpp \
+    ../../filesync.cpp \
+    ../../resultimagewriter.cpp \
+    ../../metrics.cpp
+HEADERS += ../../resultimagewriter.h \
+    ../../croparchive.h \
+    ../../filesync.h \
+    ../../metrics.h
+
+DEFINES += SRCDIR=\\\"$$PWD/\\\" \
+    _UNIT_TEST_
+QMAKE_CXXFLAGS += --coverage
+QMAKE_LFLAGS += --coverage
@@ -0,0 +1,146 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "resultimagewriter.h"
+#include <QString>
+#include <QTemporaryDir>
+#include <QtTest>
+#include <set>
+
+/**
+ * @brief ResultImageWriter unit test class.
+ */
+class TestResultImageWriter : public QObject
+{
+    Q_OBJECT
+
+public:
+    TestResultImageWriter();
+
+private Q_SLOTS:
+    void write_imagesWritten();
+    void write_dropsWhenFull();
+    void write_dropsWhenStopped();
+    void writeCrop_appendedToArchive();
+};
+
+TestResultImageWriter::TestResultImageWriter() {
+}
+
+void TestResultImageWriter::write_imagesWritten() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    ResultImageWriter writer(2);
+    writer.start();
+    const int imageCount = 20;
+    for (int i = 0; i < imageCount; i++) {
+        cv::Mat image(20, 30, CV_8UC3, cv::Scalar(i * 10, 0, 255));
+        QString fileName = dir.path() + QString("/image%1.png").arg(i);
+        QVERIFY(writer.write(fileName.toStdString(), image));
+        QVERIFY(image.empty());
+    }
+    cv::Mat jpegImage(20, 30, CV_8UC3, cv::Scalar(0, 0, 0));
+    QVERIFY(writer.write(QString(dir.path() + "/image.jpg").toStdString(), jpegImage));
+    writer.stop();
+
+    QCOMPARE(writer.writtenCount(), (uint64_t)imageCount + 1);
+    QCOMPARE(writer.droppedCount(), (uint64_t)0);
+    QCOMPARE(writer.failedCount(), (uint64_t)0);
+    for (int i = 0; i < imageCount; i++) {
+        QString fileName = dir.path() + QString("/image%1.png").arg(i);
+        cv::Mat image = cv::imread(fileName.toStdString());
+        QCOMPARE(image.cols, 30);
+        QCOMPARE(image.rows, 20);
+        QCOMPARE((int)image.at<cv::Vec3b>(10, 10)[0], i * 10);
+    }
+    QVERIFY(!cv::imread(QString(dir.path() + "/image.jpg").toStdString()).empty());
+}
+
+void TestResultImageWriter::write_dropsWhenFull() {
+    QTemporaryDir dir;
+    ResultImageWriter writer(1);
+    // running without workers, nothing leaves the queue
+    writer.m_running = true;
+    for (size_t i = 0; i < writer.MAX_PENDING_IMAGES; i++) {
+        cv::Mat image(4, 4, CV_8UC1, cv::Scalar(0));
+        QVERIFY(writer.write(QString(dir.path() + "/queued.png").toStdString(), image));
+    }
+    cv::Mat image(4, 4, CV_8UC1, cv::Scalar(0));
+    QVERIFY(!writer.write(QString(dir.path() + "/dropped.png").toStdString(), image));
+    QCOMPARE(writer.droppedCount(), (uint64_t)1);
+    // a dropped image stays with the caller
+    QVERIFY(!image.empty());
+
+    writer.m_running = false;
+    writer.m_jobs.clear();
+}
+
+void TestResultImageWriter::write_dropsWhenStopped() {
+    QTemporaryDir dir;
+    ResultImageWriter writer;
+    cv::Mat image(4, 4, CV_8UC1, cv::Scalar(0));
+    QVERIFY(!writer.write(QString(dir.path() + "/image.png").toStdString(), image));
+    QCOMPARE(writer.droppedCount(), (uint64_t)1);
+    QVERIFY(!QFile::exists(dir.path() + "/image.png"));
+}
+
+void TestResultImageWriter::writeCrop_appendedToArchive() {
+    QTemporaryDir dir;
+    QString archiveFileName = dir.path() + "/session.ufocrops";
+    ResultImageWriter writer(2);
+    cv::Mat image(10, 12, CV_8UC3, cv::Scalar(0, 0, 255));
+    cv::Mat mask(10, 12, CV_8UC1, cv::Scalar(255));
+    CropArchiveEntry entry;
+    entry.m_timestamp = 1000;
+    entry.m_trackId = 7;
+    entry.m_rect = cv::Rect(1, 2, 12, 10);
+    entry.m_isBright = true;
+    // no archive open
+    writer.start();
+    QVERIFY(!writer.writeCrop(entry, image, mask));
+    writer.stop();
+
+    QVERIFY(writer.openArchive(archiveFileName));
+    writer.start();
+    const int cropCount = 5;
+    for (int i = 0; i < cropCount; i++) {
+        cv::Mat crop(10, 12, CV_8UC3, cv::Scalar(0, 0, 255));
+        cv::Mat cropMask(10, 12, CV_8UC1, cv::Scalar(255));
+        entry.m_trackId = i;
+        QVERIFY(writer.writeCrop(entry, crop, cropMask));
+        QVERIFY(crop.empty());
+        QVERIFY(cropMask.empty());
+    }
+    writer.stop();
+    QCOMPARE(writer.writtenCount(), (uint64_t)cropCount);
+
+    CropArchiveReader reader;
+    QVERIFY(reader.open(archiveFileName));
+    QVERIFY(!reader.isIndexRecovered());
+    QCOMPARE(reader.count(), cropCount);
+    std::set<quint64> trackIds;
+    for (int i = 0; i < cropCount; i++) {
+        trackIds.insert(reader.entry(i).m_trackId);
+        QVERIFY(reader.maskData(i).size() > 0);
+    }
+    QCOMPARE((int)trackIds.size(), cropCount);
+}
+
+QTEST_MAIN(TestResultImageWriter)
+
+#include "testresultimagewriter.moc"
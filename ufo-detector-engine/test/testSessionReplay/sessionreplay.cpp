@@ -0,0 +1,118 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "sessionreplay.h"
+
+SessionReplay::SessionReplay(Camera* camera, Config* config, Logger* logger, DataManager* dataManager)
+{
+    m_camera = camera;
+    m_config = config;
+    m_logger = logger;
+    m_dataManager = dataManager;
+}
+
+QStringList SessionReplay::replay(const SessionReader& session, const QString& cascadeFile)
+{
+    QStringList events;
+    const QJsonObject& settings = session.settings();
+    ActualDetector detector(m_camera, m_config, m_logger, m_dataManager);
+    detector.m_cameraWidth = settings.value("cameraWidth").toInt();
+    detector.m_cameraHeight = settings.value("cameraHeight").toInt();
+    detector.setNoiseLevel(settings.value("noiseFilterPixelSize").toInt());
+    detector.setThresholdLevel(settings.value("motionThreshold").toInt());
+    detector.m_motionModelType = settings.value("motionModel").toInt();
+    detector.state->MIN_POS_REQUIRED = settings.value("minPositiveDetections").toInt();
+    if (!detector.m_brightnessThresholds.load(settings.value("brightnessThresholds").toString())) {
+        detector.m_brightnessThresholds.reset();
+    }
+    detector.m_region = session.region();
+
+    detector.m_isCascadeFound = false;
+    if (settings.value("birdClassifier").toBool()) {
+        detector.m_birdClassifier->setSynchronous(true);
+        detector.m_isCascadeFound = detector.m_birdClassifier->init(cascadeFile.toStdString(),
+                                                                    detector.CLASSIFIER_DIMENSION_SIZE);
+        if (!detector.m_isCascadeFound) {
+            events << "bird classifier file " + cascadeFile + " not found";
+        }
+    }
+    detector.m_isInNightMode = !detector.m_isCascadeFound;
+
+    std::vector<CameraFrame> initialFrames;
+    for (int i = 0; i < DetectionSession::INITIAL_FRAME_COUNT; i++) {
+        initialFrames.push_back(CameraFrame(session.frame(i)));
+    }
+    detector.initializeDetection(initialFrames);
+
+    int positives = 0;
+    int negatives = 0;
+    int frameIndex = 0;
+    QObject::connect(&detector, &ActualDetector::positiveMessage, [&positives]() { positives++; });
+    QObject::connect(&detector, &ActualDetector::negativeMessage, [&negatives]() { negatives++; });
+    QObject::connect(detector.state, &DetectorState::foundDetectionResult,
+                     [&events, &frameIndex](DetectorState::DetectionResult result) {
+        const char* names[] = {"UNKNOWN", "AIRPLANE", "BIRD", "ALL_NEGATIVE", "MIN_POSITIVE_NOT_REACHED"};
+        events << QString("%1 result=%2").arg(frameIndex).arg(names[result]);
+    });
+
+    const std::vector<std::pair<int, int> >& planeCounts = session.planeCounts();
+    unsigned int planeCountIndex = 0;
+
+    for (frameIndex = DetectionSession::INITIAL_FRAME_COUNT; frameIndex < session.frameCount(); frameIndex++) {
+        while ((planeCountIndex < planeCounts.size()) && (planeCounts[planeCountIndex].first <= frameIndex)) {
+            detector.state->numberOfPlanes = planeCounts[planeCountIndex].second;
+            planeCountIndex++;
+        }
+        cv::Mat frameData = session.frame(frameIndex);
+        if (frameData.empty()) {
+            events << QString("%1 missing frame").arg(frameIndex);
+            break;
+        }
+        CameraFrame frame(frameData);
+        positives = 0;
+        negatives = 0;
+        int changes = detector.processFrame(frame);
+
+        QStringList tracks;
+        for (unsigned int i = 0; i < detector.state->tracker.tracks.size(); i++) {
+            CTrack* track = detector.state->tracker.tracks[i].get();
+            cv::Rect rect = track->GetLastRect();
+            tracks << QString("%1@%2,%3:%4/%5/%6").arg(track->track_id)
+                      .arg(rect.x + rect.width / 2).arg(rect.y + rect.height / 2)
+                      .arg(track->posCounter).arg(track->negCounter).arg(track->birdCounter);
+        }
+        events << QString("%1 changes=%2 positives=%3 negatives=%4 recording=%5 night=%6 tracks=%7")
+                  .arg(frameIndex).arg(changes).arg(positives).arg(negatives)
+                  .arg((int)detector.m_startedRecording).arg((int)detector.m_isInNightMode)
+                  .arg(tracks.join(' '));
+    }
+    return events;
+}
+
+QString SessionReplay::firstDifference(const QStringList& expected, const QStringList& actual)
+{
+    for (int i = 0; i < qMin(expected.size(), actual.size()); i++) {
+        if (expected.at(i) != actual.at(i)) {
+            return QString("line %1: expected \"%2\", got \"%3\"").arg(i + 1).arg(expected.at(i)).arg(actual.at(i));
+        }
+    }
+    if (expected.size() != actual.size()) {
+        return QString("expected %1 lines, got %2").arg(expected.size()).arg(actual.size());
+    }
+    return QString();
+}
@@ -0,0 +1,61 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SESSIONREPLAY_H
+#define SESSIONREPLAY_H
+
+#include "actualdetector.h"
+#include "detectionsession.h"
+#include <QStringList>
+
+/**
+ * @brief Runs a recorded detection session through ActualDetector.
+ *
+ * Frames are processed one by one in the calling thread with bird classifier
+ * in synchronous mode, so the result depends only on the session. The result
+ * is an event log with one line per frame: amount of motion, positive and
+ * negative objects, recording and night state and tracks, plus a line for
+ * each detection result. Two logs are equal if the detector behaved the same.
+ */
+class SessionReplay
+{
+public:
+    SessionReplay(Camera* camera, Config* config, Logger* logger, DataManager* dataManager);
+
+    /**
+     * @brief Replay a session.
+     * @param session opened session
+     * @param cascadeFile bird classifier file used if the session was recorded with one
+     * @return event log
+     */
+    QStringList replay(const SessionReader& session, const QString& cascadeFile);
+
+    /**
+     * @brief Describe the first difference between two event logs.
+     * @return empty string if the logs are equal
+     */
+    static QString firstDifference(const QStringList& expected, const QStringList& actual);
+
+private:
+    Camera* m_camera;
+    Config* m_config;
+    Logger* m_logger;
+    DataManager* m_dataManager;
+};
+
+#endif // SESSIONREPLAY_H
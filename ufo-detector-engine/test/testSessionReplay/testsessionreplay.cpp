@@ -0,0 +1,328 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "sessionreplay.h"
+#include "config.h"
+#include "camera.h"
+#include "datamanager.h"
+#include "logger.h"
+#include "skygenerator.h"
+#include <QString>
+#include <QtTest>
+#include <QCoreApplication>
+#include <QTemporaryDir>
+#include <QJsonObject>
+#include <QFile>
+#include <QDir>
+#include <QTextStream>
+#include <thread>
+#include <vector>
+
+extern int mockConfigMotionThreshold;
+extern int mockConfigMotionModel;
+
+/**
+ * @brief Record/replay tests and regression replay of recorded sessions.
+ *
+ * The sessions in test/resources/sessions are always replayed. Sessions
+ * recorded with ufo-detector-cli --record-session are added by listing their
+ * folders in UFO_REPLAY_SESSIONS (separated by ':'). The event log of each
+ * session is compared to events.txt in the session folder, a session without
+ * events.txt fails. With UFO_REPLAY_UPDATE=1 the events of the replay are
+ * written to events.txt instead, which creates or updates the baselines.
+ * UFO_REPLAY_JOBS sets the number of sessions replayed in parallel (default 1).
+ */
+class TestSessionReplay : public QObject
+{
+    Q_OBJECT
+
+public:
+    TestSessionReplay();
+
+private:
+    Config* m_config;
+    Camera* m_camera;
+    DataManager* m_dataManager;
+    Logger* m_logger;
+
+    bool recordSyntheticSession(const QString& directory, int frameCount, uint64 seed);
+    QStringList readEvents(const QString& fileName);
+    bool writeEvents(const QString& fileName, const QStringList& events);
+
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+    void recordAndRead();
+    void replayIsDeterministic();
+    void recordedSessions();
+    void settingsHotReload();
+    void motionModelSwitch();
+};
+
+TestSessionReplay::TestSessionReplay() {
+    m_config = NULL;
+    m_camera = NULL;
+    m_dataManager = NULL;
+    m_logger = NULL;
+}
+
+void TestSessionReplay::initTestCase() {
+    m_config = new Config();
+    m_camera = new Camera(m_config->cameraIndex(), m_config->cameraWidth(), m_config->cameraHeight());
+    m_dataManager = new DataManager(m_config);
+    m_logger = new Logger();
+    m_logger->setOutputToFileEnabled(false);
+    m_logger->setOutputToStdioEnabled(false);
+}
+
+void TestSessionReplay::cleanupTestCase() {
+    delete m_logger;
+    delete m_dataManager;
+    delete m_camera;
+    delete m_config;
+}
+
+bool TestSessionReplay::recordSyntheticSession(const QString& directory, int frameCount, uint64 seed) {
+    SkyGenerator generator(cv::Size(320, 240), seed);
+    QJsonObject settings;
+    settings.insert("cameraWidth", 320);
+    settings.insert("cameraHeight", 240);
+    settings.insert("noiseFilterPixelSize", 2);
+    settings.insert("motionThreshold", 10);
+    settings.insert("motionModel", 0);
+    settings.insert("minPositiveDetections", 3);
+    settings.insert("brightnessThresholds", QString());
+    settings.insert("birdClassifier", false);
+    cv::Mat regionMask(240, 320, CV_8UC1, cv::Scalar(255));
+
+    SessionRecorder recorder;
+    if (!recorder.start(directory, settings, regionMask)) {
+        return false;
+    }
+    for (int i = 0; i < frameCount; i++) {
+        recorder.addFrame(generator.nextFrame());
+        if (i == frameCount / 2) {
+            recorder.addPlaneCount(1);
+        }
+    }
+    recorder.stop();
+    return true;
+}
+
+QStringList TestSessionReplay::readEvents(const QString& fileName) {
+    QStringList events;
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return events;
+    }
+    QTextStream stream(&file);
+    while (!stream.atEnd()) {
+        events << stream.readLine();
+    }
+    return events;
+}
+
+bool TestSessionReplay::writeEvents(const QString& fileName, const QStringList& events) {
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        return false;
+    }
+    QTextStream stream(&file);
+    foreach (const QString& event, events) {
+        stream << event << "\n";
+    }
+    return true;
+}
+
+void TestSessionReplay::recordAndRead() {
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+    QVERIFY(recordSyntheticSession(directory.path(), 10, 3));
+
+    SessionReader session;
+    QVERIFY(session.open(directory.path()));
+    QCOMPARE(session.frameCount(), 10);
+    QCOMPARE(session.settings().value("cameraWidth").toInt(), 320);
+    QCOMPARE(session.settings().value("motionThreshold").toInt(), 10);
+    QCOMPARE(session.planeCounts().size(), (size_t)1);
+    QCOMPARE(session.planeCounts()[0].first, 6);
+    QCOMPARE(session.planeCounts()[0].second, 1);
+    QVERIFY(!session.region().empty());
+
+    // frames are stored losslessly
+    SkyGenerator generator(cv::Size(320, 240), 3);
+    for (int i = 0; i < 10; i++) {
+        cv::Mat frame = session.frame(i);
+        QCOMPARE(frame.type(), CV_8UC3);
+        QCOMPARE(cv::norm(frame, generator.nextFrame(), cv::NORM_INF), 0.0);
+    }
+    QVERIFY(session.frame(10).empty());
+}
+
+void TestSessionReplay::replayIsDeterministic() {
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+    QVERIFY(recordSyntheticSession(directory.path(), 60, 5));
+    SessionReader session;
+    QVERIFY(session.open(directory.path()));
+
+    SessionReplay replay(m_camera, m_config, m_logger, m_dataManager);
+    QStringList first = replay.replay(session, QString());
+    QCOMPARE(first.size(), 60 - DetectionSession::INITIAL_FRAME_COUNT);
+    QString difference = SessionReplay::firstDifference(first, replay.replay(session, QString()));
+    QVERIFY2(difference.isEmpty(), qPrintable(difference));
+
+    // replays running at the same time must not affect each other
+    std::vector<QStringList> results(4);
+    std::vector<std::thread> threads;
+    for (unsigned int i = 0; i < results.size(); i++) {
+        threads.push_back(std::thread([&replay, &session, &results, i]() {
+            results[i] = replay.replay(session, QString());
+        }));
+    }
+    for (unsigned int i = 0; i < threads.size(); i++) {
+        threads[i].join();
+    }
+    for (unsigned int i = 0; i < results.size(); i++) {
+        difference = SessionReplay::firstDifference(first, results[i]);
+        QVERIFY2(difference.isEmpty(), qPrintable(difference));
+    }
+}
+
+void TestSessionReplay::recordedSessions() {
+    QStringList directories;
+    QDir sessionFolder(QString(SRCDIR) + "../resources/sessions");
+    foreach (const QString& name, sessionFolder.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name)) {
+        directories << sessionFolder.filePath(name);
+    }
+    QVERIFY2(!directories.isEmpty(), qPrintable("no sessions in " + sessionFolder.path()));
+    directories << QString::fromLocal8Bit(qgetenv("UFO_REPLAY_SESSIONS")).split(':', QString::SkipEmptyParts);
+    bool updateBaselines = (qgetenv("UFO_REPLAY_UPDATE") == "1");
+    int jobs = qMax(1, qgetenv("UFO_REPLAY_JOBS").toInt());
+    QString cascadeFile = QString(SRCDIR) + "../../resources/cascade.xml";
+
+    std::vector<SessionReader> sessions(directories.size());
+    for (int i = 0; i < directories.size(); i++) {
+        QVERIFY2(sessions[i].open(directories.at(i)), qPrintable("can't open session " + directories.at(i)));
+    }
+
+    std::vector<QStringList> results(sessions.size());
+    for (unsigned int start = 0; start < sessions.size(); start += jobs) {
+        std::vector<std::thread> threads;
+        for (unsigned int i = start; (i < start + jobs) && (i < sessions.size()); i++) {
+            threads.push_back(std::thread([this, &sessions, &results, &cascadeFile, i]() {
+                SessionReplay replay(m_camera, m_config, m_logger, m_dataManager);
+                results[i] = replay.replay(sessions[i], cascadeFile);
+            }));
+        }
+        for (unsigned int i = 0; i < threads.size(); i++) {
+            threads[i].join();
+        }
+    }
+
+    for (int i = 0; i < directories.size(); i++) {
+        QString eventFile = directories.at(i) + "/events.txt";
+        if (updateBaselines) {
+            QVERIFY2(writeEvents(eventFile, results[i]), qPrintable("can't write " + eventFile));
+            qWarning() << "wrote baseline" << eventFile;
+            continue;
+        }
+        QVERIFY2(QFile::exists(eventFile),
+                 qPrintable(eventFile + " missing, run with UFO_REPLAY_UPDATE=1 to create it"));
+        QString difference = SessionReplay::firstDifference(readEvents(eventFile), results[i]);
+        QVERIFY2(difference.isEmpty(), qPrintable(directories.at(i) + ": " + difference));
+    }
+}
+
+/*
+ * Settings changed while detecting reach the detector on the next frame,
+ * settings set on the detector itself are kept until the configuration changes.
+ */
+void TestSessionReplay::settingsHotReload() {
+    ActualDetector detector(m_camera, m_config, m_logger, m_dataManager);
+    QCOMPARE(detector.m_thresholdLevel, 10);
+    detector.setNoiseLevel(4);
+    detector.updateSettings();
+    QCOMPARE(detector.m_noiseLevel.cols, 4);
+
+    mockConfigMotionThreshold = 25;
+    m_config->publishSnapshot();
+    QCOMPARE(detector.m_thresholdLevel, 10);
+    detector.updateSettings();
+    QCOMPARE(detector.m_thresholdLevel, 25);
+    QCOMPARE(detector.m_noiseLevel.cols, 4);
+    QVERIFY(detector.m_configSnapshot == m_config->snapshot());
+
+    mockConfigMotionThreshold = 10;
+    m_config->publishSnapshot();
+}
+
+/*
+ * A motion model chosen while detecting starts from the latest frames, not
+ * from the frames read at initialization.
+ */
+void TestSessionReplay::motionModelSwitch() {
+    ActualDetector detector(m_camera, m_config, m_logger, m_dataManager);
+    detector.m_cameraWidth = 320;
+    detector.m_cameraHeight = 240;
+    for (int y = 0; y < 240; y++) {
+        for (int x = 0; x < 320; x++) {
+            detector.m_region.push_back(cv::Point(x, y));
+        }
+    }
+    detector.m_isCascadeFound = false;
+    detector.m_isInNightMode = true;
+
+    SkyGenerator generator(cv::Size(320, 240), 7);
+    std::vector<CameraFrame> initialFrames;
+    for (int i = 0; i < DetectionSession::INITIAL_FRAME_COUNT; i++) {
+        initialFrames.push_back(CameraFrame(generator.nextFrame()));
+    }
+    detector.initializeDetection(initialFrames);
+
+    std::vector<cv::Mat> grayFrames;
+    for (int i = 0; i < 5; i++) {
+        CameraFrame frame(generator.nextFrame());
+        grayFrames.push_back(frame.gray().clone());
+        detector.processFrame(frame);
+    }
+    QCOMPARE(cv::norm(detector.m_prevFrame, grayFrames[2], cv::NORM_INF), 0.0);
+    QCOMPARE(cv::norm(detector.m_currentFrame, grayFrames[3], cv::NORM_INF), 0.0);
+    QCOMPARE(cv::norm(detector.m_nextFrame, grayFrames[4], cv::NORM_INF), 0.0);
+
+    mockConfigMotionModel = MotionModel::Background;
+    m_config->publishSnapshot();
+    CameraFrame backgroundFrame(generator.nextFrame());
+    grayFrames.push_back(backgroundFrame.gray().clone());
+    detector.processFrame(backgroundFrame);
+    QCOMPARE(detector.m_motionModelType, (int)MotionModel::Background);
+
+    mockConfigMotionModel = MotionModel::FrameDifference;
+    m_config->publishSnapshot();
+    CameraFrame differenceFrame(generator.nextFrame());
+    grayFrames.push_back(differenceFrame.gray().clone());
+    detector.processFrame(differenceFrame);
+    FrameDifferenceMotionModel* model = dynamic_cast<FrameDifferenceMotionModel*>(detector.m_motionModel.get());
+    QVERIFY(model != NULL);
+    QCOMPARE(cv::norm(model->m_prevFrame, grayFrames[5], cv::NORM_INF), 0.0);
+    QCOMPARE(cv::norm(model->m_currentFrame, grayFrames[6], cv::NORM_INF), 0.0);
+}
+
+QTEST_MAIN(TestSessionReplay)
+
+#include "testsessionreplay.moc"
@@ -0,0 +1,35 @@
+#-------------------------------------------------
+#
+# Tracker test
+#
+#-------------------------------------------------
+
+QT       += testlib
+
+QT       -= gui
+
+TARGET = testtracker
+CONFIG += console testcase
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+QMAKE_CXXFLAGS += -std=c++11
+CONFIG += c++11
+
+include(../../opencv.pri)
+
+INCLUDEPATH += ../..
+
+SOURCES += testtracker.cpp \
+    ../../Ctracker.cpp \
+    ../../HungarianAlg.cpp \
+    ../../Kalman.cpp \
+    ../../SpatialGrid.cpp
+HEADERS += ../../Ctracker.h \
+    ../../HungarianAlg.h \
+    ../../Kalman.h \
+    ../../SpatialGrid.h
+
+DEFINES += SRCDIR=\\\"$$PWD/\\\" \
+    _UNIT_TEST_
@@ -0,0 +1,218 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Ctracker.h"
+#include <QString>
+#include <QtTest>
+#include <QTest>
+#include <random>
+
+#define TEST_DIST_THRES 60
+#define TEST_FRAME_WIDTH 320
+#define TEST_FRAME_HEIGHT 240
+
+/**
+ * @brief CTracker unit test class
+ */
+class TestTracker : public QObject
+{
+    Q_OBJECT
+
+private:
+    std::mt19937 m_random;
+
+    /**
+     * @brief Uniformly distributed value in [min, max), same on all platforms.
+     */
+    double uniform(double min, double max);
+
+    /**
+     * @brief Assignment as the tracker solved it before gating: all pairs evaluated,
+     * one dense solve, pairs farther than the distance threshold dropped afterwards.
+     * @param allInThreshold set to whether the solver picked no pair farther than the threshold
+     */
+    assignments_t denseAssignment(CTracker& tracker, const std::vector<cv::Point2d>& detections, bool& allInThreshold);
+
+private Q_SLOTS:
+    void assign_separateGroups();
+    void assign_outOfGate();
+    void assign_outOfGatePairIgnored();
+    void assign_crowdedScenesMatchDenseSolve();
+};
+
+double TestTracker::uniform(double min, double max)
+{
+    return min + (max - min) * ((double)m_random() / 4294967296.0);
+}
+
+assignments_t TestTracker::denseAssignment(CTracker& tracker, const std::vector<cv::Point2d>& detections, bool& allInThreshold)
+{
+    const size_t N = tracker.tracks.size();
+    const size_t M = detections.size();
+    distMatrix_t cost(N * M);
+    for (size_t i = 0; i < N; i++) {
+        for (size_t j = 0; j < M; j++) {
+            cost[i + j * N] = tracker.tracks[i]->CalcDist(Point_t(detections[j]));
+        }
+    }
+    assignments_t assignment;
+    AssignmentProblemSolver solver;
+    solver.Solve(cost, N, M, assignment, AssignmentProblemSolver::optimal);
+    allInThreshold = true;
+    for (size_t i = 0; i < N; i++) {
+        if ((assignment[i] != -1) && (cost[i + assignment[i] * N] > TEST_DIST_THRES)) {
+            assignment[i] = -1;
+            allInThreshold = false;
+        }
+    }
+    return assignment;
+}
+
+void TestTracker::assign_separateGroups()
+{
+    CTracker tracker(0.2f, 0.5f, TEST_DIST_THRES);
+    std::vector<cv::Point2d> detections;
+    detections.push_back(cv::Point2d(20, 20));
+    detections.push_back(cv::Point2d(30, 20));
+    detections.push_back(cv::Point2d(300, 200));
+    std::vector<cv::Rect> rects(detections.size());
+    tracker.Update(detections, rects, CTracker::CentersDist);
+    QCOMPARE(tracker.tracks.size(), (size_t)3);
+
+    // the two close objects swap order, the far one moves a bit
+    std::vector<cv::Point2d> moved;
+    moved.push_back(cv::Point2d(301, 202));
+    moved.push_back(cv::Point2d(31, 21));
+    moved.push_back(cv::Point2d(21, 19));
+    assignments_t assignment;
+    distMatrix_t assignedCost;
+    tracker.Assign(moved, rects, CTracker::CentersDist, assignment, assignedCost);
+    QCOMPARE(assignment.size(), (size_t)3);
+    QCOMPARE(assignment[0], 2);
+    QCOMPARE(assignment[1], 1);
+    QCOMPARE(assignment[2], 0);
+    QVERIFY(assignedCost[2] < 3);
+}
+
+void TestTracker::assign_outOfGate()
+{
+    CTracker tracker(0.2f, 0.5f, TEST_DIST_THRES);
+    std::vector<cv::Point2d> detections(1, cv::Point2d(20, 20));
+    std::vector<cv::Rect> rects(1);
+    tracker.Update(detections, rects, CTracker::CentersDist);
+
+    // the only detection is far outside the gate, the dense solve would have picked the pair
+    detections[0] = cv::Point2d(300, 200);
+    assignments_t assignment;
+    distMatrix_t assignedCost;
+    tracker.Assign(detections, rects, CTracker::CentersDist, assignment, assignedCost);
+    QCOMPARE(assignment.size(), (size_t)1);
+    QCOMPARE(assignment[0], -1);
+}
+
+void TestTracker::assign_outOfGatePairIgnored()
+{
+    CTracker tracker(0.2f, 0.5f, TEST_DIST_THRES);
+    std::vector<cv::Point2d> detections;
+    detections.push_back(cv::Point2d(100, 100));
+    detections.push_back(cv::Point2d(170, 100));
+    std::vector<cv::Rect> rects(detections.size());
+    tracker.Update(detections, rects, CTracker::CentersDist);
+    QCOMPARE(tracker.tracks.size(), (size_t)2);
+
+    // the second detection is in a neighbouring grid cell of track 1 but 65 px away;
+    // solved at its real cost it would pull the first detection to track 0
+    std::vector<cv::Point2d> moved;
+    moved.push_back(cv::Point2d(155, 100));
+    moved.push_back(cv::Point2d(235, 100));
+    assignments_t assignment;
+    distMatrix_t assignedCost;
+    tracker.Assign(moved, rects, CTracker::CentersDist, assignment, assignedCost);
+    QCOMPARE(assignment.size(), (size_t)2);
+    QCOMPARE(assignment[0], -1);
+    QCOMPARE(assignment[1], 0);
+    QVERIFY(assignedCost[1] < 20);
+}
+
+void TestTracker::assign_crowdedScenesMatchDenseSolve()
+{
+    const int objectCount = 60;
+    const int frameCount = 200;
+    m_random.seed(12345);
+    CTracker tracker(0.2f, 0.5f, TEST_DIST_THRES);
+    std::vector<cv::Point2d> positions;
+    std::vector<cv::Point2d> velocities;
+    for (int k = 0; k < objectCount; k++) {
+        positions.push_back(cv::Point2d(uniform(0, TEST_FRAME_WIDTH), uniform(0, TEST_FRAME_HEIGHT)));
+        velocities.push_back(cv::Point2d(uniform(-4, 4), uniform(-4, 4)));
+    }
+
+    int comparedFrames = 0;
+    int differingFrames = 0;
+    for (int frame = 0; frame < frameCount; frame++) {
+        std::vector<cv::Point2d> detections;
+        for (int k = 0; k < objectCount; k++) {
+            positions[k] += velocities[k];
+            if ((positions[k].x < 0) || (positions[k].x >= TEST_FRAME_WIDTH)) {
+                velocities[k].x = -velocities[k].x;
+            }
+            if ((positions[k].y < 0) || (positions[k].y >= TEST_FRAME_HEIGHT)) {
+                velocities[k].y = -velocities[k].y;
+            }
+            // every tenth object is missed now and then
+            if ((k % 10 != 0) || (frame % 7 != 0)) {
+                detections.push_back(positions[k] + cv::Point2d(uniform(-1, 1), uniform(-1, 1)));
+            }
+        }
+        // noise detections every third frame
+        for (int n = 0; (frame % 3 == 0) && (n < 5); n++) {
+            detections.push_back(cv::Point2d(uniform(0, TEST_FRAME_WIDTH), uniform(0, TEST_FRAME_HEIGHT)));
+        }
+        std::vector<cv::Rect> rects(detections.size());
+
+        if (!tracker.tracks.empty()) {
+            bool allInThreshold = false;
+            assignments_t dense = denseAssignment(tracker, detections, allInThreshold);
+            assignments_t gated;
+            distMatrix_t gatedCost;
+            tracker.Assign(detections, rects, CTracker::CentersDist, gated, gatedCost);
+            QCOMPARE(gated.size(), dense.size());
+            for (size_t i = 0; i < gated.size(); i++) {
+                if ((gated[i] != -1) && (gatedCost[i] > TEST_DIST_THRES)) {
+                    gated[i] = -1;
+                }
+            }
+            if (allInThreshold) {
+                // the dense optimum only uses pairs inside the gate, so the gated solve must find it
+                QVERIFY(gated == dense);
+                comparedFrames++;
+            } else if (gated != dense) {
+                // the dense solve was pulled by a pair it then dropped
+                differingFrames++;
+            }
+        }
+        tracker.Update(detections, rects, CTracker::CentersDist);
+    }
+    qDebug() << "frames compared:" << comparedFrames << "frames where the dense solve dropped a pair:"
+             << (frameCount - 1 - comparedFrames) << "of which assignments differ:" << differingFrames;
+    QVERIFY(comparedFrames >= frameCount / 4);
+}
+
+QTEST_APPLESS_MAIN(TestTracker)
+
+#include "testtracker.moc"
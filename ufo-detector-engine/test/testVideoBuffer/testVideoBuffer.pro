@@ -14,13 +14,18 @@ CONFIG -= app_bundle
 
 TEMPLATE = app
 
+QMAKE_CXXFLAGS += -std=c++11
+CONFIG += c++11
+
 include(../../opencv.pri)
 
 INCLUDEPATH += ../..
 
 SOURCES += testvideobuffer.cpp \
-    ../../videobuffer.cpp
-HEADERS += ../../videobuffer.h
+    ../../videobuffer.cpp \
+    ../../metrics.cpp
+HEADERS += ../../videobuffer.h \
+    ../../metrics.h
 
 DEFINES += SRCDIR=\\\"$$PWD/\\\" \
     _UNIT_TEST_
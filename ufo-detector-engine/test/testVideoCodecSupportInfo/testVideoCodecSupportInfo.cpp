@@ -20,6 +20,7 @@
 #include <QString>
 #include <QtTest>
 #include <QRegExp>
+#include <QTemporaryDir>
 #include <opencv2/core/core.hpp>
 #include <opencv2/highgui/highgui.hpp>
 
@@ -39,6 +40,7 @@ private Q_SLOTS:
     void testOpencvSupport();
     void testEncoderSupport();
     void initialize();  // init() would be called for each test case
+    void cachedInit();
     void isSupportedMethods();
     void codecName();
     void toFromFourcc();
@@ -51,6 +53,7 @@ private:
     QHash<int, QString> m_expectedEncoderStrings;   // expected codec strings for encoder
     QString m_videoEncoderLocation;
     QString m_testFileName;
+    QTemporaryDir m_cacheDir;   ///< keeps the user's support cache untouched
     int m_frameWidth;
     int m_frameHeight;
     bool localTestOpencvSupport(int fourcc);
@@ -78,6 +81,8 @@ void TestVideoCodecSupportInfo::initTestCase() {
     QVERIFY(encoderExecutable.exists());
     m_codecInfo = new VideoCodecSupportInfo(m_videoEncoderLocation);
     QVERIFY(NULL != m_codecInfo);
+    QVERIFY(m_cacheDir.isValid());
+    m_codecInfo->setCacheFileName(m_cacheDir.path() + "/VideoCodecSupport.ini");
     fillExpectedCodecs();
 }
 
@@ -276,6 +281,32 @@ void TestVideoCodecSupportInfo::initialize() {
     }
 }
 
+void TestVideoCodecSupportInfo::cachedInit() {
+    QString cacheFileName = m_cacheDir.path() + "/VideoCodecSupport.ini";
+    QVERIFY(QFile::exists(cacheFileName));
+
+    VideoCodecSupportInfo cached(m_videoEncoderLocation);
+    cached.setCacheFileName(cacheFileName);
+    QVERIFY(cached.loadFromCache());
+    QCOMPARE(cached.m_codecSupport, m_codecInfo->m_codecSupport);
+    QVERIFY(cached.init());
+    QCOMPARE(cached.m_codecSupport, m_codecInfo->m_codecSupport);
+
+    // other encoder executable must be tested again
+    VideoCodecSupportInfo otherEncoder("/nonexistingEncoderDir/nonexistingEncoderBin");
+    otherEncoder.setCacheFileName(cacheFileName);
+    QVERIFY(!otherEncoder.loadFromCache());
+
+    // so must be results of another cache version
+    {
+        QSettings cache(cacheFileName, QSettings::IniFormat);
+        cache.setValue("version", VideoCodecSupportInfo::CACHE_VERSION + 1);
+    }
+    VideoCodecSupportInfo otherVersion(m_videoEncoderLocation);
+    otherVersion.setCacheFileName(cacheFileName);
+    QVERIFY(!otherVersion.loadFromCache());
+}
+
 void TestVideoCodecSupportInfo::isSupportedMethods() {
     QListIterator<int> codecIt(m_expectedCodecs.keys());
 
@@ -0,0 +1,27 @@
+#-------------------------------------------------
+#
+# Shared worker pool test
+#
+#-------------------------------------------------
+
+QT       += testlib
+
+QT       -= gui
+
+TARGET = testworkerpool
+CONFIG += console testcase
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+QMAKE_CXXFLAGS += -std=c++11
+CONFIG += c++11
+
+INCLUDEPATH += ../..
+
+SOURCES += testworkerpool.cpp \
+    ../../workerpool.cpp
+HEADERS += ../../workerpool.h
+
+DEFINES += SRCDIR=\\\"$$PWD/\\\" \
+    _UNIT_TEST_
@@ -0,0 +1,179 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "workerpool.h"
+#include <QString>
+#include <QtTest>
+#include <atomic>
+#include <future>
+
+/**
+ * @brief WorkerPool unit test class.
+ */
+class TestWorkerPool : public QObject
+{
+    Q_OBJECT
+
+public:
+    TestWorkerPool();
+
+private Q_SLOTS:
+    void threadCount();
+    void run();
+    void post_allTasksRun();
+    void queue_maxConcurrency();
+    void clients_fairness();
+    void queues_fairnessWithinClient();
+};
+
+TestWorkerPool::TestWorkerPool() {
+}
+
+void TestWorkerPool::threadCount() {
+    WorkerPool pool(3);
+    QCOMPARE(pool.threadCount(), 3);
+    WorkerPool defaultPool;
+    QVERIFY(defaultPool.threadCount() >= 1);
+}
+
+void TestWorkerPool::run() {
+    WorkerPool pool(2);
+    WorkerPool::Queue* queue = pool.createQueue(pool.addClient());
+    std::thread::id caller = std::this_thread::get_id();
+    std::thread::id worker = caller;
+    int value = 0;
+    queue->run([&]() {
+        worker = std::this_thread::get_id();
+        value = 42;
+    });
+    QCOMPARE(value, 42);
+    QVERIFY(worker != caller);
+    QCOMPARE(queue->pendingCount(), (size_t)0);
+}
+
+void TestWorkerPool::post_allTasksRun() {
+    WorkerPool pool(4);
+    WorkerPool::Queue* queue = pool.createQueue(pool.addClient(), 4);
+    std::atomic<int> count(0);
+    for (int i = 0; i < 1000; i++) {
+        QVERIFY(queue->post([&count]() { count++; }));
+    }
+    queue->waitIdle();
+    QCOMPARE((int)count, 1000);
+}
+
+void TestWorkerPool::queue_maxConcurrency() {
+    WorkerPool pool(4);
+    int client = pool.addClient();
+    WorkerPool::Queue* serialQueue = pool.createQueue(client, 1);
+    WorkerPool::Queue* parallelQueue = pool.createQueue(client, 2);
+    std::atomic<int> serialRunning(0);
+    std::atomic<int> serialMax(0);
+    std::atomic<int> parallelRunning(0);
+    std::atomic<int> parallelMax(0);
+    std::vector<int> order;
+
+    for (int i = 0; i < 200; i++) {
+        serialQueue->post([&, i]() {
+            int running = ++serialRunning;
+            serialMax = std::max((int)serialMax, running);
+            order.push_back(i);
+            std::this_thread::sleep_for(std::chrono::microseconds(10));
+            serialRunning--;
+        });
+        parallelQueue->post([&]() {
+            int running = ++parallelRunning;
+            parallelMax = std::max((int)parallelMax, running);
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+            parallelRunning--;
+        });
+    }
+    serialQueue->waitIdle();
+    parallelQueue->waitIdle();
+    QCOMPARE((int)serialMax, 1);
+    QVERIFY(parallelMax <= 2);
+    // tasks of a serial queue run in order
+    QCOMPARE(order.size(), (size_t)200);
+    for (int i = 0; i < 200; i++) {
+        QCOMPARE(order[i], i);
+    }
+}
+
+/*
+ * A client with a long backlog must not delay tasks of another client.
+ * With one worker the clients must take turns.
+ */
+void TestWorkerPool::clients_fairness() {
+    WorkerPool pool(1);
+    WorkerPool::Queue* busyQueue = pool.createQueue(pool.addClient());
+    WorkerPool::Queue* quietQueue = pool.createQueue(pool.addClient());
+    std::promise<void> gate;
+    std::shared_future<void> gateOpened = gate.get_future().share();
+    std::mutex orderMutex;
+    QString order;
+
+    // keep the worker busy until all tasks are queued
+    busyQueue->post([gateOpened]() { gateOpened.wait(); });
+    for (int i = 0; i < 100; i++) {
+        busyQueue->post([&]() {
+            std::lock_guard<std::mutex> lock(orderMutex);
+            order += "b";
+        });
+    }
+    for (int i = 0; i < 10; i++) {
+        quietQueue->post([&]() {
+            std::lock_guard<std::mutex> lock(orderMutex);
+            order += "q";
+        });
+    }
+    gate.set_value();
+    busyQueue->waitIdle();
+    quietQueue->waitIdle();
+
+    QCOMPARE(order.size(), 110);
+    QCOMPARE(order.left(20), QString("qb").repeated(10));
+}
+
+void TestWorkerPool::queues_fairnessWithinClient() {
+    WorkerPool pool(1);
+    int client = pool.addClient();
+    WorkerPool::Queue* firstQueue = pool.createQueue(client);
+    WorkerPool::Queue* secondQueue = pool.createQueue(client);
+    WorkerPool::Queue* otherQueue = pool.createQueue(pool.addClient());
+    std::promise<void> gate;
+    std::shared_future<void> gateOpened = gate.get_future().share();
+    QString order;
+
+    otherQueue->post([gateOpened]() { gateOpened.wait(); });
+    for (int i = 0; i < 4; i++) {
+        firstQueue->post([&]() { order += "1"; });
+        secondQueue->post([&]() { order += "2"; });
+        otherQueue->post([&]() { order += "o"; });
+    }
+    gate.set_value();
+    firstQueue->waitIdle();
+    secondQueue->waitIdle();
+    otherQueue->waitIdle();
+
+    // the other client gets every second turn, the two queues share the rest
+    QCOMPARE(order, QString("1o2o1o2o1212"));
+}
+
+QTEST_MAIN(TestWorkerPool)
+
+#include "testworkerpool.moc"
@@ -11,7 +11,19 @@ SUBDIRS = \
     testActualDetector \
     testVideoCodecSupportInfo \
     testVideoBuffer \
-    testDataManager
+    testDataManager \
+    testBirdClassifier \
+    testBrightnessThresholds \
+    testAmbientBrightness \
+    testMotionModel \
+    testCameraFrame \
+    testMetrics \
+    testSessionReplay \
+    testWorkerPool \
+    testResultImageWriter \
+    testCropArchive \
+    testDetectionEventLog \
+    testTracker
 
 LIBS += -lgcov
 
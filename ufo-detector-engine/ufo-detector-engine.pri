@@ -9,33 +9,57 @@ win64:CONFIG += windows
 
 include(opencv.pri)
 
+# enable this to compile out hot path metrics (see metrics.h)
+#DEFINES += UFO_METRICS_DISABLED
+
 # https://bugreports.qt.io/browse/QTBUG-4329
 INCLUDEPATH += $$PWD
 
 SOURCES += $$PWD/recorder.cpp \
     $$PWD/actualdetector.cpp \
     $$PWD/camera.cpp \
+    $$PWD/cameraframe.cpp \
     $$PWD/Ctracker.cpp \
+    $$PWD/SpatialGrid.cpp \
     $$PWD/Detector.cpp \
+    $$PWD/birdclassifier.cpp \
+    $$PWD/brightnessthresholds.cpp \
+    $$PWD/ambientbrightness.cpp \
+    $$PWD/motionmodel.cpp \
     $$PWD/Kalman.cpp \
     $$PWD/HungarianAlg.cpp \
     $$PWD/config.cpp \
+    $$PWD/configsnapshot.cpp \
     $$PWD/camerainfo.cpp \
     $$PWD/videobuffer.cpp \
     $$PWD/videocodecsupportinfo.cpp \
     $$PWD/planechecker.cpp \
     $$PWD/detectorstate.cpp \
     $$PWD/datamanager.cpp \
-    $$PWD/logger.cpp
+    $$PWD/logger.cpp \
+    $$PWD/metrics.cpp \
+    $$PWD/detectionsession.cpp \
+    $$PWD/workerpool.cpp \
+    $$PWD/croparchive.cpp \
+    $$PWD/filesync.cpp \
+    $$PWD/resultimagewriter.cpp \
+    $$PWD/detectioneventlog.cpp
 
 HEADERS  += $$PWD/recorder.h \
     $$PWD/actualdetector.h \
     $$PWD/camera.h \
+    $$PWD/cameraframe.h \
     $$PWD/Ctracker.h \
+    $$PWD/SpatialGrid.h \
     $$PWD/Detector.h \
+    $$PWD/birdclassifier.h \
+    $$PWD/brightnessthresholds.h \
+    $$PWD/ambientbrightness.h \
+    $$PWD/motionmodel.h \
     $$PWD/Kalman.h \
     $$PWD/HungarianAlg.h \
     $$PWD/config.h \
+    $$PWD/configsnapshot.h \
     $$PWD/camerainfo.h \
     $$PWD/videobuffer.h \
     $$PWD/videocodecsupportinfo.h \
@@ -43,4 +67,11 @@ HEADERS  += $$PWD/recorder.h \
     $$PWD/detectorstate.h \
     $$PWD/datamanager.h \
     $$PWD/defines.h \
-    $$PWD/logger.h
+    $$PWD/logger.h \
+    $$PWD/metrics.h \
+    $$PWD/detectionsession.h \
+    $$PWD/workerpool.h \
+    $$PWD/croparchive.h \
+    $$PWD/filesync.h \
+    $$PWD/resultimagewriter.h \
+    $$PWD/detectioneventlog.h
@@ -41,6 +41,7 @@ BufferedVideoFrame* VideoBuffer::waitNextFrame() {
     }
     if (slotAcquired && !m_buffer.isEmpty()) {
         frame = m_buffer.dequeue();
+        Metrics::instance().setGauge(Metrics::VideoBufferDepth, m_buffer.size());
         m_freeSlots->release(1);
     }
     return frame;
@@ -57,6 +58,7 @@ bool VideoBuffer::pushFrame(BufferedVideoFrame* frame) {
     }
     if (slotAcquired && (m_buffer.count() < m_capacity)) {
         m_buffer.enqueue(frame);
+        Metrics::instance().setGauge(Metrics::VideoBufferDepth, m_buffer.size());
         ok = true;
         m_reservedSlots->release(1);
     }
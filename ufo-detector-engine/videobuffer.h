@@ -19,6 +19,7 @@
 #ifndef VIDEOBUFFER_H
 #define VIDEOBUFFER_H
 
+#include "metrics.h"
 #include <QObject>
 #include <QQueue>
 #include <QSemaphore>
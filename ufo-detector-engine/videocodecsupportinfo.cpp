@@ -17,12 +17,16 @@
  */
 
 #include "videocodecsupportinfo.h"
+#include <QCryptographicHash>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QDir>
+#include <QCoreApplication>
 
 VideoCodecSupportInfo::VideoCodecSupportInfo(QString externalVideoEncoderLocation, QObject* parent)
     : QObject(parent)
 {
     m_videoEncoderLocation = externalVideoEncoderLocation;
-    m_testFileName = "dummy_Wa8F7bVL3lmF4ngfD0894u32Nd.avi";
     m_isInitialized = false;
 
     m_rawVideoCodecStr = "IYUV";
@@ -46,27 +50,47 @@ bool VideoCodecSupportInfo::init() {
     if (m_isInitialized) {
         return false;
     }
-    int codec = 0;
-    QListIterator<int> codecIt(m_codecSupport.keys());
-    QList<int> encoderList;
+    if (loadFromCache()) {
+        m_isInitialized = true;
+        return true;
+    }
 
-    while (codecIt.hasNext()) {
-        codec = codecIt.next();
-        if (testOpencvSupport(codec)) {
-            encoderList = m_codecSupport.value(codec);
+    const QList<int> codecs = m_codecSupport.keys();
+    std::vector<char> opencvSupported(codecs.size(), 0);
+    std::vector<std::thread> opencvTests;
+
+    // each codec writes and reads its own test video
+    for (int i = 0; i < codecs.size(); i++) {
+        opencvTests.push_back(std::thread([this, &codecs, &opencvSupported, i]() {
+            opencvSupported[i] = testOpencvSupport(codecs.at(i));
+        }));
+    }
+    // meanwhile the encoder lists its codecs once for all of them
+    QStringList encoderOutput = queryEncoderCodecs();
+    for (unsigned int i = 0; i < opencvTests.size(); i++) {
+        opencvTests[i].join();
+    }
+
+    for (int i = 0; i < codecs.size(); i++) {
+        int codec = codecs.at(i);
+        QList<int> encoderList;
+        if (opencvSupported[i]) {
             encoderList.append(VideoCodecSupportInfo::OpenCv);
-            m_codecSupport.insert(codec, encoderList);
         }
-        if (testEncoderSupport(codec)) {
-            encoderList = m_codecSupport.value(codec);
+        if (isEncoderCodecListed(encoderOutput, codec)) {
             encoderList.append(VideoCodecSupportInfo::External);
-            m_codecSupport.insert(codec, encoderList);
         }
+        m_codecSupport.insert(codec, encoderList);
     }
+    saveToCache();
     m_isInitialized = true;
     return true;
 }
 
+void VideoCodecSupportInfo::setCacheFileName(QString fileName) {
+    m_cacheFileName = fileName;
+}
+
 bool VideoCodecSupportInfo::isInitialized() {
     return m_isInitialized;
 }
@@ -134,7 +158,8 @@ bool VideoCodecSupportInfo::testOpencvSupport(int fourcc) {
     cv::Mat frame;
     bool supported = false;
     int writtenFourcc = 0;
-    std::string testFileNameStd(m_testFileName.toLocal8Bit().data());
+    QString testFile = testFileName(fourcc);
+    std::string testFileNameStd(testFile.toLocal8Bit().data());
 
     // try opening & writing file
     try {
@@ -145,6 +170,7 @@ bool VideoCodecSupportInfo::testOpencvSupport(int fourcc) {
         return false;
     }
     if (!writer.isOpened()) {
+        QFile::remove(testFile);
         return false;
     }
     frame = cv::Mat(480, 640, CV_8UC3);
@@ -153,27 +179,33 @@ bool VideoCodecSupportInfo::testOpencvSupport(int fourcc) {
 
     // check result
     cv::VideoCapture reader;
-    if (!reader.open(testFileNameStd)) {
-        return false;
-    }
-    writtenFourcc = (int)reader.get(CV_CAP_PROP_FOURCC);
-    if (writtenFourcc == fourcc) {
-        supported = true;
+    if (reader.open(testFileNameStd)) {
+        writtenFourcc = (int)reader.get(CV_CAP_PROP_FOURCC);
+        if (writtenFourcc == fourcc) {
+            supported = true;
+        }
+        reader.release();
     }
-    QFile testFile(m_testFileName);
-    testFile.remove();
+    QFile::remove(testFile);
     return supported;
 }
 
+QString VideoCodecSupportInfo::testFileName(int fourcc) {
+    return QDir::temp().filePath(QString("ufo-codec-test-%1-%2.avi")
+                                 .arg(QCoreApplication::applicationPid()).arg(fourccToString(fourcc)));
+}
+
 bool VideoCodecSupportInfo::testEncoderSupport(int fourcc) {
+    if (m_fourccToEncoderStr.value(fourcc).isEmpty()) {
+        return false;
+    }
+    return isEncoderCodecListed(queryEncoderCodecs(), fourcc);
+}
+
+QStringList VideoCodecSupportInfo::queryEncoderCodecs() {
     QProcess encoder;
     QStringList encoderOutput;
     QStringList args;
-    QString encoderCodecStr = m_fourccToEncoderStr.value(fourcc);
-
-    if (encoderCodecStr.isEmpty()) {
-        return false;
-    }
 
     args << "-codecs";
     encoder.start(m_videoEncoderLocation, args);
@@ -181,6 +213,15 @@ bool VideoCodecSupportInfo::testEncoderSupport(int fourcc) {
     while (encoder.canReadLine()) {
         encoderOutput << encoder.readLine();
     }
+    return encoderOutput;
+}
+
+bool VideoCodecSupportInfo::isEncoderCodecListed(const QStringList& encoderOutput, int fourcc) {
+    QString encoderCodecStr = m_fourccToEncoderStr.value(fourcc);
+
+    if (encoderCodecStr.isEmpty()) {
+        return false;
+    }
     QStringListIterator listIt(encoderOutput);
     while (listIt.hasNext()) {
         QString line = listIt.next();
@@ -193,3 +234,83 @@ bool VideoCodecSupportInfo::testEncoderSupport(int fourcc) {
     return false;
 }
 
+QString VideoCodecSupportInfo::cacheKey() {
+    QFileInfo encoder(m_videoEncoderLocation);
+    QByteArray buildInformation(cv::getBuildInformation().c_str());
+    QString buildHash = QString::fromLatin1(QCryptographicHash::hash(buildInformation, QCryptographicHash::Sha1).toHex());
+    QStringList codecs;
+    QListIterator<int> codecIt(m_codecSupport.keys());
+    while (codecIt.hasNext()) {
+        codecs << fourccToString(codecIt.next());
+    }
+    qint64 encoderModified = encoder.exists() ? encoder.lastModified().toMSecsSinceEpoch() : 0;
+    return QString("opencv %1 %2; encoder %3 %4 %5 %6; codecs %7")
+            .arg(CV_VERSION).arg(buildHash)
+            .arg(m_videoEncoderLocation).arg(encoder.canonicalFilePath())
+            .arg(encoderModified).arg(encoder.size())
+            .arg(codecs.join(","));
+}
+
+bool VideoCodecSupportInfo::loadFromCache() {
+    QSettings* cache = openCache();
+    bool found = (cache->value("key").toString() == cacheKey());
+    QMap<int, QList<int> > codecSupport;
+    QListIterator<int> codecIt(m_codecSupport.keys());
+    cache->beginGroup("support");
+    while (found && codecIt.hasNext()) {
+        int codec = codecIt.next();
+        QString codecStr = fourccToString(codec);
+        found = cache->contains(codecStr);
+        QStringList encoders = cache->value(codecStr).toStringList();
+        QList<int> encoderList;
+        if (encoders.contains("opencv")) {
+            encoderList.append(VideoCodecSupportInfo::OpenCv);
+        }
+        if (encoders.contains("external")) {
+            encoderList.append(VideoCodecSupportInfo::External);
+        }
+        codecSupport.insert(codec, encoderList);
+    }
+    cache->endGroup();
+    delete cache;
+    if (!found) {
+        return false;
+    }
+    m_codecSupport = codecSupport;
+    return true;
+}
+
+void VideoCodecSupportInfo::saveToCache() {
+    QSettings* cache = openCache();
+    cache->remove("support");
+    cache->setValue("key", cacheKey());
+    cache->beginGroup("support");
+    QListIterator<int> codecIt(m_codecSupport.keys());
+    while (codecIt.hasNext()) {
+        int codec = codecIt.next();
+        QStringList encoders;
+        if (isOpencvSupported(codec)) {
+            encoders << "opencv";
+        }
+        if (isEncoderSupported(codec)) {
+            encoders << "external";
+        }
+        cache->setValue(fourccToString(codec), encoders);
+    }
+    cache->endGroup();
+    delete cache;
+}
+
+QSettings* VideoCodecSupportInfo::openCache() {
+    QSettings* cache;
+    if (m_cacheFileName.isEmpty()) {
+        cache = new QSettings(QSettings::IniFormat, QSettings::UserScope, "UFOID", "VideoCodecSupport");
+    } else {
+        cache = new QSettings(m_cacheFileName, QSettings::IniFormat);
+    }
+    if (cache->value("version").toInt() != CACHE_VERSION) {
+        cache->clear();
+        cache->setValue("version", CACHE_VERSION);
+    }
+    return cache;
+}
@@ -26,12 +26,20 @@
 #include <QFile>
 #include <QDebug>
 #include <QRegularExpression>
+#include <QSettings>
+#include <thread>
+#include <vector>
 #include <opencv2/core/core.hpp>
 #include <opencv2/highgui/highgui.hpp>
 
 /**
  * @brief Support info about video codecs.
  *
+ * Codecs are tested by writing a test video with OpenCV and by asking the
+ * external encoder for its codec list. The tests of all codecs run at the same
+ * time and the results are cached, so that they are repeated only when the
+ * OpenCV build or the encoder executable changes.
+ *
  * @see http://www.fourcc.org/codecs.php
  */
 class VideoCodecSupportInfo : public QObject
@@ -57,9 +65,16 @@ public:
 
     /**
      * @brief This method does the work for actually collecting info about supported codecs.
+     * Cached results are used if OpenCV and the external encoder haven't changed since they were tested.
      */
     bool init();
 
+    /**
+     * @brief Set support cache file. By default VideoCodecSupport.ini in the UFOID user settings folder.
+     * @param fileName INI file name
+     */
+    void setCacheFileName(QString fileName);
+
     /**
      * @brief Whether this object is initialized.
      */
@@ -128,6 +143,8 @@ public:
 #ifndef _UNIT_TEST_
 private:
 #endif
+    static const int CACHE_VERSION = 1; ///< increase when cache contents change
+
     QString m_videoEncoderLocation; ///< video encoder executable location
     bool m_isInitialized;           ///< object initialized
     /// @todo table model would be clearer. Columns: fourcc, encoderStr, codecName, encoderList
@@ -135,8 +152,8 @@ private:
     QHash<int, QString> m_fourccToEncoderStr;   ///< encoder fourcc -> encoder ID string used by encoder
     QHash<int, QString> m_fourccToCodecName;    ///< clear text name of codec (max. few words)
 
-    QString m_testFileName;     ///< file name used in support tests -- @todo must not collide with existing files
     QString m_rawVideoCodecStr; ///< raw video codec FOURCC string
+    QString m_cacheFileName;    ///< support cache file, empty = default
 
     /**
      * @brief Test whether OpenCV supports the specified codec.
@@ -145,6 +162,12 @@ private:
      */
     bool testOpencvSupport(int fourcc);
 
+    /**
+     * @brief Test file name for OpenCV support test. Each codec has its own so that codecs can be tested in parallel.
+     * @param fourcc FOURCC code for codec
+     */
+    QString testFileName(int fourcc);
+
     /**
      * @brief Test whether the video encoder supports the specified codec.
      * @param fourccStr FOURCC code for codec
@@ -152,6 +175,41 @@ private:
      */
     bool testEncoderSupport(int fourcc);
 
+    /**
+     * @brief Run the video encoder to list its codecs.
+     * @return output lines of the encoder
+     */
+    QStringList queryEncoderCodecs();
+
+    /**
+     * @brief Whether the encoder codec list has an encoder for the specified codec.
+     * @param encoderOutput output of queryEncoderCodecs()
+     * @param fourcc FOURCC code for codec
+     */
+    bool isEncoderCodecListed(const QStringList& encoderOutput, int fourcc);
+
+    /**
+     * @brief Key identifying the tested OpenCV build, encoder executable and codecs.
+     * Cached results are valid only for the same key.
+     */
+    QString cacheKey();
+
+    /**
+     * @brief Read codec support from cache.
+     * @return true if the cache has results for the current cache key
+     */
+    bool loadFromCache();
+
+    /**
+     * @brief Write codec support to cache.
+     */
+    void saveToCache();
+
+    /**
+     * @brief Open support cache.
+     */
+    QSettings* openCache();
+
 signals:
 
 public slots:
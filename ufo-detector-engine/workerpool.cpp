@@ -0,0 +1,173 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "workerpool.h"
+
+WorkerPool::WorkerPool(int threadCount)
+{
+    if (threadCount <= 0) {
+        threadCount = std::max(1, (int)std::thread::hardware_concurrency());
+    }
+    m_nextClient = 0;
+    m_running = true;
+    for (int i = 0; i < threadCount; i++) {
+        m_workers.push_back(std::unique_ptr<std::thread>(new std::thread(&WorkerPool::workerThread, this)));
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running = false;
+        for (unsigned int i = 0; i < m_queues.size(); i++) {
+            m_queues[i]->m_tasks.clear();
+        }
+        m_taskAvailable.notify_all();
+        m_taskFinished.notify_all();
+    }
+    for (unsigned int i = 0; i < m_workers.size(); i++) {
+        m_workers[i]->join();
+    }
+}
+
+int WorkerPool::addClient()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Client client;
+    client.m_nextQueue = 0;
+    m_clients.push_back(client);
+    return m_clients.size() - 1;
+}
+
+WorkerPool::Queue* WorkerPool::createQueue(int client, int maxConcurrency)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Queue* queue = new Queue(this, std::max(1, maxConcurrency));
+    m_queues.push_back(std::unique_ptr<Queue>(queue));
+    m_clients.at(client).m_queues.push_back(queue);
+    return queue;
+}
+
+int WorkerPool::threadCount() const
+{
+    return m_workers.size();
+}
+
+void WorkerPool::workerThread()
+{
+    std::function<void()> task;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (m_running) {
+        Queue* queue = takeTask(task);
+        if (!queue) {
+            m_taskAvailable.wait(lock);
+            continue;
+        }
+        lock.unlock();
+        task();
+        task = nullptr;
+        lock.lock();
+        queue->m_runningCount--;
+        m_taskFinished.notify_all();
+        if (!queue->m_tasks.empty()) {
+            // the queue may have been at its concurrency limit
+            m_taskAvailable.notify_one();
+        }
+    }
+}
+
+WorkerPool::Queue* WorkerPool::takeTask(std::function<void()>& task)
+{
+    for (size_t c = 0; c < m_clients.size(); c++) {
+        size_t clientIndex = (m_nextClient + c) % m_clients.size();
+        Client& client = m_clients[clientIndex];
+        for (size_t q = 0; q < client.m_queues.size(); q++) {
+            size_t queueIndex = (client.m_nextQueue + q) % client.m_queues.size();
+            Queue* queue = client.m_queues[queueIndex];
+            if (queue->m_tasks.empty() || (queue->m_runningCount >= queue->m_maxConcurrency)) {
+                continue;
+            }
+            task = queue->m_tasks.front();
+            queue->m_tasks.pop_front();
+            queue->m_runningCount++;
+            client.m_nextQueue = queueIndex + 1;
+            m_nextClient = clientIndex + 1;
+            return queue;
+        }
+    }
+    return NULL;
+}
+
+WorkerPool::Queue::Queue(WorkerPool* pool, int maxConcurrency)
+{
+    m_pool = pool;
+    m_maxConcurrency = maxConcurrency;
+    m_runningCount = 0;
+}
+
+bool WorkerPool::Queue::post(const std::function<void()>& task)
+{
+    std::lock_guard<std::mutex> lock(m_pool->m_mutex);
+    if (!m_pool->m_running) {
+        return false;
+    }
+    m_tasks.push_back(task);
+    m_pool->m_taskAvailable.notify_one();
+    return true;
+}
+
+void WorkerPool::Queue::run(const std::function<void()>& task)
+{
+    std::mutex doneMutex;
+    std::condition_variable doneCondition;
+    bool done = false;
+    bool posted = post([&]() {
+        task();
+        std::lock_guard<std::mutex> lock(doneMutex);
+        done = true;
+        doneCondition.notify_one();
+    });
+    if (!posted) {
+        task();
+        return;
+    }
+    std::unique_lock<std::mutex> lock(doneMutex);
+    while (!done) {
+        doneCondition.wait(lock);
+    }
+}
+
+void WorkerPool::Queue::waitIdle()
+{
+    std::unique_lock<std::mutex> lock(m_pool->m_mutex);
+    while (m_pool->m_running && (!m_tasks.empty() || (m_runningCount > 0))) {
+        m_pool->m_taskFinished.wait(lock);
+    }
+}
+
+size_t WorkerPool::Queue::pendingCount()
+{
+    std::lock_guard<std::mutex> lock(m_pool->m_mutex);
+    return m_tasks.size();
+}
+
+int WorkerPool::Queue::maxConcurrency() const
+{
+    return m_maxConcurrency;
+}
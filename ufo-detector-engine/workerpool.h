@@ -0,0 +1,151 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+/**
+ * @brief Fixed set of worker threads shared by several cameras.
+ *
+ * Work is submitted into queues. Each queue belongs to a client (one camera)
+ * and runs at most maxConcurrency tasks at a time, so e.g. a detection queue
+ * with concurrency 1 processes frames in order. Idle workers take the next
+ * task from any queue. Clients are served round robin, one task per turn,
+ * and so are the queues of a client: a camera with a long backlog gets one
+ * task for each task of the other cameras and can't starve them.
+ *
+ * Tasks should be CPU work like processing one frame. Blocking I/O such as
+ * reading the camera stays in the caller's threads.
+ */
+class WorkerPool
+{
+public:
+    class Queue;
+
+    /**
+     * @brief Start worker threads.
+     * @param threadCount number of threads, 0 = number of CPU cores
+     */
+    explicit WorkerPool(int threadCount = 0);
+
+    /**
+     * @brief Stop workers. Tasks not yet started are discarded.
+     * Stop everything that submits tasks first.
+     */
+    ~WorkerPool();
+
+    /**
+     * @brief Register a new client.
+     * @return client ID for createQueue()
+     */
+    int addClient();
+
+    /**
+     * @brief Create a queue for a client. The queue is owned by the pool.
+     * @param client ID from addClient()
+     * @param maxConcurrency max. number of tasks of the queue running at the same time
+     */
+    Queue* createQueue(int client, int maxConcurrency = 1);
+
+    /**
+     * @brief Number of worker threads.
+     */
+    int threadCount() const;
+
+#ifndef _UNIT_TEST_
+private:
+#endif
+    struct Client {
+        std::vector<Queue*> m_queues;
+        size_t m_nextQueue;     ///< queue served next
+    };
+
+    std::vector<std::unique_ptr<std::thread> > m_workers;
+    std::vector<std::unique_ptr<Queue> > m_queues;
+    std::vector<Client> m_clients;
+    size_t m_nextClient;        ///< client served next
+    std::mutex m_mutex;         ///< guards everything in the pool and its queues
+    std::condition_variable m_taskAvailable;
+    std::condition_variable m_taskFinished;
+    bool m_running;
+
+    void workerThread();
+
+    /**
+     * @brief Take the next runnable task in round robin order. Call with mutex locked.
+     * @return queue of the task, NULL if nothing is runnable
+     */
+    Queue* takeTask(std::function<void()>& task);
+};
+
+/**
+ * @brief Task queue of one client in WorkerPool.
+ */
+class WorkerPool::Queue
+{
+public:
+    /**
+     * @brief Queue a task and return immediately.
+     * @return false if the pool is stopping
+     */
+    bool post(const std::function<void()>& task);
+
+    /**
+     * @brief Queue a task and wait until it has been run.
+     * Don't call from a task of the same pool, it could wait for itself.
+     */
+    void run(const std::function<void()>& task);
+
+    /**
+     * @brief Wait until no task of the queue is queued or running.
+     */
+    void waitIdle();
+
+    /**
+     * @brief Number of tasks waiting to be run.
+     */
+    size_t pendingCount();
+
+    /**
+     * @brief Max. number of tasks running at the same time.
+     */
+    int maxConcurrency() const;
+
+#ifndef _UNIT_TEST_
+private:
+#endif
+    friend class WorkerPool;
+
+    Queue(WorkerPool* pool, int maxConcurrency);
+
+    WorkerPool* m_pool;
+    std::deque<std::function<void()> > m_tasks;
+    int m_maxConcurrency;
+    int m_runningCount;         ///< tasks being run by workers
+};
+
+#endif // WORKERPOOL_H
@@ -27,6 +27,8 @@ Console::Console(Config* config, Logger* logger, ActualDetector* detector, Camer
     m_camera = camera;
     m_dataManager = dataManager;
     m_initialized = false;
+    m_logMetricsAtExit = true;
+    connect(&m_metricsTimer, SIGNAL(timeout()), this, SLOT(logMetrics()));
 }
 
 Console::~Console() {
@@ -49,6 +51,7 @@ bool Console::init() {
     connect(m_actualDetector->getRecorder(), SIGNAL(recordingFinished()), this, SLOT(onRecordingFinished()));
     connect(m_actualDetector, SIGNAL(progressValueChanged(int)), this, SLOT(onDetectorStartProgressChanged(int)));
     connect(m_actualDetector, SIGNAL(broadcastOutputText(QString)), this, SLOT(logMessage(QString)));
+    connect(m_config, SIGNAL(settingsReloaded()), this, SLOT(onSettingsReloaded()));
 
     if (m_config->checkAirplanes()) {
         m_planeChecker = new PlaneChecker(this, m_config->coordinates());
@@ -66,6 +69,19 @@ bool Console::start() {
     return m_actualDetector->start();
 }
 
+void Console::setMetricsLogInterval(int seconds) {
+    m_logMetricsAtExit = (seconds >= 0);
+    if (seconds > 0) {
+        m_metricsTimer.start(seconds * 1000);
+    } else {
+        m_metricsTimer.stop();
+    }
+}
+
+void Console::setMessagePrefix(QString prefix) {
+    m_messagePrefix = prefix;
+}
+
 void Console::onRecordingStarted() {
 }
 
@@ -80,7 +96,7 @@ void Console::onDetectorStartProgressChanged(int progress) {
 
 void Console::logMessage(QString message) {
     if (m_logger) {
-        m_logger->print(message);
+        m_logger->print(m_messagePrefix + message);
     }
 }
 
@@ -101,5 +117,19 @@ void Console::onVideoSaved(QString filename, QString dateTime, QString length) {
 }
 
 void Console::onApplicationAboutToQuit() {
+    m_metricsTimer.stop();
     m_actualDetector->stopThread();
+    if (m_logMetricsAtExit) {
+        logMetrics();
+    }
+}
+
+void Console::onSettingsReloaded() {
+    logMessage("Settings reloaded from " + m_config->configFileName());
+    logMessage("Noise filter pixel size: " + QString::number(m_config->noiseFilterPixelSize()));
+    logMessage("Motion threshold size: " + QString::number(m_config->motionThreshold()));
+}
+
+void Console::logMetrics() {
+    logMessage("Metrics: " + Metrics::instance().snapshot().toString());
 }
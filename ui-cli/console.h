@@ -26,7 +26,9 @@
 #include "planechecker.h"
 #include "datamanager.h"
 #include "camera.h"
+#include "metrics.h"
 #include <QObject>
+#include <QTimer>
 
 /**
  * @brief Text-based user interface for UFO Detector
@@ -52,6 +54,17 @@ public:
      */
     bool start();
 
+    /**
+     * @brief Set how often metrics snapshot is written to log.
+     * @param seconds interval in seconds, 0 = only at exit, negative = never
+     */
+    void setMetricsLogInterval(int seconds);
+
+    /**
+     * @brief Set text written in front of every message, e.g. camera name.
+     */
+    void setMessagePrefix(QString prefix);
+
 #ifndef _UNIT_TEST_
 private:
 #endif
@@ -62,6 +75,9 @@ private:
     Camera* m_camera;
     DataManager* m_dataManager;
     bool m_initialized;
+    QTimer m_metricsTimer;  ///< triggers logging metrics snapshot
+    bool m_logMetricsAtExit;
+    QString m_messagePrefix;
 
 signals:
 
@@ -75,6 +91,8 @@ public slots:
     void onDetectionAreaFileReadError();
     void onVideoSaved(QString filename, QString dateTime, QString length);
     void onApplicationAboutToQuit();
+    void onSettingsReloaded();
+    void logMetrics();
 };
 
 #endif // CONSOLE_H
@@ -22,9 +22,14 @@
 #include "datamanager.h"
 #include "console.h"
 #include "logger.h"
+#include "metricsserver.h"
+#include "workerpool.h"
+#include "croparchive.h"
 #include <iostream>
 #include <QCoreApplication>
 #include <csignal>
+#include <vector>
+#include <memory>
 
 void handleTerminationSignals(int signal) {
     Q_UNUSED(signal);
@@ -67,8 +72,68 @@ int main(int argc, char *argv[])
         QCoreApplication::translate("ufo-detector-cli", "List available web camera resolutions."));
     cmdLineParser.addOption(listCameraResolutionsOption);
 
+    QCommandLineOption refreshCameraResolutionsOption("refresh-camera-resolutions",
+        QCoreApplication::translate("ufo-detector-cli", "With --list-camera-resolutions, query the camera again instead of using cached resolutions."));
+    cmdLineParser.addOption(refreshCameraResolutionsOption);
+
+    QCommandLineOption metricsIntervalOption("metrics-interval",
+        QCoreApplication::translate("ufo-detector-cli", "Log detection metrics every <seconds> seconds, 0 = only at exit."),
+        QCoreApplication::translate("ufo-detector-cli", "seconds"), "0");
+    cmdLineParser.addOption(metricsIntervalOption);
+
+    QCommandLineOption metricsPortOption("metrics-port",
+        QCoreApplication::translate("ufo-detector-cli", "Serve metrics in Prometheus format at http://localhost:<port>/metrics."),
+        QCoreApplication::translate("ufo-detector-cli", "port"));
+    cmdLineParser.addOption(metricsPortOption);
+
+    QCommandLineOption recordSessionOption("record-session",
+        QCoreApplication::translate("ufo-detector-cli", "Record camera frames and detector settings into <folder> for replaying."),
+        QCoreApplication::translate("ufo-detector-cli", "folder"));
+    cmdLineParser.addOption(recordSessionOption);
+
+    QCommandLineOption eventLogOption("event-log",
+        QCoreApplication::translate("ufo-detector-cli", "Append detection events as newline-delimited JSON to <file>."),
+        QCoreApplication::translate("ufo-detector-cli", "file"));
+    cmdLineParser.addOption(eventLogOption);
+
+    QCommandLineOption workerThreadsOption("worker-threads",
+        QCoreApplication::translate("ufo-detector-cli", "Number of worker threads shared by cameras when there are several, 0 = number of CPU cores."),
+        QCoreApplication::translate("ufo-detector-cli", "count"), "0");
+    cmdLineParser.addOption(workerThreadsOption);
+
+    QCommandLineOption extractCropsOption("extract-crops",
+        QCoreApplication::translate("ufo-detector-cli", "Extract result images, threshold masks and metadata of crop archive <file> into separate files and quit."),
+        QCoreApplication::translate("ufo-detector-cli", "file"));
+    cmdLineParser.addOption(extractCropsOption);
+
+    QCommandLineOption extractToOption("extract-to",
+        QCoreApplication::translate("ufo-detector-cli", "With --extract-crops, extract into <folder> instead of a folder named after the archive."),
+        QCoreApplication::translate("ufo-detector-cli", "folder"));
+    cmdLineParser.addOption(extractToOption);
+
     cmdLineParser.process(a);
 
+    if (cmdLineParser.isSet(extractCropsOption)) {
+        QString archiveFileName = cmdLineParser.value(extractCropsOption);
+        QFileInfo archiveInfo(archiveFileName);
+        QString directory = cmdLineParser.isSet(extractToOption) ? cmdLineParser.value(extractToOption)
+                : archiveInfo.absolutePath() + "/" + archiveInfo.completeBaseName();
+        CropArchiveReader archive;
+        if (!archive.open(archiveFileName)) {
+            std::cerr << "Can't read crop archive " << archiveFileName.toStdString() << std::endl;
+            return -1;
+        }
+        if (archive.isIndexRecovered()) {
+            std::cout << "Archive was not closed properly, recovered " << archive.count() << " crops" << std::endl;
+        }
+        if (!archive.extract(directory)) {
+            std::cerr << "Can't write into " << directory.toStdString() << std::endl;
+            return -1;
+        }
+        std::cout << "Extracted " << archive.count() << " crops into " << directory.toStdString() << std::endl;
+        return 0;
+    }
+
     bool resetConfigFile = cmdLineParser.isSet(resetConfigFileOption);
     bool resetDetectionAreaFile = cmdLineParser.isSet(resetDetectionAreaFileOption);
     bool listCameraResolutions = cmdLineParser.isSet(listCameraResolutionsOption);
@@ -105,52 +170,128 @@ int main(int argc, char *argv[])
         logger.setOutputToFileEnabled(true);
         logger.print("ufo-detector-cli starting");
 
-        DataManager dataManager(&config, &a);
+        // each camera has its own settings group when there are several
+        int cameraCount = qMax(1, config.cameraCount());
+        std::vector<std::unique_ptr<Config> > cameraConfigs;
+        std::vector<Config*> configs;
+        if (cameraCount == 1) {
+            configs.push_back(&config);
+        } else {
+            for (int slot = 0; slot < cameraCount; slot++) {
+                cameraConfigs.push_back(std::unique_ptr<Config>(new Config(NULL, slot)));
+                configs.push_back(cameraConfigs.back().get());
+            }
+        }
+
+        std::vector<std::unique_ptr<DataManager> > dataManagers;
+        for (unsigned int i = 0; i < configs.size(); i++) {
+            dataManagers.push_back(std::unique_ptr<DataManager>(new DataManager(configs[i])));
+        }
         if (resetDetectionAreaFile) {
-            if (dataManager.resetDetectionAreaFile(true)) {
-                logger.print(QCoreApplication::translate("ufo-detector-cli", "Created detection area file %1").arg(config.detectionAreaFile()));
-            } else {
-                logger.print(QCoreApplication::translate("ufo-detector-cli", "Failed to create detection area file %1").arg(config.detectionAreaFile()));
-                return -1;
+            for (unsigned int i = 0; i < configs.size(); i++) {
+                if (dataManagers[i]->resetDetectionAreaFile(true)) {
+                    logger.print(QCoreApplication::translate("ufo-detector-cli", "Created detection area file %1").arg(configs[i]->detectionAreaFile()));
+                } else {
+                    logger.print(QCoreApplication::translate("ufo-detector-cli", "Failed to create detection area file %1").arg(configs[i]->detectionAreaFile()));
+                    return -1;
+                }
             }
             if (!listCameraResolutions) {
                 return 0;
             }
         }
-        if (!dataManager.init()) {
-            logger.print(QCoreApplication::translate("ufo-detector-cli", "Problems in data manager initialization, continuing anyway"));
+        for (unsigned int i = 0; i < configs.size(); i++) {
+            if (!dataManagers[i]->init()) {
+                logger.print(QCoreApplication::translate("ufo-detector-cli", "Problems in data manager initialization, continuing anyway"));
+            }
         }
 
-        Camera camera(config.cameraIndex(), config.cameraWidth(), config.cameraHeight());
-        if (!camera.init()) {
-            logger.print(QCoreApplication::translate("ufo-detector-cli", "Couldn't initialize web camera, quitting"));
-            return -1;
+        std::vector<std::unique_ptr<Camera> > cameras;
+        for (unsigned int i = 0; i < configs.size(); i++) {
+            cameras.push_back(std::unique_ptr<Camera>(new Camera(configs[i]->cameraIndex(), configs[i]->cameraWidth(), configs[i]->cameraHeight())));
+            if (!cameras.back()->init()) {
+                logger.print(QCoreApplication::translate("ufo-detector-cli", "Couldn't initialize web camera %1, quitting").arg(configs[i]->cameraIndex()));
+                return -1;
+            }
         }
         if (listCameraResolutions) {
-            logger.print(QCoreApplication::translate("ufo-detector-cli", "Querying available web camera resolutions, this may take a while..."));
-            camera.queryAvailableResolutions();
-            if (camera.availableResolutions().size() == 0) {
-                logger.print(QCoreApplication::translate("ufo-detector-cli", "No web camera resolutions found"));
-            } else {
-                logger.print(QCoreApplication::translate("ufo-detector-cli", "Supported web camera resolutions:"));
-            }
-            QListIterator<QSize> resolutionIt(camera.availableResolutions());
-            while (resolutionIt.hasNext()) {
-                QSize resolution = resolutionIt.next();
-                logger.print(QCoreApplication::translate("ufo-detector-cli", "%1 x %2", "resolution: width x height").arg(resolution.width()).arg(resolution.height()));
+            for (unsigned int i = 0; i < cameras.size(); i++) {
+                Camera& camera = *cameras[i];
+                logger.print(QCoreApplication::translate("ufo-detector-cli", "Querying available web camera resolutions, this may take a while..."));
+                camera.queryAvailableResolutions(false, cmdLineParser.isSet(refreshCameraResolutionsOption));
+                if (camera.availableResolutions().size() == 0) {
+                    logger.print(QCoreApplication::translate("ufo-detector-cli", "No web camera resolutions found"));
+                } else {
+                    logger.print(QCoreApplication::translate("ufo-detector-cli", "Supported web camera resolutions:"));
+                }
+                QListIterator<QSize> resolutionIt(camera.availableResolutions());
+                while (resolutionIt.hasNext()) {
+                    QSize resolution = resolutionIt.next();
+                    logger.print(QCoreApplication::translate("ufo-detector-cli", "%1 x %2", "resolution: width x height").arg(resolution.width()).arg(resolution.height()));
+                }
             }
             return 0;
         }
 
-        ActualDetector actualDetector(&camera, &config, &logger, &dataManager, &a);
+        // several cameras share one set of worker threads instead of each having their own
+        std::unique_ptr<WorkerPool> workerPool;
+        if (configs.size() > 1) {
+            workerPool.reset(new WorkerPool(cmdLineParser.value(workerThreadsOption).toInt()));
+            logger.print(QCoreApplication::translate("ufo-detector-cli", "%1 cameras sharing %2 worker threads")
+                         .arg(configs.size()).arg(workerPool->threadCount()));
+        }
+
+        std::vector<std::unique_ptr<ActualDetector> > detectors;
+        std::vector<std::unique_ptr<Console> > consoles;
+        for (unsigned int i = 0; i < configs.size(); i++) {
+            detectors.push_back(std::unique_ptr<ActualDetector>(new ActualDetector(cameras[i].get(), configs[i], &logger, dataManagers[i].get())));
+            ActualDetector& actualDetector = *detectors.back();
+            QString sessionDirectory = cmdLineParser.value(recordSessionOption);
+            if (workerPool) {
+                actualDetector.setWorkerPool(workerPool.get());
+                if (!sessionDirectory.isEmpty()) {
+                    sessionDirectory += QString("/camera%1").arg(i);
+                }
+            }
+            actualDetector.setSessionRecordingDirectory(sessionDirectory);
+            QString eventLogFileName = cmdLineParser.value(eventLogOption);
+            if (workerPool && !eventLogFileName.isEmpty()) {
+                QFileInfo eventLogInfo(eventLogFileName);
+                // one file per camera, e.g. events-camera0.ndjson
+                eventLogFileName = eventLogInfo.absolutePath() + "/" + eventLogInfo.completeBaseName()
+                        + QString("-camera%1").arg(i)
+                        + (eventLogInfo.suffix().isEmpty() ? QString() : "." + eventLogInfo.suffix());
+            }
+            actualDetector.setEventLogFileName(eventLogFileName);
 
-        Console console(&config, &logger, &actualDetector, &camera, &dataManager, &a);
-        console.init();
-        a.connect(&a, SIGNAL(aboutToQuit()), &console, SLOT(onApplicationAboutToQuit()));
+            consoles.push_back(std::unique_ptr<Console>(new Console(configs[i], &logger, &actualDetector, cameras[i].get(), dataManagers[i].get())));
+            Console& console = *consoles.back();
+            if (workerPool) {
+                console.setMessagePrefix(QString("camera %1: ").arg(i));
+            }
+            console.init();
+            if (!configs[i]->setConfigFileWatched(true)) {
+                logger.print(QCoreApplication::translate("ufo-detector-cli", "Can't watch configuration file %1, settings changes need a restart").arg(configs[i]->configFileName()));
+            }
+            // metrics are for the whole process
+            console.setMetricsLogInterval((i == 0) ? cmdLineParser.value(metricsIntervalOption).toInt() : -1);
+        }
 
-        if (!console.start()) {
-            logger.print(QCoreApplication::translate("ufo-detector-cli", "Error starting Console, quitting"));
-            return -1;
+        MetricsServer metricsServer(&a);
+        if (cmdLineParser.isSet(metricsPortOption)) {
+            quint16 metricsPort = cmdLineParser.value(metricsPortOption).toUShort();
+            if (metricsServer.listen(metricsPort)) {
+                logger.print(QCoreApplication::translate("ufo-detector-cli", "Serving metrics at http://localhost:%1/metrics").arg(metricsPort));
+            } else {
+                logger.print(QCoreApplication::translate("ufo-detector-cli", "Couldn't serve metrics: %1").arg(metricsServer.errorString()));
+            }
+        }
+        for (unsigned int i = 0; i < consoles.size(); i++) {
+            a.connect(&a, SIGNAL(aboutToQuit()), consoles[i].get(), SLOT(onApplicationAboutToQuit()));
+            if (!consoles[i]->start()) {
+                logger.print(QCoreApplication::translate("ufo-detector-cli", "Error starting Console, quitting"));
+                return -1;
+            }
         }
         return a.exec();
     } catch (std::exception &e) {
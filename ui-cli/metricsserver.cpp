@@ -0,0 +1,105 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "metricsserver.h"
+
+MetricsServer::MetricsServer(QObject *parent) : QObject(parent)
+{
+    m_captureFps = 0;
+    m_detectionFps = 0;
+    connect(&m_server, SIGNAL(newConnection()), this, SLOT(onNewConnection()));
+    connect(&m_rateTimer, SIGNAL(timeout()), this, SLOT(onRateTimer()));
+}
+
+bool MetricsServer::listen(quint16 port)
+{
+    if (!m_server.listen(QHostAddress::LocalHost, port)) {
+        return false;
+    }
+    m_rateSnapshot = Metrics::instance().snapshot();
+    m_rateTimer.start(RATE_INTERVAL_MS);
+    return true;
+}
+
+QString MetricsServer::errorString()
+{
+    return m_server.errorString();
+}
+
+void MetricsServer::onNewConnection()
+{
+    while (m_server.hasPendingConnections()) {
+        QTcpSocket* socket = m_server.nextPendingConnection();
+        m_requests.insert(socket, QByteArray());
+        connect(socket, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+        connect(socket, SIGNAL(disconnected()), this, SLOT(onDisconnected()));
+    }
+}
+
+void MetricsServer::onReadyRead()
+{
+    QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
+    if (!socket || !m_requests.contains(socket)) {
+        return;
+    }
+    QByteArray& request = m_requests[socket];
+    request += socket->readAll();
+    if (!request.contains("\r\n\r\n")) {
+        if (request.size() > MAX_REQUEST_SIZE) {
+            respond(socket, "400 Bad Request", "");
+        }
+        return;
+    }
+
+    QList<QByteArray> requestLine = request.left(request.indexOf("\r\n")).split(' ');
+    if ((requestLine.size() >= 2) && (requestLine[0] == "GET")
+            && ((requestLine[1] == "/metrics") || requestLine[1].startsWith("/metrics?"))) {
+        MetricsSnapshot snapshot = Metrics::instance().snapshot();
+        respond(socket, "200 OK", snapshot.toPrometheusText(m_captureFps, m_detectionFps).toUtf8());
+    } else {
+        respond(socket, "404 Not Found", "");
+    }
+}
+
+void MetricsServer::onDisconnected()
+{
+    QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
+    if (socket) {
+        m_requests.remove(socket);
+        socket->deleteLater();
+    }
+}
+
+void MetricsServer::onRateTimer()
+{
+    MetricsSnapshot snapshot = Metrics::instance().snapshot();
+    m_captureFps = snapshot.captureFps(m_rateSnapshot);
+    m_detectionFps = snapshot.detectionFps(m_rateSnapshot);
+    m_rateSnapshot = snapshot;
+}
+
+void MetricsServer::respond(QTcpSocket* socket, const QByteArray& status, const QByteArray& body)
+{
+    QByteArray response = "HTTP/1.0 " + status + "\r\n"
+            + "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+            + "Content-Length: " + QByteArray::number(body.size()) + "\r\n"
+            + "Connection: close\r\n\r\n" + body;
+    socket->write(response);
+    m_requests.remove(socket);
+    socket->disconnectFromHost();
+}
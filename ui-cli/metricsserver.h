@@ -0,0 +1,79 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef METRICSSERVER_H
+#define METRICSSERVER_H
+
+#include "metrics.h"
+#include <QObject>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QHash>
+#include <QByteArray>
+
+/**
+ * @brief Serves engine metrics over HTTP in Prometheus text format.
+ *
+ * Listens on localhost only. "GET /metrics" returns the current metrics
+ * snapshot, other requests get 404. Everything runs in the main thread event
+ * loop and only reads metrics atomics, so the detection thread is never blocked.
+ * Frame rates are measured over complete RATE_INTERVAL_MS windows and are zero
+ * until the first window has passed.
+ */
+class MetricsServer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit MetricsServer(QObject *parent = 0);
+
+    /**
+     * @brief Start listening.
+     * @param port TCP port on localhost
+     * @return false if the port can't be listened
+     */
+    bool listen(quint16 port);
+
+    /**
+     * @brief Error message of the last failed listen().
+     */
+    QString errorString();
+
+#ifndef _UNIT_TEST_
+private:
+#endif
+    const int RATE_INTERVAL_MS = 5000;      ///< interval of snapshots for frame rates
+    const int MAX_REQUEST_SIZE = 8192;      ///< connection is closed if request header doesn't end before this
+
+    QTcpServer m_server;
+    QTimer m_rateTimer;
+    MetricsSnapshot m_rateSnapshot;         ///< snapshot at the start of the current rate window
+    double m_captureFps;                    ///< camera frame rate of the last complete window
+    double m_detectionFps;                  ///< detection frame rate of the last complete window
+    QHash<QTcpSocket*, QByteArray> m_requests;  ///< received request data by connection
+
+    void respond(QTcpSocket* socket, const QByteArray& status, const QByteArray& body);
+
+private slots:
+    void onNewConnection();
+    void onReadyRead();
+    void onDisconnected();
+    void onRateTimer();
+};
+
+#endif // METRICSSERVER_H
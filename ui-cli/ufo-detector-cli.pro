@@ -19,10 +19,12 @@ TEMPLATE = app
 include(../ufo-detector-engine/ufo-detector-engine.pri)
 
 SOURCES += main.cpp \
-    console.cpp
+    console.cpp \
+    metricsserver.cpp
 
 HEADERS += \
-    console.h
+    console.h \
+    metricsserver.h
 
 embedded {
     INSTALLS += target
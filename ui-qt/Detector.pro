@@ -33,6 +33,7 @@ SOURCES += main.cpp\
     videowidget.cpp \
     clickablelabel.cpp \
     imageexplorer.cpp \
+    imagethumbnailmodel.cpp \
     settingsdialog.cpp \
     detectionareaeditdialog.cpp \
     cameraresolutiondialog.cpp \
@@ -48,6 +49,7 @@ HEADERS  += \
     videowidget.h \
     clickablelabel.h \
     imageexplorer.h \
+    imagethumbnailmodel.h \
     settingsdialog.h \
     detectionareaeditdialog.h \
     cameraresolutiondialog.h \
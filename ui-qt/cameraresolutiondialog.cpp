@@ -51,9 +51,12 @@ void CameraResolutionDialog::on_startQueryPushButton_clicked() {
     ui->resolutionComboBox->setEnabled(true);
     ui->queryProgressBar->setEnabled(true);
 
-    m_camera->queryAvailableResolutions();
+    // checking again forgets the resolutions cached for the camera
+    bool refresh = m_camera->availableResolutions().size() > 0;
+    m_camera->queryAvailableResolutions(false, refresh);
 
     updateResolutionComboBox();
+    ui->startQueryPushButton->setText(tr("Check &again"));
 }
 
 void CameraResolutionDialog::on_resolutionComboBox_currentIndexChanged(int index) {
@@ -72,6 +75,7 @@ void CameraResolutionDialog::updateResolutionComboBox() {
     QSize currentResolution(m_config->cameraWidth(), m_config->cameraHeight());
     QListIterator<QSize> resolutionListIt(m_camera->availableResolutions());
 
+    ui->resolutionComboBox->clear();
     while (resolutionListIt.hasNext()) {
         QSize resolution = resolutionListIt.next();
         QString itemStr = QString::number(resolution.width()) + " x " + QString::number(resolution.height());
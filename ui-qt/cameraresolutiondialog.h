@@ -30,8 +30,6 @@ class CameraResolutionDialog;
 
 /**
  * @brief Dialog for querying supported resolutions from camera
- *
- * @todo use cache so that don't need to query again when dialog is reopened; need to check camera is the same
  */
 class CameraResolutionDialog : public QDialog
 {
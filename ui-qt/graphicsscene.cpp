@@ -177,9 +177,8 @@ void GraphicsScene::clearPolygon()
 }
 
 bool GraphicsScene::takePicture() {
-    Mat src;
-    src = m_camera->getWebcamFrame();
-    cv::cvtColor(src, src, CV_BGR2RGB);
+    // the frame is shared with the detector, don't convert it in place
+    Mat src = m_camera->getCameraFrame().rgb();
     QImage imgToDisplay = QImage((uchar*)src.data, src.cols, src.rows, src.step, QImage::Format_RGB888);
     if (items().contains((QGraphicsItem*)m_picture)) {
         removeItem((QGraphicsItem*)m_picture);
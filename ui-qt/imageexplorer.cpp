@@ -18,9 +18,10 @@
 
 #include "imageexplorer.h"
 #include "ui_imageexplorer.h"
-#include <QListWidget>
 #include <QDir>
-#include <QIcon>
+#include <QFileInfo>
+#include <QScrollBar>
+#include <QTimer>
 #include <QDebug>
 #include <QtNetwork/QNetworkRequest>
 #include <QDesktopServices>
@@ -37,21 +38,13 @@ ImageExplorer::ImageExplorer(QWidget *parent, Config *config) :
     }
     else ui->labelFolder->setText(tr("Activate the saving of images in the settings"));
 
-    QDir dir(mainDir);
-    dir.setFilter(QDir::Dirs | QDir::Hidden | QDir::NoSymLinks);
-    dir.setSorting(QDir::LocaleAware);
-
-
-    QStringList list = dir.entryList();
-    for (int i = 0; i < list.size(); ++i)
-	{
-        if(list.at(i)!="." && list.at(i)!="..")
-		{
-            ui->listWidget->addItem(new QListWidgetItem(list.at(i)));
-        }
-    }
+    m_folderModel = new QStringListModel(this);
+    m_imageModel = new ImageThumbnailModel(70, this);
+    updateFolderList();
+    setListModel(m_folderModel);
 
-    connect(ui->listWidget,SIGNAL(clicked(QModelIndex)),this,SLOT(displayFolder(QModelIndex)));
+    connect(ui->listView,SIGNAL(clicked(QModelIndex)),this,SLOT(displayFolder(QModelIndex)));
+    connect(ui->listView->verticalScrollBar(),SIGNAL(valueChanged(int)),this,SLOT(updateVisibleRows()));
     manager = new QNetworkAccessManager(this);
 
     this->setFixedSize(611,631);
@@ -60,32 +53,89 @@ ImageExplorer::ImageExplorer(QWidget *parent, Config *config) :
 
 void ImageExplorer::displayFolder(QModelIndex index)
 {
-    disconnect(ui->listWidget,SIGNAL(clicked(QModelIndex)),this,SLOT(displayFolder(QModelIndex)));
+    disconnect(ui->listView,SIGNAL(clicked(QModelIndex)),this,SLOT(displayFolder(QModelIndex)));
 
-    folderName = ui->listWidget->item(index.row())->text();
+    QString entryName = index.data().toString();
+    bool isArchive = CropArchive::isArchiveFileName(entryName);
+    // crops in an archive are uploaded as if they were in a folder named after the session
+    folderName = isArchive ? QFileInfo(entryName).completeBaseName() : entryName;
     currentDir = mainDir+"/"+folderName+"/";
-    ui->labelFolder->setText(currentDir);
+    ui->labelFolder->setText(isArchive ? mainDir+"/"+entryName : currentDir);
+
+    ui->listView->setViewMode(QListView::IconMode);
+    ui->listView->setResizeMode(QListView::Adjust);
+    ui->listView->setIconSize(QSize(70,70));
+    ui->listView->setSelectionMode(QListView::MultiSelection);
+    ui->listView->setMovement(QListView::Static);
+    // otherwise the layout asks every item for its size, and so for its thumbnail
+    ui->listView->setUniformItemSizes(true);
+    ui->listView->setLayoutMode(QListView::Batched);
+
+    // only file names or the archive index are read here, thumbnails are decoded when shown
+    if (isArchive)
+	{
+        if (!m_imageModel->setArchive(mainDir+"/"+entryName))
+		{
+            ui->output->append(tr("ERROR cannot read %1").arg(entryName));
+        }
+    }
+    else m_imageModel->setFolder(currentDir);
+    setListModel(m_imageModel);
+    QTimer::singleShot(0, this, SLOT(updateVisibleRows()));
+}
 
-    ui->listWidget->clear();
-    ui->listWidget->setViewMode(QListWidget::IconMode);
-    ui->listWidget->setResizeMode(QListWidget::Adjust);
-    ui->listWidget->setIconSize(QSize(70,70));
-    ui->listWidget->setSelectionMode(QListWidget::MultiSelection);
-    ui->listWidget->setMovement(QListWidget::Static);
+void ImageExplorer::updateVisibleRows()
+{
+    if (ui->listView->model() != m_imageModel)
+	{
+        return;
+    }
+    // items are laid out in row order, so stop after the first row below the view
+    QRect viewRect = ui->listView->viewport()->rect();
+    int firstRow = -1;
+    int lastRow = -1;
+    for (int row = 0; row < m_imageModel->rowCount(); ++row)
+	{
+        QRect itemRect = ui->listView->visualRect(m_imageModel->index(row));
+        if (itemRect.intersects(viewRect))
+		{
+            if (firstRow < 0) firstRow = row;
+            lastRow = row;
+        }
+        else if (itemRect.top() > viewRect.bottom()) break;
+    }
+    if (firstRow >= 0)
+	{
+        m_imageModel->setVisibleRows(firstRow, lastRow);
+    }
+}
 
-    QDir dir(currentDir);
-    dir.setFilter(QDir::Files | QDir::Hidden | QDir::NoSymLinks);
+void ImageExplorer::updateFolderList()
+{
+    // older sessions have a folder of images, newer ones a crop archive
+    QDir dir(mainDir);
+    dir.setFilter(QDir::AllDirs | QDir::Files | QDir::Hidden | QDir::NoSymLinks);
+    dir.setNameFilters(QStringList() << QString("*.") + CropArchive::FILE_SUFFIX);
     dir.setSorting(QDir::LocaleAware);
-    dir.setNameFilters(QStringList()<<"*.jpg");
 
-    QFileInfoList list = dir.entryInfoList();
+    QStringList folders;
+    QStringList list = dir.entryList();
     for (int i = 0; i < list.size(); ++i)
 	{
-        QFileInfo fileInfo = list.at(i);
-        QIcon image(fileInfo.absoluteFilePath());
-        ui->listWidget->addItem(new QListWidgetItem(image,fileInfo.fileName()));
+        if(list.at(i)!="." && list.at(i)!="..")
+		{
+            folders << list.at(i);
+        }
     }
+    m_folderModel->setStringList(folders);
+}
 
+void ImageExplorer::setListModel(QAbstractItemModel* model)
+{
+    // the view doesn't delete the selection model of the previous model
+    QItemSelectionModel* oldSelectionModel = ui->listView->selectionModel();
+    ui->listView->setModel(model);
+    delete oldSelectionModel;
 }
 
 void ImageExplorer::uploadFinish(QNetworkReply* r)
@@ -114,21 +164,20 @@ void ImageExplorer::openedPHP()
     disconnect(manager, SIGNAL(finished(QNetworkReply*)), this, SLOT(openedPHP()));
     connect(manager, SIGNAL(finished(QNetworkReply*)), this, SLOT(uploadFinish(QNetworkReply*)));
     ui->output->append(tr("Upload started"));
-    QList<QListWidgetItem*> list = ui->listWidget->selectedItems();
+    QModelIndexList list = ui->listView->selectionModel()->selectedIndexes();
 
     for (int i = 0; i < list.size(); ++i)
 	{
-        QString fileToUpload = currentDir + list.at(i)->text();
+        QString fileToUpload = currentDir + list.at(i).data().toString();
         fileList.push(fileToUpload);
-        QFile file(fileToUpload);
+        QByteArray data = m_imageModel->imageData(list.at(i).row());
         QString folderToUpload = fileToUpload.remove(0,mainDir.size());
         QUrl url("ftp://ufoid.net/" + folderToUpload);
         url.setUserName("imagesaccount");
         url.setPassword("password");
 
-        if (file.open(QIODevice::ReadOnly))
+        if (!data.isEmpty())
 		{
-            QByteArray data = file.readAll();
             QNetworkReply *reply =  manager->put(QNetworkRequest(url), data);
             connect(reply, SIGNAL(error(QNetworkReply::NetworkError)), this, SLOT(uploadError(QNetworkReply::NetworkError)));
         }
@@ -139,29 +188,20 @@ void ImageExplorer::openedPHP()
 void ImageExplorer::on_buttonBack_clicked()
 {
     ui->labelFolder->setText(mainDir);
-    ui->listWidget->clear();
-    ui->listWidget->setViewMode(QListWidget::ListMode);
-    ui->listWidget->setSelectionMode(QListWidget::SingleSelection);
-
-    QDir dir(mainDir);
-    dir.setFilter(QDir::Dirs | QDir::Hidden | QDir::NoSymLinks);
-    dir.setSorting(QDir::LocaleAware);
+    ui->listView->setViewMode(QListView::ListMode);
+    ui->listView->setSelectionMode(QListView::SingleSelection);
+    ui->listView->setUniformItemSizes(false);
+    ui->listView->setLayoutMode(QListView::SinglePass);
 
-    QStringList list = dir.entryList();
-    for (int i = 0; i < list.size(); ++i)
-	{
-        if(list.at(i)!="." && list.at(i)!="..")
-		{
-            ui->listWidget->addItem(new QListWidgetItem(list.at(i)));
-        }
-    }
-    connect(ui->listWidget,SIGNAL(clicked(QModelIndex)),this,SLOT(displayFolder(QModelIndex)));
+    updateFolderList();
+    setListModel(m_folderModel);
+    connect(ui->listView,SIGNAL(clicked(QModelIndex)),this,SLOT(displayFolder(QModelIndex)));
 
 }
 
 void ImageExplorer::on_buttonUpload_clicked()
 {
-    if(ui->listWidget->selectedItems().size())
+    if(ui->listView->selectionModel()->hasSelection())
 	{
         disconnect(manager, SIGNAL(finished(QNetworkReply*)), this, SLOT(uploadFinish(QNetworkReply*)));
         connect(manager, SIGNAL(finished(QNetworkReply*)), this, SLOT(openedPHP()) );
@@ -181,7 +221,7 @@ void ImageExplorer::on_commandLinkButton_clicked()
 
 void ImageExplorer::on_buttonClear_clicked()
 {
-    ui->listWidget->clearSelection();
+    ui->listView->clearSelection();
 }
 
 ImageExplorer::~ImageExplorer()
@@ -20,8 +20,10 @@
 #define IMAGEEXPLORER_H
 
 #include "config.h"
+#include "imagethumbnailmodel.h"
 #include <QDialog>
 #include <QModelIndex>
+#include <QStringListModel>
 #include <QtNetwork/QNetworkReply>
 #include <QtNetwork/QNetworkAccessManager>
 #include <stack>
@@ -50,6 +52,18 @@ private:
     QString folderName;
     std::stack<QString> fileList;
     QNetworkAccessManager* manager;
+    QStringListModel* m_folderModel;        ///< result image folders and crop archives
+    ImageThumbnailModel* m_imageModel;      ///< images of the folder or archive being shown
+
+    /**
+     * @brief List result image folders and crop archives in folder model.
+     */
+    void updateFolderList();
+
+    /**
+     * @brief Show a model in the list view.
+     */
+    void setListModel(QAbstractItemModel* model);
 
 private slots:
     void on_buttonClear_clicked();
@@ -60,6 +74,11 @@ private slots:
     void uploadError(QNetworkReply::NetworkError state);
     void openedPHP();
     void on_commandLinkButton_clicked();
+
+    /**
+     * @brief Tell the image model which rows are visible so that their thumbnails are decoded first.
+     */
+    void updateVisibleRows();
 };
 
 #endif // IMAGEEXPLORER_H
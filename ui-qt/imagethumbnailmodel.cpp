@@ -0,0 +1,273 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "imagethumbnailmodel.h"
+#include <QImageReader>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QBuffer>
+#include <climits>
+
+ImageThumbnailModel::ImageThumbnailModel(int thumbnailSize, QObject *parent) : QAbstractListModel(parent)
+{
+    m_thumbnailSize = thumbnailSize;
+    m_thumbnails.setMaxCost(MEMORY_CACHE_BYTES);
+    m_generation = 0;
+    m_firstWantedRow = 0;
+    m_lastWantedRow = -1;
+
+    m_diskCacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/thumbnails";
+    QDir().mkpath(m_diskCacheDir);
+
+    m_placeholder = QPixmap(thumbnailSize, thumbnailSize);
+    m_placeholder.fill(Qt::transparent);
+
+    // leave the other cores for detection
+    int threadCount = std::max(1, (int)std::thread::hardware_concurrency() / 2);
+    m_workerPool.reset(new WorkerPool(threadCount));
+    m_decodingQueue = m_workerPool->createQueue(m_workerPool->addClient(), threadCount);
+}
+
+ImageThumbnailModel::~ImageThumbnailModel()
+{
+    m_generation++;
+    m_workerPool.reset();
+}
+
+void ImageThumbnailModel::setFolder(QString folder)
+{
+    beginResetModel();
+    clear();
+
+    QDir dir(folder);
+    dir.setFilter(QDir::Files | QDir::Hidden | QDir::NoSymLinks);
+    dir.setSorting(QDir::LocaleAware);
+    dir.setNameFilters(QStringList() << "*.jpg");
+    m_files = dir.entryInfoList();
+    endResetModel();
+}
+
+bool ImageThumbnailModel::setArchive(QString fileName)
+{
+    beginResetModel();
+    clear();
+    // tasks of the previous archive keep their own reference to it
+    std::shared_ptr<CropArchiveReader> archive(new CropArchiveReader());
+    bool opened = archive->open(fileName);
+    if (opened) {
+        m_archive = archive;
+    }
+    endResetModel();
+    return opened;
+}
+
+void ImageThumbnailModel::clear()
+{
+    m_generation++;
+    m_requested.clear();
+    m_failed.clear();
+    m_files.clear();
+    m_archive.reset();
+    // until the view tells which rows are visible
+    m_firstWantedRow = 0;
+    m_lastWantedRow = INT_MAX;
+}
+
+QString ImageThumbnailModel::filePath(int row) const
+{
+    if ((row < 0) || (row >= m_files.size())) {
+        return QString();
+    }
+    return m_files.at(row).absoluteFilePath();
+}
+
+QByteArray ImageThumbnailModel::imageData(int row) const
+{
+    if ((row < 0) || (row >= rowCount())) {
+        return QByteArray();
+    }
+    if (m_archive) {
+        // deep copy, the mapping goes away with the archive
+        QByteArray mapped = m_archive->imageData(row);
+        return QByteArray(mapped.constData(), mapped.size());
+    }
+    QFile file(m_files.at(row).absoluteFilePath());
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QByteArray();
+    }
+    return file.readAll();
+}
+
+QString ImageThumbnailModel::imageKey(int row) const
+{
+    if (m_archive) {
+        return m_archive->fileName() + "#" + QString::number(row);
+    }
+    return m_files.at(row).absoluteFilePath();
+}
+
+void ImageThumbnailModel::setVisibleRows(int firstRow, int lastRow)
+{
+    m_firstWantedRow = std::max(0, firstRow - PREFETCH_ROWS);
+    m_lastWantedRow = std::min(rowCount() - 1, lastRow + PREFETCH_ROWS);
+
+    // visible rows first, then the rows in scrolling direction
+    for (int row = firstRow; row <= lastRow; row++) {
+        requestThumbnail(row);
+    }
+    for (int row = lastRow + 1; row <= m_lastWantedRow; row++) {
+        requestThumbnail(row);
+    }
+    for (int row = firstRow - 1; row >= m_firstWantedRow; row--) {
+        requestThumbnail(row);
+    }
+}
+
+int ImageThumbnailModel::rowCount(const QModelIndex& parent) const
+{
+    if (parent.isValid()) {
+        return 0;
+    }
+    return m_archive ? m_archive->count() : m_files.size();
+}
+
+QVariant ImageThumbnailModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || (index.row() >= rowCount())) {
+        return QVariant();
+    }
+    if (role == Qt::DisplayRole) {
+        if (m_archive) {
+            return CropArchiveReader::imageFileName(index.row());
+        }
+        return m_files.at(index.row()).fileName();
+    }
+    if (role == Qt::DecorationRole) {
+        QPixmap* thumbnail = m_thumbnails.object(imageKey(index.row()));
+        if (thumbnail) {
+            return *thumbnail;
+        }
+        // views ask only for the rows they show
+        const_cast<ImageThumbnailModel*>(this)->requestThumbnail(index.row());
+        return m_placeholder;
+    }
+    return QVariant();
+}
+
+void ImageThumbnailModel::requestThumbnail(int row)
+{
+    if ((row < 0) || (row >= rowCount())) {
+        return;
+    }
+    QString key = imageKey(row);
+    if (m_thumbnails.contains(key) || m_requested.contains(key) || m_failed.contains(key)) {
+        return;
+    }
+    m_requested.insert(key);
+    if (m_archive) {
+        m_decodingQueue->post(std::bind(&ImageThumbnailModel::loadArchiveThumbnail, this,
+                                        (int)m_generation, row, key, m_archive));
+        return;
+    }
+    m_decodingQueue->post(std::bind(&ImageThumbnailModel::loadThumbnail, this,
+                                    (int)m_generation, row, key, diskCacheFileName(m_files.at(row))));
+}
+
+void ImageThumbnailModel::loadThumbnail(int generation, int row, QString filePath, QString cacheFileName)
+{
+    QImage thumbnail;
+    bool skipped = isSkipped(generation, row);
+
+    if (!skipped && QFile::exists(cacheFileName)) {
+        thumbnail.load(cacheFileName);
+    }
+    if (!skipped && thumbnail.isNull()) {
+        QImageReader reader(filePath);
+        thumbnail = readThumbnail(reader);
+        if (!thumbnail.isNull()) {
+            thumbnail.save(cacheFileName, "PNG");
+        }
+    }
+    QMetaObject::invokeMethod(this, "onThumbnailLoaded", Qt::QueuedConnection,
+                              Q_ARG(int, generation), Q_ARG(int, row), Q_ARG(QString, filePath),
+                              Q_ARG(QImage, thumbnail), Q_ARG(bool, skipped));
+}
+
+void ImageThumbnailModel::loadArchiveThumbnail(int generation, int row, QString key, std::shared_ptr<CropArchiveReader> archive)
+{
+    QImage thumbnail;
+    bool skipped = isSkipped(generation, row);
+
+    if (!skipped) {
+        // decoded straight from the mapped file
+        QByteArray data = archive->imageData(row);
+        QBuffer buffer(&data);
+        buffer.open(QIODevice::ReadOnly);
+        QImageReader reader(&buffer, "JPG");
+        thumbnail = readThumbnail(reader);
+    }
+    QMetaObject::invokeMethod(this, "onThumbnailLoaded", Qt::QueuedConnection,
+                              Q_ARG(int, generation), Q_ARG(int, row), Q_ARG(QString, key),
+                              Q_ARG(QImage, thumbnail), Q_ARG(bool, skipped));
+}
+
+bool ImageThumbnailModel::isSkipped(int generation, int row) const
+{
+    return (generation != m_generation) || (row < m_firstWantedRow) || (row > m_lastWantedRow);
+}
+
+QImage ImageThumbnailModel::readThumbnail(QImageReader& reader) const
+{
+    QSize size = reader.size();
+    if (size.isValid() && ((size.width() > m_thumbnailSize) || (size.height() > m_thumbnailSize))) {
+        // the JPEG reader decodes at a fraction of the full size directly
+        size.scale(m_thumbnailSize, m_thumbnailSize, Qt::KeepAspectRatio);
+        reader.setScaledSize(size);
+    }
+    return reader.read();
+}
+
+QString ImageThumbnailModel::diskCacheFileName(const QFileInfo& file) const
+{
+    QString key = QString("%1 %2 %3 %4").arg(file.absoluteFilePath())
+            .arg(file.lastModified().toMSecsSinceEpoch()).arg(file.size()).arg(m_thumbnailSize);
+    QByteArray hash = QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1);
+    return m_diskCacheDir + "/" + QString::fromLatin1(hash.toHex()) + ".png";
+}
+
+void ImageThumbnailModel::onThumbnailLoaded(int generation, int row, QString key, QImage thumbnail, bool skipped)
+{
+    if (generation != m_generation) {
+        return;
+    }
+    m_requested.remove(key);
+    if (skipped) {
+        return;
+    }
+    if (thumbnail.isNull()) {
+        m_failed.insert(key);
+        return;
+    }
+    int cost = thumbnail.width() * thumbnail.height() * 4;
+    m_thumbnails.insert(key, new QPixmap(QPixmap::fromImage(thumbnail)), cost);
+    QModelIndex changed = index(row);
+    emit dataChanged(changed, changed, QVector<int>() << Qt::DecorationRole);
+}
@@ -0,0 +1,175 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IMAGETHUMBNAILMODEL_H
+#define IMAGETHUMBNAILMODEL_H
+
+#include "workerpool.h"
+#include "croparchive.h"
+#include <QAbstractListModel>
+#include <QFileInfo>
+#include <QPixmap>
+#include <QImage>
+#include <QImageReader>
+#include <QCache>
+#include <QSet>
+#include <atomic>
+#include <memory>
+
+/**
+ * @brief List model of the JPEG images in a folder or crop archive, with thumbnails as decoration.
+ *
+ * Listing a folder only reads the file names, and a crop archive is only
+ * mapped into memory and its index read. Thumbnails are decoded on a
+ * worker pool when a view asks for them, and for the rows around the visible
+ * ones given with setVisibleRows(). JPEG images are decoded directly at
+ * thumbnail size, which is much faster than decoding the full image.
+ *
+ * Thumbnails of folder images are stored in a disk cache, keyed by image path,
+ * modification time and size. Archive crops are small enough to be decoded
+ * again. All thumbnails are kept in memory in a cache of limited size
+ * that drops the least recently used thumbnails first.
+ */
+class ImageThumbnailModel : public QAbstractListModel
+{
+    Q_OBJECT
+public:
+    /**
+     * @brief Constructor.
+     * @param thumbnailSize max. width and height of thumbnails
+     * @param parent
+     */
+    explicit ImageThumbnailModel(int thumbnailSize, QObject *parent = 0);
+
+    /**
+     * @brief Wait for running thumbnail decoding. Queued decoding is discarded.
+     */
+    ~ImageThumbnailModel();
+
+    /**
+     * @brief List JPEG images of a folder. Thumbnails are decoded later.
+     * @param folder folder path
+     */
+    void setFolder(QString folder);
+
+    /**
+     * @brief List crops of a crop archive. Thumbnails are decoded later.
+     * @param fileName archive file name
+     * @return false if the archive can't be read, the model is then empty
+     */
+    bool setArchive(QString fileName);
+
+    /**
+     * @brief Absolute file path of the image on a row, empty for crops of an archive.
+     */
+    QString filePath(int row) const;
+
+    /**
+     * @brief Encoded image on a row, read from its file or copied from the archive.
+     */
+    QByteArray imageData(int row) const;
+
+    /**
+     * @brief Tell which rows are visible. Thumbnails are decoded for them and
+     * PREFETCH_ROWS rows around them; queued decoding of other rows is skipped.
+     * @param firstRow first visible row
+     * @param lastRow last visible row
+     */
+    void setVisibleRows(int firstRow, int lastRow);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const;
+
+#ifndef _UNIT_TEST_
+private:
+#endif
+    static const int PREFETCH_ROWS = 40;            ///< rows decoded before and after the visible rows
+    static const int MEMORY_CACHE_BYTES = 32 << 20; ///< max. size of thumbnails kept in memory
+
+    int m_thumbnailSize;
+    QString m_diskCacheDir;         ///< folder of thumbnail files
+    QFileInfoList m_files;          ///< images of current folder
+    std::shared_ptr<CropArchiveReader> m_archive;   ///< current archive, shared with decoding tasks
+    mutable QCache<QString, QPixmap> m_thumbnails;  ///< least recently used thumbnails by image key
+    QSet<QString> m_requested;      ///< thumbnails queued or being decoded
+    QSet<QString> m_failed;         ///< images that couldn't be decoded
+    QPixmap m_placeholder;          ///< shown until the thumbnail is ready
+    std::atomic<int> m_generation;  ///< increased when folder or archive changes, older tasks are skipped
+    std::atomic<int> m_firstWantedRow;
+    std::atomic<int> m_lastWantedRow;
+    std::unique_ptr<WorkerPool> m_workerPool;
+    WorkerPool::Queue* m_decodingQueue;
+
+    /**
+     * @brief Forget images and thumbnail requests of the previous folder or archive.
+     */
+    void clear();
+
+    /**
+     * @brief Key of the image on a row in the thumbnail caches: file path, or archive file name and row.
+     */
+    QString imageKey(int row) const;
+
+    /**
+     * @brief Queue thumbnail decoding of a row unless it's cached, queued or failed.
+     */
+    void requestThumbnail(int row);
+
+    /**
+     * @brief Worker task: read a thumbnail from disk cache or decode it from the image.
+     * Skipped if the folder changed or the row scrolled out of the wanted rows.
+     */
+    void loadThumbnail(int generation, int row, QString filePath, QString cacheFileName);
+
+    /**
+     * @brief Worker task: decode a thumbnail of an archive crop from the memory mapping.
+     */
+    void loadArchiveThumbnail(int generation, int row, QString key, std::shared_ptr<CropArchiveReader> archive);
+
+    /**
+     * @brief Whether a task for a row is outdated.
+     */
+    bool isSkipped(int generation, int row) const;
+
+    /**
+     * @brief Decode an image at thumbnail size.
+     */
+    QImage readThumbnail(QImageReader& reader) const;
+
+    /**
+     * @brief Thumbnail file name in disk cache.
+     */
+    QString diskCacheFileName(const QFileInfo& file) const;
+
+#ifndef _UNIT_TEST_
+private slots:
+#else
+public slots:
+#endif
+    /**
+     * @brief Called in GUI thread when a worker task has finished.
+     * @param generation folder generation of the task
+     * @param row row of the image
+     * @param key image key
+     * @param thumbnail thumbnail, null if skipped or failed
+     * @param skipped whether the task was skipped
+     */
+    void onThumbnailLoaded(int generation, int row, QString key, QImage thumbnail, bool skipped);
+};
+
+#endif // IMAGETHUMBNAILMODEL_H
@@ -117,28 +117,37 @@ MainWindow::MainWindow(Camera* cameraPtr, Config* configPtr, DataManager* dataMa
  */
 void MainWindow::updateWebcamFrame()
 {
+    CameraFrame cameraFrame;
     cv::Mat frame;
-    int availableFrameTime = 1000/24;   // ms per frame
-    qint64 frameStartTime;
-    qint64 frameEndTime;
-    int frameTimeLeft;
+    quint64 frameSequence = 0;
+    const qint64 minFrameIntervalUs = 1000000 / 24;
+    qint64 nextDueUs = 0;
     while (m_showCameraVideo)
     {
-        frameStartTime = QDateTime::currentMSecsSinceEpoch();
+        // sleeps until the camera delivers the next frame
+        cameraFrame = m_camera->waitNextFrame(frameSequence);
+        if (cameraFrame.empty())
+        {
+            continue;
+        }
+        // keep camera view at ~24 fps, emitting signals faster would flood the event loop.
+        // Frames are due on a fixed schedule, so a 30 fps camera isn't cut to every second frame
+        const qint64 timestampUs = cameraFrame.timestampUs();
+        if (timestampUs < nextDueUs)
+        {
+            continue;
+        }
+        nextDueUs += minFrameIntervalUs;
+        if (nextDueUs <= timestampUs)
+        {
+            // first frame or the camera stalled, restart the schedule instead of catching up
+            nextDueUs = timestampUs + minFrameIntervalUs;
+        }
 
-        m_webcamFrame = m_camera->getWebcamFrame();
-        cv::cvtColor(m_webcamFrame, frame, CV_BGR2RGB);
+        m_webcamFrame = cameraFrame.bgr();
+        frame = cameraFrame.rgb();
         m_cameraViewImage = QImage((uchar*)frame.data, frame.cols, frame.rows, frame.step, QImage::Format_RGB888);
         emit updatePixmap(m_cameraViewImage);
-
-        frameEndTime = QDateTime::currentMSecsSinceEpoch();
-        frameTimeLeft = availableFrameTime - (frameEndTime - frameStartTime);
-        // Sleep to keep frame rate of camera view ~constant,
-        // but more importantly if not sleeping then emitting signals too fast
-        if (frameTimeLeft > 0) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(frameTimeLeft));
-        }
-        std::this_thread::yield();
     }
 }
 
@@ -393,13 +402,25 @@ void MainWindow::addOutputText(QString msg)
 void MainWindow::on_sliderNoise_sliderMoved(int position)
 {
     ui->lineNoise->setText(QString::number(position));
-    m_actualDetector->setNoiseLevel(position);
+}
+
+/*
+ * Settings are saved when the slider is released, saving on every move would
+ * write the configuration file and publish a new snapshot many times a second
+ */
+void MainWindow::on_sliderNoise_sliderReleased()
+{
+    m_config->setNoiseFilterPixelSize(ui->sliderNoise->value());
 }
 
 void MainWindow::on_sliderThresh_sliderMoved(int position)
 {
     ui->lineThresh->setText(QString::number(position));
-    m_actualDetector->setThresholdLevel(position);
+}
+
+void MainWindow::on_sliderThresh_sliderReleased()
+{
+    m_config->setMotionThreshold(ui->sliderThresh->value());
 }
 
 void MainWindow::on_settingsButton_clicked()
@@ -426,8 +447,8 @@ void MainWindow::on_startButton_clicked()
 
         disconnect(this,SIGNAL(updatePixmap(QImage)),this,SLOT(displayPixmap(QImage)));
 
-        m_actualDetector->setNoiseLevel(ui->sliderNoise->value());
-        m_actualDetector->setThresholdLevel(ui->sliderThresh->value());
+        m_config->setNoiseFilterPixelSize(ui->sliderNoise->value());
+        m_config->setMotionThreshold(ui->sliderThresh->value());
 
         if(m_actualDetector->start())
         {
@@ -146,6 +146,7 @@ private slots:
     void on_checkBoxDisplayWebcam_stateChanged(int arg1);
     void on_buttonClear_clicked();
     void on_sliderNoise_sliderMoved(int position);
+    void on_sliderNoise_sliderReleased();
     void on_settingsButton_clicked();
     void on_recordingTestButton_clicked();
     void onVideoPlayClicked();
@@ -168,6 +169,7 @@ private slots:
 
     void on_buttonImageExpl_clicked();
     void on_sliderThresh_sliderMoved(int position);
+    void on_sliderThresh_sliderReleased();
     void on_toolButtonNoise_clicked();
     void on_toolButtonThresh_clicked();
 
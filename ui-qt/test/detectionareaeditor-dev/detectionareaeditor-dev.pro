@@ -19,10 +19,13 @@ include(../../../ufo-detector-engine/opencv.pri)
 SOURCES += ./main.cpp\
     ./mainwindow.cpp \
     ../../../ufo-detector-engine/config.cpp \
+    ../../../ufo-detector-engine/configsnapshot.cpp \
     ../../../ufo-detector-engine/datamanager.cpp \
     ../../graphicsscene.cpp \
     ../../detectionareaeditdialog.cpp \
     ../../../ufo-detector-engine/camera.cpp \
+    ../../../ufo-detector-engine/cameraframe.cpp \
+    ../../../ufo-detector-engine/metrics.cpp \
     ../../../ufo-detector-engine/camerainfo.cpp \
     ../../../ufo-detector-engine/videocodecsupportinfo.cpp \
     ../../polygonnode.cpp \
@@ -30,10 +33,13 @@ SOURCES += ./main.cpp\
 
 HEADERS  += ./mainwindow.h \
     ../../../ufo-detector-engine/config.h \
+    ../../../ufo-detector-engine/configsnapshot.h \
     ../../../ufo-detector-engine/datamanager.h \
     ../../graphicsscene.h \
     ../../detectionareaeditdialog.h \
     ../../../ufo-detector-engine/camera.h \
+    ../../../ufo-detector-engine/cameraframe.h \
+    ../../../ufo-detector-engine/metrics.h \
     ../../../ufo-detector-engine/camerainfo.h \
     ../../../ufo-detector-engine/videocodecsupportinfo.h \
     ../../polygonnode.h \